@@ -0,0 +1,1522 @@
+// sobel_bench.cpp
+// ------------------------------------------------------------
+// Benchmark of every Sobel implementation in the tree:
+//
+//   2D  naive at<> loop (Version 3), quadrant threads (Version 5/6),
+//       row kernels single-threaded and on the pool, per SIMD level,
+//       per magnitude / orientation mode, int16 kernels per magnitude
+//       mode, template vs SIMD Sobel3 rows, Scharr3 / Sobel5 / Sobel7
+//   3D  naive 27-tap loop (Version 7), separable, rolling window,
+//       rolling window fused with normalization, per SIMD level,
+//       int16 rolling window per magnitude mode, Scharr3 / Sobel5 /
+//       Sobel7 windows
+//
+// on synthetic frames (and real ones with --video) at 480p, 1080p
+// and 4K. Reports Mpixel/s, ns/pixel, per-stage timings of the video
+// loop and thread scaling curves.
+//
+// --check instead compares every optimized path with the reference
+// loops and the throughput with a per-machine baseline (see the
+// Regression check section); the exit code is 1 on any failure.
+//
+//   sobel_bench [--sizes 480p,1080p,4k] [--video FILE]
+//               [--min-time SEC] [--csv]
+//   sobel_bench --check [--input FILE]... [--baseline FILE]
+//               [--save-baseline] [--tolerance F] [--min-time SEC]
+// ------------------------------------------------------------
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "kernel_family.hpp"
+#include "normalize.hpp"
+#include "ocl_backend.hpp"
+#include "pyramid.hpp"
+#include "simd.hpp"
+#include "simd_kernels.hpp"
+#include "sobel.hpp"
+#include "sobel2d.hpp"
+#include "sobel3d.hpp"
+#include "thread_pool.hpp"
+
+// ------------------------------------------------------------
+// Settings
+// ------------------------------------------------------------
+struct BenchSize {
+    const char* name;
+    int width, height;
+};
+
+static const BenchSize kSizes[] = {
+    { "480p",   640,  480 },
+    { "1080p", 1920, 1080 },
+    { "4k",    3840, 2160 }
+};
+
+struct BenchConfig {
+    std::vector<BenchSize> sizes;
+    std::string videoPath;          // "" = synthetic frames only
+    double minSeconds = 0.3;        // per measurement
+    bool csv = false;
+
+    // --check
+    bool check = false;
+    std::vector<std::string> checkInputs;   // empty = the pictures of the repo
+    std::string baselinePath;               // "" = bench/baselines/<host>.txt
+    bool saveBaseline = false;
+    double tolerance = -1.0;                // allowed drop, -1 = the baseline's (15%)
+};
+
+// Same weights as SOBEL_KX/KY, but a different address, so
+// SobelWorker takes the generic at<> path of the archived versions
+static const int kNaiveKx[3][3] = { {-1, 0, +1}, {-2, 0, +2}, {-1, 0, +1} };
+static const int kNaiveKy[3][3] = { {-1, -2, -1}, { 0, 0, 0}, {+1, +2, +1} };
+
+// ------------------------------------------------------------
+// Timing
+// ------------------------------------------------------------
+
+// Seconds per call: one warm-up call, then repeat until minSeconds
+static double time_per_call(double minSeconds, const std::function<void()>& fn) {
+    using clock = std::chrono::steady_clock;
+
+    fn();
+
+    int calls = 0;
+    const clock::time_point t0 = clock::now();
+    double elapsed = 0.0;
+    do {
+        fn();
+        calls++;
+        elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+    } while (elapsed < minSeconds);
+
+    return elapsed / calls;
+}
+
+static void report(const BenchConfig& cfg, const std::string& group, const std::string& name,
+                   const std::string& size, long long pixels, double sec) {
+    const double mpxs = pixels / sec * 1e-6;
+    const double nspx = sec * 1e9 / pixels;
+
+    if (cfg.csv) {
+        std::cout << group << "," << name << "," << size << ","
+                  << mpxs << "," << nspx << "," << sec * 1e3 << "\n";
+        return;
+    }
+
+    std::cout << "  " << std::left << std::setw(34) << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << mpxs << " Mpx/s"
+              << std::setprecision(2) << std::setw(10) << nspx << " ns/px"
+              << std::setprecision(3) << std::setw(11) << sec * 1e3 << " ms\n";
+}
+
+static void heading(const BenchConfig& cfg, const std::string& text) {
+    if (!cfg.csv)
+        std::cout << "\n" << text << "\n";
+}
+
+// ------------------------------------------------------------
+// Frames
+// ------------------------------------------------------------
+
+// Textured frame with a per-frame shift, so 3D sees motion
+static void synthetic_frame(const cv::Size& size, int t, cv::Mat& bgr) {
+    bgr.create(size, CV_8UC3);
+    unsigned h = 2166136261u;
+    for (int y = 0; y < size.height; y++) {
+        uint8_t* row = bgr.ptr<uint8_t>(y);
+        for (int x = 0; x < size.width; x++) {
+            h = h * 1103515245u + 12345u;
+            const int xs = x + 3 * t;
+            const int v = ((xs / 16 + y / 16) & 1) * 128 + ((xs * y) >> 7) % 64 + static_cast<int>((h >> 16) & 31);
+            row[3 * x + 0] = static_cast<uint8_t>(v);
+            row[3 * x + 1] = static_cast<uint8_t>(v + 17);
+            row[3 * x + 2] = static_cast<uint8_t>(v + 41);
+        }
+    }
+}
+
+// First 3 frames of the video, resized; false if unreadable
+static bool video_frames(const std::string& path, const cv::Size& size, cv::Mat bgr[3]) {
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened())
+        return false;
+    for (int i = 0; i < 3; i++) {
+        cv::Mat f;
+        cap >> f;
+        if (f.empty())
+            return false;
+        cv::resize(f, bgr[i], size);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// SIMD levels this CPU/build can run
+// ------------------------------------------------------------
+static std::vector<SimdLevel> supported_levels() {
+    const SimdLevel all[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON };
+    const SimdLevel active = simd_active();
+
+    std::vector<SimdLevel> levels;
+    for (SimdLevel l : all)
+        if (simd_set_level(l))
+            levels.push_back(l);
+
+    simd_set_level(active);
+    return levels;
+}
+
+// ------------------------------------------------------------
+// Kernels
+// ------------------------------------------------------------
+static void bench_2d(const BenchConfig& cfg, const std::string& tag, const cv::Mat& gray, ThreadPool& pool) {
+    const long long pixels = static_cast<long long>(gray.total());
+    cv::Mat gx, gy, mag, theta;
+
+    heading(cfg, "2D Sobel, " + tag);
+
+    // Version 3: one thread, at<> loop
+    gx = cv::Mat(gray.size(), CV_32F, cv::Scalar(0));
+    gy = gx.clone(); mag = gx.clone(); theta = gx.clone();
+    report(cfg, "2d", "naive at<>", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        SobelTask task = { &gray, &gx, &gy, &mag, &theta,
+                           0, gray.cols, 0, gray.rows, kNaiveKx, kNaiveKy };
+        SobelWorker(task);
+    }));
+
+    // Version 5/6: 4 threads per frame, one per quadrant
+    report(cfg, "2d", "quadrant threads (4)", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        const int midX = gray.cols / 2, midY = gray.rows / 2;
+        SobelTask tasks[4] = {
+            { &gray, &gx, &gy, &mag, &theta, 0,    midX,      0,    midY,      kNaiveKx, kNaiveKy },
+            { &gray, &gx, &gy, &mag, &theta, midX, gray.cols, 0,    midY,      kNaiveKx, kNaiveKy },
+            { &gray, &gx, &gy, &mag, &theta, 0,    midX,      midY, gray.rows, kNaiveKx, kNaiveKy },
+            { &gray, &gx, &gy, &mag, &theta, midX, gray.cols, midY, gray.rows, kNaiveKx, kNaiveKy }
+        };
+        std::thread threads[4];
+        for (int i = 0; i < 4; i++)
+            threads[i] = std::thread(SobelWorker, std::cref(tasks[i]));
+        for (std::thread& t : threads)
+            t.join();
+    }));
+
+    // Row kernels per SIMD level, 1 thread and the pool
+    const SimdLevel active = simd_active();
+    for (SimdLevel l : supported_levels()) {
+        simd_set_level(l);
+        const std::string name = std::string("row kernels ") + simd_name(l);
+
+        report(cfg, "2d", name + " 1T", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(nullptr, gray, gx, gy, mag, theta);
+        }));
+        report(cfg, "2d", name + " pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(&pool, gray, gx, gy, mag, theta);
+        }));
+        report(cfg, "2d", name + " pool, mag only", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(&pool, gray, gx, gy, mag, theta, OUT_MAG);
+        }));
+
+        // Cheaper magnitude (mag only) / orientation (every product)
+        cv::Mat thetaFast;
+        const MagMode mags[] = { MagMode::L1, MagMode::AMax };
+        for (MagMode m : mags) {
+            GradientMode grad;
+            grad.mag = m;
+            report(cfg, "2d", name + " pool, mag only " + mag_mode_name(m), tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel2d(&pool, gray, gx, gy, mag, thetaFast, OUT_MAG, grad);
+            }));
+        }
+        const ThetaMode thetas[] = { ThetaMode::Poly, ThetaMode::Bins4, ThetaMode::Bins8, ThetaMode::Bins16 };
+        for (ThetaMode th : thetas) {
+            GradientMode grad;
+            grad.theta = th;
+            report(cfg, "2d", name + " pool, theta " + theta_mode_name(th), tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel2d(&pool, gray, gx, gy, mag, thetaFast, OUT_GX | OUT_GY | OUT_MAG | OUT_THETA, grad);
+            }));
+        }
+
+        // Full frame from padded rows instead of the zero border
+        const BorderMode borders[] = { BorderMode::Replicate, BorderMode::Reflect, BorderMode::Constant };
+        for (BorderMode b : borders) {
+            GradientMode grad;
+            grad.border = b;
+            report(cfg, "2d", name + " pool, border " + border_mode_name(b), tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel2d(&pool, gray, gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG | OUT_THETA, grad);
+            }));
+        }
+
+        // Integer gradients, Gx/Gy/magnitude (no theta)
+        cv::Mat gx16, gy16, mag16;
+        for (int m = 0; m < MAG_MODE_COUNT; m++) {
+            GradientMode grad;
+            grad.precision = Precision::Int16;
+            grad.mag = static_cast<MagMode>(m);
+
+            report(cfg, "2d", name + " int16 " + mag_mode_name(grad.mag) + " pool", tag, pixels,
+                   time_per_call(cfg.minSeconds, [&] {
+                sobel2d(&pool, gray, gx16, gy16, mag16, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+            }));
+        }
+    }
+    simd_set_level(active);
+
+    // Kernel family (kernel_family.hpp): the template Sobel3 against
+    // the hand-written SIMD rows, same level, 1 thread, inside the
+    // zero border
+    const Family2DKernels& family = kernel_family_2d(KernelType::Sobel3);
+    std::vector<int16_t> vs(gray.cols + 2), vd(gray.cols + 2);
+    report(cfg, "2d", std::string("sobel3 template ") + simd_name(active) + " rows 1T", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        for (int y = 1; y < gray.rows - 1; y++) {
+            const uint8_t* rows[3] = { gray.ptr<uint8_t>(y - 1), gray.ptr<uint8_t>(y), gray.ptr<uint8_t>(y + 1) };
+            family.f32[0][K2D_GXGY | K2D_MAG](rows, vs.data() + 1, vd.data() + 1,
+                                              gx.ptr<float>(y), gy.ptr<float>(y), mag.ptr<float>(y), 1, gray.cols - 1);
+        }
+    }));
+    const Sobel2DFn simdRow = sobel_kernels().sobel2d[0][K2D_GXGY | K2D_MAG];
+    report(cfg, "2d", std::string("sobel3 ") + simd_name(active) + " rows 1T", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        for (int y = 1; y < gray.rows - 1; y++)
+            simdRow(gray.ptr<uint8_t>(y - 1), gray.ptr<uint8_t>(y), gray.ptr<uint8_t>(y + 1),
+                    gx.ptr<float>(y), gy.ptr<float>(y), mag.ptr<float>(y), 1, gray.cols - 1);
+    }));
+
+    // Wider apertures, Gx/Gy/magnitude, float and int16
+    const KernelType kernels[] = { KernelType::Scharr3, KernelType::Sobel5, KernelType::Sobel7 };
+    cv::Mat gx16, gy16, mag16;
+    for (KernelType k : kernels) {
+        GradientMode grad;
+        grad.kernel = k;
+        const std::string name = std::string("kernel ") + kernel_type_name(k);
+
+        report(cfg, "2d", name + " 1T", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(nullptr, gray, gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+        }));
+        report(cfg, "2d", name + " pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(&pool, gray, gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+        }));
+        if (!kernel_fits_int16(k))
+            continue;
+        grad.precision = Precision::Int16;
+        report(cfg, "2d", name + " int16 pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel2d(&pool, gray, gx16, gy16, mag16, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+        }));
+    }
+}
+
+static void bench_3d(const BenchConfig& cfg, const std::string& tag, const cv::Mat gray[3], ThreadPool& pool) {
+    const long long pixels = static_cast<long long>(gray[1].total());
+    cv::Mat gt, mag3d, gtBgr, magBgr;
+
+    heading(cfg, "3D Sobel, " + tag);
+
+    // Version 7: one thread, 27-tap loop
+    report(cfg, "3d", "naive 27-tap", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel3d_reference(gray[0], gray[1], gray[2], gt, mag3d);
+    }));
+
+    const SimdLevel active = simd_active();
+    for (SimdLevel l : supported_levels()) {
+        simd_set_level(l);
+        const std::string name = simd_name(l);
+
+        // Three spatial passes + temporal pass, no reuse
+        Sobel3DEngine single;
+        sobel3d_reserve(single, gray[1].size());
+        report(cfg, "3d", "separable " + name + " 1T", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel3d_separable(single, gray[0], gray[1], gray[2], gt, mag3d);
+        }));
+
+        // Steady state of the video loop: one spatial pass per frame
+        Sobel3DEngine engine;
+        engine.pool = &pool;
+        sobel3d_reserve(engine, gray[1].size());
+        sobel3d_push(engine, gray[0]);
+        sobel3d_push(engine, gray[1]);
+        int t = 2;
+
+        report(cfg, "3d", "rolling " + name + " pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel3d_push(engine, gray[t++ % 3]);
+            sobel3d_compute(engine, gt, mag3d);
+        }));
+        report(cfg, "3d", "rolling+bgr " + name + " pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel3d_push(engine, gray[t++ % 3]);
+            sobel3d_compute_bgr(engine, NormMode::MinMax, gtBgr, magBgr);
+        }));
+        report(cfg, "3d", "rolling+bgr prev-range " + name + " pool", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+            sobel3d_push(engine, gray[t++ % 3]);
+            sobel3d_compute_bgr(engine, NormMode::PrevFrame, gtBgr, magBgr);
+        }));
+        for (NormMode nm : { NormMode::Fixed, NormMode::Ema, NormMode::Percentile }) {
+            sobel3d_reset(engine);
+            sobel3d_push(engine, gray[t++ % 3]);
+            sobel3d_push(engine, gray[t++ % 3]);
+            report(cfg, "3d", std::string("rolling+bgr ") + norm_mode_name(nm) + " " + name + " pool", tag, pixels,
+                   time_per_call(cfg.minSeconds, [&] {
+                sobel3d_push(engine, gray[t++ % 3]);
+                sobel3d_compute_bgr(engine, nm, gtBgr, magBgr);
+            }));
+        }
+
+        // Full frame, padded rows
+        for (BorderMode b : { BorderMode::Replicate, BorderMode::Reflect, BorderMode::Constant }) {
+            Sobel3DEngine eb;
+            eb.pool = &pool;
+            eb.grad.border = b;
+            sobel3d_reserve(eb, gray[1].size());
+            sobel3d_push(eb, gray[0]);
+            sobel3d_push(eb, gray[1]);
+
+            report(cfg, "3d", "rolling border " + std::string(border_mode_name(b)) + " " + name + " pool",
+                   tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel3d_push(eb, gray[t++ % 3]);
+                sobel3d_compute(eb, gt, mag3d);
+            }));
+        }
+
+        // Motion gate on a still scene (every tile static) and an ROI
+        // of a quarter of the frame
+        for (int g = 0; g < 2; g++) {
+            Sobel3DEngine eg;
+            eg.pool = &pool;
+            if (g == 0)
+                eg.gate.threshold = 2.0f;
+            else
+                eg.gate.rois.push_back(cv::Rect(0, 0, gray[1].cols / 2, gray[1].rows / 2));
+            sobel3d_reserve(eg, gray[1].size());
+            const cv::Mat& still = gray[1];
+            sobel3d_push(eg, g == 0 ? still : gray[0]);
+            sobel3d_push(eg, g == 0 ? still : gray[1]);
+
+            report(cfg, "3d", std::string(g == 0 ? "rolling motion, still " : "rolling roi 1/4 ") + name + " pool",
+                   tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel3d_push(eg, g == 0 ? still : gray[t++ % 3]);
+                sobel3d_compute(eg, gt, mag3d);
+            }));
+        }
+
+        // Same window with integer gt / mag3d
+        for (int m = 0; m < MAG_MODE_COUNT; m++) {
+            Sobel3DEngine e16;
+            e16.pool = &pool;
+            e16.grad.precision = Precision::Int16;
+            e16.grad.mag = static_cast<MagMode>(m);
+            sobel3d_reserve(e16, gray[1].size());
+            sobel3d_push(e16, gray[0]);
+            sobel3d_push(e16, gray[1]);
+
+            report(cfg, "3d", "rolling int16 " + std::string(mag_mode_name(e16.grad.mag)) + " " + name + " pool",
+                   tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel3d_push(e16, gray[t++ % 3]);
+                sobel3d_compute(e16, gt, mag3d);
+            }));
+        }
+
+        // Wider kernels: a ring of 2R + 1 frames, float planes
+        for (KernelType k : { KernelType::Scharr3, KernelType::Sobel5, KernelType::Sobel7 }) {
+            Sobel3DEngine ek;
+            ek.pool = &pool;
+            ek.grad.kernel = k;
+            sobel3d_reserve(ek, gray[1].size());
+            for (int i = 0; i < 2 * kernel_radius(k); i++)
+                sobel3d_push(ek, gray[t++ % 3]);
+
+            report(cfg, "3d", "rolling " + std::string(kernel_type_name(k)) + " " + name + " pool",
+                   tag, pixels, time_per_call(cfg.minSeconds, [&] {
+                sobel3d_push(ek, gray[t++ % 3]);
+                sobel3d_compute(ek, gt, mag3d);
+            }));
+        }
+    }
+    simd_set_level(active);
+}
+
+// ------------------------------------------------------------
+// Per-stage timings of one video frame (best SIMD level, pool)
+// ------------------------------------------------------------
+static void bench_stages(const BenchConfig& cfg, const std::string& tag, const cv::Mat bgr[3], ThreadPool& pool) {
+    const long long pixels = static_cast<long long>(bgr[1].total());
+    cv::Mat gray[3], gx, gy, mag, theta, planeBgr, gtBgr, magBgr;
+    for (int i = 0; i < 3; i++)
+        cv::cvtColor(bgr[i], gray[i], cv::COLOR_BGR2GRAY);
+
+    heading(cfg, "Stages per frame, " + tag);
+
+    report(cfg, "stage", "cvtColor BGR2GRAY", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        cv::cvtColor(bgr[1], gray[1], cv::COLOR_BGR2GRAY);
+    }));
+
+    // 2D: gradient, then normalize + BGR of the magnitude
+    report(cfg, "stage", "2d gradient (gx,gy,mag,theta)", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel2d(&pool, gray[1], gx, gy, mag, theta);
+    }));
+    report(cfg, "stage", "2d cvtColor + gradient", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        cv::cvtColor(bgr[1], gray[1], cv::COLOR_BGR2GRAY);
+        sobel2d(&pool, gray[1], gx, gy, mag, theta);
+    }));
+    report(cfg, "stage", "2d fused bgr gradient", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel2d(&pool, bgr[1], gx, gy, mag, theta);
+    }));
+    report(cfg, "stage", "2d normalize + bgr (1 plane)", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        plane_to_bgr(&pool, mag, false, range_of_plane(&pool, mag, false), planeBgr);
+    }));
+
+    // --pyramid: one decimation pass, then the kernels on the small frame
+    cv::Mat level;
+    for (int l = 1; l <= 2; l++) {
+        report(cfg, "stage", "pyramid level " + std::to_string(l) + " decimation", tag, pixels,
+               time_per_call(cfg.minSeconds, [&] {
+            pyramid_down(bgr[1], l, level, &pool);
+        }));
+        report(cfg, "stage", "pyramid level " + std::to_string(l) + " + 2d gradient", tag, pixels,
+               time_per_call(cfg.minSeconds, [&] {
+            pyramid_down(bgr[1], l, level, &pool);
+            sobel2d(&pool, level, gx, gy, mag, theta);
+        }));
+    }
+
+    // 3D: spatial pass on the new frame, then temporal + normalize
+    Sobel3DEngine engine;
+    engine.pool = &pool;
+    sobel3d_reserve(engine, gray[1].size());
+    for (int i = 0; i < 3; i++)
+        sobel3d_push(engine, gray[i]);
+
+    int t = 0;
+    report(cfg, "stage", "3d spatial pass (push)", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel3d_push(engine, gray[t++ % 3]);
+    }));
+    report(cfg, "stage", "3d cvtColor + spatial pass", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        cv::cvtColor(bgr[t % 3], gray[t % 3], cv::COLOR_BGR2GRAY);
+        sobel3d_push(engine, gray[t++ % 3]);
+    }));
+    report(cfg, "stage", "3d fused bgr spatial pass", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel3d_push(engine, bgr[t++ % 3]);
+    }));
+    report(cfg, "stage", "3d temporal + normalize + bgr", tag, pixels, time_per_call(cfg.minSeconds, [&] {
+        sobel3d_compute_bgr(engine, NormMode::MinMax, gtBgr, magBgr);
+    }));
+}
+
+// ------------------------------------------------------------
+// Thread scaling: 1, 2, 4, ... cores (and the core count itself)
+// ------------------------------------------------------------
+static void bench_scaling(const BenchConfig& cfg, const std::string& tag, const cv::Mat gray[3]) {
+    const long long pixels = static_cast<long long>(gray[1].total());
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<int> counts;
+    for (int n = 1; n < cores; n *= 2)
+        counts.push_back(n);
+    counts.push_back(cores);
+
+    heading(cfg, "Thread scaling, " + tag + " (" + simd_name(simd_active()) + ")");
+
+    double base2d = 0.0, base3d = 0.0;
+    for (int n : counts) {
+        ThreadPool pool(n);
+        cv::Mat gx, gy, mag, theta, gtBgr, magBgr;
+
+        const double s2d = time_per_call(cfg.minSeconds, [&] {
+            sobel2d(&pool, gray[1], gx, gy, mag, theta);
+        });
+
+        Sobel3DEngine engine;
+        engine.pool = &pool;
+        sobel3d_reserve(engine, gray[1].size());
+        sobel3d_push(engine, gray[0]);
+        sobel3d_push(engine, gray[1]);
+        int t = 2;
+        const double s3d = time_per_call(cfg.minSeconds, [&] {
+            sobel3d_push(engine, gray[t++ % 3]);
+            sobel3d_compute_bgr(engine, NormMode::MinMax, gtBgr, magBgr);
+        });
+
+        if (n == 1) {
+            base2d = s2d;
+            base3d = s3d;
+        }
+
+        const std::string threads = std::to_string(n) + "T";
+        report(cfg, "scaling", "2d row kernels " + threads, tag, pixels, s2d);
+        report(cfg, "scaling", "3d rolling+bgr " + threads, tag, pixels, s3d);
+
+        if (!cfg.csv)
+            std::cout << "    speedup: 2d " << std::setprecision(2) << base2d / s2d
+                      << "x, 3d " << base3d / s3d << "x\n";
+    }
+}
+
+// ------------------------------------------------------------
+// Regression check (--check)
+//
+// Every optimized path against the reference loops: the naive
+// SobelWorker at<> loop (2D, any border) and a 27-tap loop (3D,
+// checked first against sobel3d_reference; the wider kernels a
+// (2R+1)^3 one over a short clip), per SIMD level,
+// precision, magnitude / orientation mode, border and kernel, on
+// the pictures of the repo and randomized frames. Integer sums must
+// match exactly, the cheaper formulas must stay inside the bounds
+// documented in grad_modes.hpp. The embedding API (sobel.hpp) must
+// write the same planes into caller buffers with a padded stride,
+// and nothing past the rows.
+//
+// Then the main kernels are timed on 1080p frames against the
+// machine's baseline file (--baseline, default
+// bench/baselines/<host>.txt): a rate below baseline * (1 -
+// tolerance) fails. The file is written on the first run (or with
+// --save-baseline) and keeps its tolerance.
+// ------------------------------------------------------------
+#ifndef SOBEL_PICTURES_DIR
+#define SOBEL_PICTURES_DIR "pictures"
+#endif
+#ifndef SOBEL_BASELINE_DIR
+#define SOBEL_BASELINE_DIR "bench/baselines"
+#endif
+
+static const double kPi = 3.14159265358979323846;
+
+static const BorderMode kCheckBorders[] = {
+    BorderMode::Zero, BorderMode::Replicate, BorderMode::Reflect, BorderMode::Constant
+};
+
+struct CheckStats {
+    long long planes = 0;       // planes compared
+    long long failed = 0;       // planes with a pixel out of bounds
+};
+
+static double plane_at(const cv::Mat& m, int y, int x) {
+    switch (m.type()) {
+    case CV_16S: return m.at<int16_t>(y, x);
+    case CV_8U:  return m.at<uint8_t>(y, x);
+    default:     return m.at<float>(y, x);
+    }
+}
+
+// ok(y, x, v) for every pixel of got at least margin from the edges;
+// the first bad pixel of a plane is printed
+static void check_plane(CheckStats& st, const std::string& what, const cv::Mat& got, int margin,
+                        const std::function<bool(int, int, double)>& ok) {
+    st.planes++;
+    for (int y = margin; y < got.rows - margin; y++) {
+        for (int x = margin; x < got.cols - margin; x++) {
+            const double v = plane_at(got, y, x);
+            if (!ok(y, x, v)) {
+                st.failed++;
+                std::cout << "  FAIL " << what << " at (" << x << ", " << y << "): " << v << "\n";
+                return;
+            }
+        }
+    }
+}
+
+static double angle_diff(double a, double b) {
+    const double d = std::fabs(a - b);
+    return std::min(d, 2.0 * kPi - d);
+}
+
+// ThetaMode::BinsN of the reference angle; a gradient within 1e-4
+// sector of an edge may land on either side
+static bool bin_ok(double v, double theta, int bins) {
+    const double s = theta / (2.0 * kPi / bins) + 0.5;
+    const double k = std::floor(s);
+    const int want = (static_cast<int>(k) % bins + bins) % bins;
+    const double frac = s - k;
+    return static_cast<int>(v) == want || frac < 1e-4 || frac > 1.0 - 1e-4;
+}
+
+// Magnitude of MagMode from exact components, as documented in
+// grad_modes.hpp: exact sums (Exact, L1) or the AMax error bounds
+static bool mag_ok(MagMode m, Precision p, double v, const int* g, int dims) {
+    double sq = 0.0, l1 = 0.0;
+    for (int i = 0; i < dims; i++) {
+        sq += static_cast<double>(g[i]) * g[i];
+        l1 += std::abs(g[i]);
+    }
+    const bool s16 = p == Precision::Int16;
+
+    if (m == MagMode::L1 && s16)
+        return v == l1;
+    if (m == MagMode::L1) {
+        // Float adds in the kernels' order: the 3D sums of the wider
+        // kernels round past 2^24
+        float f = 0.0f;
+        for (int i = 0; i < dims; i++)
+            f += static_cast<float>(std::abs(g[i]));
+        return static_cast<float>(v) == f;
+    }
+    if (m == MagMode::Exact) {
+        // The kernels' own float formulas: sqrt(float(x^2 + y^2 ..))
+        // in int16, sqrt(fx fx + fy fy ..) in float
+        if (s16) {
+            long long isq = 0;
+            for (int i = 0; i < dims; i++)
+                isq += static_cast<long long>(g[i]) * g[i];
+            return v == std::lrintf(std::sqrt(static_cast<float>(isq)));
+        }
+        float f = 0.0f;
+        for (int i = 0; i < dims; i++)
+            f += static_cast<float>(g[i]) * static_cast<float>(g[i]);
+        return static_cast<float>(v) == std::sqrt(f);
+    }
+    const double e = std::sqrt(sq);
+    const double slack = s16 ? (dims == 2 ? 1.0 : 1.5) : 1e-3 + 1e-6 * e;
+    // max of a cos + b sin (+ c ..): sqrt(a^2 + b^2 (+ c^2))
+    const double hi = dims == 2 ? 1.04817 : 1.05980;
+    return v >= e * (1.0 - 0.0625) - slack && v <= e * hi + slack;
+}
+
+// ------------------------------------------------------------
+// References
+// ------------------------------------------------------------
+
+// Naive at<> loop (float gx / gy / exact magnitude / atan2) in border b
+static void reference_2d(const cv::Mat& gray, BorderMode b, cv::Mat out[4]) {
+    for (int i = 0; i < 4; i++)
+        out[i] = cv::Mat(gray.size(), CV_32F, cv::Scalar(0));
+    SobelTask task = { &gray, &out[0], &out[1], &out[2], &out[3],
+                       0, gray.cols, 0, gray.rows, kNaiveKx, kNaiveKy };
+    task.grad.border = b;
+    SobelWorker(task);
+}
+
+// Weights of the KernelType family (OpenCV getDerivKernels)
+static const int kFamilySmooth[KERNEL_TYPE_COUNT][7] = {
+    { 1, 2, 1 }, { 3, 10, 3 }, { 1, 4, 6, 4, 1 }, { 1, 6, 15, 20, 15, 6, 1 }
+};
+static const int kFamilyDeriv[KERNEL_TYPE_COUNT][7] = {
+    { -1, 0, 1 }, { -1, 0, 1 }, { -1, -2, 0, 2, 1 }, { -1, -4, -5, 0, 5, 4, 1 }
+};
+
+// Direct (2R+1)^2 convolution; false where Zero leaves the border 0
+static bool reference_family(const cv::Mat& gray, KernelType k, BorderMode b, int y, int x, int g[2]) {
+    const int r = kernel_radius(k), kk = static_cast<int>(k);
+    if (b == BorderMode::Zero && (y < r || y >= gray.rows - r || x < r || x >= gray.cols - r))
+        return false;
+
+    g[0] = g[1] = 0;
+    for (int j = 0; j <= 2 * r; j++) {
+        for (int i = 0; i <= 2 * r; i++) {
+            const int yy = y + j - r, xx = x + i - r;
+            const int ry = (yy < 0 || yy >= gray.rows) ? border_index(yy, gray.rows, b) : yy;
+            const int rx = (xx < 0 || xx >= gray.cols) ? border_index(xx, gray.cols, b) : xx;
+            const int p = (ry < 0 || rx < 0) ? 0 : gray.at<uint8_t>(ry, rx);
+            g[0] += kFamilyDeriv[kk][i] * kFamilySmooth[kk][j] * p;
+            g[1] += kFamilySmooth[kk][i] * kFamilyDeriv[kk][j] * p;
+        }
+    }
+    return true;
+}
+
+// 27-tap loop of curr (frames f[0..2]) in border b: Gx, Gy, Gt as
+// int planes (CV_32S); Zero leaves the x/y border 0
+static void reference_3d(const cv::Mat f[3], BorderMode b, cv::Mat g[3]) {
+    const int smooth[3] = { 1, 2, 1 };
+    const int deriv[3]  = { -1, 0, 1 };
+    const int rows = f[1].rows, cols = f[1].cols;
+    for (int i = 0; i < 3; i++)
+        g[i] = cv::Mat(f[1].size(), CV_32S, cv::Scalar(0));
+
+    const int m = b == BorderMode::Zero ? 1 : 0;
+    for (int y = m; y < rows - m; y++) {
+        for (int x = m; x < cols - m; x++) {
+            int s[3] = { 0, 0, 0 };
+            for (int dt = 0; dt < 3; dt++) {
+                for (int dy = 0; dy < 3; dy++) {
+                    for (int dx = 0; dx < 3; dx++) {
+                        const int yy = y + dy - 1, xx = x + dx - 1;
+                        const int ry = (yy < 0 || yy >= rows) ? border_index(yy, rows, b) : yy;
+                        const int rx = (xx < 0 || xx >= cols) ? border_index(xx, cols, b) : xx;
+                        const int p = (ry < 0 || rx < 0) ? 0 : f[dt].at<uint8_t>(ry, rx);
+                        s[0] += p * deriv[dx]  * smooth[dy] * smooth[dt];
+                        s[1] += p * smooth[dx] * deriv[dy]  * smooth[dt];
+                        s[2] += p * smooth[dx] * smooth[dy] * deriv[dt];
+                    }
+                }
+            }
+            for (int i = 0; i < 3; i++)
+                g[i].at<int32_t>(y, x) = s[i];
+        }
+    }
+}
+
+// Direct (2R+1)^3 convolution of frame t of the clip f (n frames) in
+// border b: Gx, Gy, Gt; false where Zero leaves the output 0 or gives
+// the frame none
+static bool reference_family_3d(const cv::Mat* f, int n, KernelType k, BorderMode b, int t, int y, int x, int g[3]) {
+    const int r = kernel_radius(k), kk = static_cast<int>(k);
+    const int rows = f[0].rows, cols = f[0].cols;
+    if (b == BorderMode::Zero && (t < r || t >= n - r))
+        return false;
+    g[0] = g[1] = g[2] = 0;
+    if (b == BorderMode::Zero && (y < r || y >= rows - r || x < r || x >= cols - r))
+        return true;
+
+    for (int dt = 0; dt <= 2 * r; dt++) {
+        const int rt = border_index(t + dt - r, n, b);
+        for (int dy = 0; dy <= 2 * r; dy++) {
+            const int ry = border_index(y + dy - r, rows, b);
+            for (int dx = 0; dx <= 2 * r; dx++) {
+                const int rx = border_index(x + dx - r, cols, b);
+                const int p = (rt < 0 || ry < 0 || rx < 0) ? 0 : f[rt].at<uint8_t>(ry, rx);
+                g[0] += p * kFamilyDeriv[kk][dx]  * kFamilySmooth[kk][dy] * kFamilySmooth[kk][dt];
+                g[1] += p * kFamilySmooth[kk][dx] * kFamilyDeriv[kk][dy]  * kFamilySmooth[kk][dt];
+                g[2] += p * kFamilySmooth[kk][dx] * kFamilySmooth[kk][dy] * kFamilyDeriv[kk][dt];
+            }
+        }
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Optimized paths against the references
+// ------------------------------------------------------------
+static void check_2d(CheckStats& st, const std::string& tag, const cv::Mat& bgr, ThreadPool& pool) {
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+    const cv::Mat* sources[2] = { &gray, &bgr };
+    const char* sourceNames[2] = { "gray", "bgr" };
+    const SimdLevel active = simd_active();
+
+    for (BorderMode border : kCheckBorders) {
+        cv::Mat ref[4];
+        reference_2d(gray, border, ref);
+        auto ref_g = [&](int y, int x, int g[2]) {
+            g[0] = static_cast<int>(ref[0].at<float>(y, x));
+            g[1] = static_cast<int>(ref[1].at<float>(y, x));
+        };
+
+        for (SimdLevel l : supported_levels()) {
+            simd_set_level(l);
+            for (int p = 0; p < 2; p++) {
+                for (int s = 0; s < 2; s++) {
+                    GradientMode grad;
+                    grad.border = border;
+                    grad.precision = static_cast<Precision>(p);
+                    const std::string base = tag + " 2d " + simd_name(l) + " " + precision_name(grad.precision) +
+                                             " " + border_mode_name(border) + " " + sourceNames[s];
+                    cv::Mat gx, gy, mag, theta;
+
+                    for (int m = 0; m < MAG_MODE_COUNT; m++) {
+                        grad.mag = static_cast<MagMode>(m);
+                        sobel2d(&pool, *sources[s], gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+                        const std::string what = base + " mag " + mag_mode_name(grad.mag);
+                        check_plane(st, what + " gx", gx, 0, [&](int y, int x, double v) { return v == ref[0].at<float>(y, x); });
+                        check_plane(st, what + " gy", gy, 0, [&](int y, int x, double v) { return v == ref[1].at<float>(y, x); });
+                        check_plane(st, what, mag, 0, [&](int y, int x, double v) {
+                            int g[2];
+                            ref_g(y, x, g);
+                            return mag_ok(grad.mag, grad.precision, v, g, 2);
+                        });
+                    }
+                    grad.mag = MagMode::Exact;
+
+                    const ThetaMode thetas[] = { ThetaMode::Exact, ThetaMode::Poly, ThetaMode::Bins4, ThetaMode::Bins8, ThetaMode::Bins16 };
+                    for (ThetaMode th : thetas) {
+                        grad.theta = th;
+                        sobel2d(&pool, *sources[s], gx, gy, mag, theta, OUT_THETA, grad);
+                        const int bins = theta_bin_count(th);
+                        check_plane(st, base + " theta " + theta_mode_name(th), theta, 0, [&](int y, int x, double v) {
+                            const double want = ref[3].at<float>(y, x);
+                            if (th == ThetaMode::Exact)
+                                return static_cast<float>(v) == static_cast<float>(want);
+                            if (th == ThetaMode::Poly)
+                                return angle_diff(v, want) <= 1.3e-5;
+                            return bin_ok(v, want, bins);
+                        });
+                    }
+                }
+            }
+        }
+        simd_set_level(active);
+
+        // Wider kernels, per SIMD level (kernel_family.hpp)
+        const KernelType kernels[] = { KernelType::Scharr3, KernelType::Sobel5, KernelType::Sobel7 };
+        for (SimdLevel l : supported_levels()) {
+            simd_set_level(l);
+            for (KernelType k : kernels) {
+                for (int p = 0; p < 2; p++) {
+                    GradientMode grad;
+                    grad.border = border;
+                    grad.kernel = k;
+                    grad.precision = static_cast<Precision>(p);
+                    if (!kernel_fits_int16(k) && grad.precision == Precision::Int16)
+                        continue;
+
+                    for (int m = 0; m < MAG_MODE_COUNT; m++) {
+                        grad.mag = static_cast<MagMode>(m);
+                        cv::Mat gx, gy, mag, theta;
+                        sobel2d(&pool, bgr, gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, grad);
+                        const std::string what = tag + " 2d " + kernel_type_name(k) + " " + simd_name(l) + " " +
+                                                 precision_name(grad.precision) + " " + border_mode_name(border) +
+                                                 " mag " + mag_mode_name(grad.mag);
+                        const cv::Mat* planes[3] = { &gx, &gy, &mag };
+                        const char* names[3] = { " gx", " gy", "" };
+                        for (int i = 0; i < 3; i++) {
+                            check_plane(st, what + names[i], *planes[i], 0, [&](int y, int x, double v) {
+                                int g[2];
+                                if (!reference_family(gray, k, border, y, x, g))
+                                    return v == 0.0;
+                                return i < 2 ? v == g[i] : mag_ok(grad.mag, grad.precision, v, g, 2);
+                            });
+                        }
+                    }
+                }
+            }
+        }
+        simd_set_level(active);
+
+        // The OpenCL kernel, when there is a device (float, exact magnitude)
+        OclSobel ocl;
+        GradientMode oclGrad;
+        oclGrad.border = border;
+        if (ocl_init(ocl, oclGrad, false)) {
+            cv::Mat o[4];
+            ocl_sobel2d(ocl, bgr, o[0], o[1], o[2], o[3], OUT_GX | OUT_GY | OUT_MAG | OUT_THETA);
+            const std::string what = tag + " 2d opencl " + border_mode_name(border);
+            check_plane(st, what + " gx", o[0], 0, [&](int y, int x, double v) { return v == ref[0].at<float>(y, x); });
+            check_plane(st, what + " gy", o[1], 0, [&](int y, int x, double v) { return v == ref[1].at<float>(y, x); });
+            check_plane(st, what + " mag", o[2], 0, [&](int y, int x, double v) {
+                return std::fabs(v - ref[2].at<float>(y, x)) <= 1e-5 * ref[2].at<float>(y, x) + 1e-4;
+            });
+            check_plane(st, what + " theta", o[3], 0, [&](int y, int x, double v) {
+                return angle_diff(v, ref[3].at<float>(y, x)) <= 1e-4;
+            });
+        }
+    }
+}
+
+static void check_3d(CheckStats& st, const std::string& tag, const cv::Mat bgr[3], ThreadPool& pool) {
+    cv::Mat gray[3];
+    for (int i = 0; i < 3; i++)
+        cv::cvtColor(bgr[i], gray[i], cv::COLOR_BGR2GRAY);
+
+    // The harness' own 27-tap loop against the one kept in sobel3d.cpp
+    cv::Mat refGt, refMag, ref[3];
+    sobel3d_reference(gray[0], gray[1], gray[2], refGt, refMag);
+    reference_3d(gray, BorderMode::Zero, ref);
+    check_plane(st, tag + " 3d reference gt", refGt, 0, [&](int y, int x, double v) { return v == ref[2].at<int32_t>(y, x); });
+    check_plane(st, tag + " 3d reference mag", refMag, 0, [&](int y, int x, double v) {
+        const int g[3] = { ref[0].at<int32_t>(y, x), ref[1].at<int32_t>(y, x), ref[2].at<int32_t>(y, x) };
+        return mag_ok(MagMode::Exact, Precision::Float32, v, g, 3);
+    });
+
+    const SimdLevel active = simd_active();
+    for (BorderMode border : kCheckBorders) {
+        reference_3d(gray, border, ref);
+
+        for (int u = 0; u < 2; u++) {
+            // u = 0: every SIMD level on the CPU; u = 1: OpenCL, if any
+            OclSobel ocl;
+            GradientMode oclGrad;
+            oclGrad.border = border;
+            if (u == 1 && !ocl_init(ocl, oclGrad, false))
+                break;
+            const std::vector<SimdLevel> levels = u == 0 ? supported_levels() : std::vector<SimdLevel>(1, active);
+
+            for (SimdLevel l : levels) {
+                simd_set_level(l);
+                for (int p = 0; p < (u == 0 ? 2 : 1); p++) {
+                    for (int m = 0; m < (u == 0 ? MAG_MODE_COUNT : 1); m++) {
+                        Sobel3DEngine e;
+                        e.pool = &pool;
+                        e.grad.border = border;
+                        e.grad.precision = static_cast<Precision>(p);
+                        e.grad.mag = static_cast<MagMode>(m);
+                        e.ocl = u == 1 ? &ocl : nullptr;
+                        sobel3d_reserve(e, gray[1].size());
+
+                        // The window of frame 1: BGR frames 0, 1 (the
+                        // border modes' output of frame 0), then 2
+                        cv::Mat gt, mag3d;
+                        sobel3d_push(e, bgr[0]);
+                        sobel3d_push(e, bgr[1]);
+                        if (sobel3d_ready(e))
+                            sobel3d_compute(e, gt, mag3d);
+                        sobel3d_push(e, bgr[2]);
+                        sobel3d_compute(e, gt, mag3d);
+
+                        const std::string what = tag + " 3d " + (u == 1 ? "opencl" : simd_name(l)) + " " +
+                                                 precision_name(e.grad.precision) + " " + border_mode_name(border) +
+                                                 " mag " + mag_mode_name(e.grad.mag);
+                        check_plane(st, what + " gt", gt, 0, [&](int y, int x, double v) { return v == ref[2].at<int32_t>(y, x); });
+                        check_plane(st, what, mag3d, 0, [&](int y, int x, double v) {
+                            const int g[3] = { ref[0].at<int32_t>(y, x), ref[1].at<int32_t>(y, x), ref[2].at<int32_t>(y, x) };
+                            if (u == 1) {
+                                const double e3 = std::sqrt(static_cast<double>(g[0]) * g[0] + static_cast<double>(g[1]) * g[1] +
+                                                            static_cast<double>(g[2]) * g[2]);
+                                return std::fabs(v - e3) <= 1e-5 * e3 + 1e-3;
+                            }
+                            return mag_ok(e.grad.mag, e.grad.precision, v, g, 3);
+                        });
+                    }
+                }
+            }
+        }
+        simd_set_level(active);
+    }
+
+    // Wider kernels: a crop of at most 64x48 and a clip of 2R + 2
+    // frames (the ring wraps once), against the direct sums
+    const cv::Rect crop(0, 0, std::min(bgr[0].cols, 64), std::min(bgr[0].rows, 48));
+    for (KernelType k : { KernelType::Scharr3, KernelType::Sobel5, KernelType::Sobel7 }) {
+        const int r = kernel_radius(k);
+        const int n = 2 * r + 2;
+        std::vector<cv::Mat> clip(n), clipGray(n);
+        for (int t = 0; t < n; t++) {
+            // Frames 3.. are flipped copies of 0 .. 2
+            const cv::Mat src = bgr[t % 3](crop);
+            if (t < 3)
+                clip[t] = src.clone();
+            else
+                cv::flip(src, clip[t], t < 6 ? 1 : 0);
+            cv::cvtColor(clip[t], clipGray[t], cv::COLOR_BGR2GRAY);
+        }
+
+        for (BorderMode border : kCheckBorders) {
+            for (SimdLevel l : supported_levels()) {
+                simd_set_level(l);
+                for (int m = 0; m < MAG_MODE_COUNT; m++) {
+                    Sobel3DEngine e;
+                    e.pool = &pool;
+                    e.grad.border = border;
+                    e.grad.mag = static_cast<MagMode>(m);
+                    e.grad.kernel = k;
+                    sobel3d_reserve(e, crop.size());
+
+                    const std::string what = tag + " 3d " + kernel_type_name(k) + " " + simd_name(l) + " " +
+                                             border_mode_name(border) + " mag " + mag_mode_name(e.grad.mag);
+                    // The window's curr is frame t once frame t + R is
+                    // pushed, past the end after each finish
+                    auto compare = [&](int t) {
+                        if (!sobel3d_ready(e))
+                            return;
+                        cv::Mat gt, mag3d;
+                        sobel3d_compute(e, gt, mag3d);
+                        const std::string at = what + " frame " + std::to_string(t);
+                        int g[3];
+                        check_plane(st, at + " gt", gt, 0, [&](int y, int x, double v) {
+                            return reference_family_3d(clipGray.data(), n, k, border, t, y, x, g) && v == g[2];
+                        });
+                        check_plane(st, at, mag3d, 0, [&](int y, int x, double v) {
+                            return reference_family_3d(clipGray.data(), n, k, border, t, y, x, g) &&
+                                   mag_ok(e.grad.mag, Precision::Float32, v, g, 3);
+                        });
+                    };
+                    for (int t = 0; t < n; t++) {
+                        sobel3d_push(e, clip[t]);
+                        compare(t - r);
+                    }
+                    for (int i = 1; i <= r; i++) {
+                        sobel3d_finish(e);
+                        compare(n - 1 - r + i);
+                    }
+                }
+            }
+            simd_set_level(active);
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// The embedding API (sobel.hpp) on caller buffers
+// ------------------------------------------------------------
+
+// Caller-owned buffer with a padded row stride, the padding and the
+// bytes past the last row filled with a sentinel
+static const uint8_t kSentinel = 0xA5;
+static const size_t kRowPad = 48;
+
+struct ApiBuffer {
+    std::vector<uint8_t> bytes;
+    size_t rowBytes = 0;
+    SobelPlane plane;
+};
+
+static void api_buffer(cv::Size size, size_t elem, ApiBuffer& b) {
+    b.rowBytes = static_cast<size_t>(size.width) * elem;
+    b.plane.stride = b.rowBytes + kRowPad;
+    b.plane.width = size.width;
+    b.plane.height = size.height;
+    b.bytes.assign(b.plane.stride * size.height + kRowPad, kSentinel);
+    b.plane.data = b.bytes.data();
+}
+
+// The plane rows against want, and every padding byte untouched
+static void check_api_plane(CheckStats& st, const std::string& what, const ApiBuffer& b, const cv::Mat& want) {
+    st.planes++;
+    for (int y = 0; y < b.plane.height; y++) {
+        const uint8_t* row = b.bytes.data() + y * b.plane.stride;
+        if (std::memcmp(row, want.ptr<uint8_t>(y), b.rowBytes) != 0) {
+            st.failed++;
+            std::cout << "  FAIL " << what << ": row " << y << " differs from sobel2d / sobel3d_compute\n";
+            return;
+        }
+    }
+    for (size_t i = 0; i < b.bytes.size(); i++) {
+        if (i % b.plane.stride >= b.rowBytes || i >= b.plane.stride * b.plane.height) {
+            if (b.bytes[i] != kSentinel) {
+                st.failed++;
+                std::cout << "  FAIL " << what << ": padding byte " << i << " overwritten\n";
+                return;
+            }
+        }
+    }
+}
+
+static void check_api(CheckStats& st, const std::string& tag, const cv::Mat bgr[3], ThreadPool& pool) {
+    const cv::Size size = bgr[0].size();
+
+    // The frames at a padded stride too
+    ApiBuffer in[3];
+    SobelImage frames[3];
+    for (int i = 0; i < 3; i++) {
+        api_buffer(size, 3, in[i]);
+        for (int y = 0; y < size.height; y++)
+            std::memcpy(in[i].bytes.data() + y * in[i].plane.stride, bgr[i].ptr<uint8_t>(y), in[i].rowBytes);
+        frames[i].data = in[i].bytes.data();
+        frames[i].stride = in[i].plane.stride;
+        frames[i].width = size.width;
+        frames[i].height = size.height;
+        frames[i].channels = 3;
+    }
+
+    for (BorderMode border : kCheckBorders) {
+        for (int p = 0; p < 2; p++) {
+            SobelConfig cfg;
+            cfg.width = size.width;
+            cfg.height = size.height;
+            cfg.pool = &pool;
+            cfg.grad.border = border;
+            cfg.grad.precision = static_cast<Precision>(p);
+            cfg.grad.theta = p == 0 ? ThetaMode::Exact : ThetaMode::Bins8;
+            const std::string base = tag + " api " + precision_name(cfg.grad.precision) + " " + border_mode_name(border);
+            const size_t elem = cfg.grad.precision == Precision::Int16 ? sizeof(int16_t) : sizeof(float);
+
+            SobelContext* ctx = sobel_create(cfg);
+            if (!ctx) {
+                st.planes++;
+                st.failed++;
+                std::cout << "  FAIL " << base << ": sobel_create\n";
+                continue;
+            }
+
+            // 2D: every plane, then each one alone
+            cv::Mat ref[4];
+            sobel2d(&pool, bgr[1], ref[0], ref[1], ref[2], ref[3], OUT_GX | OUT_GY | OUT_MAG | OUT_THETA, cfg.grad);
+            const char* names[4] = { " gx", " gy", " mag", " theta" };
+            for (int only = -1; only < 4; only++) {
+                ApiBuffer out[4];
+                const SobelPlane* planes[4] = { nullptr, nullptr, nullptr, nullptr };
+                for (int i = 0; i < 4; i++) {
+                    if (only >= 0 && i != only)
+                        continue;
+                    api_buffer(size, i == 3 ? ref[3].elemSize() : elem, out[i]);
+                    planes[i] = &out[i].plane;
+                }
+                const std::string what = base + " 2d" + (only < 0 ? "" : " only");
+                if (!sobel_2d(ctx, frames[1], planes[0], planes[1], planes[2], planes[3])) {
+                    st.planes++;
+                    st.failed++;
+                    std::cout << "  FAIL " << what << ": sobel_2d\n";
+                    continue;
+                }
+                for (int i = 0; i < 4; i++)
+                    if (planes[i])
+                        check_api_plane(st, what + names[i], out[i], ref[i]);
+            }
+
+            // 3D: the window of frame 1, as in check_3d
+            Sobel3DEngine e;
+            e.pool = &pool;
+            e.grad = cfg.grad;
+            sobel3d_reserve(e, size);
+            cv::Mat gt, mag3d;
+            sobel3d_push(e, bgr[0]);
+            sobel3d_push(e, bgr[1]);
+            if (sobel3d_ready(e))
+                sobel3d_compute(e, gt, mag3d);
+            sobel3d_push(e, bgr[2]);
+            sobel3d_compute(e, gt, mag3d);
+
+            for (int only = -1; only < 2; only++) {
+                ApiBuffer out[2];
+                api_buffer(size, elem, out[0]);
+                api_buffer(size, elem, out[1]);
+                const SobelPlane* gtP  = only != 1 ? &out[0].plane : nullptr;
+                const SobelPlane* magP = only != 0 ? &out[1].plane : nullptr;
+                const std::string what = base + " 3d" + (only < 0 ? "" : " only");
+
+                sobel_3d_reset(ctx);
+                bool ok = sobel_3d_push(ctx, frames[0]) && sobel_3d_push(ctx, frames[1]);
+                if (ok && sobel_3d_ready(ctx))
+                    ok = sobel_3d_compute(ctx, nullptr, nullptr);
+                ok = ok && sobel_3d_push(ctx, frames[2]) && sobel_3d_compute(ctx, gtP, magP);
+                if (!ok) {
+                    st.planes++;
+                    st.failed++;
+                    std::cout << "  FAIL " << what << ": sobel_3d_*\n";
+                    continue;
+                }
+                if (gtP)
+                    check_api_plane(st, what + " gt", out[0], gt);
+                if (magP)
+                    check_api_plane(st, what + " mag", out[1], mag3d);
+            }
+            sobel_destroy(ctx);
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// Frames of the check
+// ------------------------------------------------------------
+
+// src shifted right by dx pixels (wrapping), a stand-in next frame
+static void shifted_frame(const cv::Mat& src, int dx, cv::Mat& dst) {
+    dst.create(src.size(), src.type());
+    const int cn = src.channels();
+    for (int y = 0; y < src.rows; y++)
+        for (int x = 0; x < src.cols; x++)
+            std::memcpy(dst.ptr<uint8_t>(y) + cn * ((x + dx) % src.cols), src.ptr<uint8_t>(y) + cn * x, cn);
+}
+
+// First 3 frames of a video / GIF, or a still image and two shifted
+// copies; false if unreadable
+static bool check_frames(const std::string& path, cv::Mat bgr[3]) {
+    int n = 0;
+    cv::VideoCapture cap(path);
+    while (cap.isOpened() && n < 3) {
+        cv::Mat f;
+        cap >> f;
+        if (f.empty())
+            break;
+        if (f.channels() != 3)
+            cv::cvtColor(f, f, cv::COLOR_GRAY2BGR);
+        bgr[n++] = f.clone();
+    }
+    if (n == 0) {
+        bgr[0] = cv::imread(path, cv::IMREAD_COLOR);
+        if (bgr[0].empty())
+            return false;
+        n = 1;
+    }
+    for (; n < 3; n++)
+        shifted_frame(bgr[n - 1], 1, bgr[n]);
+    return true;
+}
+
+static void random_frame(cv::Size size, unsigned& seed, cv::Mat& bgr) {
+    bgr.create(size, CV_8UC3);
+    for (int y = 0; y < size.height; y++) {
+        uint8_t* row = bgr.ptr<uint8_t>(y);
+        for (int x = 0; x < 3 * size.width; x++) {
+            seed = seed * 1103515245u + 12345u;
+            row[x] = static_cast<uint8_t>(seed >> 16);
+        }
+    }
+    // Saturated patches reach the kernel bounds
+    for (int y = 0; y < size.height / 2; y++)
+        for (int x = 0; x < size.width / 3; x++)
+            std::memset(bgr.ptr<uint8_t>(y) + 3 * x, (x + y) % 2 ? 255 : 0, 3);
+}
+
+// ------------------------------------------------------------
+// Throughput against the machine's baseline
+// ------------------------------------------------------------
+static std::string host_name() {
+#ifdef _WIN32
+    const char* name = std::getenv("COMPUTERNAME");
+    return name ? name : "host";
+#else
+    char name[256] = "host";
+    gethostname(name, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    return name;
+#endif
+}
+
+// "name rate" lines (Mpx/s) and "tolerance T"
+static bool load_baseline(const std::string& path, std::vector<std::pair<std::string, double>>& rates, double& tolerance) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t sp = line.rfind(' ');
+        if (line.empty() || line[0] == '#' || sp == std::string::npos)
+            continue;
+        const std::string name = line.substr(0, sp);
+        const double value = std::atof(line.c_str() + sp + 1);
+        if (name == "tolerance")
+            tolerance = value;
+        else
+            rates.emplace_back(name, value);
+    }
+    return true;
+}
+
+static bool save_baseline(const std::string& path, const std::vector<std::pair<std::string, double>>& rates,
+                          double tolerance, const ThreadPool& pool) {
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, ec);
+
+    std::ofstream out(path);
+    out << "# sobel_bench --check baseline: " << host_name() << ", " << simd_name(simd_active()) << ", "
+        << pool.size() << " threads, Mpx/s at 1080p\n";
+    out << "tolerance " << tolerance << "\n";
+    for (const auto& r : rates)
+        out << r.first << " " << r.second << "\n";
+    return static_cast<bool>(out);
+}
+
+// false when a rate fell below its baseline
+static bool check_perf(const BenchConfig& cfg, ThreadPool& pool) {
+    const cv::Size size(1920, 1080);
+    const long long pixels = static_cast<long long>(size.area());
+    cv::Mat bgr[3], gray[3];
+    for (int i = 0; i < 3; i++) {
+        synthetic_frame(size, i, bgr[i]);
+        cv::cvtColor(bgr[i], gray[i], cv::COLOR_BGR2GRAY);
+    }
+
+    cv::Mat gx, gy, mag, theta, gt, mag3d;
+    GradientMode s16;
+    s16.precision = Precision::Int16;
+    GradientMode sobel5;
+    sobel5.kernel = KernelType::Sobel5;
+    Sobel3DEngine e32, e16;
+    Sobel3DEngine* engines[2] = { &e32, &e16 };
+    for (Sobel3DEngine* e : engines) {
+        e->pool = &pool;
+        e->grad.precision = e == &e16 ? Precision::Int16 : Precision::Float32;
+        sobel3d_reserve(*e, size);
+        sobel3d_push(*e, gray[0]);
+        sobel3d_push(*e, gray[1]);
+    }
+    int t = 2;
+
+    const std::pair<std::string, std::function<void()>> cases[] = {
+        { "2d float pool",        [&] { sobel2d(&pool, gray[1], gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG); } },
+        { "2d int16 pool",        [&] { sobel2d(&pool, gray[1], gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, s16); } },
+        { "2d fused bgr pool",    [&] { sobel2d(&pool, bgr[1], gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG); } },
+        { "2d theta exact pool",  [&] { sobel2d(&pool, gray[1], gx, gy, mag, theta); } },
+        { "2d sobel5 pool",       [&] { sobel2d(&pool, gray[1], gx, gy, mag, theta, OUT_GX | OUT_GY | OUT_MAG, sobel5); } },
+        { "3d rolling pool",      [&] { sobel3d_push(e32, gray[t++ % 3]); sobel3d_compute(e32, gt, mag3d); } },
+        { "3d rolling int16 pool", [&] { sobel3d_push(e16, gray[t++ % 3]); sobel3d_compute(e16, gt, mag3d); } }
+    };
+
+    // Best of 3 against scheduling noise
+    std::vector<std::pair<std::string, double>> rates;
+    for (const auto& c : cases) {
+        double best = 0.0;
+        for (int r = 0; r < 3; r++)
+            best = std::max(best, pixels / time_per_call(cfg.minSeconds, c.second) * 1e-6);
+        rates.emplace_back(c.first, best);
+    }
+
+    const std::string path = cfg.baselinePath.empty() ? std::string(SOBEL_BASELINE_DIR) + "/" + host_name() + ".txt"
+                                                      : cfg.baselinePath;
+    std::vector<std::pair<std::string, double>> base;
+    double tolerance = cfg.tolerance >= 0.0 ? cfg.tolerance : 0.15;
+    const bool haveBase = !cfg.saveBaseline && load_baseline(path, base, tolerance);
+    if (cfg.tolerance >= 0.0)
+        tolerance = cfg.tolerance;
+
+    bool ok = true;
+    std::cout << "\nThroughput, 1080p (" << simd_name(simd_active()) << ", " << pool.size() << " threads)\n";
+    for (const auto& r : rates) {
+        std::cout << "  " << std::left << std::setw(24) << r.first << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << r.second << " Mpx/s";
+        for (const auto& b : base) {
+            if (b.first != r.first)
+                continue;
+            const bool pass = r.second >= b.second * (1.0 - tolerance);
+            ok = ok && pass;
+            std::cout << "   baseline " << std::setw(8) << b.second << (pass ? "   ok" : "   FAIL: regressed");
+        }
+        std::cout << "\n";
+    }
+
+    if (!haveBase) {
+        if (!save_baseline(path, rates, tolerance, pool)) {
+            std::cout << "Could not write the baseline: " << path << "\n";
+            return false;
+        }
+        std::cout << "Baseline written to " << path << " (tolerance " << tolerance * 100.0 << "%)\n";
+    } else {
+        std::cout << "Baseline " << path << ", tolerance " << tolerance * 100.0 << "%\n";
+    }
+    return ok;
+}
+
+// 0 = every check passed
+static int run_check(const BenchConfig& cfg) {
+    ThreadPool pool;
+    CheckStats st;
+    std::cout << "sobel_bench --check: " << pool.size() << " threads, best SIMD " << simd_name(simd_detect()) << "\n";
+
+    std::vector<std::string> inputs = cfg.checkInputs;
+    if (inputs.empty()) {
+        const char* names[] = { "test.jpg", "silk_song.gif", "piplup.mp4" };
+        for (const char* n : names)
+            inputs.push_back(std::string(SOBEL_PICTURES_DIR) + "/" + n);
+    }
+
+    bool inputsOk = true;
+    for (const std::string& path : inputs) {
+        cv::Mat bgr[3];
+        if (!check_frames(path, bgr)) {
+            std::cout << "  FAIL could not read " << path << "\n";
+            inputsOk = false;
+            continue;
+        }
+        const std::string tag = std::filesystem::path(path).filename().string();
+        std::cout << tag << " (" << bgr[0].cols << "x" << bgr[0].rows << ")\n";
+        check_2d(st, tag, bgr[1], pool);
+        check_3d(st, tag, bgr, pool);
+        check_api(st, tag, bgr, pool);
+    }
+
+    // Randomized frames: tails of every vector width, 1-pixel frames
+    const cv::Size sizes[] = { {1, 1}, {2, 3}, {5, 2}, {7, 7}, {17, 9}, {33, 5}, {64, 4}, {131, 37} };
+    unsigned seed = 12345u;
+    for (const cv::Size& s : sizes) {
+        cv::Mat bgr[3];
+        for (int i = 0; i < 3; i++)
+            random_frame(s, seed, bgr[i]);
+        const std::string tag = "random " + std::to_string(s.width) + "x" + std::to_string(s.height);
+        check_2d(st, tag, bgr[1], pool);
+        check_3d(st, tag, bgr, pool);
+        check_api(st, tag, bgr, pool);
+    }
+    std::cout << "Correctness: " << st.planes << " planes compared, " << st.failed << " failed\n";
+
+    const bool perfOk = check_perf(cfg, pool);
+    const bool ok = inputsOk && st.failed == 0 && perfOk;
+    std::cout << (ok ? "PASS" : "FAIL") << "\n";
+    return ok ? 0 : 1;
+}
+
+// ------------------------------------------------------------
+// Command line
+// ------------------------------------------------------------
+static bool parse_bench_args(int argc, char** argv, BenchConfig& cfg) {
+    std::string sizes = "480p,1080p,4k";
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--sizes" && hasValue) {
+            sizes = argv[++i];
+        } else if (arg == "--video" && hasValue) {
+            cfg.videoPath = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            cfg.minSeconds = std::atof(argv[++i]);
+        } else if (arg == "--csv") {
+            cfg.csv = true;
+        } else if (arg == "--check") {
+            cfg.check = true;
+        } else if (arg == "--input" && hasValue) {
+            cfg.checkInputs.push_back(argv[++i]);
+        } else if (arg == "--baseline" && hasValue) {
+            cfg.baselinePath = argv[++i];
+        } else if (arg == "--save-baseline") {
+            cfg.saveBaseline = true;
+        } else if (arg == "--tolerance" && hasValue) {
+            cfg.tolerance = std::atof(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0]
+                      << " [--sizes 480p,1080p,4k] [--video FILE] [--min-time SEC] [--csv]\n"
+                      << "       " << argv[0]
+                      << " --check [--input FILE]... [--baseline FILE] [--save-baseline] [--tolerance F]\n";
+            return false;
+        }
+    }
+
+    for (const BenchSize& s : kSizes)
+        if (("," + sizes + ",").find(std::string(",") + s.name + ",") != std::string::npos)
+            cfg.sizes.push_back(s);
+
+    if (cfg.sizes.empty()) {
+        std::cout << "No known size in: " << sizes << "\n";
+        return false;
+    }
+    if (cfg.tolerance >= 1.0) {
+        std::cout << "--tolerance is a fraction, [0, 1)\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    if (!parse_bench_args(argc, argv, cfg))
+        return -1;
+    if (cfg.check)
+        return run_check(cfg);
+
+    ThreadPool pool;
+
+    if (cfg.csv)
+        std::cout << "group,name,size,mpx_per_s,ns_per_px,ms\n";
+    else
+        std::cout << "sobel_bench: " << pool.size() << " threads, best SIMD "
+                  << simd_name(simd_detect()) << "\n";
+
+    for (const BenchSize& s : cfg.sizes) {
+        const cv::Size size(s.width, s.height);
+
+        // Synthetic frames always, first frames of --video too
+        std::vector<std::pair<std::string, std::vector<cv::Mat>>> sets;
+
+        std::vector<cv::Mat> syn(3);
+        for (int i = 0; i < 3; i++)
+            synthetic_frame(size, i, syn[i]);
+        sets.emplace_back(std::string(s.name) + " synthetic", syn);
+
+        if (!cfg.videoPath.empty()) {
+            std::vector<cv::Mat> real(3);
+            if (video_frames(cfg.videoPath, size, real.data()))
+                sets.emplace_back(std::string(s.name) + " video", real);
+            else
+                std::cout << "Could not read 3 frames from: " << cfg.videoPath << "\n";
+        }
+
+        for (const auto& set : sets) {
+            const std::string& tag = set.first;
+            const cv::Mat* bgr = set.second.data();
+
+            cv::Mat gray[3];
+            for (int i = 0; i < 3; i++)
+                cv::cvtColor(bgr[i], gray[i], cv::COLOR_BGR2GRAY);
+
+            bench_2d(cfg, tag, gray[1], pool);
+            bench_3d(cfg, tag, gray, pool);
+            bench_stages(cfg, tag, bgr, pool);
+            bench_scaling(cfg, tag, gray);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+// batch.cpp
+// ------------------------------------------------------------
+// Multi-stream batch scheduler, see batch.hpp.
+// ------------------------------------------------------------
+
+#include "batch.hpp"
+
+#include "runner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+// Lower-cased, so names that differ only in case still count as the
+// same folder on Windows / macOS
+static std::string folder_key(const std::string& name) {
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
+// One sub-folder per input: the file stem, the file name when two
+// inputs share a stem (clip.mp4 / clip.gif), then "-2", "-3", ... in
+// input order when they share the name too (a/x.mp4 / b/x.mp4).
+// Renamed folders are reported; two inputs never write one folder.
+static std::vector<std::string> out_dirs_for(const RunConfig& cfg, const std::vector<std::string>& files) {
+    if (files.size() <= 1)
+        return std::vector<std::string>(files.size(), cfg.outDir);
+
+    std::map<std::string, int> stems, names;
+    for (const std::string& f : files) {
+        const std::filesystem::path p(f);
+        stems[folder_key(p.stem().string())]++;
+        names[folder_key(p.filename().string())]++;
+    }
+
+    std::set<std::string> taken;
+    std::vector<std::string> dirs;
+    for (const std::string& f : files) {
+        const std::filesystem::path p(f);
+        std::string name = p.stem().string();
+        if (stems[folder_key(name)] > 1)
+            name = p.filename().string();
+        std::string unique = name;
+        for (int n = 2; !taken.insert(folder_key(unique)).second; n++)
+            unique = name + "-" + std::to_string(n);
+        if (unique != name)
+            std::cout << "Inputs share the name " << name << ": " << f << " writes into "
+                      << cfg.outDir << "/" << unique << "/\n";
+        dirs.push_back(cfg.outDir + "/" + unique);
+    }
+    return dirs;
+}
+
+// Indices into files, largest first; files whose size cannot be read
+// go last, in their original (sorted) order
+static std::vector<size_t> largest_first(const std::vector<std::string>& files) {
+    std::vector<std::pair<long long, size_t>> sized;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::error_code ec;
+        const auto bytes = std::filesystem::file_size(files[i], ec);
+        sized.emplace_back(ec ? -1 : static_cast<long long>(bytes), i);
+    }
+    std::stable_sort(sized.begin(), sized.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<size_t> out;
+    for (const auto& s : sized)
+        out.push_back(s.second);
+    return out;
+}
+
+int run_batch(const RunConfig& cfg, const std::vector<std::string>& files, ThreadPool& pool) {
+    const int streams = std::max(1, std::min(cfg.streams, static_cast<int>(files.size())));
+
+    // One context per stream; the OpenCL program is built per
+    // context (kernel objects hold their arguments), reported once
+    std::unique_ptr<RunContext[]> ctx(new RunContext[streams]);
+    for (int s = 0; s < streams; s++) {
+        ctx[s].pool = &pool;
+        if (cfg.backend == Backend::OpenCL && !ocl_init(ctx[s].ocl, cfg.grad, s == 0) && s == 0)
+            std::cout << "Falling back to the CPU backend.\n";
+    }
+
+    const std::vector<std::string> outDirs = out_dirs_for(cfg, files);
+
+    // A single stream keeps the given order
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    if (streams > 1)
+        order = largest_first(files);
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> failed{0};
+
+    auto stream_loop = [&](int s) {
+        for (size_t i = next++; i < order.size(); i = next++) {
+            if (run_input(cfg, files[order[i]], outDirs[order[i]], ctx[s]) != 0)
+                failed++;
+        }
+    };
+
+    // The calling thread is stream 0
+    std::vector<std::thread> threads;
+    for (int s = 1; s < streams; s++)
+        threads.emplace_back(stream_loop, s);
+    stream_loop(0);
+    for (std::thread& t : threads)
+        t.join();
+
+    return failed.load();
+}
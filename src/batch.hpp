@@ -0,0 +1,35 @@
+// batch.hpp
+// ------------------------------------------------------------
+// Multi-stream batch: many inputs in one process.
+//
+// With --streams N, N stream threads take inputs from one shared
+// list until it is empty. Each stream has its own RunContext (3D
+// engine planes, OpenCL buffers, its pipelined decode / encode
+// threads), so a clip's prev / curr / next window only ever sees
+// that clip's frames, in order. The kernels of every stream go to
+// the one shared ThreadPool as jobs of their own: the workers spread
+// over the open jobs and steal within them (thread_pool.hpp), so no
+// stream waits for another and none runs its passes alone.
+//
+// Inputs are handed out largest file first, so the long clips
+// start early and the short ones fill in at the end (balances the
+// streams without knowing the frame counts).
+//
+// The point is aggregate throughput on many short clips, whose
+// open / prime / writer setup otherwise runs with every core idle
+// but one. Output lines of concurrent inputs interleave.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cli.hpp"
+#include "thread_pool.hpp"
+
+// Run every file (cfg.streams at a time), each into its own
+// sub-folder of cfg.outDir when there are several (named after the
+// file, made unique when names collide).
+// Returns the number of inputs that failed.
+int run_batch(const RunConfig& cfg, const std::vector<std::string>& files, ThreadPool& pool);
@@ -0,0 +1,77 @@
+// border.cpp
+// ------------------------------------------------------------
+// Row padding, see border.hpp.
+// ------------------------------------------------------------
+
+#include "border.hpp"
+#include "simd_kernels.hpp"
+
+#include <cstring>
+
+// The radius pixels on each side from the row already in
+// dst[radius .. radius + cols - 1]
+static void pad_edges(uint8_t* dst, int cols, BorderMode m, int radius) {
+    uint8_t* row = dst + radius;
+    for (int k = 1; k <= radius; k++) {
+        const int left  = border_index(-k, cols, m);
+        const int right = border_index(cols - 1 + k, cols, m);
+        row[-k]           = left  < 0 ? 0 : row[left];
+        row[cols - 1 + k] = right < 0 ? 0 : row[right];
+    }
+}
+
+void pad_row(const uint8_t* src, int cols, BorderMode m, uint8_t* dst, int radius) {
+    if (src == nullptr) {
+        std::memset(dst, 0, static_cast<size_t>(cols) + 2 * radius);
+        return;
+    }
+
+    std::memcpy(dst + radius, src, static_cast<size_t>(cols));
+    pad_edges(dst, cols, m, radius);
+}
+
+void pad_source_row(const cv::Mat& src, int y, BorderMode m, uint8_t* dst, int radius) {
+    const int r = border_index(y, src.rows, m);
+    if (r < 0 || src.type() == CV_8U) {
+        pad_row(r < 0 ? nullptr : src.ptr<uint8_t>(r), src.cols, m, dst, radius);
+        return;
+    }
+
+    sobel_kernels().bgr_gray(src.ptr<uint8_t>(r), dst + radius, 0, src.cols);
+    pad_edges(dst, src.cols, m, radius);
+}
+
+static uint8_t* ring_row(PaddedRows& p, int y) {
+    const int count = 2 * p.radius + 1;
+    return p.buf.data() + static_cast<size_t>((y + p.radius) % count) * p.stride;
+}
+
+static void pad_ring_row(PaddedRows& p, int y) {
+    pad_source_row(*p.src, y, p.mode, ring_row(p, y), p.radius);
+}
+
+void padded_rows_begin(PaddedRows& p, const cv::Mat& src, BorderMode m, int y, int radius) {
+    p.src = &src;
+    p.mode = m;
+    p.radius = radius;
+    p.stride = src.cols + 2 * radius;
+    p.buf.resize((2 * static_cast<size_t>(radius) + 1) * p.stride);
+
+    for (int r = y - radius; r < y + radius; r++)
+        pad_ring_row(p, r);
+}
+
+void padded_rows_at(PaddedRows& p, int y, const uint8_t*& u, const uint8_t*& c, const uint8_t*& d) {
+    pad_ring_row(p, y + 1);
+
+    u = ring_row(p, y - 1) + 1;
+    c = ring_row(p, y) + 1;
+    d = ring_row(p, y + 1) + 1;
+}
+
+void padded_rows_window(PaddedRows& p, int y, const uint8_t** rows) {
+    pad_ring_row(p, y + p.radius);
+
+    for (int j = -p.radius; j <= p.radius; j++)
+        rows[j + p.radius] = ring_row(p, y + j) + p.radius;
+}
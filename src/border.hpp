@@ -0,0 +1,59 @@
+// border.hpp
+// ------------------------------------------------------------
+// Row padding for the BorderMode of grad_modes.hpp.
+//
+// Every input row a 3x3 kernel reads is copied once into a reusable
+// buffer with one pixel of padding on each side, filled per the
+// mode. The row kernels then run over whole rows, x in [0, cols),
+// with the same branch-free loop as the interior: no scalar edge
+// columns, no special first / last row.
+//
+// The source may also be the decoded BGR frame (CV_8UC3): its luma
+// is computed row by row into the same buffer (bgr_gray kernel,
+// identical to cv::COLOR_BGR2GRAY), so no gray frame is written and
+// read back; only the few rows the stencil needs stay in L1.
+//
+// The wider 2D kernels (KernelType) pad radius pixels per side and
+// keep 2 * radius + 1 rows.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "grad_modes.hpp"
+
+// dst[r .. r + cols - 1] = src, the r pixels on each side per m
+// (r = radius). src == nullptr is a row outside a Constant border
+// (all 0). dst holds cols + 2 r.
+void pad_row(const uint8_t* src, int cols, BorderMode m, uint8_t* dst, int radius = 1);
+
+// Same for row y (mapped per m) of a CV_8U plane or the gray of a
+// CV_8UC3 BGR frame.
+void pad_source_row(const cv::Mat& src, int y, BorderMode m, uint8_t* dst, int radius = 1);
+
+// Rows y - radius .. y + radius of a CV_8U plane (or BGR frame),
+// padded, for a sweep over consecutive y: each row is padded once,
+// when it becomes y + radius.
+struct PaddedRows {
+    const cv::Mat* src = nullptr;
+    BorderMode mode = BorderMode::Replicate;
+    int radius = 1;
+    int stride = 0;             // cols + 2 radius
+    std::vector<uint8_t> buf;   // 2 radius + 1 padded rows, ring by (y + radius) % count
+};
+
+// Begin a sweep at row y (pads y - radius .. y + radius - 1).
+void padded_rows_begin(PaddedRows& p, const cv::Mat& src, BorderMode m, int y, int radius = 1);
+
+// Pad y + radius and fill rows[0 .. 2 radius] with the rows of y
+// (pixel 0 of each, [-radius] and [cols + radius - 1] readable).
+void padded_rows_window(PaddedRows& p, int y, const uint8_t** rows);
+
+// radius 1: pad y+1 and return the three rows for y (the previous
+// call was for y-1, or padded_rows_begin(y)). Each pointer is pixel
+// 0, so [-1] and [cols] are readable.
+void padded_rows_at(PaddedRows& p, int y, const uint8_t*& u, const uint8_t*& c, const uint8_t*& d);
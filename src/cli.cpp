@@ -0,0 +1,451 @@
+// cli.cpp
+// ------------------------------------------------------------
+// Command line / config file parsing, see cli.hpp.
+// ------------------------------------------------------------
+
+#include "cli.hpp"
+
+#include "live_source.hpp"
+#include "outputs.hpp"
+#include "segments.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static const char* kImageExts[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".webp" };
+static const char* kVideoExts[] = { ".mp4", ".avi", ".mov", ".mkv", ".webm", ".m4v", ".gif", ".npy" };
+
+static std::string lower_ext(const std::string& path) {
+    std::string ext = fs::path(path).extension().string();
+    for (char& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext;
+}
+
+static bool has_ext(const std::string& path, const char* const* exts, size_t n) {
+    const std::string ext = lower_ext(path);
+    for (size_t i = 0; i < n; i++)
+        if (ext == exts[i])
+            return true;
+    return false;
+}
+
+static bool is_image(const std::string& path) {
+    return has_ext(path, kImageExts, sizeof(kImageExts) / sizeof(kImageExts[0]));
+}
+
+static bool is_media(const std::string& path) {
+    return is_image(path) || has_ext(path, kVideoExts, sizeof(kVideoExts) / sizeof(kVideoExts[0]));
+}
+
+// ------------------------------------------------------------
+// Option values
+// ------------------------------------------------------------
+static bool parse_int(const std::string& s, int lo, int& out) {
+    char* end = nullptr;
+    const long v = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0' || v < lo || v > 1 << 20)
+        return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+static bool parse_mode(const std::string& s, RunMode& mode) {
+    if (s == "auto")                 { mode = RunMode::Auto;    return true; }
+    if (s == "image")                { mode = RunMode::Image;   return true; }
+    if (s == "2d" || s == "gif")     { mode = RunMode::Video2D; return true; }
+    if (s == "3d")                   { mode = RunMode::Video3D; return true; }
+    if (s == "volume")               { mode = RunMode::Volume;  return true; }
+    return false;
+}
+
+const char* run_mode_name(RunMode mode) {
+    switch (mode) {
+    case RunMode::Auto:    return "auto";
+    case RunMode::Image:   return "image";
+    case RunMode::Video2D: return "2d";
+    case RunMode::Video3D: return "3d";
+    case RunMode::Volume:  return "volume";
+    }
+    return "unknown";
+}
+
+const char* hw_accel_name(cv::VideoAccelerationType accel) {
+    switch (accel) {
+    case cv::VIDEO_ACCELERATION_NONE:  return "none";
+    case cv::VIDEO_ACCELERATION_ANY:   return "any";
+    case cv::VIDEO_ACCELERATION_D3D11: return "d3d11";
+    case cv::VIDEO_ACCELERATION_VAAPI: return "vaapi";
+    case cv::VIDEO_ACCELERATION_MFX:   return "mfx";
+    }
+    return "unknown";
+}
+
+bool hw_accel_parse(const std::string& name, cv::VideoAccelerationType& accel) {
+    const cv::VideoAccelerationType all[] = {
+        cv::VIDEO_ACCELERATION_NONE, cv::VIDEO_ACCELERATION_ANY, cv::VIDEO_ACCELERATION_D3D11,
+        cv::VIDEO_ACCELERATION_VAAPI, cv::VIDEO_ACCELERATION_MFX
+    };
+    for (cv::VideoAccelerationType a : all) {
+        if (name == hw_accel_name(a)) {
+            accel = a;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_list(const std::string& path, RunConfig& cfg) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Could not open input list: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            cfg.inputs.push_back(line);
+    }
+    return true;
+}
+
+static const char* kOptionKeys[] = {
+    "out", "input", "list", "config", "mode", "threads", "streams", "simd", "outputs", "color", "pack", "raw", "norm", "norm-alpha", "norm-pct", "driver", "queue",
+    "live-frames", "precision", "mag", "theta", "border", "kernel", "pyramid", "segments", "segment", "motion", "motion-block", "roi", "backend", "hwaccel",
+    "metrics-json", "metrics-prom", "trace", "metrics-interval"
+};
+
+static bool is_option_key(const std::string& key) {
+    for (const char* k : kOptionKeys)
+        if (key == k)
+            return true;
+    return false;
+}
+
+// One "key value" pair, shared by argv and the config file
+static bool apply_option(const std::string& key, const std::string& value, RunConfig& cfg) {
+    bool ok = true;
+
+    if (key == "out") {
+        cfg.outDir = value;
+    } else if (key == "input") {
+        cfg.inputs.push_back(value);
+    } else if (key == "list") {
+        return read_list(value, cfg);
+    } else if (key == "config") {
+        return load_config(value, cfg);
+    } else if (key == "mode") {
+        ok = parse_mode(value, cfg.mode);
+    } else if (key == "threads") {
+        ok = parse_int(value, 0, cfg.threads);
+    } else if (key == "streams") {
+        ok = parse_int(value, 1, cfg.streams);
+    } else if (key == "simd") {
+        SimdLevel level;
+        ok = simd_parse(value.c_str(), level);
+        if (ok) cfg.simd = value;
+    } else if (key == "outputs") {
+        ok = parse_outputs(value, cfg.outputs);
+    } else if (key == "color") {
+        if (value == "bgr")       cfg.grayOutput = false;
+        else if (value == "gray") cfg.grayOutput = true;
+        else ok = false;
+    } else if (key == "pack") {
+        if (value == "none")          cfg.packChannels = false;
+        else if (value == "channels") cfg.packChannels = true;
+        else ok = false;
+    } else if (key == "raw") {
+        if (value == "none")     cfg.rawNpy = false;
+        else if (value == "npy") cfg.rawNpy = true;
+        else ok = false;
+    } else if (key == "norm") {
+        ok = norm_mode_parse(value.c_str(), cfg.norm);
+    } else if (key == "norm-alpha") {
+        cfg.normParams.emaAlpha = static_cast<float>(std::atof(value.c_str()));
+        ok = cfg.normParams.emaAlpha > 0.0f && cfg.normParams.emaAlpha <= 1.0f;
+    } else if (key == "norm-pct") {
+        cfg.normParams.percentile = static_cast<float>(std::atof(value.c_str()));
+        ok = cfg.normParams.percentile > 50.0f && cfg.normParams.percentile <= 100.0f;
+    } else if (key == "driver") {
+        if (value == "pipelined")       cfg.pipelined = true;
+        else if (value == "sequential") cfg.pipelined = false;
+        else ok = false;
+    } else if (key == "queue") {
+        ok = parse_int(value, 1, cfg.queueDepth);
+    } else if (key == "live-frames") {
+        ok = parse_int(value, 0, cfg.liveFrames);
+    } else if (key == "precision") {
+        ok = precision_parse(value.c_str(), cfg.grad.precision);
+    } else if (key == "mag") {
+        ok = mag_mode_parse(value.c_str(), cfg.grad.mag);
+    } else if (key == "theta") {
+        ok = theta_mode_parse(value.c_str(), cfg.grad.theta);
+    } else if (key == "border") {
+        ok = border_mode_parse(value.c_str(), cfg.grad.border);
+    } else if (key == "kernel") {
+        ok = kernel_type_parse(value.c_str(), cfg.grad.kernel);
+    } else if (key == "pyramid") {
+        ok = parse_int(value, 0, cfg.pyramid) && cfg.pyramid <= PYRAMID_MAX_LEVEL;
+    } else if (key == "segments") {
+        ok = parse_int(value, 1, cfg.segments);
+    } else if (key == "segment") {
+        ok = segment_parse(value, cfg.segment);
+    } else if (key == "motion") {
+        cfg.gate.threshold = static_cast<float>(std::atof(value.c_str()));
+        ok = cfg.gate.threshold >= 0.0f;
+    } else if (key == "motion-block") {
+        ok = parse_int(value, 2, cfg.gate.block);
+    } else if (key == "roi") {
+        ok = roi_parse(value.c_str(), cfg.gate.rois);
+    } else if (key == "backend") {
+        ok = backend_parse(value.c_str(), cfg.backend);
+    } else if (key == "hwaccel") {
+        ok = hw_accel_parse(value, cfg.hwAccel);
+    } else if (key == "metrics-json") {
+        cfg.metrics.jsonPath = value;
+    } else if (key == "metrics-prom") {
+        cfg.metrics.promPath = value;
+    } else if (key == "trace") {
+        cfg.metrics.tracePath = value;
+    } else if (key == "metrics-interval") {
+        cfg.metrics.intervalSec = std::atof(value.c_str());
+        ok = cfg.metrics.intervalSec > 0.0;
+    } else {
+        std::cout << "Unknown option: " << key << std::endl;
+        return false;
+    }
+
+    if (!ok)
+        std::cout << "Invalid value for " << key << ": " << value << std::endl;
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Config file
+// ------------------------------------------------------------
+static std::string trim(const std::string& s) {
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) b++;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) e--;
+    return s.substr(b, e - b);
+}
+
+bool load_config(const std::string& path, RunConfig& cfg) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Could not open config: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        line = trim(line);
+        if (line.empty())
+            continue;
+
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cout << path << ":" << lineNo << ": expected key = value" << std::endl;
+            return false;
+        }
+        if (!apply_option(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), cfg)) {
+            std::cout << "  (" << path << ":" << lineNo << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Command line
+// ------------------------------------------------------------
+void print_usage(const char* prog) {
+    std::cout
+        << "Usage: " << prog << " [options] <input>...\n"
+        << "\n"
+        << "Inputs: files, directories, or patterns like clips/*.mp4;\n"
+        << "        live: camera:N, /dev/videoN, rtsp:// (or http, udp, ...) URLs\n"
+        << "\n"
+        << "Options:\n"
+        << "  -o, --out DIR         output folder (default: output)\n"
+        << "  -m, --mode MODE       auto | image | 2d | gif | 3d | volume (default: auto)\n"
+        << "  -j, --threads N       worker threads, 0 = one per core (default: 0)\n"
+        << "      --streams N       inputs processed concurrently over the shared pool (default: 1)\n"
+        << "      --simd LEVEL      scalar | sse4.1 | avx2 | neon (default: best)\n"
+        << "      --outputs LIST    original,gray,gx,gy,mag,theta,gt or all (default: all)\n"
+        << "      --color C         bgr | gray: gradient planes as 3 equal channels or single-channel (default: bgr)\n"
+        << "      --pack MODE       none | channels: gx,gy,mag (3D: gt,mag) as B,G,R of one stream (default: none)\n"
+        << "      --raw FORMAT      none | npy: lossless <product>.npy of the unscaled planes (default: none)\n"
+        << "      --norm MODE       minmax | prev | fixed | ema | percentile output scaling (default: minmax)\n"
+        << "      --norm-alpha A    ema: weight of the newest frame, (0, 1] (default: 0.1)\n"
+        << "      --norm-pct P      percentile: scale [100 - P, P] percentiles, (50, 100] (default: 99.5)\n"
+        << "      --driver NAME     pipelined | sequential (3D, default: pipelined)\n"
+        << "      --queue N         pipelined queue depth; live: frames waiting before the oldest is dropped (default: 4)\n"
+        << "      --live-frames N   live: stop after N captured frames (default: 0 = until Ctrl-C)\n"
+        << "      --precision P     float | int16 gradient planes (default: float)\n"
+        << "      --mag MODE        exact | l1 | amax magnitude (default: exact)\n"
+        << "      --theta MODE      exact | poly | bins4 | bins8 | bins16 orientation (default: exact)\n"
+        << "      --border MODE     zero | replicate | reflect | constant pixels/frames outside the input (default: zero)\n"
+        << "      --kernel K        sobel3 | scharr3 | sobel5 | sobel7 2D / 3D aperture (default: sobel3)\n"
+        << "      --pyramid L       process at 1/2^L width and height, L = 0..3 (default: 0 = full)\n"
+        << "      --segments N      3D: split each video into N time segments run in parallel, then merged\n"
+        << "      --segment I       with --segments: run only segment I (one per process / node), or 'merge' (default: all)\n"
+        << "      --motion T        3D: skip the temporal pass on tiles whose frames differ by < T gray levels (default: 0 = off)\n"
+        << "      --motion-block N  3D: tile side in pixels for --motion / --roi (default: 16)\n"
+        << "      --roi X,Y,W,H     3D: only compute inside the rectangle (repeat or ';' for several)\n"
+        << "      --backend NAME    cpu | opencl (default: cpu, opencl falls back to cpu)\n"
+        << "      --hwaccel TYPE    none | any | vaapi | d3d11 | mfx video decode/encode (default: any)\n"
+        << "      --list FILE       read inputs from FILE, one per line\n"
+        << "      --config FILE     read 'key = value' options from FILE\n"
+        << "      --metrics-json F  append per-stage p50/p99, fps, queue depths as JSON lines (- = stdout)\n"
+        << "      --metrics-prom F  rewrite F in Prometheus text format every interval\n"
+        << "      --trace FILE      write a Chrome trace (chrome://tracing) at exit\n"
+        << "      --metrics-interval SEC  export interval (default: 1)\n"
+        << "  -h, --help            show this help\n"
+        << "\n"
+        << "With several inputs each one writes into <out>/<name>/ (name without extension,\n"
+        << "the full file name or a -2, -3, ... suffix when inputs share it).\n";
+}
+
+bool parse_args(int argc, char** argv, RunConfig& cfg) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return false;
+        }
+
+        if (arg.size() < 2 || arg[0] != '-') {
+            cfg.inputs.push_back(arg);
+            continue;
+        }
+
+        // --key=value, --key value, -k value
+        std::string key, value;
+        bool haveValue = false;
+
+        if (arg.compare(0, 2, "--") == 0) {
+            key = arg.substr(2);
+            const size_t eq = key.find('=');
+            if (eq != std::string::npos) {
+                value = key.substr(eq + 1);
+                key.erase(eq);
+                haveValue = true;
+            }
+        } else if (arg == "-o") {
+            key = "out";
+        } else if (arg == "-m") {
+            key = "mode";
+        } else if (arg == "-j") {
+            key = "threads";
+        } else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+
+        if (!is_option_key(key)) {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+
+        if (!haveValue) {
+            if (i + 1 >= argc) {
+                std::cout << "Missing value for " << arg << std::endl;
+                return false;
+            }
+            value = argv[++i];
+        }
+
+        if (!apply_option(key, value, cfg))
+            return false;
+    }
+
+    if (cfg.inputs.empty()) {
+        print_usage(argv[0]);
+        return false;
+    }
+    if (cfg.grad.precision == Precision::Int16 && !kernel_fits_int16(cfg.grad.kernel)) {
+        std::cout << "--kernel " << kernel_type_name(cfg.grad.kernel) << " needs --precision float" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Input expansion
+// ------------------------------------------------------------
+
+// Glob match of a file name: * = any run, ? = any one character
+static bool wildcard_match(const char* p, const char* s) {
+    if (*p == '\0')
+        return *s == '\0';
+    if (*p == '*')
+        return wildcard_match(p + 1, s) || (*s != '\0' && wildcard_match(p, s + 1));
+    if (*s == '\0')
+        return false;
+    return (*p == '?' || *p == *s) && wildcard_match(p + 1, s + 1);
+}
+
+std::vector<std::string> expand_inputs(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    std::error_code ec;
+
+    for (const std::string& in : inputs) {
+        const size_t before = files.size();
+
+        if (is_live(in)) {
+            // Cameras and streams are not files
+            files.push_back(in);
+        } else if (in.find_first_of("*?") != std::string::npos) {
+            // Pattern in the file name part only
+            const fs::path p(in);
+            const fs::path dir = p.has_parent_path() ? p.parent_path() : fs::path(".");
+            const std::string pattern = p.filename().string();
+
+            for (const fs::directory_entry& e : fs::directory_iterator(dir, ec)) {
+                if (e.is_regular_file(ec) &&
+                    wildcard_match(pattern.c_str(), e.path().filename().string().c_str()))
+                    files.push_back(e.path().string());
+            }
+        } else if (fs::is_directory(in, ec)) {
+            for (const fs::directory_entry& e : fs::directory_iterator(in, ec)) {
+                if (e.is_regular_file(ec) && is_media(e.path().string()))
+                    files.push_back(e.path().string());
+            }
+        } else if (fs::exists(in, ec)) {
+            files.push_back(in);
+        }
+
+        if (files.size() == before)
+            std::cout << "No input matches: " << in << std::endl;
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+RunMode mode_for(RunMode mode, const std::string& path) {
+    if (mode != RunMode::Auto)
+        return mode;
+    if (is_image(path))
+        return RunMode::Image;
+    if (lower_ext(path) == ".gif")
+        return RunMode::Video2D;
+    return RunMode::Video3D;
+}
@@ -0,0 +1,96 @@
+// cli.hpp
+// ------------------------------------------------------------
+// Command line / config file for the runner.
+//
+//   OpenCVExample [options] <input>...
+//
+// An input is a file, a directory (every image/video file in it)
+// or a file name pattern with * and ? ("clips/*.mp4"). All inputs
+// are processed by one process, so the thread pool, the kernel
+// dispatch and OpenCV are set up once for the whole batch.
+//
+// --config FILE reads "key = value" lines with the same keys as the
+// long options ("threads = 4", "input = clips/*.gif", # comments).
+// Options given on the command line after --config override it.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "grad_modes.hpp"
+#include "metrics.hpp"
+#include "motion_gate.hpp"
+#include "normalize.hpp"
+#include "ocl_backend.hpp"
+#include "pyramid.hpp"
+
+// ------------------------------------------------------------
+// What to run on an input
+// ------------------------------------------------------------
+enum class RunMode {
+    Auto,           // from the extension: image, .gif -> 2D, video -> 3D
+    Image,          // 2D Sobel on a still image, PNG outputs
+    Video2D,        // 2D Sobel per frame (video or animated GIF)
+    Video3D,        // 3D Sobel over prev/curr/next (video or mapped .npy volume)
+    Volume          // decode once into frames.npy, 8-bit gray, for later 3D runs
+};
+
+struct RunConfig {
+    std::vector<std::string> inputs;    // as given (files, dirs, patterns)
+    std::string outDir = "output";
+
+    RunMode mode = RunMode::Auto;
+    int threads = 0;                    // 0 = one per core
+    int streams = 1;                    // inputs in flight at once (batch.hpp)
+    std::string simd;                   // "" = best supported
+    unsigned outputs = 0;               // 0 = every product of the mode
+
+    NormMode norm = NormMode::MinMax;
+    NormParams normParams;              // ema weight / percentile of norm
+    bool grayOutput = false;            // single-channel planes instead of B=G=R
+    bool packChannels = false;          // gradient planes as B/G/R of one stream
+    bool rawNpy = false;                // lossless .npy sidecars of the planes
+    bool pipelined = true;              // 3D: pipelined driver
+    int queueDepth = 4;                 // 3D pipelined: frames in flight; live: frames waiting
+    int liveFrames = 0;                 // live: stop after this many captured, 0 = until Ctrl-C / end
+    GradientMode grad;                  // plane precision / magnitude formula
+    MotionGate gate;                    // 3D: ROIs / motion-gated temporal pass
+    int segments = 1;                   // 3D: split each video into N time segments (segments.hpp)
+    int segment = -1;                   // -1 all in this process, -2 merge only, else that one
+    int pyramid = 0;                    // run at 1 / 2^pyramid resolution (pyramid.hpp)
+    Backend backend = Backend::Cpu;     // where the gradients are computed
+
+    // Video decode / encode acceleration asked of OpenCV. With anything
+    // but NONE the hardware path is tried first and software is the
+    // fallback (see runner.cpp).
+    cv::VideoAccelerationType hwAccel = cv::VIDEO_ACCELERATION_ANY;
+
+    MetricsConfig metrics;              // all paths empty = off
+};
+
+// Parse argv into cfg. Prints the problem (or the usage for
+// --help) and returns false when the run should not start.
+bool parse_args(int argc, char** argv, RunConfig& cfg);
+
+// Apply a config file to cfg (see the header comment).
+bool load_config(const std::string& path, RunConfig& cfg);
+
+void print_usage(const char* prog);
+
+// Expand files / directories / patterns into a sorted, de-duplicated
+// file list. Unmatched entries are reported and skipped; live inputs
+// (is_live) are kept as given.
+std::vector<std::string> expand_inputs(const std::vector<std::string>& inputs);
+
+// Mode for one file (resolves RunMode::Auto; .npy -> 3D).
+RunMode mode_for(RunMode mode, const std::string& path);
+
+// "auto", "image", "2d", "3d", "volume"
+const char* run_mode_name(RunMode mode);
+
+// "none", "any", "d3d11", "vaapi", "mfx"
+const char* hw_accel_name(cv::VideoAccelerationType accel);
+bool hw_accel_parse(const std::string& name, cv::VideoAccelerationType& accel);
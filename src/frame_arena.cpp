@@ -0,0 +1,30 @@
+// frame_arena.cpp
+// ------------------------------------------------------------
+// Preallocated per-stream frame buffers, see frame_arena.hpp.
+// ------------------------------------------------------------
+
+#include "frame_arena.hpp"
+
+void arena_plane(cv::Mat& m, const cv::Size& size, int type) {
+    if (m.size() == size && m.type() == type)
+        return;
+    m.create(size, type);
+}
+
+void frame_arena_init(FrameArena& arena, const cv::Size& size, Precision precision, int frames) {
+    arena.size = size;
+
+    arena.bgr.resize(static_cast<size_t>(frames));
+    for (cv::Mat& m : arena.bgr)
+        arena_plane(m, size, CV_8UC3);
+    arena_plane(arena.gray, size, CV_8U);
+
+    arena_plane(arena.gtBgr,  size, CV_8UC3);
+    arena_plane(arena.magBgr, size, CV_8UC3);
+
+    const int type = precision == Precision::Int16 ? CV_16S : CV_32F;
+    arena_plane(arena.gx,    size, type);
+    arena_plane(arena.gy,    size, type);
+    arena_plane(arena.mag,   size, type);
+    arena_plane(arena.theta, size, CV_32F);
+}
@@ -0,0 +1,44 @@
+// frame_arena.hpp
+// ------------------------------------------------------------
+// Preallocated per-stream frame buffers.
+//
+// Everything the video loop touches per frame is allocated once,
+// from frameSize, and reused: kernels call cv::Mat::create() on
+// these Mats, which is a no-op when size and type already match.
+//
+// The decoded frames of the 3D window (curr .. curr + R) share a
+// ring of buffers, so a new frame is always decoded into the buffer
+// whose frame was just written and never into one still waiting.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+#include "grad_modes.hpp"
+
+struct FrameArena {
+    cv::Size size;
+
+    std::vector<cv::Mat> bgr;   // decoded frames (CV_8UC3)
+    cv::Mat gray;               // BGR2GRAY scratch (CV_8U, the 2D gray product)
+
+    // 3D outputs
+    cv::Mat gtBgr;              // |Gt| as BGR (CV_8UC3)
+    cv::Mat magBgr;             // 3D magnitude as BGR (CV_8UC3)
+
+    // 2D outputs
+    cv::Mat gx, gy, mag, theta; // CV_32F (gx/gy/mag CV_16S for Precision::Int16)
+};
+
+// Allocate every buffer for frames of the given size, frames decoded
+// BGR buffers.
+void frame_arena_init(FrameArena& arena, const cv::Size& size,
+                      Precision precision = Precision::Float32, int frames = 1);
+
+// Allocate m once, uninitialized: the kernels write every pixel of
+// their outputs (BorderMode::Zero writes the border as 0). No-op
+// when size and type already match.
+void arena_plane(cv::Mat& m, const cv::Size& size, int type);
@@ -0,0 +1,189 @@
+// grad_modes.cpp
+// ------------------------------------------------------------
+// Names of the gradient modes, see grad_modes.hpp.
+// ------------------------------------------------------------
+
+#include "grad_modes.hpp"
+
+#include <cmath>
+#include <cstring>
+
+const char* precision_name(Precision p) {
+    switch (p) {
+    case Precision::Float32: return "float";
+    case Precision::Int16:   return "int16";
+    }
+    return "unknown";
+}
+
+bool precision_parse(const char* name, Precision& p) {
+    const Precision all[] = { Precision::Float32, Precision::Int16 };
+    for (Precision v : all) {
+        if (std::strcmp(name, precision_name(v)) == 0) {
+            p = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* mag_mode_name(MagMode m) {
+    switch (m) {
+    case MagMode::Exact: return "exact";
+    case MagMode::L1:    return "l1";
+    case MagMode::AMax:  return "amax";
+    }
+    return "unknown";
+}
+
+bool mag_mode_parse(const char* name, MagMode& m) {
+    const MagMode all[] = { MagMode::Exact, MagMode::L1, MagMode::AMax };
+    for (MagMode v : all) {
+        if (std::strcmp(name, mag_mode_name(v)) == 0) {
+            m = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* theta_mode_name(ThetaMode m) {
+    switch (m) {
+    case ThetaMode::Exact:  return "exact";
+    case ThetaMode::Poly:   return "poly";
+    case ThetaMode::Bins4:  return "bins4";
+    case ThetaMode::Bins8:  return "bins8";
+    case ThetaMode::Bins16: return "bins16";
+    }
+    return "unknown";
+}
+
+bool theta_mode_parse(const char* name, ThetaMode& m) {
+    const ThetaMode all[] = { ThetaMode::Exact, ThetaMode::Poly, ThetaMode::Bins4,
+                              ThetaMode::Bins8, ThetaMode::Bins16 };
+    for (ThetaMode v : all) {
+        if (std::strcmp(name, theta_mode_name(v)) == 0) {
+            m = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+int theta_bin_count(ThetaMode m) {
+    switch (m) {
+    case ThetaMode::Bins4:  return 4;
+    case ThetaMode::Bins8:  return 8;
+    case ThetaMode::Bins16: return 16;
+    default:                return 0;
+    }
+}
+
+const char* border_mode_name(BorderMode m) {
+    switch (m) {
+    case BorderMode::Zero:      return "zero";
+    case BorderMode::Replicate: return "replicate";
+    case BorderMode::Reflect:   return "reflect";
+    case BorderMode::Constant:  return "constant";
+    }
+    return "unknown";
+}
+
+bool border_mode_parse(const char* name, BorderMode& m) {
+    const BorderMode all[] = { BorderMode::Zero, BorderMode::Replicate,
+                               BorderMode::Reflect, BorderMode::Constant };
+    for (BorderMode v : all) {
+        if (std::strcmp(name, border_mode_name(v)) == 0) {
+            m = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+int border_index(int i, int n, BorderMode m) {
+    if (i >= 0 && i < n)
+        return i;
+
+    switch (m) {
+    case BorderMode::Replicate:
+        return i < 0 ? 0 : n - 1;
+    case BorderMode::Reflect: {
+        if (n == 1)
+            return 0;
+        // Mirror about both edges, period 2n - 2
+        const int period = 2 * n - 2;
+        int r = i % period;
+        if (r < 0) r += period;
+        return r < n ? r : period - r;
+    }
+    default:
+        return -1;
+    }
+}
+
+const char* kernel_type_name(KernelType k) {
+    switch (k) {
+    case KernelType::Sobel3:  return "sobel3";
+    case KernelType::Scharr3: return "scharr3";
+    case KernelType::Sobel5:  return "sobel5";
+    case KernelType::Sobel7:  return "sobel7";
+    }
+    return "unknown";
+}
+
+bool kernel_type_parse(const char* name, KernelType& k) {
+    const KernelType all[] = { KernelType::Sobel3, KernelType::Scharr3, KernelType::Sobel5, KernelType::Sobel7 };
+    for (KernelType v : all) {
+        if (std::strcmp(name, kernel_type_name(v)) == 0) {
+            k = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+int kernel_radius(KernelType k) {
+    switch (k) {
+    case KernelType::Sobel5: return 2;
+    case KernelType::Sobel7: return 3;
+    default:                 return 1;
+    }
+}
+
+bool kernel_fits_int16(KernelType k, int dims) {
+    // max |mag| L1: dims * gradient_bound, int16 up to 32767
+    return magnitude_bound(MagMode::L1, dims, k) <= 32767.0f;
+}
+
+float gradient_bound(int dims, KernelType kernel) {
+    float deriv = 1.0f, smooth = 4.0f;
+    switch (kernel) {
+    case KernelType::Scharr3: smooth = 16.0f; break;
+    case KernelType::Sobel5:  deriv = 3.0f;  smooth = 16.0f; break;
+    case KernelType::Sobel7:  deriv = 10.0f; smooth = 64.0f; break;
+    default:                  break;
+    }
+    return 255.0f * deriv * smooth * (dims == 3 ? smooth : 1.0f);
+}
+
+float magnitude_bound(MagMode m, int dims, KernelType kernel) {
+    const float g = gradient_bound(dims, kernel);
+    switch (m) {
+    case MagMode::Exact: return g * std::sqrt(static_cast<float>(dims));
+    case MagMode::L1:    return g * dims;
+    case MagMode::AMax:  return g * (dims == 3 ? 15.0f / 16 + 13.0f / 32 + 9.0f / 32 : 15.0f / 16 + 15.0f / 32);
+    }
+    return g;
+}
+
+void theta_bounds(ThetaMode m, float& lo, float& hi) {
+    const int bins = theta_bin_count(m);
+    if (bins > 0) {
+        lo = 0.0f;
+        hi = static_cast<float>(bins - 1);
+    } else {
+        lo = -3.14159265f;
+        hi =  3.14159265f;
+    }
+}
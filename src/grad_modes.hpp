@@ -0,0 +1,156 @@
+// grad_modes.hpp
+// ------------------------------------------------------------
+// How gradients are stored and how magnitude / orientation are formed.
+//
+// Precision::Int16 keeps Gx/Gy/Gt and the magnitude as CV_16S:
+// every Sobel sum of 8-bit input is an exact small integer
+// (2D |G| <= 1020, 3D |G| <= 4080), so nothing is lost, memory
+// traffic per plane halves and a SIMD register holds twice as many
+// results (SSE/NEON: 4 floats -> 8 int16, AVX2: 8 -> 16).
+//
+// Magnitude formulas (relative error vs. sqrt(x^2 + y^2 [+ t^2])):
+//   Exact   sqrt, rounded to the nearest integer in Int16 mode
+//           (|error| <= 0.5)
+//   L1      |x| + |y| [+ |t|]        0 .. +41.4% (2D), +73.2% (3D)
+//   AMax    alpha-max-beta-min, round((a max + b mid + c min) in Q15)
+//           2D  a = 15/16, b = 15/32             -6.25% .. +4.8%
+//           3D  a = 15/16, b = 13/32, c = 9/32   -6.25% .. +6.0%
+//           (plus up to 1 (2D) / 1.5 (3D) from rounding each term
+//           in Int16 mode)
+// All three are available for both precisions.
+//
+// Orientation (theta, 2D):
+//   Exact   std::atan2, radians [-pi, pi] (CV_32F)
+//   Poly    SIMD atan2: octant reduction + 9th order minimax atan on
+//           [0, 1] (Abramowitz & Stegun 4.4.49), |error| <= 1.2e-5 rad
+//           (7e-4 degrees) (CV_32F)
+//   BinsN   N = 4, 8, 16 sectors without trig (CV_8U): bin k covers
+//           k * 360/N +- 180/N degrees of atan2(gy, gx), so 0 = +x,
+//           N/4 = +y; |angle error| <= 180/N degrees. The sector edges
+//           are compared as |gy| > |gx| tan(edge), exact for the
+//           integer gradients of 8-bit input; a gradient exactly on
+//           an edge (|gy| == |gx| in bins4) goes to the sector nearer
+//           the x axis. bin % (N/2) is the
+//           undirected edge orientation (bins8 % 4 = the 4 non-max
+//           suppression directions).
+//
+// Borders (pixels / frames the 3x3 [x3] kernels need outside the input):
+//   Zero       no gradient there: the 1-pixel frame border is written
+//              as 0 and a 3D run has no output for the first and the
+//              last frame (original behaviour)
+//   Replicate  edge pixel / frame repeated        aaa|abcd|ddd
+//   Reflect    mirrored about the edge pixel      cb|abcd|cb
+//              (cv::BORDER_REFLECT_101, OpenCV's default)
+//   Constant   0 outside                          00|abcd|00
+// Every mode but Zero computes every pixel of every frame.
+//
+// 2D kernels (separable: derivative along one axis, smoothing along
+// the other; OpenCV's getDerivKernels weights):
+//   Sobel3   [-1 0 1]            x [1 2 1]               (default)
+//   Scharr3  [-1 0 1]            x [3 10 3]   better rotation invariance
+//   Sobel5   [-1 -2 0 2 1]       x [1 4 6 4 1]
+//   Sobel7   [-1 -4 -5 0 5 4 1]  x [1 6 15 20 15 6 1]
+// The wider apertures smooth more (noisy feeds); Zero then writes a
+// border of 2 / 3 pixels. Sobel7 sums exceed int16: float only. The
+// 3D engine is the 3x3x3 Sobel (int16 planes, 3-frame window).
+//
+// Kept free of OpenCV: included by the SIMD kernel files.
+// ------------------------------------------------------------
+
+#pragma once
+
+enum class Precision {
+    Float32,        // CV_32F planes (original)
+    Int16           // CV_16S planes, integer kernels
+};
+
+enum class MagMode {
+    Exact,
+    L1,
+    AMax
+};
+
+const int MAG_MODE_COUNT = 3;
+
+// "float", "int16"
+const char* precision_name(Precision p);
+bool precision_parse(const char* name, Precision& p);
+
+// "exact", "l1", "amax"
+const char* mag_mode_name(MagMode m);
+bool mag_mode_parse(const char* name, MagMode& m);
+
+enum class ThetaMode {
+    Exact,
+    Poly,
+    Bins4,
+    Bins8,
+    Bins16
+};
+
+// "exact", "poly", "bins4", "bins8", "bins16"
+const char* theta_mode_name(ThetaMode m);
+bool theta_mode_parse(const char* name, ThetaMode& m);
+
+// Number of sectors of a Bins mode, 0 otherwise
+int theta_bin_count(ThetaMode m);
+
+enum class BorderMode {
+    Zero,
+    Replicate,
+    Reflect,
+    Constant
+};
+
+// "zero", "replicate", "reflect", "constant"
+const char* border_mode_name(BorderMode m);
+bool border_mode_parse(const char* name, BorderMode& m);
+
+// Index in [0, n) that i (any i: a wide kernel reaches up to 3
+// pixels out) reads under m; -1 for a pixel / frame outside a Zero
+// or Constant border
+int border_index(int i, int n, BorderMode m);
+
+enum class KernelType {
+    Sobel3,
+    Scharr3,
+    Sobel5,
+    Sobel7
+};
+
+const int KERNEL_TYPE_COUNT = 4;
+
+// "sobel3", "scharr3", "sobel5", "sobel7"
+const char* kernel_type_name(KernelType k);
+bool kernel_type_parse(const char* name, KernelType& k);
+
+// Pixels the kernel reaches on each side (1, 1, 2, 3)
+int kernel_radius(KernelType k);
+
+// Precision::Int16 holds the kernel's sums in dims = 2 (all but
+// Sobel7) or 3 (Sobel3 only) dimensions
+bool kernel_fits_int16(KernelType k, int dims = 2);
+
+struct GradientMode {
+    Precision precision = Precision::Float32;
+    MagMode mag = MagMode::Exact;
+    ThetaMode theta = ThetaMode::Exact;
+    BorderMode border = BorderMode::Zero;
+    KernelType kernel = KernelType::Sobel3;     // 2D and 3D
+};
+
+// ------------------------------------------------------------
+// Largest values the kernel weights allow for 8-bit input
+// (NormMode::Fixed): dims = 2 (Gx, Gy) or 3 (Gx, Gy, Gt)
+// ------------------------------------------------------------
+
+// max |Gx| = max |Gy| (= max |Gt|): 255 * the positive derivative
+// weights of kernel * its smoothing sum, once per other axis (1020 /
+// 4080 for the 3x3 / 3x3x3 Sobel)
+float gradient_bound(int dims, KernelType kernel = KernelType::Sobel3);
+
+// Magnitude formula of MagMode applied to all components at the bound
+float magnitude_bound(MagMode m, int dims, KernelType kernel = KernelType::Sobel3);
+
+// Value range of the theta plane of m
+void theta_bounds(ThetaMode m, float& lo, float& hi);
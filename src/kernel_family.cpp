@@ -0,0 +1,161 @@
+// kernel_family.cpp
+// ------------------------------------------------------------
+// Compile-time specialized 2D and 3D kernels, scalar level (and the
+// row tails of the ISA files), see kernel_family.hpp.
+// ------------------------------------------------------------
+
+#include "kernel_family.hpp"
+#include "kernel_weights.hpp"
+#include "scalar_mag.hpp"
+
+// ------------------------------------------------------------
+// Outputs by precision
+// ------------------------------------------------------------
+template <int Mag>
+static inline void store(float* gx, float* gy, float* mag, int x, int sx, int sy, int want) {
+    const float fx = static_cast<float>(sx), fy = static_cast<float>(sy);
+    if (want & K2D_GXGY) {
+        gx[x] = fx;
+        gy[x] = fy;
+    }
+    if (want & K2D_MAG)
+        mag[x] = mag2_f32<Mag>(fx, fy);
+}
+
+template <int Mag>
+static inline void store(int16_t* gx, int16_t* gy, int16_t* mag, int x, int sx, int sy, int want) {
+    if (want & K2D_GXGY) {
+        gx[x] = static_cast<int16_t>(sx);
+        gy[x] = static_cast<int16_t>(sy);
+    }
+    if (want & K2D_MAG)
+        mag[x] = mag2_s16<Mag>(sx, sy);
+}
+
+template <class W, int Mag, int Want, typename T>
+static void family2d(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                     T* gx, T* gy, T* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    const uint8_t* r[2 * R + 1];
+    for (int j = 0; j <= 2 * R; j++)
+        r[j] = rows[j];
+
+    // Vertical: smoothed (for Gx) and differenced (for Gy) columns
+    for (int x = x0 - R; x < x1 + R; x++) {
+        const auto col = [&](int k) { return static_cast<int32_t>(r[R + k][x]); };
+        vs[x] = static_cast<int16_t>(smooth_sum<W, R>(col));
+        vd[x] = static_cast<int16_t>(deriv_sum<W, R>(col));
+    }
+
+    // Horizontal
+    for (int x = x0; x < x1; x++) {
+        const int32_t sx = deriv_sum<W, R>([&](int k) { return static_cast<int32_t>(vs[x + k]); });
+        const int32_t sy = smooth_sum<W, R>([&](int k) { return static_cast<int32_t>(vd[x + k]); });
+        store<Mag>(gx, gy, mag, x, sx, sy, Want);
+    }
+}
+
+template <class W, int Mag, int Want>
+static constexpr Family2DS16Fn family2d_s16() {
+    if constexpr (W::Int16)
+        return family2d<W, Mag, Want, int16_t>;
+    else
+        return nullptr;
+}
+
+template <class W>
+static constexpr Family2DKernels family_table() {
+    return {
+        W::R,
+        {
+            { family2d<W, 0, 0, float>, family2d<W, 0, 1, float>, family2d<W, 0, 2, float>, family2d<W, 0, 3, float> },
+            { family2d<W, 1, 0, float>, family2d<W, 1, 1, float>, family2d<W, 1, 2, float>, family2d<W, 1, 3, float> },
+            { family2d<W, 2, 0, float>, family2d<W, 2, 1, float>, family2d<W, 2, 2, float>, family2d<W, 2, 3, float> }
+        },
+        {
+            { family2d_s16<W, 0, 0>(), family2d_s16<W, 0, 1>(), family2d_s16<W, 0, 2>(), family2d_s16<W, 0, 3>() },
+            { family2d_s16<W, 1, 0>(), family2d_s16<W, 1, 1>(), family2d_s16<W, 1, 2>(), family2d_s16<W, 1, 3>() },
+            { family2d_s16<W, 2, 0>(), family2d_s16<W, 2, 1>(), family2d_s16<W, 2, 2>(), family2d_s16<W, 2, 3>() }
+        }
+    };
+}
+
+// [KernelType]
+const Family2DKernels FAMILY_2D_SCALAR[KERNEL_TYPE_COUNT] = {
+    family_table<Sobel3Weights>(),
+    family_table<Scharr3Weights>(),
+    family_table<Sobel5Weights>(),
+    family_table<Sobel7Weights>()
+};
+
+const Family2DKernels& kernel_family_2d(KernelType k) {
+    return sobel_kernels().family2d[static_cast<int>(k)];
+}
+
+// ------------------------------------------------------------
+// 3D: spatial pass per frame row, temporal pass over 2R + 1 frames
+// ------------------------------------------------------------
+template <class W, int Want>
+static void family3d_spatial(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                             float* dxs, float* sdy, float* ss, int x0, int x1) {
+    constexpr int R = W::R;
+
+    // Vertical: smoothed (for dxs, ss) and differenced (for sdy) columns
+    for (int x = x0 - R; x < x1 + R; x++) {
+        const auto col = [&](int k) { return static_cast<int32_t>(rows[R + k][x]); };
+        vs[x] = static_cast<int16_t>(smooth_sum<W, R>(col));
+        if (Want & K3D_DERIV)
+            vd[x] = static_cast<int16_t>(deriv_sum<W, R>(col));
+    }
+
+    // Horizontal, in int32 (|ss| reaches 255 * 64 * 64)
+    for (int x = x0; x < x1; x++) {
+        const auto s = [&](int k) { return static_cast<int32_t>(vs[x + k]); };
+        ss[x] = static_cast<float>(smooth_sum<W, R>(s));
+        if (Want & K3D_DERIV) {
+            dxs[x] = static_cast<float>(deriv_sum<W, R>(s));
+            sdy[x] = static_cast<float>(smooth_sum<W, R>([&](int k) { return static_cast<int32_t>(vd[x + k]); }));
+        }
+    }
+}
+
+template <class W, int Mag, int Want>
+static void family3d_combine(const float* const* dxs, const float* const* sdy, const float* const* ss,
+                             float* gt, float* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    for (int x = x0; x < x1; x++) {
+        const float t = deriv_sum<W, R>([&](int k) { return ss[R + k][x]; });
+        if (Want & K3D_GT)
+            gt[x] = t;
+        if (Want & K3D_MAG) {
+            const float gx = smooth_sum<W, R>([&](int k) { return dxs[R + k][x]; });
+            const float gy = smooth_sum<W, R>([&](int k) { return sdy[R + k][x]; });
+            mag[x] = mag3_f32<Mag>(gx, gy, t);
+        }
+    }
+}
+
+template <class W>
+static constexpr Family3DKernels family3d_table() {
+    return {
+        W::R,
+        { family3d_spatial<W, 0>, family3d_spatial<W, K3D_DERIV> },
+        {
+            { family3d_combine<W, 0, 0>, family3d_combine<W, 0, 1>, family3d_combine<W, 0, 2>, family3d_combine<W, 0, 3> },
+            { family3d_combine<W, 1, 0>, family3d_combine<W, 1, 1>, family3d_combine<W, 1, 2>, family3d_combine<W, 1, 3> },
+            { family3d_combine<W, 2, 0>, family3d_combine<W, 2, 1>, family3d_combine<W, 2, 2>, family3d_combine<W, 2, 3> }
+        }
+    };
+}
+
+// [KernelType]
+const Family3DKernels FAMILY_3D_SCALAR[KERNEL_TYPE_COUNT] = {
+    family3d_table<Sobel3Weights>(),
+    family3d_table<Scharr3Weights>(),
+    family3d_table<Sobel5Weights>(),
+    family3d_table<Sobel7Weights>()
+};
+
+const Family3DKernels& kernel_family_3d(KernelType k) {
+    return sobel_kernels().family3d[static_cast<int>(k)];
+}
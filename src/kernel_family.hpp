@@ -0,0 +1,46 @@
+// kernel_family.hpp
+// ------------------------------------------------------------
+// 2D and 3D row kernels of the wider kernel family (KernelType, see
+// grad_modes.hpp), generated from compile-time weights.
+//
+// Every kernel is separable: Gx = deriv (x) . smooth (y), Gy =
+// smooth (x) . deriv (y). One template per KernelType / MagMode /
+// outputs / precision is instantiated with its weights as constants
+// (kernel_weights.hpp), so the sums are unrolled, the symmetric taps
+// share one multiply and the zero taps disappear. A row is two
+// passes over int16 scratch: vertical (2R + 1 rows into the smoothed
+// and differenced columns, x in [x0 - R, x1 + R); at most 64 * 255),
+// then horizontal.
+//
+// The templates are built per SIMD level like the row kernels
+// (simd_kernels.hpp): the ISA files run both passes on vectors and
+// hand the row tail to the scalar ones here. Sums are exact (int16
+// lanes wrap, but every int16 output fits; Sobel7 widens to int32
+// for the horizontal pass), so every level, float and int16
+// (kernel_fits_int16) agree with a direct convolution with the same
+// weights. Sobel3 keeps the hand-written kernels of
+// simd_kernels.hpp; its table entry here is the generic reference
+// (sobel_bench compares them).
+//
+// 3D (sobel3d.hpp) uses the same weights along t: Gx = Dx Sy St,
+// Gy = Sx Dy St, Gt = Sx Sy Dt. The spatial pass is the 2D one plus
+// ss = Sx Sy, its horizontal sums in int32 and stored as float
+// planes (|ss| reaches 255 * 64 * 64 for Sobel7, past int16 for all
+// but Sobel3); the temporal pass sums 2R + 1 of them in float. Every
+// sum is an integer below 2^24, so float is exact and all levels
+// agree with a direct (2R + 1)^3 convolution. The engine keeps
+// Sobel3 on its int16 planes.
+//
+// Kept free of OpenCV, like simd_kernels.hpp.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include "grad_modes.hpp"
+#include "simd_kernels.hpp"
+
+// Kernels for the level chosen by simd.hpp (sobel_kernels().family2d)
+const Family2DKernels& kernel_family_2d(KernelType k);
+
+// Same for 3D (sobel_kernels().family3d)
+const Family3DKernels& kernel_family_3d(KernelType k);
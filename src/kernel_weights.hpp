@@ -0,0 +1,72 @@
+// kernel_weights.hpp
+// ------------------------------------------------------------
+// Weights of the kernel family (internal header), shared by the
+// scalar kernels (kernel_family.cpp) and the ISA files.
+//
+// Only constants and static templates, like simd_kernels.hpp, so
+// the files built with -msse4.1 / -mavx2 can include it.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+#include "grad_modes.hpp"
+
+// ------------------------------------------------------------
+// Weights (OpenCV getDerivKernels): smooth is symmetric, deriv
+// antisymmetric with a zero centre. Int16: the 2D outputs fit int16
+// (kernel_fits_int16; in 3D only Sobel3's do).
+// ------------------------------------------------------------
+struct Sobel3Weights {
+    static constexpr KernelType Type = KernelType::Sobel3;
+    static constexpr int R = 1;
+    static constexpr bool Int16 = true;
+    static constexpr int smooth[3] = { 1, 2, 1 };
+    static constexpr int deriv[3]  = { -1, 0, 1 };
+};
+
+struct Scharr3Weights {
+    static constexpr KernelType Type = KernelType::Scharr3;
+    static constexpr int R = 1;
+    static constexpr bool Int16 = true;
+    static constexpr int smooth[3] = { 3, 10, 3 };
+    static constexpr int deriv[3]  = { -1, 0, 1 };
+};
+
+struct Sobel5Weights {
+    static constexpr KernelType Type = KernelType::Sobel5;
+    static constexpr int R = 2;
+    static constexpr bool Int16 = true;
+    static constexpr int smooth[5] = { 1, 4, 6, 4, 1 };
+    static constexpr int deriv[5]  = { -1, -2, 0, 2, 1 };
+};
+
+struct Sobel7Weights {
+    static constexpr KernelType Type = KernelType::Sobel7;
+    static constexpr int R = 3;
+    static constexpr bool Int16 = false;
+    static constexpr int smooth[7] = { 1, 6, 15, 20, 15, 6, 1 };
+    static constexpr int deriv[7]  = { -1, -4, -5, 0, 5, 4, 1 };
+};
+
+// ------------------------------------------------------------
+// Unrolled taps: v(k) is the sample at offset k in [-R, R] (int32
+// or float, the type of the sum); taps K and -K share one multiply
+// (folded away for a weight of 1)
+// ------------------------------------------------------------
+template <class W, int K, typename F>
+static inline auto smooth_sum(const F& v) -> decltype(v(0)) {
+    if constexpr (K == 0)
+        return W::smooth[W::R] * v(0);
+    else
+        return W::smooth[W::R + K] * (v(K) + v(-K)) + smooth_sum<W, K - 1>(v);
+}
+
+template <class W, int K, typename F>
+static inline auto deriv_sum(const F& v) -> decltype(v(0)) {
+    if constexpr (K == 0)
+        return 0;
+    else
+        return W::deriv[W::R + K] * (v(K) - v(-K)) + deriv_sum<W, K - 1>(v);
+}
@@ -0,0 +1,179 @@
+// live_source.cpp
+// ------------------------------------------------------------
+// Capture thread and drop-oldest frame queue, see live_source.hpp.
+// ------------------------------------------------------------
+
+#include "live_source.hpp"
+#include "frame_arena.hpp"
+#include "metrics.hpp"
+#include "pyramid.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Set by SIGINT, seen by every capture thread
+static std::atomic<bool> gLiveInterrupted{false};
+
+static void on_interrupt(int) {
+    gLiveInterrupted.store(true);
+}
+
+// "camera:N" -> N, else -1
+static int camera_index(const std::string& input) {
+    const std::string prefix = "camera:";
+    if (input.compare(0, prefix.size(), prefix) != 0 || input.size() == prefix.size())
+        return -1;
+    for (size_t i = prefix.size(); i < input.size(); i++)
+        if (!std::isdigit(static_cast<unsigned char>(input[i])))
+            return -1;
+    return std::atoi(input.c_str() + prefix.size());
+}
+
+bool is_live(const std::string& input) {
+    static const char* kSchemes[] = { "rtsp://", "rtsps://", "rtmp://", "http://", "https://", "udp://", "tcp://" };
+    for (const char* s : kSchemes)
+        if (input.compare(0, std::strlen(s), s) == 0)
+            return true;
+    return camera_index(input) >= 0 || input.compare(0, 10, "/dev/video") == 0;
+}
+
+bool live_open(const std::string& input, cv::VideoCapture& cap, cv::Size& frameSize, double& fps,
+               cv::VideoAccelerationType hwAccel) {
+    const int index = camera_index(input);
+    if (index >= 0) {
+        cap.open(index);
+    } else {
+        if (hwAccel != cv::VIDEO_ACCELERATION_NONE)
+            cap.open(input, cv::CAP_ANY, { cv::CAP_PROP_HW_ACCELERATION, hwAccel });
+        if (!cap.isOpened())
+            cap.open(input);
+    }
+    if (!cap.isOpened()) {
+        std::cout << "Could not open live input: " << input << std::endl;
+        return false;
+    }
+
+    std::cout << "Live capture with " << cap.getBackendName() << "\n";
+
+    fps = cap.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0.0 && fps < 1000.0)) fps = 30.0;
+
+    // A stream cannot rewind: the size comes from the device, or
+    // from a frame that is not processed
+    frameSize = cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                         static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    if (frameSize.area() <= 0) {
+        cv::Mat first;
+        cap >> first;
+        if (first.empty()) {
+            std::cout << "Live input delivered no frame: " << input << std::endl;
+            return false;
+        }
+        frameSize = first.size();
+    }
+
+    std::signal(SIGINT, on_interrupt);
+    return true;
+}
+
+// ------------------------------------------------------------
+// Capture thread
+// ------------------------------------------------------------
+static void capture_loop(LiveSource& src) {
+    cv::Mat decoded;
+    for (long long seq = 0; src.maxFrames == 0 || seq < src.maxFrames; seq++) {
+        if (gLiveInterrupted.load() || src.stopping.load())
+            break;
+
+        cv::Mat* buf;
+        {
+            std::lock_guard<std::mutex> lock(src.mtx);
+            if (src.freeBufs.empty()) {
+                // Every buffer queued or held: the oldest waiting frame goes
+                buf = src.queue.front().buf;
+                src.queue.pop_front();
+                src.dropped++;
+            } else {
+                buf = src.freeBufs.back();
+                src.freeBufs.pop_back();
+            }
+        }
+
+        {
+            StageTimer timer(Stage::Decode);
+            src.cap->read(src.level > 0 ? decoded : *buf);
+        }
+        const int64_t captureNs = metrics_now_ns();
+        const bool empty = src.level > 0 ? decoded.empty() : buf->empty();
+        if (!empty && src.level > 0)
+            pyramid_down(decoded, src.level, *buf, src.pool);
+
+        std::lock_guard<std::mutex> lock(src.mtx);
+        if (empty) {
+            src.freeBufs.push_back(buf);
+            break;
+        }
+        if (src.queue.size() >= src.depth) {
+            src.freeBufs.push_back(src.queue.front().buf);
+            src.queue.pop_front();
+            src.dropped++;
+        }
+        src.queue.push_back(LiveFrame{ buf, seq, captureNs });
+        src.captured++;
+        src.ready.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(src.mtx);
+    src.ended = true;
+    src.ready.notify_all();
+}
+
+void live_start(LiveSource& src, const cv::Size& frameSize, int depth, int held) {
+    src.depth = static_cast<size_t>(depth < 1 ? 1 : depth);
+    src.bufs.assign(src.depth + 1 + static_cast<size_t>(held < 1 ? 1 : held), cv::Mat());
+    src.freeBufs.clear();
+    for (cv::Mat& m : src.bufs) {
+        arena_plane(m, frameSize, CV_8UC3);
+        src.freeBufs.push_back(&m);
+    }
+    src.queue.clear();
+    src.ended = false;
+    src.stopping.store(false);
+    src.captured = 0;
+    src.dropped = 0;
+
+    src.thread = std::thread(capture_loop, std::ref(src));
+}
+
+LiveFrame live_pop(LiveSource& src) {
+    std::unique_lock<std::mutex> lock(src.mtx);
+    src.ready.wait(lock, [&] { return !src.queue.empty() || src.ended; });
+    if (src.queue.empty())
+        return LiveFrame{};
+    LiveFrame f = src.queue.front();
+    src.queue.pop_front();
+    return f;
+}
+
+void live_release(LiveSource& src, LiveFrame& frame) {
+    if (!frame.buf)
+        return;
+    std::lock_guard<std::mutex> lock(src.mtx);
+    src.freeBufs.push_back(frame.buf);
+    frame.buf = nullptr;
+}
+
+size_t live_pending(LiveSource& src) {
+    std::lock_guard<std::mutex> lock(src.mtx);
+    return src.queue.size();
+}
+
+void live_stop(LiveSource& src) {
+    src.stopping.store(true);
+    if (src.thread.joinable())
+        src.thread.join();
+}
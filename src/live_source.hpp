@@ -0,0 +1,89 @@
+// live_source.hpp
+// ------------------------------------------------------------
+// Live capture (camera, RTSP / HTTP stream) for the real-time mode.
+//
+// A capture thread reads the device as fast as it delivers and
+// stamps every frame when read() returns, the closest this side of
+// the driver gets to glass time. Frames wait in a queue of at most
+// `depth` entries; when it is full the oldest waiting frame is
+// dropped, so under load the output skips frames instead of falling
+// behind: latency stays at about depth frames plus the processing
+// of one, however long the stream runs.
+//
+// Each frame carries its capture sequence number, so a consumer sees
+// drops as a jump in seq (the 3D live driver closes the window
+// there, see video_pipeline.hpp). Buffers are preallocated and
+// recycled: depth queued + the one being captured + those held by
+// the consumer (two, R + 1 for the 3D window).
+//
+// Ctrl-C (SIGINT) ends every live source like the end of the
+// stream, so the drivers finish and the files are finalized.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// Camera index ("camera:0", "/dev/video0") or a stream URL
+// (rtsp://, rtsps://, rtmp://, http(s)://, udp://, tcp://)
+bool is_live(const std::string& input);
+
+// Open input for live capture (hwAccel as for files). frameSize is
+// taken from the device, or from one frame read (and dropped).
+bool live_open(const std::string& input, cv::VideoCapture& cap, cv::Size& frameSize, double& fps,
+               cv::VideoAccelerationType hwAccel);
+
+struct LiveFrame {
+    cv::Mat* buf = nullptr;     // nullptr = end of stream
+    long long seq = -1;         // capture index (a jump = dropped frames)
+    int64_t captureNs = 0;      // metrics_now_ns() when read() returned
+};
+
+struct LiveSource {
+    cv::VideoCapture* cap = nullptr;
+    int level = 0;              // pyramid level the frames are decimated to
+    ThreadPool* pool = nullptr; // for the decimation
+    long long maxFrames = 0;    // stop after this many captured, 0 = no limit
+
+    // Capture thread state
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable ready;      // a frame was queued / the stream ended
+    std::deque<LiveFrame> queue;        // oldest first, at most depth
+    std::vector<cv::Mat*> freeBufs;
+    std::vector<cv::Mat> bufs;
+    size_t depth = 1;
+    bool ended = false;
+    std::atomic<bool> stopping{false};
+
+    // Totals (read under mtx or after live_stop)
+    long long captured = 0;
+    long long dropped = 0;
+};
+
+// Start capturing frames of frameSize (after decimation) with at most
+// depth frames waiting and held frames out with the consumer.
+void live_start(LiveSource& src, const cv::Size& frameSize, int depth, int held = 2);
+
+// Block for the next frame; buf == nullptr once the stream ended.
+LiveFrame live_pop(LiveSource& src);
+
+// Hand a popped frame's buffer back.
+void live_release(LiveSource& src, LiveFrame& frame);
+
+// Frames waiting in the queue (a metrics gauge)
+size_t live_pending(LiveSource& src);
+
+// Stop the capture thread (also after the end of the stream).
+void live_stop(LiveSource& src);
@@ -0,0 +1,410 @@
+// metrics.cpp
+// ------------------------------------------------------------
+// Per-thread event rings, collector thread and exporters,
+// see metrics.hpp.
+// ------------------------------------------------------------
+
+#include "metrics.hpp"
+
+#include "spsc_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static std::atomic<bool> gMetricsEnabled{false};
+
+bool metrics_enabled() {
+    return gMetricsEnabled.load(std::memory_order_relaxed);
+}
+
+const char* stage_name(Stage s) {
+    switch (s) {
+    case Stage::Decode:    return "decode";
+    case Stage::CvtColor:  return "cvtcolor";
+    case Stage::Pyramid:   return "pyramid";
+    case Stage::Gradient:  return "gradient";
+    case Stage::Normalize: return "normalize";
+    case Stage::ToBgr:     return "tobgr";
+    case Stage::Encode:    return "encode";
+    case Stage::Latency:   return "latency";
+    case Stage::Count:     break;
+    }
+    return "unknown";
+}
+
+// ------------------------------------------------------------
+// Per-thread rings (producer: the thread, consumer: the collector)
+// ------------------------------------------------------------
+struct StageEvent {
+    int64_t t0 = 0;
+    int64_t ns = 0;
+    Stage stage = Stage::Count;
+};
+
+struct ThreadRing {
+    SpscQueue<StageEvent> events{4096};
+    int tid = 0;
+};
+
+static std::mutex gRingsMtx;
+static std::vector<std::shared_ptr<ThreadRing>> gRings;       // drain() drops the exited threads
+static int gNextTid = 0;
+static thread_local std::shared_ptr<ThreadRing> tRing;
+
+static std::atomic<uint64_t> gDropped{0};
+static std::atomic<uint64_t> gFrames{0};
+
+void metrics_record(Stage s, int64_t t0, int64_t ns) {
+    if (!tRing) {
+        std::lock_guard<std::mutex> lock(gRingsMtx);
+        tRing = std::make_shared<ThreadRing>();
+        tRing->tid = ++gNextTid;
+        gRings.push_back(tRing);
+    }
+
+    StageEvent ev;
+    ev.t0 = t0;
+    ev.ns = ns;
+    ev.stage = s;
+    if (!tRing->events.try_push(ev))
+        gDropped.fetch_add(1, std::memory_order_relaxed);   // collector fell behind
+}
+
+void metrics_frame() {
+    if (metrics_enabled())
+        gFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------
+// Gauges
+// ------------------------------------------------------------
+static std::mutex gGaugesMtx;
+static std::map<int, std::pair<std::string, std::function<double()>>> gGauges;
+static int gNextGauge = 0;
+
+int metrics_add_gauge(const std::string& name, std::function<double()> fn) {
+    std::lock_guard<std::mutex> lock(gGaugesMtx);
+    const int id = ++gNextGauge;
+    gGauges[id] = std::make_pair(name, std::move(fn));
+    return id;
+}
+
+void metrics_remove_gauge(int id) {
+    std::lock_guard<std::mutex> lock(gGaugesMtx);
+    gGauges.erase(id);
+}
+
+// ------------------------------------------------------------
+// Latency histogram: log2 buckets split in 8 (<= 12.5% error)
+// ------------------------------------------------------------
+struct LatencyHist {
+    static const int kBuckets = 62 * 8;
+
+    uint64_t buckets[kBuckets] = {};
+    uint64_t count = 0;
+    double sumNs = 0.0;
+
+    static int index_of(int64_t ns) {
+        if (ns < 8)
+            return ns < 0 ? 0 : static_cast<int>(ns);
+        int e = 63;
+        while (!(static_cast<uint64_t>(ns) >> e)) e--;
+        const int sub = static_cast<int>((ns >> (e - 3)) & 7);
+        return (e - 2) * 8 + sub;
+    }
+
+    // Middle of bucket i
+    static double value_of(int i) {
+        if (i < 8)
+            return i;
+        const int e = i / 8 + 2;
+        const double lo = static_cast<double>((8 + i % 8)) * static_cast<double>(1ull << (e - 3));
+        return lo + 0.5 * static_cast<double>(1ull << (e - 3));
+    }
+
+    void add(int64_t ns) {
+        buckets[index_of(ns)]++;
+        count++;
+        sumNs += static_cast<double>(ns);
+    }
+
+    double quantile(double q) const {
+        if (count == 0)
+            return 0.0;
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += buckets[i];
+            if (seen >= rank)
+                return value_of(i);
+        }
+        return value_of(kBuckets - 1);
+    }
+};
+
+// ------------------------------------------------------------
+// Collector
+// ------------------------------------------------------------
+struct QueueSample {
+    std::string name;
+    double value;
+};
+
+struct Collector {
+    MetricsConfig config;
+    std::ofstream jsonFile;
+    std::ostream* json = nullptr;
+
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    int64_t startNs = 0;
+    int64_t lastReportNs = 0;
+    uint64_t lastFrames = 0;
+
+    LatencyHist hist[static_cast<int>(Stage::Count)];
+
+    // Chrome trace (only with config.tracePath)
+    struct TraceEvent { StageEvent ev; int tid; };
+    std::vector<TraceEvent> trace;
+    uint64_t traceDropped = 0;
+};
+
+static const size_t kMaxTraceEvents = 4u << 20;
+
+static std::unique_ptr<Collector> gCollector;
+
+static void drain(Collector& c) {
+    // A ring that only gRings and this copy hold belongs to a thread
+    // that has exited (its thread_local is gone): it is dropped from
+    // gRings and drained one last time, so the short-lived decoder /
+    // encoder threads of each video do not keep their rings for the
+    // life of the process
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(gRingsMtx);
+        rings.reserve(gRings.size());
+        size_t kept = 0;
+        for (size_t i = 0; i < gRings.size(); i++) {
+            rings.push_back(gRings[i]);
+            if (rings.back().use_count() > 2)
+                gRings[kept++] = gRings[i];
+        }
+        gRings.resize(kept);
+    }
+    // Pairs with the exited thread's release of the ring
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const bool keepTrace = !c.config.tracePath.empty();
+
+    for (const std::shared_ptr<ThreadRing>& r : rings) {
+        StageEvent ev;
+        while (r->events.try_pop(ev)) {
+            c.hist[static_cast<int>(ev.stage)].add(ev.ns);
+            if (keepTrace) {
+                if (c.trace.size() < kMaxTraceEvents)
+                    c.trace.push_back(Collector::TraceEvent{ ev, r->tid });
+                else
+                    c.traceDropped++;
+            }
+        }
+    }
+}
+
+// Gauges of the same name (one per concurrent stream) are summed
+static std::vector<QueueSample> sample_gauges() {
+    std::vector<QueueSample> out;
+    std::lock_guard<std::mutex> lock(gGaugesMtx);
+    for (const auto& g : gGauges) {
+        const double v = g.second.second();
+        auto same = std::find_if(out.begin(), out.end(),
+                                 [&](const QueueSample& q) { return q.name == g.second.first; });
+        if (same != out.end())
+            same->value += v;
+        else
+            out.push_back(QueueSample{ g.second.first, v });
+    }
+    return out;
+}
+
+static void write_json_line(Collector& c, double elapsed, double fps, uint64_t frames,
+                            const std::vector<QueueSample>& gauges) {
+    std::ostringstream js;
+    js << "{\"time_s\":" << elapsed
+       << ",\"frames\":" << frames
+       << ",\"fps\":" << fps
+       << ",\"dropped_events\":" << gDropped.load(std::memory_order_relaxed)
+       << ",\"stages\":{";
+
+    bool first = true;
+    for (int s = 0; s < static_cast<int>(Stage::Count); s++) {
+        const LatencyHist& h = c.hist[s];
+        if (h.count == 0)
+            continue;
+        js << (first ? "" : ",") << "\"" << stage_name(static_cast<Stage>(s)) << "\":{"
+           << "\"count\":" << h.count
+           << ",\"mean_us\":" << h.sumNs / h.count * 1e-3
+           << ",\"p50_us\":" << h.quantile(0.50) * 1e-3
+           << ",\"p99_us\":" << h.quantile(0.99) * 1e-3 << "}";
+        first = false;
+    }
+
+    js << "},\"gauges\":{";
+    for (size_t i = 0; i < gauges.size(); i++)
+        js << (i ? "," : "") << "\"" << gauges[i].name << "\":" << gauges[i].value;
+    js << "}}\n";
+
+    *c.json << js.str() << std::flush;
+}
+
+static void write_prometheus(Collector& c, double fps, uint64_t frames,
+                             const std::vector<QueueSample>& gauges) {
+    std::ostringstream pr;
+
+    pr << "# HELP sobel_stage_latency_seconds Stage latency.\n"
+       << "# TYPE sobel_stage_latency_seconds summary\n";
+    for (int s = 0; s < static_cast<int>(Stage::Count); s++) {
+        const LatencyHist& h = c.hist[s];
+        const char* name = stage_name(static_cast<Stage>(s));
+        pr << "sobel_stage_latency_seconds{stage=\"" << name << "\",quantile=\"0.5\"} "  << h.quantile(0.50) * 1e-9 << "\n"
+           << "sobel_stage_latency_seconds{stage=\"" << name << "\",quantile=\"0.99\"} " << h.quantile(0.99) * 1e-9 << "\n"
+           << "sobel_stage_latency_seconds_sum{stage=\"" << name << "\"} " << h.sumNs * 1e-9 << "\n"
+           << "sobel_stage_latency_seconds_count{stage=\"" << name << "\"} " << h.count << "\n";
+    }
+
+    pr << "# TYPE sobel_frames_total counter\n"  << "sobel_frames_total " << frames << "\n"
+       << "# TYPE sobel_fps gauge\n"             << "sobel_fps " << fps << "\n"
+       << "# TYPE sobel_dropped_events_total counter\n"
+       << "sobel_dropped_events_total " << gDropped.load(std::memory_order_relaxed) << "\n"
+       << "# TYPE sobel_queue_depth gauge\n";
+    for (const QueueSample& g : gauges)
+        pr << "sobel_queue_depth{queue=\"" << g.name << "\"} " << g.value << "\n";
+
+    // Write + rename, so a scraper never sees half a file
+    const std::string tmp = c.config.promPath + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << pr.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, c.config.promPath, ec);
+}
+
+static void report(Collector& c) {
+    const int64_t now = metrics_now_ns();
+    const uint64_t frames = gFrames.load(std::memory_order_relaxed);
+
+    const double dt = (now - c.lastReportNs) * 1e-9;
+    const double fps = dt > 0.0 ? (frames - c.lastFrames) / dt : 0.0;
+    c.lastReportNs = now;
+    c.lastFrames = frames;
+
+    const std::vector<QueueSample> gauges = sample_gauges();
+
+    if (c.json)
+        write_json_line(c, (now - c.startNs) * 1e-9, fps, frames, gauges);
+    if (!c.config.promPath.empty())
+        write_prometheus(c, fps, frames, gauges);
+}
+
+static void write_trace(Collector& c) {
+    std::ofstream out(c.config.tracePath, std::ios::trunc);
+    if (!out) {
+        std::cout << "Could not write trace: " << c.config.tracePath << std::endl;
+        return;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < c.trace.size(); i++) {
+        const Collector::TraceEvent& t = c.trace[i];
+        out << (i ? ",\n" : "")
+            << "{\"name\":\"" << stage_name(t.ev.stage) << "\",\"cat\":\"sobel\",\"ph\":\"X\",\"pid\":1"
+            << ",\"tid\":" << t.tid
+            << ",\"ts\":" << (t.ev.t0 - c.startNs) * 1e-3
+            << ",\"dur\":" << t.ev.ns * 1e-3 << "}";
+    }
+    out << "\n]}\n";
+
+    if (c.traceDropped)
+        std::cout << "Trace truncated: " << c.traceDropped << " events not kept.\n";
+}
+
+static void collector_loop(Collector* c) {
+    // Drain often (rings are small), report every interval
+    const std::chrono::milliseconds tick(20);
+    const int64_t intervalNs = static_cast<int64_t>(c->config.intervalSec * 1e9);
+
+    std::unique_lock<std::mutex> lock(c->mtx);
+    while (!c->stopping) {
+        c->cv.wait_for(lock, tick);
+
+        drain(*c);
+        if (metrics_now_ns() - c->lastReportNs >= intervalNs)
+            report(*c);
+    }
+}
+
+bool metrics_start(const MetricsConfig& config) {
+    if (gCollector || (config.jsonPath.empty() && config.promPath.empty() && config.tracePath.empty()))
+        return true;
+
+    std::unique_ptr<Collector> c(new Collector());
+    c->config = config;
+    if (!(c->config.intervalSec > 0.0))
+        c->config.intervalSec = 1.0;
+
+    if (config.jsonPath == "-") {
+        c->json = &std::cout;
+    } else if (!config.jsonPath.empty()) {
+        c->jsonFile.open(config.jsonPath, std::ios::app);
+        if (!c->jsonFile) {
+            std::cout << "Could not open metrics file: " << config.jsonPath << std::endl;
+            return false;
+        }
+        c->json = &c->jsonFile;
+    }
+
+    c->startNs = c->lastReportNs = metrics_now_ns();
+    c->lastFrames = gFrames.load();
+    c->thread = std::thread(collector_loop, c.get());
+
+    gCollector = std::move(c);
+    gMetricsEnabled.store(true);
+    return true;
+}
+
+void metrics_stop() {
+    if (!gCollector)
+        return;
+
+    gMetricsEnabled.store(false);
+
+    Collector& c = *gCollector;
+    {
+        std::lock_guard<std::mutex> lock(c.mtx);
+        c.stopping = true;
+    }
+    c.cv.notify_one();
+    c.thread.join();
+
+    // This thread is the rings' consumer now
+    drain(c);
+    report(c);
+    if (!c.config.tracePath.empty())
+        write_trace(c);
+
+    gCollector.reset();
+}
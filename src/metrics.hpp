@@ -0,0 +1,94 @@
+// metrics.hpp
+// ------------------------------------------------------------
+// Low-overhead per-stage instrumentation.
+//
+// Hot path: a StageTimer around a stage reads the clock twice and
+// pushes one event into the calling thread's own SPSC ring (no
+// locks, no allocation). With metrics off it is one relaxed load.
+//
+// A collector thread drains every ring, keeps a latency histogram
+// per stage (p50/p99) and samples the registered gauges (queue
+// depths). Every interval it appends one JSON line and/or rewrites
+// a Prometheus text-format file (for a textfile collector / any
+// scraper that reads the exposition format). Optionally all events
+// are kept and written as a Chrome trace (chrome://tracing,
+// ui.perfetto.dev) by metrics_stop().
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// ------------------------------------------------------------
+// Instrumented stages
+// ------------------------------------------------------------
+enum class Stage : uint8_t {
+    Decode,         // VideoCapture read
+    CvtColor,       // BGR -> gray
+    Pyramid,        // --pyramid decimation of the decoded frame
+    Gradient,       // Sobel passes (2D, 3D spatial / temporal)
+    Normalize,      // value range of a plane
+    ToBgr,          // scale to 8 bit + expand to BGR
+    Encode,         // VideoWriter::write
+    Latency,        // live: capture of a frame to its outputs written
+    Count
+};
+
+// "decode", "cvtcolor", "pyramid", "gradient", "normalize", "tobgr", "encode", "latency"
+const char* stage_name(Stage s);
+
+struct MetricsConfig {
+    std::string jsonPath;       // JSON lines every interval ("-" = stdout)
+    std::string promPath;       // Prometheus text file, rewritten every interval
+    std::string tracePath;      // Chrome trace, written by metrics_stop()
+    double intervalSec = 1.0;
+};
+
+// Start the collector (no-op if every path is empty).
+// Returns false if an output cannot be opened.
+bool metrics_start(const MetricsConfig& config);
+
+// Final report + trace file, then stop the collector.
+void metrics_stop();
+
+// Collector running? Out of line so no data symbol crosses the
+// library boundary (a Windows DLL exports functions only).
+bool metrics_enabled();
+
+// One output frame done (fps).
+void metrics_frame();
+
+// Sampled by the collector every interval, e.g. a queue's size().
+// fn must stay valid until metrics_remove_gauge(id) returns.
+int  metrics_add_gauge(const std::string& name, std::function<double()> fn);
+void metrics_remove_gauge(int id);
+
+// Record one stage run [t0, t0 + ns) on the calling thread.
+void metrics_record(Stage s, int64_t t0, int64_t ns);
+
+inline int64_t metrics_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------------------------------------------------------
+// Scoped timer: StageTimer t(Stage::Decode);
+// ------------------------------------------------------------
+class StageTimer {
+public:
+    explicit StageTimer(Stage s) : stage(s), t0(metrics_enabled() ? metrics_now_ns() : -1) {}
+    ~StageTimer() {
+        if (t0 >= 0)
+            metrics_record(stage, t0, metrics_now_ns() - t0);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stage stage;
+    int64_t t0;
+};
@@ -0,0 +1,150 @@
+// motion_gate.cpp
+// ------------------------------------------------------------
+// ROI tiles and the sampled frame-difference test, see motion_gate.hpp.
+// ------------------------------------------------------------
+
+#include "motion_gate.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+bool gate_enabled(const MotionGate& gate) {
+    return gate.threshold > 0.0f || !gate.rois.empty();
+}
+
+bool roi_parse(const char* text, std::vector<cv::Rect>& rois) {
+    std::vector<cv::Rect> parsed;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ';')) {
+        int v[4];
+        const char* p = item.c_str();
+        for (int i = 0; i < 4; i++) {
+            char* end = nullptr;
+            v[i] = static_cast<int>(std::strtol(p, &end, 10));
+            if (end == p || (i < 3 && *end != ',') || (i == 3 && *end != '\0'))
+                return false;
+            p = end + 1;
+        }
+        if (v[0] < 0 || v[1] < 0 || v[2] <= 0 || v[3] <= 0)
+            return false;
+        parsed.push_back(cv::Rect(v[0], v[1], v[2], v[3]));
+    }
+    if (parsed.empty())
+        return false;
+
+    rois.insert(rois.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+// ------------------------------------------------------------
+// ROI mask: GATE_ACTIVE inside a rectangle (rounded out to tiles)
+// ------------------------------------------------------------
+static void roi_tiles(const MotionGate& gate, const cv::Size& size, GateMap& map) {
+    const int block = map.block;
+    if (gate.rois.empty()) {
+        std::fill(map.state.begin(), map.state.end(), GATE_ACTIVE);
+        return;
+    }
+
+    std::fill(map.state.begin(), map.state.end(), GATE_OFF);
+    for (const cv::Rect& roi : gate.rois) {
+        const cv::Rect r = roi & cv::Rect(0, 0, size.width, size.height);
+        if (r.area() == 0)
+            continue;
+        const int bx1 = (r.x + r.width - 1) / block + 1;
+        const int by1 = (r.y + r.height - 1) / block + 1;
+        for (int by = r.y / block; by < by1; by++)
+            for (int bx = r.x / block; bx < bx1; bx++)
+                map.state[static_cast<size_t>(by) * map.blocksX + bx] = GATE_ACTIVE;
+    }
+}
+
+cv::Rect gate_area(const MotionGate& gate, const cv::Size& size) {
+    const cv::Rect frame(0, 0, size.width, size.height);
+    if (gate.rois.empty())
+        return frame;
+
+    const int block = std::max(1, gate.block);
+    cv::Rect area;
+    for (const cv::Rect& roi : gate.rois) {
+        const cv::Rect r = roi & frame;
+        if (r.area() == 0)
+            continue;
+        const int x0 = r.x / block * block;
+        const int y0 = r.y / block * block;
+        const cv::Rect tiles(x0, y0,
+                             ((r.x + r.width - 1) / block + 1) * block - x0,
+                             ((r.y + r.height - 1) / block + 1) * block - y0);
+        area = area.area() ? (area | tiles) : tiles;
+    }
+    return area & frame;
+}
+
+void gate_update(const MotionGate& gate,
+                 const cv::Mat& ssPrev,
+                 const cv::Mat& ssNext,
+                 BorderMode border,
+                 GateMap& map,
+                 ThreadPool* pool) {
+    const int rows = ssNext.rows;
+    const int cols = ssNext.cols;
+    const int block = std::max(1, gate.block);
+
+    map.block = block;
+    map.blocksX = (cols + block - 1) / block;
+    map.blocksY = (rows + block - 1) / block;
+    map.state.resize(static_cast<size_t>(map.blocksX) * map.blocksY);
+
+    roi_tiles(gate, ssNext.size(), map);
+
+    if (gate.threshold > 0.0f) {
+        // ss is 16x the gray level (Sx Sy sums to 16)
+        const int inset = border == BorderMode::Zero ? 1 : 0;
+        const float limit = gate.threshold * 16.0f;
+        const size_t bytesPerRow = static_cast<size_t>(cols) * block * 2 * sizeof(short) / GATE_ROW_STEP;
+
+        parallel_for_rows(pool, 0, map.blocksY, bytesPerRow, [&](int b0, int b1) {
+            static thread_local std::vector<long long> sums;
+            static thread_local std::vector<int> counts;
+
+            for (int by = b0; by < b1; by++) {
+                uint8_t* states = map.state.data() + static_cast<size_t>(by) * map.blocksX;
+                sums.assign(map.blocksX, 0);
+                counts.assign(map.blocksX, 0);
+
+                const int ya = std::max(by * block, inset);
+                const int yb = std::min((by + 1) * block, rows - inset);
+                for (int y = ya; y < yb; y += GATE_ROW_STEP) {
+                    const short* p = ssPrev.ptr<short>(y);
+                    const short* n = ssNext.ptr<short>(y);
+                    for (int bx = 0; bx < map.blocksX; bx++) {
+                        if (states[bx] == GATE_OFF)
+                            continue;
+                        const int xa = std::max(bx * block, inset);
+                        const int xb = std::min((bx + 1) * block, cols - inset);
+                        int sum = 0;
+                        for (int x = xa; x < xb; x++)
+                            sum += std::abs(n[x] - p[x]);
+                        sums[bx] += sum;
+                        counts[bx] += std::max(0, xb - xa);
+                    }
+                }
+
+                // A tile with nothing to sample (inside the zero border) stays active
+                for (int bx = 0; bx < map.blocksX; bx++) {
+                    if (states[bx] != GATE_OFF && counts[bx] > 0 &&
+                        static_cast<float>(sums[bx]) < limit * static_cast<float>(counts[bx]))
+                        states[bx] = GATE_STATIC;
+                }
+            }
+        });
+    }
+
+    for (uint8_t s : map.state) {
+        map.active += s == GATE_ACTIVE;
+        map.total  += s != GATE_OFF;
+    }
+}
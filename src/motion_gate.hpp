@@ -0,0 +1,83 @@
+// motion_gate.hpp
+// ------------------------------------------------------------
+// Regions of interest and a motion gate for the 3D temporal pass.
+//
+// In surveillance-style footage most of the frame is static: Gt is
+// ~0 there, yet the temporal pass reads 8 planes of 3 frames per
+// pixel. The gate tiles the frame into block x block pixels and gives
+// every tile a state per window:
+//
+//   GATE_OFF     outside every ROI rectangle: gt / mag3d are 0
+//   GATE_STATIC  the smoothed frame difference |ss[next] - ss[prev]|
+//                / 16 (gray levels, every GATE_ROW_STEP-th row of
+//                the tile) averages below the threshold: Gt = 0 and
+//                Gx / Gy from curr's cached spatial planes alone
+//                (4 dxs, 4 sdy: what a still scene gives)
+//   GATE_ACTIVE  the full temporal pass
+//
+// ROI rectangles are rounded out to the tile grid. No ROI = the
+// whole frame; threshold 0 = every tile inside an ROI is active.
+//
+// The spatial pass is limited to the bounding box of the ROI tiles
+// (gate_area) but not to the active tiles: its planes are prev /
+// next of the following windows, whose states are not known yet.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "grad_modes.hpp"
+#include "thread_pool.hpp"
+
+enum : uint8_t { GATE_OFF = 0, GATE_STATIC = 1, GATE_ACTIVE = 2 };
+
+// Rows of a tile sampled by the motion test (1 in GATE_ROW_STEP)
+const int GATE_ROW_STEP = 4;
+
+struct MotionGate {
+    float threshold = 0.0f;         // gray levels, 0 = no motion test
+    int block = 16;                 // tile side in pixels
+    std::vector<cv::Rect> rois;     // empty = the whole frame
+};
+
+// Tile states of the current window
+struct GateMap {
+    int block = 0;
+    int blocksX = 0;
+    int blocksY = 0;
+    std::vector<uint8_t> state;     // blocksY x blocksX
+
+    // Totals over the windows since sobel3d_reset
+    long long active = 0;           // GATE_ACTIVE tiles
+    long long total = 0;            // tiles inside an ROI
+};
+
+// Threshold or ROIs set
+bool gate_enabled(const MotionGate& gate);
+
+// Append "x,y,w,h" rectangles, several separated by ';'. Returns
+// false (rois untouched) on anything else or an empty rectangle.
+bool roi_parse(const char* text, std::vector<cv::Rect>& rois);
+
+// Bounding box of the ROI tiles (clipped to size), the whole frame
+// without ROIs
+cv::Rect gate_area(const MotionGate& gate, const cv::Size& size);
+
+// States for the window prev / next (their ss planes, CV_16S).
+// With BorderMode::Zero the 1-pixel frame border is not sampled
+// (the spatial pass leaves it unwritten).
+void gate_update(const MotionGate& gate,
+                 const cv::Mat& ssPrev,
+                 const cv::Mat& ssNext,
+                 BorderMode border,
+                 GateMap& map,
+                 ThreadPool* pool = nullptr);
+
+// States of the tiles row y lies in, indexed by x / map.block
+inline const uint8_t* gate_row(const GateMap& map, int y) {
+    return map.state.data() + static_cast<size_t>(y / map.block) * map.blocksX;
+}
@@ -0,0 +1,361 @@
+// normalize.cpp
+// ------------------------------------------------------------
+// Fused normalize -> 8-bit -> BGR output stage, see normalize.hpp.
+// ------------------------------------------------------------
+
+#include "normalize.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+const char* norm_mode_name(NormMode m) {
+    switch (m) {
+    case NormMode::MinMax:     return "minmax";
+    case NormMode::PrevFrame:  return "prev";
+    case NormMode::Fixed:      return "fixed";
+    case NormMode::Ema:        return "ema";
+    case NormMode::Percentile: return "percentile";
+    }
+    return "unknown";
+}
+
+bool norm_mode_parse(const char* name, NormMode& m) {
+    const NormMode all[] = { NormMode::MinMax, NormMode::PrevFrame, NormMode::Fixed,
+                             NormMode::Ema, NormMode::Percentile };
+    for (NormMode v : all) {
+        if (std::strcmp(name, norm_mode_name(v)) == 0) {
+            m = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+void range_of_row(const float* v, int x0, int x1, bool useAbs, NormRange& r) {
+    float lo = r.lo, hi = r.hi;
+
+    for (int x = x0; x < x1; x++) {
+        float a = useAbs ? std::fabs(v[x]) : v[x];
+        lo = a < lo ? a : lo;
+        hi = a > hi ? a : hi;
+    }
+
+    r.lo = lo;
+    r.hi = hi;
+}
+
+// Integer rows (int16 gradients, uint8 orientation bins)
+template <typename T>
+static void range_of_int_row(const T* v, int x0, int x1, bool useAbs, NormRange& r) {
+    int lo = INT_MAX, hi = INT_MIN;
+
+    for (int x = x0; x < x1; x++) {
+        int a = useAbs ? std::abs(v[x]) : v[x];
+        lo = a < lo ? a : lo;
+        hi = a > hi ? a : hi;
+    }
+
+    if (lo <= hi) {
+        range_add(r, static_cast<float>(lo));
+        range_add(r, static_cast<float>(hi));
+    }
+}
+
+void range_of_row(const int16_t* v, int x0, int x1, bool useAbs, NormRange& r) {
+    range_of_int_row(v, x0, x1, useAbs, r);
+}
+
+void range_of_row(const uint8_t* v, int x0, int x1, bool useAbs, NormRange& r) {
+    range_of_int_row(v, x0, x1, useAbs, r);
+}
+
+void range_scale(const NormRange& r, float& scale, float& shift) {
+    // Same rule as cv::normalize: a flat frame maps to 0
+    double span = r.valid() ? static_cast<double>(r.hi) - r.lo : 0.0;
+    double s = span > DBL_EPSILON ? 255.0 / span : 0.0;
+
+    scale = static_cast<float>(s);
+    shift = r.valid() ? static_cast<float>(-r.lo * s) : 0.0f;
+}
+
+// ------------------------------------------------------------
+// Frame-to-frame scale state
+// ------------------------------------------------------------
+bool norm_pick(NormMode mode, const NormTrack& t, NormRange& range) {
+    switch (mode) {
+    case NormMode::MinMax:     return false;
+    case NormMode::PrevFrame:  range = t.last;  break;
+    case NormMode::Fixed:      range = t.fixed; break;
+    case NormMode::Ema:        range = t.ema;   break;
+    case NormMode::Percentile: range = t.pct;   break;
+    }
+    return range.valid();
+}
+
+// Value at which the running count of hist passes count
+// (lower bin edge for the low end, upper edge for the high end)
+static float hist_value(const std::vector<uint32_t>& hist, const NormRange& span,
+                        double count, bool upperEdge) {
+    const double binWidth = (static_cast<double>(span.hi) - span.lo) / NORM_HIST_BINS;
+    double seen = 0.0;
+    for (int k = 0; k < NORM_HIST_BINS; k++) {
+        seen += hist[k];
+        if (seen > count || (upperEdge && seen >= count))
+            return static_cast<float>(span.lo + binWidth * (k + (upperEdge ? 1 : 0)));
+    }
+    return span.hi;
+}
+
+void norm_update(NormMode mode, const NormParams& params, const NormRange& frame, NormTrack& t) {
+    if (!frame.valid())
+        return;
+    t.last = frame;
+
+    if (!t.ema.valid()) {
+        t.ema = frame;
+    } else {
+        const float a = params.emaAlpha;
+        t.ema.lo = a * frame.lo + (1.0f - a) * t.ema.lo;
+        t.ema.hi = a * frame.hi + (1.0f - a) * t.ema.hi;
+    }
+
+    if (norm_wants_hist(mode) && t.hist.size() == NORM_HIST_BINS && t.fixed.valid()) {
+        double total = 0.0;
+        for (uint32_t c : t.hist)
+            total += c;
+
+        if (total > 0.0) {
+            const double p = params.percentile / 100.0;
+            t.pct.lo = hist_value(t.hist, t.fixed, total * (1.0 - p), false);
+            t.pct.hi = hist_value(t.hist, t.fixed, total * p, true);
+            // Never wider than what the frame actually held
+            if (t.pct.lo < frame.lo) t.pct.lo = frame.lo;
+            if (t.pct.hi > frame.hi) t.pct.hi = frame.hi;
+        }
+        std::fill(t.hist.begin(), t.hist.end(), 0u);
+    }
+}
+
+void norm_reset(NormTrack& t) {
+    t.last = NormRange();
+    t.ema  = NormRange();
+    t.pct  = NormRange();
+    std::fill(t.hist.begin(), t.hist.end(), 0u);
+}
+
+template <typename T>
+static void hist_of_row_t(const T* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist) {
+    const float binScale = span.hi > span.lo ? NORM_HIST_BINS / (span.hi - span.lo) : 0.0f;
+    const float lo = span.lo;
+
+    for (int x = x0; x < x1; x++) {
+        float a = useAbs ? std::fabs(static_cast<float>(v[x])) : static_cast<float>(v[x]);
+        int k = static_cast<int>((a - lo) * binScale);
+        k = k < 0 ? 0 : k >= NORM_HIST_BINS ? NORM_HIST_BINS - 1 : k;
+        hist[k]++;
+    }
+}
+
+void hist_of_row(const float* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist) {
+    hist_of_row_t(v, x0, x1, useAbs, span, hist);
+}
+
+void hist_of_row(const int16_t* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist) {
+    hist_of_row_t(v, x0, x1, useAbs, span, hist);
+}
+
+void hist_of_row(const uint8_t* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist) {
+    hist_of_row_t(v, x0, x1, useAbs, span, hist);
+}
+
+void norm_hist_merge(NormTrack& t, const uint32_t* hist) {
+    t.hist.resize(NORM_HIST_BINS, 0u);
+    for (int k = 0; k < NORM_HIST_BINS; k++)
+        t.hist[k] += hist[k];
+}
+
+// B=G=R (CN = 3) or gray (CN = 1) bytes. Integer rows use the same
+// float mapping as the float row, so an integer plane and its
+// CV_32F copy give the same bytes
+template <int CN, typename T>
+static void row_to_u8(const T* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst) {
+    for (int x = 0; x < cols; x++) {
+        float a = useAbs ? std::fabs(static_cast<float>(v[x])) : static_cast<float>(v[x]);
+        long q = std::lrintf(a * scale + shift);          // round to nearest like convertTo
+        uint8_t b = static_cast<uint8_t>(q < 0 ? 0 : q > 255 ? 255 : q);
+
+        for (int c = 0; c < CN; c++)
+            dst[CN * x + c] = b;
+    }
+}
+
+template <typename T>
+static void row_to_cn(const T* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn) {
+    if (cn == 1)
+        row_to_u8<1>(v, cols, useAbs, scale, shift, dst);
+    else
+        row_to_u8<3>(v, cols, useAbs, scale, shift, dst);
+}
+
+void row_to_bgr(const float* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn) {
+    row_to_cn(v, cols, useAbs, scale, shift, dst, cn);
+}
+
+void row_to_bgr(const int16_t* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn) {
+    row_to_cn(v, cols, useAbs, scale, shift, dst, cn);
+}
+
+void row_to_bgr(const uint8_t* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn) {
+    row_to_cn(v, cols, useAbs, scale, shift, dst, cn);
+}
+
+void plane_to_bgr(ThreadPool* pool, const cv::Mat& src, bool useAbs,
+                  const NormRange& range, cv::Mat& bgr, int cn) {
+    StageTimer timer(Stage::ToBgr);
+    bgr.create(src.size(), CV_8UC(cn));
+
+    float scale, shift;
+    range_scale(range, scale, shift);
+
+    const int depth = src.depth();
+    const size_t bytesPerRow = static_cast<size_t>(src.cols) * (src.elemSize() + cn);
+
+    parallel_for_rows(pool, 0, src.rows, bytesPerRow, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            if (depth == CV_16S)
+                row_to_bgr(src.ptr<int16_t>(y), src.cols, useAbs, scale, shift, bgr.ptr<uint8_t>(y), cn);
+            else if (depth == CV_8U)
+                row_to_bgr(src.ptr<uint8_t>(y), src.cols, useAbs, scale, shift, bgr.ptr<uint8_t>(y), cn);
+            else
+                row_to_bgr(src.ptr<float>(y), src.cols, useAbs, scale, shift, bgr.ptr<uint8_t>(y), cn);
+        }
+    });
+}
+
+NormRange range_of_plane(ThreadPool* pool, const cv::Mat& src, bool useAbs) {
+    StageTimer timer(Stage::Normalize);
+    NormRange range;
+    std::mutex rangeMtx;
+
+    const int depth = src.depth();
+    const size_t bytesPerRow = static_cast<size_t>(src.cols) * src.elemSize();
+
+    parallel_for_rows(pool, 0, src.rows, bytesPerRow, [&](int y0, int y1) {
+        NormRange r;
+        for (int y = y0; y < y1; y++) {
+            if (depth == CV_16S)
+                range_of_row(src.ptr<int16_t>(y), 0, src.cols, useAbs, r);
+            else if (depth == CV_8U)
+                range_of_row(src.ptr<uint8_t>(y), 0, src.cols, useAbs, r);
+            else
+                range_of_row(src.ptr<float>(y), 0, src.cols, useAbs, r);
+        }
+
+        std::lock_guard<std::mutex> lock(rangeMtx);
+        range_merge(range, r);
+    });
+
+    return range;
+}
+
+// One row of plane_to_bgr_norm: bytes with scale / shift (when dst
+// is set), range and histogram (when hist is set) of the row
+template <typename T>
+static void row_norm(const T* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn,
+                     NormRange& r, const NormRange& span, uint32_t* hist) {
+    range_of_row(v, 0, cols, useAbs, r);
+    if (hist)
+        hist_of_row(v, 0, cols, useAbs, span, hist);
+    if (dst)
+        row_to_bgr(v, cols, useAbs, scale, shift, dst, cn);
+}
+
+// Range (+ histogram) of src, and its bytes when bgr is set
+static NormRange plane_stats(ThreadPool* pool, const cv::Mat& src, bool useAbs, NormTrack& t,
+                             bool wantHist, const NormRange* scaleWith, cv::Mat* bgr, int cn) {
+    NormRange range;
+    std::mutex statsMtx;
+
+    float scale = 0.0f, shift = 0.0f;
+    if (scaleWith)
+        range_scale(*scaleWith, scale, shift);
+
+    const int depth = src.depth();
+    const size_t bytesPerRow = static_cast<size_t>(src.cols) * (src.elemSize() + (bgr ? cn : 0));
+
+    parallel_for_rows(pool, 0, src.rows, bytesPerRow, [&](int y0, int y1) {
+        NormRange r;
+        std::vector<uint32_t> h(wantHist ? NORM_HIST_BINS : 0, 0u);
+        uint32_t* hist = wantHist ? h.data() : nullptr;
+
+        for (int y = y0; y < y1; y++) {
+            uint8_t* dst = bgr ? bgr->ptr<uint8_t>(y) : nullptr;
+            if (depth == CV_16S)
+                row_norm(src.ptr<int16_t>(y), src.cols, useAbs, scale, shift, dst, cn, r, t.fixed, hist);
+            else if (depth == CV_8U)
+                row_norm(src.ptr<uint8_t>(y), src.cols, useAbs, scale, shift, dst, cn, r, t.fixed, hist);
+            else
+                row_norm(src.ptr<float>(y), src.cols, useAbs, scale, shift, dst, cn, r, t.fixed, hist);
+        }
+
+        std::lock_guard<std::mutex> lock(statsMtx);
+        range_merge(range, r);
+        if (hist)
+            norm_hist_merge(t, hist);
+    });
+
+    return range;
+}
+
+void plane_to_bgr_norm(ThreadPool* pool, const cv::Mat& src, bool useAbs,
+                       NormMode mode, const NormParams& params, NormTrack& t,
+                       cv::Mat& bgr, int cn) {
+    const bool wantHist = norm_wants_hist(mode) && t.fixed.valid();
+
+    NormRange range;
+    if (norm_pick(mode, t, range)) {
+        // Scale known: bytes and this frame's statistics in one pass
+        StageTimer timer(Stage::ToBgr);
+        bgr.create(src.size(), CV_8UC(cn));
+        norm_update(mode, params, plane_stats(pool, src, useAbs, t, wantHist, &range, &bgr, cn), t);
+        return;
+    }
+
+    NormRange frame;
+    {
+        StageTimer timer(Stage::Normalize);
+        frame = plane_stats(pool, src, useAbs, t, wantHist, nullptr, nullptr, cn);
+    }
+    norm_update(mode, params, frame, t);
+
+    // MinMax, or the first frame of the others (their range is now this frame's)
+    if (!norm_pick(mode, t, range))
+        range = frame;
+    plane_to_bgr(pool, src, useAbs, range, bgr, cn);
+}
+
+void pack_channels(ThreadPool* pool, const cv::Mat* b, const cv::Mat* g, const cv::Mat* r,
+                   const cv::Size& size, cv::Mat& packed) {
+    StageTimer timer(Stage::ToBgr);
+    packed.create(size, CV_8UC3);
+
+    const cv::Mat* planes[3] = { b, g, r };
+    const size_t bytesPerRow = static_cast<size_t>(size.width) * 6;
+
+    parallel_for_rows(pool, 0, size.height, bytesPerRow, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            uint8_t* dst = packed.ptr<uint8_t>(y);
+            for (int c = 0; c < 3; c++) {
+                const uint8_t* src = planes[c] ? planes[c]->ptr<uint8_t>(y) : nullptr;
+                for (int x = 0; x < size.width; x++)
+                    dst[3 * x + c] = src ? src[x] : 0;
+            }
+        }
+    });
+}
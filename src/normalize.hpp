@@ -0,0 +1,148 @@
+// normalize.hpp
+// ------------------------------------------------------------
+// Fused normalize -> 8-bit -> BGR output stage.
+//
+// The old per-frame chain was
+//   cv::abs -> cv::normalize(NORM_MINMAX) -> convertTo(CV_8U) -> cvtColor(GRAY2BGR)
+// i.e. ~4 full-frame passes per output. Here the value range is
+// tracked while the gradient is produced, and one pass maps a
+// float (or int16 / uint8, grad_modes.hpp) row straight to B=G=R bytes.
+// With cn = 1 (--color gray) the same pass writes one gray byte per
+// pixel instead, for single-channel writers: no GRAY2BGR expansion.
+//
+// Scaling matches cv::normalize(NORM_MINMAX) into [0, 255] followed
+// by convertTo(CV_8U) (round to nearest, saturate).
+//
+// The NormMode picks the range that is mapped to [0, 255]. Only
+// MinMax needs the frame's own range before it can write a byte;
+// the others know their scale up front, so gradient, statistics and
+// bytes are one pass over the frame (the statistics feed the next
+// frame), and the scale no longer jumps with each frame's extremes:
+//   Fixed       [0, bound of the kernel weights] (grad_modes.hpp),
+//               the same for every frame and every clip
+//   PrevFrame   the previous frame's min/max
+//   Ema         running average of the previous frames' min/max
+//   Percentile  [100 - p, p] percentiles of the previous frame,
+//               from a histogram over the Fixed range kept during
+//               the gradient pass (outliers saturate)
+// PrevFrame / Ema / Percentile scale their first frame with its
+// own statistics (two passes).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// ------------------------------------------------------------
+// How to pick the scale of a frame
+// ------------------------------------------------------------
+enum class NormMode {
+    MinMax,         // this frame's min/max (two passes, matches the old output)
+    PrevFrame,      // previous frame's min/max (one pass, no float planes)
+    Fixed,          // range the kernel weights allow (one pass)
+    Ema,            // running average of previous min/max (one pass)
+    Percentile      // previous frame's percentiles (one pass)
+};
+
+// "minmax", "prev", "fixed", "ema", "percentile"
+const char* norm_mode_name(NormMode m);
+bool norm_mode_parse(const char* name, NormMode& m);
+
+struct NormParams {
+    float emaAlpha   = 0.1f;    // Ema: weight of the newest frame
+    float percentile = 99.5f;   // Percentile: hi = p, lo = 100 - p
+};
+
+const int NORM_HIST_BINS = 1024;
+
+// ------------------------------------------------------------
+// Value range seen so far (lo > hi means empty)
+// ------------------------------------------------------------
+struct NormRange {
+    float lo =  1e30f;
+    float hi = -1e30f;
+
+    bool valid() const { return lo <= hi; }
+};
+
+inline void range_add(NormRange& r, float v) {
+    if (v < r.lo) r.lo = v;
+    if (v > r.hi) r.hi = v;
+}
+
+inline void range_merge(NormRange& r, const NormRange& o) {
+    if (o.lo < r.lo) r.lo = o.lo;
+    if (o.hi > r.hi) r.hi = o.hi;
+}
+
+// ------------------------------------------------------------
+// Scale state of one output plane, carried from frame to frame
+// ------------------------------------------------------------
+struct NormTrack {
+    NormRange fixed;            // Fixed range, also the histogram span (set by the caller)
+    NormRange last;             // previous frame's min/max
+    NormRange ema;              // running average of last
+    NormRange pct;              // percentiles of the previous frame
+    std::vector<uint32_t> hist; // this frame's histogram (Percentile)
+};
+
+inline bool norm_wants_hist(NormMode m) {
+    return m == NormMode::Percentile;
+}
+
+// Range to scale this frame with before its own statistics exist.
+// False: the mode needs this frame's range (MinMax, first frame).
+bool norm_pick(NormMode mode, const NormTrack& t, NormRange& range);
+
+// Fold this frame's range (and t.hist) into the history and clear
+// t.hist for the next frame.
+void norm_update(NormMode mode, const NormParams& params, const NormRange& frame, NormTrack& t);
+
+// Forget the history (fixed is kept).
+void norm_reset(NormTrack& t);
+
+// Add a row to a NORM_HIST_BINS histogram over span (clamped at both
+// ends), optionally of |v|
+void hist_of_row(const float* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist);
+void hist_of_row(const int16_t* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist);
+void hist_of_row(const uint8_t* v, int x0, int x1, bool useAbs, const NormRange& span, uint32_t* hist);
+
+// hist[NORM_HIST_BINS] into t.hist
+void norm_hist_merge(NormTrack& t, const uint32_t* hist);
+
+// Range of a float / int16 / uint8 row, x in [x0, x1), optionally of |v|
+void range_of_row(const float* v, int x0, int x1, bool useAbs, NormRange& r);
+void range_of_row(const int16_t* v, int x0, int x1, bool useAbs, NormRange& r);
+void range_of_row(const uint8_t* v, int x0, int x1, bool useAbs, NormRange& r);
+
+// cv::normalize(NORM_MINMAX) mapping of range -> [0, 255]
+void range_scale(const NormRange& r, float& scale, float& shift);
+
+// dst[cn x + c] = saturate(round(v * scale + shift)) for c < cn (3 = BGR, 1 = gray)
+void row_to_bgr(const float* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn = 3);
+void row_to_bgr(const int16_t* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn = 3);
+void row_to_bgr(const uint8_t* v, int cols, bool useAbs, float scale, float shift, uint8_t* dst, int cn = 3);
+
+// Range of a whole CV_32F / CV_16S / CV_8U plane (borders included, like cv::normalize)
+NormRange range_of_plane(ThreadPool* pool, const cv::Mat& src, bool useAbs);
+
+// Whole CV_32F / CV_16S / CV_8U plane -> CV_8UC(cn) in one pass (bgr allocated here).
+void plane_to_bgr(ThreadPool* pool, const cv::Mat& src, bool useAbs,
+                  const NormRange& range, cv::Mat& bgr, int cn = 3);
+
+// plane_to_bgr with the range of mode / t: one pass that also
+// gathers this frame's statistics, or (MinMax, first frame) a
+// statistics pass first. Updates t.
+void plane_to_bgr_norm(ThreadPool* pool, const cv::Mat& src, bool useAbs,
+                       NormMode mode, const NormParams& params, NormTrack& t,
+                       cv::Mat& bgr, int cn = 3);
+
+// Interleave up to three CV_8UC1 planes into the B, G, R channels
+// of one CV_8UC3 frame (--pack channels); a nullptr plane gives 0.
+void pack_channels(ThreadPool* pool, const cv::Mat* b, const cv::Mat* g, const cv::Mat* r,
+                   const cv::Size& size, cv::Mat& packed);
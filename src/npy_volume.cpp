@@ -0,0 +1,318 @@
+// npy_volume.cpp
+// ------------------------------------------------------------
+// .npy volume sidecars, see npy_volume.hpp.
+// ------------------------------------------------------------
+
+#include "npy_volume.hpp"
+#include "metrics.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char* npy_descr(int type) {
+    switch (type) {
+    case CV_8U:  return "|u1";
+    case CV_16S: return "<i2";
+    case CV_16U: return "<u2";
+    case CV_32S: return "<i4";
+    case CV_32F: return "<f4";
+    case CV_64F: return "<f8";
+    }
+    return nullptr;
+}
+
+// Magic, version 1.0, little-endian header length, then the dict
+// padded with spaces to NPY_HEADER_BYTES (ends in '\n')
+static void header_bytes(const NpyWriter& w, char (&out)[NPY_HEADER_BYTES]) {
+    std::memset(out, ' ', sizeof(out));
+
+    const unsigned char magic[8] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+    std::memcpy(out, magic, sizeof(magic));
+
+    const uint16_t dictLen = NPY_HEADER_BYTES - 10;
+    out[8] = static_cast<char>(dictLen & 0xff);
+    out[9] = static_cast<char>(dictLen >> 8);
+
+    const std::string dict = cv::format("{'descr': '%s', 'fortran_order': False, 'shape': (%lld, %d, %d), }",
+                                        npy_descr(w.type), w.frames, w.size.height, w.size.width);
+    std::memcpy(out + 10, dict.data(), dict.size());
+    out[NPY_HEADER_BYTES - 1] = '\n';
+}
+
+bool npy_open(NpyWriter& w, const std::string& path) {
+    w.file.open(path, std::ios::binary | std::ios::trunc);
+    w.path = path;
+    w.type = -1;
+    w.frames = 0;
+    if (!w.file) {
+        std::cout << "Could not create raw output: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool npy_is_open(const NpyWriter& w) {
+    return w.file.is_open();
+}
+
+bool npy_write(NpyWriter& w, const cv::Mat& plane) {
+    if (!w.file.is_open())
+        return false;
+    StageTimer timer(Stage::Encode);
+
+    if (w.type < 0) {
+        if (plane.channels() != 1 || npy_descr(plane.type()) == nullptr) {
+            std::cout << "Raw output needs a single-channel plane: " << w.path << std::endl;
+            return false;
+        }
+        w.type = plane.type();
+        w.size = plane.size();
+
+        char header[NPY_HEADER_BYTES];
+        header_bytes(w, header);
+        w.file.write(header, sizeof(header));
+    } else if (plane.type() != w.type || plane.size() != w.size) {
+        std::cout << "Raw output frame does not match the first one: " << w.path << std::endl;
+        return false;
+    }
+
+    const std::streamsize rowBytes = static_cast<std::streamsize>(plane.cols * plane.elemSize());
+    if (plane.isContinuous()) {
+        w.file.write(reinterpret_cast<const char*>(plane.data), rowBytes * plane.rows);
+    } else {
+        for (int y = 0; y < plane.rows; y++)
+            w.file.write(reinterpret_cast<const char*>(plane.ptr(y)), rowBytes);
+    }
+
+    w.frames++;
+    return static_cast<bool>(w.file);
+}
+
+bool npy_close(NpyWriter& w) {
+    if (!w.file.is_open())
+        return true;
+
+    bool ok = static_cast<bool>(w.file);
+    if (ok && w.type >= 0) {
+        char header[NPY_HEADER_BYTES];
+        header_bytes(w, header);
+        w.file.seekp(0);
+        w.file.write(header, sizeof(header));
+        ok = static_cast<bool>(w.file);
+    }
+
+    w.file.close();
+    if (!ok)
+        std::cout << "Failed to write raw output: " << w.path << std::endl;
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Reading
+// ------------------------------------------------------------
+
+static int type_for_descr(const std::string& descr) {
+    static const int types[] = { CV_8U, CV_16S, CV_16U, CV_32S, CV_32F, CV_64F };
+    for (int type : types) {
+        if (descr == npy_descr(type))
+            return type;
+    }
+    if (descr == "<u1" || descr == "u1")
+        return CV_8U;
+    return -1;
+}
+
+// The quoted value after 'key': in the header dict
+static bool dict_value(const std::string& dict, const char* key, std::string& value) {
+    const size_t at = dict.find(std::string("'") + key + "'");
+    if (at == std::string::npos)
+        return false;
+    size_t pos = dict.find(':', at);
+    if (pos == std::string::npos)
+        return false;
+    pos = dict.find_first_not_of(' ', pos + 1);
+    if (pos == std::string::npos)
+        return false;
+
+    size_t end;
+    if (dict[pos] == '\'') {
+        end = dict.find('\'', ++pos);
+    } else if (dict[pos] == '(') {
+        end = dict.find(')', ++pos);
+    } else {
+        end = dict.find_first_of(",}", pos);
+    }
+    if (end == std::string::npos)
+        return false;
+    value = dict.substr(pos, end - pos);
+    return true;
+}
+
+// "(N, H, W)" or "(H, W)" without the parentheses
+static bool parse_shape(const std::string& shape, long long dims[3], int& ndim) {
+    ndim = 0;
+    const char* p = shape.c_str();
+    while (*p) {
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (!*p)
+            break;
+        char* end = nullptr;
+        const long long d = std::strtoll(p, &end, 10);
+        if (end == p || d < 0 || ndim == 3)
+            return false;
+        dims[ndim++] = d;
+        p = end;
+    }
+    return ndim >= 2;
+}
+
+static bool map_file(NpyVolume& vol, const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER len;
+    if (!GetFileSizeEx(file, &len) || len.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    vol.file = file;
+    vol.mapping = mapping;
+    vol.base = base;
+    vol.bytes = static_cast<size_t>(len.QuadPart);
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                  // the mapping keeps the file referenced
+    if (base == MAP_FAILED)
+        return false;
+    // Frames are consumed front to back
+    madvise(base, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    vol.base = base;
+    vol.bytes = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+bool npy_map(NpyVolume& vol, const std::string& path) {
+    npy_unmap(vol);
+    if (!map_file(vol, path)) {
+        std::cout << "Could not map volume: " << path << std::endl;
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(vol.base);
+    const unsigned char magic[6] = { 0x93, 'N', 'U', 'M', 'P', 'Y' };
+    size_t dictAt = 0, dictLen = 0;
+    if (vol.bytes >= 10 && std::memcmp(bytes, magic, sizeof(magic)) == 0) {
+        if (bytes[6] == 1) {
+            dictAt = 10;
+            dictLen = bytes[8] | (bytes[9] << 8);
+        } else if ((bytes[6] == 2 || bytes[6] == 3) && vol.bytes >= 12) {
+            dictAt = 12;
+            dictLen = bytes[8] | (bytes[9] << 8) | (bytes[10] << 16) | (static_cast<size_t>(bytes[11]) << 24);
+        }
+    }
+    if (dictAt == 0 || dictAt + dictLen > vol.bytes) {
+        std::cout << "Not an .npy file: " << path << std::endl;
+        npy_unmap(vol);
+        return false;
+    }
+
+    const std::string dict(reinterpret_cast<const char*>(bytes + dictAt), dictLen);
+    std::string descr, order, shape;
+    long long dims[3] = { 0, 0, 0 };
+    int ndim = 0;
+    if (!dict_value(dict, "descr", descr) || !dict_value(dict, "fortran_order", order) ||
+        !dict_value(dict, "shape", shape) || !parse_shape(shape, dims, ndim)) {
+        std::cout << "Unreadable .npy header: " << path << std::endl;
+        npy_unmap(vol);
+        return false;
+    }
+
+    vol.type = type_for_descr(descr);
+    if (vol.type < 0 || order != "False") {
+        std::cout << "Unsupported .npy layout (" << descr << ", fortran_order " << order
+                  << "), expected C order and one of |u1 <i2 <u2 <i4 <f4 <f8: " << path << std::endl;
+        npy_unmap(vol);
+        return false;
+    }
+    if (ndim == 2) {
+        dims[2] = dims[1];
+        dims[1] = dims[0];
+        dims[0] = 1;
+    }
+
+    // Bounds first, then divisions only: a crafted shape must not wrap
+    // the byte count into something that passes the size check
+    const size_t dataAt = dictAt + dictLen;
+    const size_t avail = vol.bytes - dataAt;
+    const size_t elemBytes = CV_ELEM_SIZE(vol.type);
+    if (dims[1] == 0 || dims[2] == 0 || dims[0] > INT_MAX || dims[1] > INT_MAX || dims[2] > INT_MAX ||
+        static_cast<size_t>(dims[1]) > avail / elemBytes / static_cast<size_t>(dims[2]) ||
+        static_cast<size_t>(dims[0]) >
+            avail / (static_cast<size_t>(dims[1]) * static_cast<size_t>(dims[2]) * elemBytes)) {
+        std::cout << "Volume shape (" << shape << ") does not fit the file: " << path << std::endl;
+        npy_unmap(vol);
+        return false;
+    }
+
+    vol.data = bytes + dataAt;
+    vol.frames = static_cast<int>(dims[0]);
+    vol.size = cv::Size(static_cast<int>(dims[2]), static_cast<int>(dims[1]));
+    return true;
+}
+
+cv::Mat npy_frame(const NpyVolume& vol, int t) {
+    const size_t frameBytes = static_cast<size_t>(vol.size.width) * static_cast<size_t>(vol.size.height) *
+                              CV_ELEM_SIZE(vol.type);
+    // Read-only mapping: callers must treat the view as const
+    return cv::Mat(vol.size, vol.type, const_cast<uint8_t*>(vol.data) + frameBytes * static_cast<size_t>(t));
+}
+
+void npy_unmap(NpyVolume& vol) {
+#ifdef _WIN32
+    if (vol.base)
+        UnmapViewOfFile(vol.base);
+    if (vol.mapping)
+        CloseHandle(vol.mapping);
+    if (vol.file)
+        CloseHandle(vol.file);
+    vol.file = nullptr;
+    vol.mapping = nullptr;
+#else
+    if (vol.base)
+        munmap(vol.base, vol.bytes);
+#endif
+    vol = NpyVolume();
+}
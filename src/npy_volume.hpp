@@ -0,0 +1,87 @@
+// npy_volume.hpp
+// ------------------------------------------------------------
+// Lossless plane sidecars as NumPy .npy volumes, and memory-mapped
+// .npy frame volumes as 3D input.
+//
+// One file per product, shape (frames, rows, cols), C order, the
+// plane's own element type:
+//   CV_32F -> '<f4'   (float gradients, theta in radians)
+//   CV_16S -> '<i2'   (Precision::Int16 gradients)
+//   CV_8U  -> '|u1'   (theta bins, 8-bit frames)
+// Gradients are written signed and unscaled (Gx, Gy, Gt as
+// computed), so np.load(path, mmap_mode='r') hands downstream code
+// the exact values instead of a decoded 8-bit MPEG-4 frame.
+//
+// The header is a fixed 128 bytes (format version 1.0); the frame
+// count is patched in by npy_close, so a stream of unknown length
+// can be appended frame by frame.
+//
+// Reading (npy_map) maps the whole file read-only; npy_frame returns
+// a cv::Mat header pointing into the mapping, so the 3D engine's
+// prev / curr / next are views of the file and a rerun over the
+// same clip costs neither a decode nor a copy. `--mode volume`
+// writes such a file (frames.npy, 8-bit gray) from any video once.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+const int NPY_HEADER_BYTES = 128;
+
+struct NpyWriter {
+    std::ofstream file;
+    std::string path;
+    int type = -1;              // of the first frame, kept for the file
+    cv::Size size;
+    long long frames = 0;
+};
+
+// Create / truncate path. The element type and the frame size are
+// taken from the first npy_write.
+bool npy_open(NpyWriter& w, const std::string& path);
+
+bool npy_is_open(const NpyWriter& w);
+
+// Append one single-channel plane (same type / size as the first).
+bool npy_write(NpyWriter& w, const cv::Mat& plane);
+
+// Patch the frame count into the header and close. No-op when not open.
+bool npy_close(NpyWriter& w);
+
+// '<f4', '<i2', '|u1' etc. for a single-channel type, nullptr if none
+const char* npy_descr(int type);
+
+// ------------------------------------------------------------
+// Read-only mapping of a C-order .npy volume (versions 1 - 3).
+// 2D arrays are one frame, 3D arrays are (frames, rows, cols).
+// ------------------------------------------------------------
+struct NpyVolume {
+    const uint8_t* data = nullptr;  // first frame
+    int type = -1;                  // CV_8U, CV_16S, CV_32F, ...
+    int frames = 0;
+    cv::Size size;
+
+    // Mapping
+    void* base = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+// Map path and parse its header. Prints the problem and returns
+// false for anything but a C-order, single-channel 2D or 3D array.
+bool npy_map(NpyVolume& vol, const std::string& path);
+
+// Frame t (0 <= t < frames) as a read-only view into the mapping (no copy)
+cv::Mat npy_frame(const NpyVolume& vol, int t);
+
+void npy_unmap(NpyVolume& vol);
+
@@ -0,0 +1,509 @@
+// ocl_backend.cpp
+// ------------------------------------------------------------
+// OpenCL kernels + host side, see ocl_backend.hpp.
+// ------------------------------------------------------------
+
+#include "ocl_backend.hpp"
+#include "metrics.hpp"
+#include "outputs.hpp"
+#include "sobel3d.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+const char* backend_name(Backend b) {
+    switch (b) {
+    case Backend::Cpu:    return "cpu";
+    case Backend::OpenCL: return "opencl";
+    }
+    return "unknown";
+}
+
+bool backend_parse(const char* name, Backend& b) {
+    const Backend all[] = { Backend::Cpu, Backend::OpenCL };
+    for (Backend v : all) {
+        if (std::strcmp(name, backend_name(v)) == 0) {
+            b = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ------------------------------------------------------------
+// Device code. Mats arrive as (ptr, step, offset[, rows, cols])
+// (cv::ocl::KernelArg), one work item per pixel. BORDER is the
+// BorderMode: 0 (Zero) writes the borders as 0 like the CPU kernels,
+// the others read the pixels outside the frame through border_at.
+// MAG_MODE / THETA_BINS / BORDER come from ocl_init.
+// ------------------------------------------------------------
+static const char* kOclSource = R"CLC(
+#pragma OPENCL FP_CONTRACT OFF
+
+#define ROW(T, m, y)  ((__global T*)((m) + m##_offset + (y) * m##_step))
+#define CROW(T, m, y) ((__global const T*)((m) + m##_offset + (y) * m##_step))
+
+// Index read for i in [-1, n] (grad_modes.cpp border_index),
+// -1 = outside a Constant border
+inline int border_at(int i, int n) {
+    if (i >= 0 && i < n)
+        return i;
+#if BORDER == 1
+    return i < 0 ? 0 : n - 1;
+#elif BORDER == 2
+    return n == 1 ? 0 : (i < 0 ? -i : 2 * n - 2 - i);
+#else
+    return -1;
+#endif
+}
+
+// 3x3 neighbourhood of (x, y) in an 8-bit plane; with BORDER == 0
+// only called for interior pixels
+inline void neighbourhood(__global const uchar* src, int src_step, int src_offset, int rows, int cols,
+                          int x, int y, int p[3][3]) {
+    for (int j = 0; j < 3; j++) {
+        int ry = border_at(y + j - 1, rows);
+        for (int i = 0; i < 3; i++) {
+            int rx = border_at(x + i - 1, cols);
+            p[j][i] = (rx < 0 || ry < 0) ? 0 : CROW(uchar, src, ry)[rx];
+        }
+    }
+}
+
+#define INSIDE(x, y) (BORDER != 0 || ((x) > 0 && (y) > 0 && (x) < cols - 1 && (y) < rows - 1))
+
+inline float mag2(float x, float y) {
+#if MAG_MODE == 0
+    return sqrt(x * x + y * y);
+#elif MAG_MODE == 1
+    return fabs(x) + fabs(y);
+#else
+    float ax = fabs(x), ay = fabs(y);
+    return fmax(ax, ay) * 0.9375f + fmin(ax, ay) * 0.46875f;
+#endif
+}
+
+inline float mag3(float x, float y, float t) {
+#if MAG_MODE == 0
+    return sqrt(x * x + y * y + t * t);
+#elif MAG_MODE == 1
+    return fabs(x) + fabs(y) + fabs(t);
+#else
+    float ax = fabs(x), ay = fabs(y), at = fabs(t);
+    float mx = fmax(fmax(ax, ay), at), mn = fmin(fmin(ax, ay), at);
+    float md = ax + ay + at - mx - mn;
+    return mx * 0.9375f + md * 0.40625f + mn * 0.28125f;
+#endif
+}
+
+#if THETA_BINS > 0
+inline int theta_bin(float fx, float fy) {
+    float ax = fabs(fx), ay = fabs(fy);
+    int j = 0;
+#if THETA_BINS == 4
+    j += ay > ax;
+#elif THETA_BINS == 8
+    j += ay > ax * 0.41421356f;
+    j += ay > ax * 2.41421356f;
+#else
+    j += ay > ax * 0.19891237f;
+    j += ay > ax * 0.66817864f;
+    j += ay > ax * 1.49660576f;
+    j += ay > ax * 5.02733949f;
+#endif
+    int negX = fx < 0.0f, negY = fy < 0.0f;
+    int k = (negX ? THETA_BINS / 2 : 0) + (negX != negY ? -j : j);
+    return k & (THETA_BINS - 1);
+}
+#endif
+
+__kernel void sobel2d(__global const uchar* src, int src_step, int src_offset, int rows, int cols,
+                      __global uchar* gx, int gx_step, int gx_offset,
+                      __global uchar* gy, int gy_step, int gy_offset,
+                      __global uchar* mag, int mag_step, int mag_offset,
+                      __global uchar* theta, int theta_step, int theta_offset) {
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+
+    int inside = INSIDE(x, y);
+    float fx = 0.0f, fy = 0.0f;
+    if (inside) {
+        int p[3][3];
+        neighbourhood(src, src_step, src_offset, rows, cols, x, y, p);
+        int sx = (p[0][2] - p[0][0]) + 2 * (p[1][2] - p[1][0]) + (p[2][2] - p[2][0]);
+        int sy = (p[2][0] + 2 * p[2][1] + p[2][2]) - (p[0][0] + 2 * p[0][1] + p[0][2]);
+        fx = (float)sx;
+        fy = (float)sy;
+    }
+
+    ROW(float, gx, y)[x]  = fx;
+    ROW(float, gy, y)[x]  = fy;
+    ROW(float, mag, y)[x] = mag2(fx, fy);
+#if THETA_BINS > 0
+    ROW(uchar, theta, y)[x] = (uchar)(inside ? theta_bin(fx, fy) : 0);
+#else
+    ROW(float, theta, y)[x] = inside ? atan2(fy, fx) : 0.0f;
+#endif
+}
+
+__kernel void spatial3d(__global const uchar* src, int src_step, int src_offset, int rows, int cols,
+                        __global uchar* dxs, int dxs_step, int dxs_offset,
+                        __global uchar* sdy, int sdy_step, int sdy_offset,
+                        __global uchar* ss, int ss_step, int ss_offset) {
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+
+    int vdxs = 0, vsdy = 0, vss = 0;
+    if (INSIDE(x, y)) {
+        int p[3][3], hs[3], hd[3];
+        neighbourhood(src, src_step, src_offset, rows, cols, x, y, p);
+        for (int j = 0; j < 3; j++) {
+            hs[j] = p[j][0] + 2 * p[j][1] + p[j][2];
+            hd[j] = p[j][2] - p[j][0];
+        }
+        vdxs = hd[0] + 2 * hd[1] + hd[2];
+        vsdy = hs[2] - hs[0];
+        vss  = hs[0] + 2 * hs[1] + hs[2];
+    }
+
+    ROW(short, dxs, y)[x] = (short)vdxs;
+    ROW(short, sdy, y)[x] = (short)vsdy;
+    ROW(short, ss, y)[x]  = (short)vss;
+}
+
+__kernel void combine3d(__global const uchar* dxsP, int dxsP_step, int dxsP_offset, int rows, int cols,
+                        __global const uchar* dxsC, int dxsC_step, int dxsC_offset,
+                        __global const uchar* dxsN, int dxsN_step, int dxsN_offset,
+                        __global const uchar* sdyP, int sdyP_step, int sdyP_offset,
+                        __global const uchar* sdyC, int sdyC_step, int sdyC_offset,
+                        __global const uchar* sdyN, int sdyN_step, int sdyN_offset,
+                        __global const uchar* ssP, int ssP_step, int ssP_offset,
+                        __global const uchar* ssN, int ssN_step, int ssN_offset,
+                        __global uchar* gt, int gt_step, int gt_offset,
+                        __global uchar* mag, int mag_step, int mag_offset,
+                        int absGt) {
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+
+    float t = 0.0f, m = 0.0f;
+    if (INSIDE(x, y)) {
+        int sx = CROW(short, dxsP, y)[x] + 2 * CROW(short, dxsC, y)[x] + CROW(short, dxsN, y)[x];
+        int sy = CROW(short, sdyP, y)[x] + 2 * CROW(short, sdyC, y)[x] + CROW(short, sdyN, y)[x];
+        t = (float)(CROW(short, ssN, y)[x] - CROW(short, ssP, y)[x]);
+        m = mag3((float)sx, (float)sy, t);
+    }
+
+    ROW(float, gt, y)[x]  = absGt ? fabs(t) : t;
+    ROW(float, mag, y)[x] = m;
+}
+
+__kernel void to_bgr(__global const uchar* src, int src_step, int src_offset, int rows, int cols,
+                     __global uchar* dst, int dst_step, int dst_offset,
+                     float scale, float shift, int cn) {
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+
+    int q = convert_int_sat_rte(CROW(float, src, y)[x] * scale + shift);
+    uchar b = (uchar)clamp(q, 0, 255);
+
+    __global uchar* d = ROW(uchar, dst, y) + cn * x;
+    for (int c = 0; c < cn; c++)
+        d[c] = b;
+}
+
+// NormMode::Percentile: bin k of (src - lo) * binScale, clamped
+__kernel void hist(__global const uchar* src, int src_step, int src_offset, int rows, int cols,
+                   __global int* bins, float lo, float binScale) {
+    int x = get_global_id(0), y = get_global_id(1);
+    if (x >= cols || y >= rows)
+        return;
+
+    int k = (int)((CROW(float, src, y)[x] - lo) * binScale);
+    atomic_inc(&bins[clamp(k, 0, HIST_BINS - 1)]);
+}
+)CLC";
+
+// ------------------------------------------------------------
+// Host side
+// ------------------------------------------------------------
+bool ocl_init(OclSobel& ocl, const GradientMode& grad, bool report) {
+    ocl.ready = false;
+    std::ostringstream quiet;
+    std::ostream& out = report ? std::cout : quiet;
+
+    if (!cv::ocl::haveOpenCL()) {
+        out << "OpenCL backend: no OpenCL runtime/device found.\n";
+        return false;
+    }
+    cv::ocl::setUseOpenCL(true);
+
+    const cv::ocl::Device& dev = cv::ocl::Device::getDefault();
+    if (dev.empty()) {
+        out << "OpenCL backend: no default OpenCL device.\n";
+        return false;
+    }
+
+    const cv::String opts = cv::format("-D MAG_MODE=%d -D THETA_BINS=%d -D HIST_BINS=%d -D BORDER=%d",
+                                       static_cast<int>(grad.mag), theta_bin_count(grad.theta),
+                                       NORM_HIST_BINS, static_cast<int>(grad.border));
+    cv::String err;
+    cv::ocl::Program program(cv::ocl::ProgramSource(kOclSource), opts, err);
+    if (program.ptr() == nullptr) {
+        out << "OpenCL backend: kernel build failed on " << dev.name() << ":\n" << err << "\n";
+        return false;
+    }
+
+    if (!ocl.spatial3d.create("spatial3d", program) ||
+        !ocl.combine3d.create("combine3d", program) ||
+        !ocl.toBgr.create("to_bgr", program) ||
+        !ocl.hist.create("hist", program) ||
+        !ocl.sobel2d.create("sobel2d", program)) {
+        out << "OpenCL backend: could not create the kernels on " << dev.name() << ".\n";
+        return false;
+    }
+
+    if (grad.precision == Precision::Int16)
+        out << "OpenCL backend computes float32 gradients (--precision applies to the CPU path).\n";
+
+    out << "OpenCL backend: " << dev.name() << "\n";
+    ocl.grad = grad;
+    ocl.ready = true;
+    return true;
+}
+
+// BGR frames are converted on the host first (1 byte per pixel
+// over the bus instead of 3)
+void ocl_upload_gray(const cv::Mat& frame, cv::Mat& grayHost, cv::UMat& gray) {
+    if (frame.type() == CV_8U) {
+        frame.copyTo(gray);
+        return;
+    }
+    cv::cvtColor(frame, grayHost, cv::COLOR_BGR2GRAY);
+    grayHost.copyTo(gray);
+}
+
+static bool run_2d(cv::ocl::Kernel& k, const cv::Size& size) {
+    size_t global[2] = { static_cast<size_t>(size.width), static_cast<size_t>(size.height) };
+    if (k.run(2, global, nullptr, false))
+        return true;
+    std::cout << "OpenCL kernel launch failed.\n";
+    return false;
+}
+
+void ocl_sobel2d(OclSobel& ocl, const cv::Mat& gray,
+                 cv::Mat& gx, cv::Mat& gy, cv::Mat& mag, cv::Mat& theta,
+                 unsigned outputs) {
+    StageTimer timer(Stage::Gradient);
+    const cv::Size size = gray.size();
+
+    ocl_upload_gray(gray, ocl.grayHost, ocl.gray);
+    ocl.gx.create(size, CV_32F);
+    ocl.gy.create(size, CV_32F);
+    ocl.mag.create(size, CV_32F);
+    ocl.theta.create(size, theta_bin_count(ocl.grad.theta) ? CV_8U : CV_32F);
+
+    ocl.sobel2d.args(cv::ocl::KernelArg::ReadOnly(ocl.gray),
+                     cv::ocl::KernelArg::WriteOnlyNoSize(ocl.gx),
+                     cv::ocl::KernelArg::WriteOnlyNoSize(ocl.gy),
+                     cv::ocl::KernelArg::WriteOnlyNoSize(ocl.mag),
+                     cv::ocl::KernelArg::WriteOnlyNoSize(ocl.theta));
+    if (!run_2d(ocl.sobel2d, size))
+        return;
+
+    // Theta brings gx and gy along, as on the CPU
+    if (outputs & (OUT_GX | OUT_GY | OUT_THETA)) {
+        ocl.gx.copyTo(gx);
+        ocl.gy.copyTo(gy);
+    }
+    if (outputs & OUT_MAG)
+        ocl.mag.copyTo(mag);
+    if (outputs & OUT_THETA)
+        ocl.theta.copyTo(theta);
+}
+
+void ocl_sobel3d_reserve(OclSobel& ocl, const cv::Size& size, int cn, BorderMode border) {
+    ocl.gray.create(size, CV_8U);
+    for (int i = 0; i < 3; i++) {
+        ocl.dxs[i].create(size, CV_16S);
+        ocl.sdy[i].create(size, CV_16S);
+        ocl.ss[i].create(size, CV_16S);
+    }
+    ocl.gt.create(size, CV_32F);
+    ocl.mag3d.create(size, CV_32F);
+    ocl.gtBgr.create(size, CV_8UC(cn));
+    ocl.magBgr.create(size, CV_8UC(cn));
+
+    if (border == BorderMode::Constant) {
+        ocl.zero.create(size, CV_16S);
+        ocl.zero.setTo(cv::Scalar(0));
+    }
+}
+
+// Spatial plane of ring slot i, or the frame of 0 for i == -1
+static const cv::UMat& slot_plane(const OclSobel& ocl, const cv::UMat* planes, int i) {
+    return i < 0 ? ocl.zero : planes[i];
+}
+
+void ocl_sobel3d_spatial(OclSobel& ocl, const cv::Mat& gray, int slot) {
+    ocl_upload_gray(gray, ocl.grayHost, ocl.gray);
+    ocl_sobel3d_spatial(ocl, ocl.gray, slot);
+}
+
+void ocl_sobel3d_spatial(OclSobel& ocl, const cv::UMat& gray, int slot) {
+    // No-ops once sobel3d_reserve ran for this size
+    ocl.dxs[slot].create(gray.size(), CV_16S);
+    ocl.sdy[slot].create(gray.size(), CV_16S);
+    ocl.ss[slot].create(gray.size(), CV_16S);
+
+    ocl.spatial3d.args(cv::ocl::KernelArg::ReadOnly(gray),
+                       cv::ocl::KernelArg::WriteOnlyNoSize(ocl.dxs[slot]),
+                       cv::ocl::KernelArg::WriteOnlyNoSize(ocl.sdy[slot]),
+                       cv::ocl::KernelArg::WriteOnlyNoSize(ocl.ss[slot]));
+    run_2d(ocl.spatial3d, gray.size());
+}
+
+// Temporal pass into ocl.gt / ocl.mag3d (|gt| when absGt)
+static bool combine(OclSobel& ocl, const Sobel3DEngine& engine, bool absGt) {
+    int p, c, n;
+    sobel3d_window(engine, p, c, n);
+
+    ocl.gt.create(ocl.ss[c].size(), CV_32F);
+    ocl.mag3d.create(ocl.ss[c].size(), CV_32F);
+
+    ocl.combine3d.args(cv::ocl::KernelArg::ReadOnly(slot_plane(ocl, ocl.dxs, p)),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(ocl.dxs[c]),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(slot_plane(ocl, ocl.dxs, n)),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(slot_plane(ocl, ocl.sdy, p)),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(ocl.sdy[c]),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(slot_plane(ocl, ocl.sdy, n)),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(slot_plane(ocl, ocl.ss, p)),
+                       cv::ocl::KernelArg::ReadOnlyNoSize(slot_plane(ocl, ocl.ss, n)),
+                       cv::ocl::KernelArg::WriteOnlyNoSize(ocl.gt),
+                       cv::ocl::KernelArg::WriteOnlyNoSize(ocl.mag3d),
+                       absGt ? 1 : 0);
+    return run_2d(ocl.combine3d, ocl.ss[c].size());
+}
+
+void ocl_sobel3d_combine(OclSobel& ocl, const Sobel3DEngine& engine, cv::Mat& gt, cv::Mat& mag3d) {
+    if (!combine(ocl, engine, false))
+        return;
+    ocl.gt.copyTo(gt);
+    ocl.mag3d.copyTo(mag3d);
+}
+
+static NormRange range_of(const cv::UMat& plane) {
+    double lo, hi;
+    cv::minMaxLoc(plane, &lo, &hi);
+
+    NormRange r;
+    r.lo = static_cast<float>(lo);
+    r.hi = static_cast<float>(hi);
+    return r;
+}
+
+static bool to_bgr(OclSobel& ocl, const cv::UMat& plane, const NormRange& range,
+                   cv::UMat& bgrDev, int cn) {
+    bgrDev.create(plane.size(), CV_8UC(cn));
+    float scale, shift;
+    range_scale(range, scale, shift);
+
+    ocl.toBgr.args(cv::ocl::KernelArg::ReadOnly(plane),
+                   cv::ocl::KernelArg::WriteOnlyNoSize(bgrDev),
+                   scale, shift, cn);
+    return run_2d(ocl.toBgr, plane.size());
+}
+
+// Histogram of a non-negative plane over t.fixed into t.hist
+static void hist_of(OclSobel& ocl, const cv::UMat& plane, NormTrack& t) {
+    ocl.histBins.create(1, NORM_HIST_BINS, CV_32S);
+    ocl.histBins.setTo(cv::Scalar(0));
+
+    const float binScale = NORM_HIST_BINS / (t.fixed.hi - t.fixed.lo);
+    ocl.hist.args(cv::ocl::KernelArg::ReadOnly(plane),
+                  cv::ocl::KernelArg::PtrReadWrite(ocl.histBins),
+                  t.fixed.lo, binScale);
+    if (!run_2d(ocl.hist, plane.size()))
+        return;
+
+    cv::Mat bins;
+    ocl.histBins.copyTo(bins);
+    norm_hist_merge(t, bins.ptr<uint32_t>());
+}
+
+// Outputs into gtBgr / magBgr on the device (queued, not waited for)
+static bool compute_bgr(OclSobel& ocl, Sobel3DEngine& engine, NormMode mode,
+                        cv::UMat& gtBgr, cv::UMat& magBgr) {
+    const bool wantGt  = (engine.outputs & OUT_GT)  != 0;
+    const bool wantMag = (engine.outputs & OUT_MAG) != 0;
+
+    // Same rules as the CPU path (sobel3d.cpp): the scale is known
+    // before the frame except for MinMax and a first frame
+    NormRange gtScaleRange, magScaleRange;
+    const bool known = (!wantGt  || norm_pick(mode, engine.gtNorm,  gtScaleRange)) &&
+                       (!wantMag || norm_pick(mode, engine.magNorm, magScaleRange));
+
+    // Fixed needs no statistics: no reduction, no wait on the device
+    const bool stats = mode != NormMode::Fixed || !known;
+
+    NormRange gtRange, magRange;    // this frame (|gt| and mag3d)
+    {
+        StageTimer timer(Stage::Gradient);
+        if (!combine(ocl, engine, true))
+            return false;
+        if (stats && wantGt)  gtRange  = range_of(ocl.gt);
+        if (stats && wantMag) magRange = range_of(ocl.mag3d);
+        if (stats && norm_wants_hist(mode)) {
+            if (wantGt)  hist_of(ocl, ocl.gt,    engine.gtNorm);
+            if (wantMag) hist_of(ocl, ocl.mag3d, engine.magNorm);
+        }
+    }
+
+    norm_update(mode, engine.normParams, gtRange,  engine.gtNorm);
+    norm_update(mode, engine.normParams, magRange, engine.magNorm);
+    if (!known) {
+        if (!norm_pick(mode, engine.gtNorm, gtScaleRange))
+            gtScaleRange = gtRange;
+        if (!norm_pick(mode, engine.magNorm, magScaleRange))
+            magScaleRange = magRange;
+    }
+
+    {
+        StageTimer timer(Stage::ToBgr);
+        if (wantGt && !to_bgr(ocl, ocl.gt, gtScaleRange, gtBgr, engine.outChannels))
+            return false;
+        if (wantMag && !to_bgr(ocl, ocl.mag3d, magScaleRange, magBgr, engine.outChannels))
+            return false;
+    }
+
+    // Signed planes for the raw sidecars: one more temporal pass
+    // rather than a signed range on the device
+    if (engine.keepPlanes) {
+        StageTimer timer(Stage::Gradient);
+        if (!combine(ocl, engine, false))
+            return false;
+        if (wantGt)  ocl.gt.copyTo(engine.gt);
+        if (wantMag) ocl.mag3d.copyTo(engine.mag3d);
+    }
+    return true;
+}
+
+void ocl_sobel3d_compute_bgr(OclSobel& ocl, Sobel3DEngine& engine, NormMode mode,
+                             cv::Mat& gtBgr, cv::Mat& magBgr) {
+    if (!compute_bgr(ocl, engine, mode, ocl.gtBgr, ocl.magBgr))
+        return;
+    StageTimer timer(Stage::ToBgr);
+    if (engine.outputs & OUT_GT)  ocl.gtBgr.copyTo(gtBgr);
+    if (engine.outputs & OUT_MAG) ocl.magBgr.copyTo(magBgr);
+}
+
+void ocl_sobel3d_compute_bgr(OclSobel& ocl, Sobel3DEngine& engine, NormMode mode,
+                             cv::UMat& gtBgr, cv::UMat& magBgr) {
+    compute_bgr(ocl, engine, mode, gtBgr, magBgr);
+    // Done on return, for readers on other threads' queues
+    cv::ocl::finish();
+}
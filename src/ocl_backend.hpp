@@ -0,0 +1,95 @@
+// ocl_backend.hpp
+// ------------------------------------------------------------
+// OpenCL backend (OpenCV T-API: cv::UMat + cv::ocl::Kernel) for
+// the 2D Sobel and the 3D engine.
+//
+// The 3D window stays resident on the device: each push uploads
+// only the new 8-bit frame and runs the spatial pass into its ring
+// slot (same slot order as Sobel3DEngine::planes), the temporal pass
+// combines the three slots there, and only the two 8-bit BGR
+// outputs come back. Kernel launches are asynchronous on the
+// device's in-order queue; the host waits only for the range
+// (minMaxLoc, not with NormMode::Fixed) and the readback. Decode / encode keep overlapping
+// with the compute stage through the pipelined driver.
+//
+// Copies: a Mat <-> UMat copy blocks on the calling thread's queue,
+// and the T-API's default queue is per thread. So the pipelined
+// driver uploads each frame from its decoder thread into that
+// frame's own UMat (ocl_upload_gray) and reads the BGR outputs back
+// on the encoder threads (the UMat compute_bgr below, finished on
+// return): the transfers run on their queues while the compute
+// thread's queue runs the next frame's kernels. The sequential and
+// live drivers and 2D copy on the compute thread, in line.
+//
+// Gradients are float32 and the magnitude / theta formulas and the
+// border mode follow the GradientMode given to ocl_init (Poly theta
+// uses the device's atan2). Results match the CPU kernels up to the device's sqrt /
+// atan2 rounding.
+//
+// Selected with --backend opencl; without an OpenCL device (or if
+// the program does not build) ocl_init fails and the CPU path runs.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+
+#include "grad_modes.hpp"
+#include "normalize.hpp"
+
+struct Sobel3DEngine;
+
+enum class Backend {
+    Cpu,
+    OpenCL
+};
+
+// "cpu", "opencl"
+const char* backend_name(Backend b);
+bool backend_parse(const char* name, Backend& b);
+
+struct OclSobel {
+    bool ready = false;
+    GradientMode grad;
+
+    cv::ocl::Kernel spatial3d, combine3d, toBgr, sobel2d, hist;
+
+    // 3D: uploaded frame, ring slots of the spatial planes (CV_16S)
+    cv::Mat grayHost;           // gray of a BGR input frame, before upload
+    cv::UMat gray;
+    cv::UMat dxs[3], sdy[3], ss[3];
+    cv::UMat zero;              // CV_16S 0, frames outside a BorderMode::Constant clip
+    cv::UMat gt, mag3d;         // CV_32F
+    cv::UMat gtBgr, magBgr;     // CV_8UC3 (CV_8UC1 for gray outputs)
+    cv::UMat histBins;          // CV_32S, NormMode::Percentile
+
+    // 2D planes
+    cv::UMat gx, gy, mag, theta;
+};
+
+// Pick the default OpenCL device and build the kernels for grad.
+// Prints the device (or why it failed) when report is set;
+// false = use the CPU.
+bool ocl_init(OclSobel& ocl, const GradientMode& grad, bool report = true);
+
+// 2D Sobel of a CV_8U (or BGR) frame; only the planes in outputs are
+// downloaded (CV_32F, theta CV_8U for ThetaMode::BinsN).
+void ocl_sobel2d(OclSobel& ocl, const cv::Mat& gray,
+                 cv::Mat& gx, cv::Mat& gy, cv::Mat& mag, cv::Mat& theta,
+                 unsigned outputs);
+
+// Gray of a CV_8U or BGR frame into gray, on the calling thread's
+// queue and finished on return (grayHost: scratch for the BGR
+// conversion). Any thread may call it, e.g. a decoder.
+void ocl_upload_gray(const cv::Mat& frame, cv::Mat& grayHost, cv::UMat& gray);
+
+// Device side of the sobel3d_* calls when engine.ocl is set
+void ocl_sobel3d_reserve(OclSobel& ocl, const cv::Size& size, int cn, BorderMode border);
+void ocl_sobel3d_spatial(OclSobel& ocl, const cv::Mat& gray, int slot);
+void ocl_sobel3d_spatial(OclSobel& ocl, const cv::UMat& gray, int slot);
+void ocl_sobel3d_combine(OclSobel& ocl, const Sobel3DEngine& engine, cv::Mat& gt, cv::Mat& mag3d);
+void ocl_sobel3d_compute_bgr(OclSobel& ocl, Sobel3DEngine& engine, NormMode mode,
+                             cv::Mat& gtBgr, cv::Mat& magBgr);
+void ocl_sobel3d_compute_bgr(OclSobel& ocl, Sobel3DEngine& engine, NormMode mode,
+                             cv::UMat& gtBgr, cv::UMat& magBgr);
@@ -0,0 +1,73 @@
+// outputs.cpp
+// ------------------------------------------------------------
+// Output product names, see outputs.hpp.
+// ------------------------------------------------------------
+
+#include "outputs.hpp"
+
+static const OutputProduct kAllProducts[] = {
+    OUT_ORIGINAL, OUT_GRAY, OUT_GX, OUT_GY, OUT_MAG, OUT_THETA, OUT_GT
+};
+
+const char* output_name(OutputProduct p) {
+    switch (p) {
+    case OUT_ORIGINAL: return "original";
+    case OUT_GRAY:     return "gray";
+    case OUT_GX:       return "gx";
+    case OUT_GY:       return "gy";
+    case OUT_MAG:      return "mag";
+    case OUT_THETA:    return "theta";
+    case OUT_GT:       return "gt";
+    }
+    return "unknown";
+}
+
+bool parse_outputs(const std::string& list, unsigned& mask) {
+    unsigned m = 0;
+    size_t pos = 0;
+
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+            comma = list.size();
+
+        const std::string name = list.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        if (name.empty())
+            continue;
+
+        if (name == "all") {
+            m = ~0u;
+            continue;
+        }
+
+        bool found = false;
+        for (OutputProduct p : kAllProducts) {
+            if (name == output_name(p)) {
+                m |= p;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+
+    if (m == 0)
+        return false;
+
+    mask = m;
+    return true;
+}
+
+std::string outputs_to_string(unsigned mask) {
+    std::string s;
+    for (OutputProduct p : kAllProducts) {
+        if (mask & p) {
+            if (!s.empty()) s += ",";
+            s += output_name(p);
+        }
+    }
+    return s;
+}
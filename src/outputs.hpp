@@ -0,0 +1,46 @@
+// outputs.hpp
+// ------------------------------------------------------------
+// Output product selection.
+//
+// A bit mask of the planes a run should produce. Kernels are
+// specialized on the bits they care about, so an unrequested plane
+// (theta's atan2, the 3D Gt, ...) is never computed, normalized or
+// encoded.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+
+enum OutputProduct : unsigned {
+    OUT_ORIGINAL = 1u << 0,     // decoded input frame
+    OUT_GRAY     = 1u << 1,     // 2D: grayscale input
+    OUT_GX       = 1u << 2,     // 2D: Gx
+    OUT_GY       = 1u << 3,     // 2D: Gy
+    OUT_MAG      = 1u << 4,     // 2D / 3D: gradient magnitude
+    OUT_THETA    = 1u << 5,     // 2D: gradient direction
+    OUT_GT       = 1u << 6      // 3D: temporal gradient |Gt|
+};
+
+const int OUT_COUNT = 7;        // number of products (bits above)
+
+// Bit position of p, 0 .. OUT_COUNT-1 (for per-product arrays)
+inline int output_index(OutputProduct p) {
+    int i = 0;
+    while ((1u << i) != static_cast<unsigned>(p))
+        i++;
+    return i;
+}
+
+const unsigned OUT_ALL_2D = OUT_ORIGINAL | OUT_GRAY | OUT_GX | OUT_GY | OUT_MAG | OUT_THETA;
+const unsigned OUT_ALL_3D = OUT_ORIGINAL | OUT_GT | OUT_MAG;
+
+// Parse "original,mag,gt" (names as in output_name, or "all").
+// "all" sets every bit; callers mask it with OUT_ALL_2D / OUT_ALL_3D.
+bool parse_outputs(const std::string& list, unsigned& mask);
+
+// "original", "gray", "gx", "gy", "mag", "theta", "gt"
+const char* output_name(OutputProduct p);
+
+// Comma-separated names of the bits set in mask
+std::string outputs_to_string(unsigned mask);
@@ -0,0 +1,78 @@
+// pyramid.cpp
+// ------------------------------------------------------------
+// Fused box decimation, see pyramid.hpp.
+// ------------------------------------------------------------
+
+#include "pyramid.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+cv::Size pyramid_size(const cv::Size& size, int level) {
+    return cv::Size(size.width >> level, size.height >> level);
+}
+
+// Vertical sums first (contiguous, vectorizes), then the F
+// neighbouring sums of each channel per output pixel
+template <int F, int CN>
+static void decimate(const cv::Mat& src, cv::Mat& dst, int shift, ThreadPool* pool) {
+    const int dcols = dst.cols;
+    const int n = dcols * F * CN;       // source bytes per row that are used
+    const int half = 1 << (shift - 1);
+
+    // F source rows in, one row out
+    const size_t bytesPerRow = static_cast<size_t>(n) * F;
+    parallel_for_rows(pool, 0, dst.rows, bytesPerRow, [&](int y0, int y1) {
+        static thread_local std::vector<uint16_t> acc;
+        acc.resize(n);
+        uint16_t* a = acc.data();
+
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* s0 = src.ptr<uint8_t>(y * F);
+            for (int i = 0; i < n; i++)
+                a[i] = s0[i];
+            for (int r = 1; r < F; r++) {
+                const uint8_t* s = src.ptr<uint8_t>(y * F + r);
+                for (int i = 0; i < n; i++)
+                    a[i] = static_cast<uint16_t>(a[i] + s[i]);
+            }
+
+            uint8_t* d = dst.ptr<uint8_t>(y);
+            for (int x = 0; x < dcols; x++) {
+                const uint16_t* b = a + x * F * CN;
+                for (int c = 0; c < CN; c++) {
+                    int sum = half;
+                    for (int i = 0; i < F; i++)
+                        sum += b[i * CN + c];
+                    d[x * CN + c] = static_cast<uint8_t>(sum >> shift);
+                }
+            }
+        }
+    });
+}
+
+template <int F>
+static void decimate_cn(const cv::Mat& src, cv::Mat& dst, int shift, ThreadPool* pool) {
+    if (src.channels() == 3)
+        decimate<F, 3>(src, dst, shift, pool);
+    else
+        decimate<F, 1>(src, dst, shift, pool);
+}
+
+void pyramid_down(const cv::Mat& src, int level, cv::Mat& dst, ThreadPool* pool) {
+    StageTimer timer(Stage::Pyramid);
+
+    dst.create(pyramid_size(src.size(), level), src.type());
+    if (dst.empty())
+        return;
+
+    // Sum of 2^level x 2^level pixels, / 2^(2 level) rounded
+    const int shift = 2 * level;
+    switch (level) {
+    case 1:  decimate_cn<2>(src, dst, shift, pool); break;
+    case 2:  decimate_cn<4>(src, dst, shift, pool); break;
+    default: decimate_cn<8>(src, dst, shift, pool); break;
+    }
+}
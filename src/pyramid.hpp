@@ -0,0 +1,29 @@
+// pyramid.hpp
+// ------------------------------------------------------------
+// Decimated input for --pyramid (preview / coarse analytics).
+//
+// Level L runs everything at 1 / 2^L of the width and height:
+// every 2^L x 2^L block of the decoded frame is averaged (box
+// filter, rounded) into one pixel in a single pass, straight from
+// the full frame, without building the levels in between. The 2D
+// and 3D kernels, the outputs and the writers then see a smaller
+// frame, so level 1 costs about 1/4 of the full-resolution run and
+// level 2 about 1/16 (plus the one pass over the decoded frame).
+//
+// Rows / columns past the last whole block are dropped (size >> L).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "thread_pool.hpp"
+
+const int PYRAMID_MAX_LEVEL = 3;
+
+// size >> level
+cv::Size pyramid_size(const cv::Size& size, int level);
+
+// Box-decimate an 8-bit frame (CV_8U or CV_8UC3) to level
+// (1 <= level <= PYRAMID_MAX_LEVEL) into dst, allocated here.
+void pyramid_down(const cv::Mat& src, int level, cv::Mat& dst, ThreadPool* pool = nullptr);
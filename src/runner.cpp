@@ -0,0 +1,728 @@
+// runner.cpp
+// ------------------------------------------------------------
+// Image / 2D video / 3D video runs, see runner.hpp.
+// ------------------------------------------------------------
+
+#include "runner.hpp"
+
+#include "normalize.hpp"
+#include "npy_volume.hpp"
+#include "outputs.hpp"
+#include "segments.hpp"
+#include "sobel2d.hpp"
+#include "video_pipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------
+// Output file names (same as the archived versions)
+// ------------------------------------------------------------
+static const char* output_file_stem(OutputProduct p, bool is3D) {
+    switch (p) {
+    case OUT_ORIGINAL: return "original";
+    case OUT_GRAY:     return "gray";
+    case OUT_GX:       return "gx";
+    case OUT_GY:       return "gy";
+    case OUT_MAG:      return is3D ? "sobel3d_mag" : "magnitude";
+    case OUT_THETA:    return "theta";
+    case OUT_GT:       return "sobel3d_gt";
+    }
+    return "unknown";
+}
+
+// One writer per product bit, the --pack stream and the --raw sidecars
+struct OutputWriters {
+    cv::VideoWriter w[OUT_COUNT];
+    cv::VideoWriter packed;
+    NpyWriter raw[OUT_COUNT];
+
+    cv::VideoWriter* get(unsigned outputs, OutputProduct p) {
+        return (outputs & p) ? &w[output_index(p)] : nullptr;
+    }
+
+    NpyWriter* get_raw(unsigned rawOutputs, OutputProduct p) {
+        return (rawOutputs & p) ? &raw[output_index(p)] : nullptr;
+    }
+
+    // Video writers only (the encoder fallback reopens them)
+    void release() {
+        for (cv::VideoWriter& v : w)
+            v.release();
+        packed.release();
+    }
+
+    // Finalize the sidecars (frame count into the .npy headers)
+    bool close_raw() {
+        bool ok = true;
+        for (NpyWriter& r : raw)
+            ok = npy_close(r) && ok;
+        return ok;
+    }
+};
+
+// ------------------------------------------------------------
+// Encoders in order of preference. The hardware entry is only
+// kept when the backend reports that it really got a hardware
+// encoder: a software H.264 encoder is slower than mp4v.
+// ------------------------------------------------------------
+struct WriterCodec {
+    const char* name;
+    char fourcc[4];
+    const char* ext;
+    bool hw;                    // needs VIDEOWRITER_PROP_HW_ACCELERATION
+};
+
+static const WriterCodec kWriterCodecs[] = {
+    { "H.264",  { 'a', 'v', 'c', '1' }, "mp4", true  },    // hardware: VAAPI / D3D11 / MFX (QSV)
+    { "MPEG-4", { 'm', 'p', '4', 'v' }, "mp4", false },
+    { "MJPG",   { 'M', 'J', 'P', 'G' }, "avi", false }     // very widely supported
+};
+
+// What open_writers_with_fallback settled on
+struct WriterChoice {
+    std::string ext;
+    std::string codec;
+    cv::VideoAccelerationType accel = cv::VIDEO_ACCELERATION_NONE;
+};
+
+// "hw vaapi" / "software" for a property value read back from OpenCV
+static std::string accel_desc(double prop) {
+    const auto accel = static_cast<cv::VideoAccelerationType>(static_cast<int>(prop));
+    if (accel == cv::VIDEO_ACCELERATION_NONE)
+        return "software";
+    return std::string("hw ") + hw_accel_name(accel);
+}
+
+// Open the writers selected in outputs (the products in packed go
+// to one "packed" stream instead) with the first codec of
+// kWriterCodecs that works for all of them
+static bool open_writers_with_fallback(
+    const std::string& outDir,
+    const cv::Size& frameSize,
+    double fps,
+    unsigned outputs,
+    unsigned packed,
+    bool is3D,
+    int channels,
+    cv::VideoAccelerationType hwAccel,
+    OutputWriters& writers,
+    WriterChoice& chosen
+) {
+    for (const WriterCodec& codec : kWriterCodecs) {
+        if (codec.hw && hwAccel == cv::VIDEO_ACCELERATION_NONE)
+            continue;
+
+        const int fourcc = cv::VideoWriter::fourcc(codec.fourcc[0], codec.fourcc[1],
+                                                   codec.fourcc[2], codec.fourcc[3]);
+        double accel = cv::VIDEO_ACCELERATION_NONE;
+
+        auto open_one = [&](cv::VideoWriter& w, const char* stem, bool color) {
+            std::vector<int> params = { cv::VIDEOWRITER_PROP_IS_COLOR, color ? 1 : 0 };
+            if (codec.hw) {
+                params.push_back(cv::VIDEOWRITER_PROP_HW_ACCELERATION);
+                params.push_back(hwAccel);
+            }
+
+            w.open(outDir + "/" + stem + "." + codec.ext, fourcc, fps, frameSize, params);
+            if (!w.isOpened())
+                return false;
+
+            // Every stream has to be on the hardware encoder
+            if (codec.hw) {
+                accel = w.get(cv::VIDEOWRITER_PROP_HW_ACCELERATION);
+                return accel > cv::VIDEO_ACCELERATION_NONE;
+            }
+            return true;
+        };
+
+        bool allOpen = true;
+        for (int b = 0; b < OUT_COUNT && allOpen; b++) {
+            const OutputProduct p = static_cast<OutputProduct>(1u << b);
+            if (!(outputs & p) || (packed & p))
+                continue;
+            // Only the decoded frame is color with single-channel outputs
+            allOpen = open_one(writers.w[b], output_file_stem(p, is3D), channels == 3 || p == OUT_ORIGINAL);
+        }
+        if (allOpen && packed != 0)
+            allOpen = open_one(writers.packed, is3D ? "sobel3d_packed" : "packed", true);
+
+        if (allOpen) {
+            chosen.ext   = codec.ext;
+            chosen.codec = codec.name;
+            chosen.accel = static_cast<cv::VideoAccelerationType>(static_cast<int>(accel));
+            return true;
+        }
+
+        writers.release();
+    }
+
+    return false;
+}
+
+// <stem>.npy for every product in rawOutputs
+static bool open_raw(const std::string& outDir, unsigned rawOutputs, bool is3D, OutputWriters& writers) {
+    for (int b = 0; b < OUT_COUNT; b++) {
+        const OutputProduct p = static_cast<OutputProduct>(1u << b);
+        if ((rawOutputs & p) && !npy_open(writers.raw[b], outDir + "/" + output_file_stem(p, is3D) + ".npy"))
+            return false;
+    }
+    return true;
+}
+
+// Open path, with hardware decoding when hwAccel asks for it and
+// the backend can (software otherwise)
+static bool open_input(const std::string& path, cv::VideoCapture& cap,
+                       cv::Size& frameSize, double& fps,
+                       cv::VideoAccelerationType hwAccel) {
+    if (hwAccel != cv::VIDEO_ACCELERATION_NONE)
+        cap.open(path, cv::CAP_ANY, { cv::CAP_PROP_HW_ACCELERATION, hwAccel });
+    if (!cap.isOpened())
+        cap.open(path);
+    if (!cap.isOpened()) {
+        std::cout << "Could not open video: " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Decoding with " << cap.getBackendName() << ", "
+              << accel_desc(cap.get(cv::CAP_PROP_HW_ACCELERATION)) << "\n";
+
+    // Get FPS (fallback)
+    fps = cap.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0.0 && std::isfinite(fps))) fps = 30.0;
+
+    // Read one frame to determine size
+    cv::Mat tmp;
+    cap >> tmp;
+    if (tmp.empty()) {
+        std::cout << "Video has no frames: " << path << std::endl;
+        return false;
+    }
+    frameSize = tmp.size();
+
+    // Rewind
+    cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+    return true;
+}
+
+static void print_writer_failure() {
+    std::cout << "Failed to open video writers (H.264, MP4 and AVI all failed).\n"
+              << "This usually means your OpenCV build lacks a video backend (FFMPEG/GStreamer)\n"
+              << "or the system has no encoders available.\n";
+}
+
+// Products that go into the --pack stream / get a --raw sidecar
+static unsigned packed_outputs(const RunConfig& cfg, unsigned outputs, bool is3D) {
+    if (!cfg.packChannels)
+        return 0;
+    return outputs & (is3D ? (OUT_GT | OUT_MAG) : (OUT_GX | OUT_GY | OUT_MAG));
+}
+
+static unsigned raw_outputs(const RunConfig& cfg, unsigned outputs) {
+    return cfg.rawNpy ? outputs & (OUT_GX | OUT_GY | OUT_MAG | OUT_THETA | OUT_GT) : 0;
+}
+
+// The OpenCL 2D kernel is the 3x3 Sobel: wider kernels run on the CPU
+static OclSobel* ocl_2d(const RunConfig& cfg, RunContext& ctx) {
+    return ctx.ocl.ready && cfg.grad.kernel == KernelType::Sobel3 ? &ctx.ocl : nullptr;
+}
+
+// ------------------------------------------------------------
+// Still image -> PNGs
+// ------------------------------------------------------------
+static int run_image(const RunConfig& cfg, const std::string& path,
+                     const std::string& outDir, unsigned outputs, RunContext& ctx) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+    if (image.empty()) {
+        std::cout << "Could not open image: " << path << std::endl;
+        return -1;
+    }
+    if (cfg.pyramid > 0) {
+        cv::Mat full = image;
+        pyramid_down(full, cfg.pyramid, image, ctx.pool);
+        if (image.empty()) {
+            std::cout << "Image is too small for --pyramid " << cfg.pyramid << ": " << path << std::endl;
+            return -1;
+        }
+    }
+
+    // The kernels convert to gray row by row; the gray plane itself
+    // is only made for the gray product
+    cv::Mat gray, gx, gy, mag, theta, bgr;
+    if (outputs & OUT_GRAY)
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+
+    const unsigned planes = outputs & (OUT_GX | OUT_GY | OUT_MAG | OUT_THETA);
+    if (planes != 0 && ocl_2d(cfg, ctx))
+        ocl_sobel2d(ctx.ocl, image, gx, gy, mag, theta, planes);
+    else if (planes != 0)
+        sobel2d(ctx.pool, image, gx, gy, mag, theta, planes, cfg.grad);
+
+    const unsigned packed = packed_outputs(cfg, outputs, false);
+    const unsigned raw    = raw_outputs(cfg, outputs);
+
+    bool ok = true;
+    auto save = [&](OutputProduct p, const cv::Mat& m) {
+        if ((outputs & p) && !(packed & p))
+            ok = cv::imwrite(outDir + "/" + output_file_stem(p, false) + ".png", m) && ok;
+    };
+    cv::Mat packGray[3];
+    // One frame: PrevFrame / Ema give the image's own range,
+    // Percentile its own percentiles, Fixed the kernel bound
+    auto save_plane = [&](OutputProduct p, const cv::Mat& m, bool useAbs, cv::Mat* packTo) {
+        if (!(outputs & p))
+            return;
+        NormTrack track;
+        track.fixed.lo = 0.0f;
+        track.fixed.hi = p == OUT_MAG ? magnitude_bound(cfg.grad.mag, 2, cfg.grad.kernel) : gradient_bound(2, cfg.grad.kernel);
+        if (p == OUT_THETA)
+            theta_bounds(cfg.grad.theta, track.fixed.lo, track.fixed.hi);
+
+        if (packed & p) {
+            plane_to_bgr_norm(ctx.pool, m, useAbs, cfg.norm, cfg.normParams, track, *packTo, 1);
+            return;
+        }
+        plane_to_bgr_norm(ctx.pool, m, useAbs, cfg.norm, cfg.normParams, track, bgr, cfg.grayOutput ? 1 : 3);
+        save(p, bgr);
+    };
+    auto save_raw = [&](OutputProduct p, const cv::Mat& m) {
+        if (!(raw & p))
+            return;
+        NpyWriter npy;
+        ok = npy_open(npy, outDir + "/" + output_file_stem(p, false) + ".npy") && ok;
+        if (npy_is_open(npy))
+            ok = npy_write(npy, m) && npy_close(npy) && ok;
+    };
+
+    save(OUT_ORIGINAL, image);
+    save(OUT_GRAY, gray);
+    save_plane(OUT_GX,    gx,    true,  &packGray[0]);
+    save_plane(OUT_GY,    gy,    true,  &packGray[1]);
+    save_plane(OUT_MAG,   mag,   false, &packGray[2]);
+    save_plane(OUT_THETA, theta, false, nullptr);
+
+    if (packed != 0) {
+        pack_channels(ctx.pool,
+                      (packed & OUT_GX)  ? &packGray[0] : nullptr,
+                      (packed & OUT_GY)  ? &packGray[1] : nullptr,
+                      (packed & OUT_MAG) ? &packGray[2] : nullptr,
+                      image.size(), bgr);
+        ok = cv::imwrite(outDir + "/packed.png", bgr) && ok;
+    }
+
+    save_raw(OUT_GX,    gx);
+    save_raw(OUT_GY,    gy);
+    save_raw(OUT_MAG,   mag);
+    save_raw(OUT_THETA, theta);
+
+    if (!ok) {
+        std::cout << "Failed to write outputs to: " << outDir << std::endl;
+        return -1;
+    }
+
+    std::cout << "Done. Wrote " << outputs_to_string(outputs) << " PNGs.\n";
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Video -> frames.npy (8-bit gray), the input of later 3D runs
+// ------------------------------------------------------------
+static bool is_volume(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    for (char& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".npy";
+}
+
+static int run_to_volume(const RunConfig& cfg, const std::string& path, const std::string& outDir) {
+    cv::VideoCapture cap;
+    cv::Size frameSize;
+    double fps = 30.0;
+    if (!open_input(path, cap, frameSize, fps, cfg.hwAccel))
+        return -1;
+
+    const std::string out = outDir + "/frames.npy";
+    NpyWriter npy;
+    if (!npy_open(npy, out))
+        return -1;
+
+    cv::Mat frame, gray, level;
+    bool ok = true;
+    while (ok) {
+        {
+            StageTimer timer(Stage::Decode);
+            cap >> frame;
+        }
+        if (frame.empty())
+            break;
+        {
+            StageTimer timer(Stage::CvtColor);
+            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        }
+        if (cfg.pyramid > 0) {
+            pyramid_down(gray, cfg.pyramid, level);
+            ok = !level.empty() && npy_write(npy, level);
+        } else {
+            ok = npy_write(npy, gray);
+        }
+        metrics_frame();
+    }
+    const long long frames = npy.frames;
+    cap.release();
+    if (!npy_close(npy) || !ok)
+        return -1;
+
+    std::cout << "Done. Wrote " << frames << " frames to " << out << ".\n";
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Video / GIF / mapped volume
+// ------------------------------------------------------------
+// seg: only that segment of the clip (segments.hpp), sequential driver
+static int run_video(const RunConfig& cfg, RunMode mode, const std::string& path,
+                     const std::string& outDir, unsigned outputs, RunContext& ctx,
+                     const Segment* seg = nullptr) {
+    const bool is3D = (mode == RunMode::Video3D);
+    const bool live = is_live(path);
+
+    // .npy: frames come from the mapping, there is no capture
+    NpyVolume volume;
+    cv::VideoCapture cap;
+    cv::Size frameSize;
+    double fps = 30.0;
+    if (live) {
+        if (!live_open(path, cap, frameSize, fps, cfg.hwAccel))
+            return -1;
+    } else if (is_volume(path)) {
+        if (!is3D) {
+            std::cout << ".npy volumes are read by the 3D mode only.\n";
+            return -1;
+        }
+        if (!npy_map(volume, path))
+            return -1;
+        if (volume.type != CV_8U) {
+            std::cout << "Volume must hold 8-bit frames (|u1), not " << npy_descr(volume.type)
+                      << ": " << path << std::endl;
+            npy_unmap(volume);
+            return -1;
+        }
+        frameSize = volume.size;
+        std::cout << "Mapped " << volume.frames << " frames of " << frameSize.width << "x"
+                  << frameSize.height << " from " << path << "\n";
+    } else if (!open_input(path, cap, frameSize, fps, cfg.hwAccel)) {
+        return -1;
+    } else if (seg && !segment_seek(cap, seg->start)) {
+        return -1;
+    }
+
+    // Everything from the decimation on runs at the pyramid level
+    if (cfg.pyramid > 0) {
+        frameSize = pyramid_size(frameSize, cfg.pyramid);
+        if (frameSize.area() == 0) {
+            std::cout << "Frames are too small for --pyramid " << cfg.pyramid << ": " << path << std::endl;
+            npy_unmap(volume);
+            return -1;
+        }
+        std::cout << "Pyramid level " << cfg.pyramid << ": " << frameSize.width << "x" << frameSize.height << "\n";
+    }
+
+    const unsigned packed = packed_outputs(cfg, outputs, is3D);
+    const unsigned raw    = raw_outputs(cfg, outputs);
+
+    OutputWriters writers;
+    WriterChoice chosen;
+    const int channels = cfg.grayOutput ? 1 : 3;
+    if (!open_writers_with_fallback(outDir, frameSize, fps, outputs, packed, is3D, channels, cfg.hwAccel,
+                                    writers, chosen)) {
+        print_writer_failure();
+        npy_unmap(volume);
+        return -1;
+    }
+    if (!open_raw(outDir, raw, is3D, writers)) {
+        writers.release();
+        writers.close_raw();
+        npy_unmap(volume);
+        return -1;
+    }
+
+    std::cout << "Writing " << outputs_to_string(outputs) << (cfg.grayOutput ? " (gray)" : "")
+              << " as ." << chosen.ext
+              << " (" << chosen.codec << ", " << accel_desc(chosen.accel) << ") in folder: " << outDir << "\n";
+    if (packed != 0)
+        std::cout << "Packed " << outputs_to_string(packed) << " into the B, G, R channels of one stream\n";
+    if (raw != 0)
+        std::cout << "Raw .npy sidecars: " << outputs_to_string(raw) << "\n";
+
+    // Live: capture thread + drop-oldest queue, one latency row per output
+    LiveSource source;
+    LiveStats liveStats;
+    std::ofstream liveLog;
+    if (live) {
+        liveLog.open(outDir + "/live.csv");
+        source.cap = &cap;
+        source.level = cfg.pyramid;
+        source.pool = ctx.pool;
+        source.maxFrames = cfg.liveFrames;
+        // 3D holds the window's curr .. curr + R
+        live_start(source, frameSize, cfg.queueDepth, is3D ? kernel_radius(cfg.grad.kernel) + 1 : 2);
+        std::cout << "Live: up to " << cfg.queueDepth << " frames waiting, the oldest is dropped"
+                  << (cfg.liveFrames > 0 ? "" : "; Ctrl-C ends the run") << "\n";
+    }
+    std::ostream* log = liveLog.is_open() ? &liveLog : nullptr;
+
+    long long frameCountWritten;
+
+    if (is3D) {
+        // Unselected products get no writer: not computed, not encoded
+        Sobel3DWriters w = {
+            writers.get(outputs, OUT_ORIGINAL),
+            writers.get(outputs & ~packed, OUT_GT),
+            writers.get(outputs & ~packed, OUT_MAG),
+            channels
+        };
+        w.packed        = packed ? &writers.packed : nullptr;
+        w.packedOutputs = packed;
+        w.gtRaw         = writers.get_raw(raw, OUT_GT);
+        w.magRaw        = writers.get_raw(raw, OUT_MAG);
+
+        if (live)
+            frameCountWritten = run_sobel3d_live(source, frameSize, w, ctx.engine, cfg.norm, log, liveStats);
+        else if (volume.data)
+            frameCountWritten = run_sobel3d_volume(volume, w, ctx.engine, cfg.norm, cfg.pyramid);
+        else if (seg)
+            frameCountWritten = run_sobel3d_sequential(cap, frameSize, w, ctx.engine, cfg.norm, cfg.pyramid,
+                                                       seg->range);
+        else if (cfg.pipelined)
+            frameCountWritten = run_sobel3d_pipelined(cap, frameSize, w, ctx.engine, cfg.norm, cfg.queueDepth,
+                                                      cfg.pyramid);
+        else
+            frameCountWritten = run_sobel3d_sequential(cap, frameSize, w, ctx.engine, cfg.norm, cfg.pyramid);
+
+        if (frameCountWritten < 0) {
+            std::cout << "Video must have at least " << 2 * kernel_radius(cfg.grad.kernel) + 1
+                      << " frames for Sobel 3D (2 with --border).\n";
+            writers.release();
+            writers.close_raw();
+            npy_unmap(volume);
+            return -1;
+        }
+    } else {
+        Sobel2DWriters w = {
+            writers.get(outputs, OUT_ORIGINAL),
+            writers.get(outputs, OUT_GRAY),
+            writers.get(outputs & ~packed, OUT_GX),
+            writers.get(outputs & ~packed, OUT_GY),
+            writers.get(outputs & ~packed, OUT_MAG),
+            writers.get(outputs, OUT_THETA),
+            channels
+        };
+        w.packed        = packed ? &writers.packed : nullptr;
+        w.packedOutputs = packed;
+        w.gxRaw         = writers.get_raw(raw, OUT_GX);
+        w.gyRaw         = writers.get_raw(raw, OUT_GY);
+        w.magRaw        = writers.get_raw(raw, OUT_MAG);
+        w.thetaRaw      = writers.get_raw(raw, OUT_THETA);
+
+        OclSobel* ocl = ocl_2d(cfg, ctx);
+        if (live)
+            frameCountWritten = run_sobel2d_live(source, frameSize, w, ctx.pool, cfg.grad, ocl,
+                                                 cfg.norm, cfg.normParams, log, liveStats);
+        else
+            frameCountWritten = run_sobel2d_sequential(cap, frameSize, w, ctx.pool, cfg.grad, ocl,
+                                                       cfg.norm, cfg.normParams, cfg.pyramid);
+    }
+    live_stop(source);
+
+    // IMPORTANT: finalize files
+    writers.release();
+    cap.release();
+    npy_unmap(volume);
+    if (!writers.close_raw())
+        return -1;
+
+    if (seg)
+        std::cout << "Done. Segment " << seg->index << ": wrote " << frameCountWritten << " frames.\n";
+    else
+        std::cout << "Done. Wrote " << frameCountWritten << " frames.\n";
+    if (live)
+        std::cout << "Live: captured " << source.captured << ", dropped " << source.dropped
+                  << ", gaps " << liveStats.gaps << "; latency mean "
+                  << (liveStats.latencyCount ? liveStats.latencySumMs / liveStats.latencyCount : 0.0)
+                  << " ms, max " << liveStats.latencyMaxMs << " ms (" << outDir << "/live.csv).\n";
+    if (is3D && ctx.engine.gateMap.total > 0)
+        std::cout << "Motion gate: " << ctx.engine.gateMap.active << " of " << ctx.engine.gateMap.total
+                  << " tiles active (" << 100.0 * ctx.engine.gateMap.active / ctx.engine.gateMap.total << "%).\n";
+    return 0;
+}
+
+// ------------------------------------------------------------
+// One 3D video as time segments (--segments)
+// ------------------------------------------------------------
+static void setup_engine(const RunConfig& cfg, bool is3D, RunContext& ctx) {
+    ctx.engine.pool = ctx.pool;
+    ctx.engine.grad = cfg.grad;
+    ctx.engine.normParams = cfg.normParams;
+    ctx.engine.gate = cfg.gate;
+    ctx.engine.ocl  = ctx.ocl.ready ? &ctx.ocl : nullptr;
+
+    // The gated temporal pass has no OpenCL kernel
+    if (is3D && ctx.engine.ocl && gate_enabled(cfg.gate)) {
+        std::cout << "--motion / --roi: 3D Sobel runs on the CPU backend.\n";
+        ctx.engine.ocl = nullptr;
+    }
+
+    if (cfg.grad.kernel == KernelType::Sobel3)
+        return;
+    const char* name = kernel_type_name(cfg.grad.kernel);
+    if (!is3D) {
+        if (ctx.ocl.ready)
+            std::cout << "--kernel " << name << ": 2D Sobel runs on the CPU backend.\n";
+        return;
+    }
+
+    // The OpenCL and the gated temporal passes are 3x3x3
+    if (ctx.engine.ocl) {
+        std::cout << "--kernel " << name << ": 3D Sobel runs on the CPU backend.\n";
+        ctx.engine.ocl = nullptr;
+    }
+    if (gate_enabled(cfg.gate)) {
+        std::cout << "--kernel " << name << ": --motion / --roi apply to sobel3 only, every tile is computed.\n";
+        ctx.engine.gate = MotionGate();
+    }
+    if (cfg.grad.precision == Precision::Int16 && !kernel_fits_int16(cfg.grad.kernel, 3)) {
+        std::cout << "--kernel " << name << ": 3D Sobel runs in --precision float.\n";
+        ctx.engine.grad.precision = Precision::Float32;
+    }
+}
+
+static int run_segmented(const RunConfig& cfg, RunMode mode, const std::string& path,
+                         const std::string& outDir, unsigned outputs, RunContext& ctx) {
+    // The plan comes from the container's frame count, the same on
+    // every node
+    long long frames = 0;
+    {
+        cv::VideoCapture probe(path);
+        if (probe.isOpened())
+            frames = static_cast<long long>(probe.get(cv::CAP_PROP_FRAME_COUNT));
+    }
+    if (frames <= 0) {
+        std::cout << "Frame count unknown, --segments ignored: " << path << std::endl;
+        return run_video(cfg, mode, path, outDir, outputs, ctx);
+    }
+
+    const std::vector<Segment> plan = segment_plan(frames, cfg.segments, kernel_radius(cfg.grad.kernel));
+    const int count = static_cast<int>(plan.size());
+    std::cout << count << " segments of about " << frames / count << " frames (" << frames << " in the file)\n";
+
+    std::vector<std::string> rawStems;
+    const unsigned raw = raw_outputs(cfg, outputs);
+    for (int b = 0; b < OUT_COUNT; b++) {
+        const OutputProduct p = static_cast<OutputProduct>(1u << b);
+        if (raw & p)
+            rawStems.push_back(output_file_stem(p, true));
+    }
+
+    std::error_code ec;
+    if (cfg.segment >= 0) {
+        // One part of a multi-process / multi-node run
+        if (cfg.segment >= count) {
+            std::cout << "--segment " << cfg.segment << ": the plan has " << count << " segments.\n";
+            return -1;
+        }
+        const Segment& seg = plan[cfg.segment];
+        std::filesystem::create_directories(segment_dir(outDir, seg.index), ec);
+        return run_video(cfg, mode, path, segment_dir(outDir, seg.index), outputs, ctx, &seg);
+    }
+
+    if (cfg.segment == SEGMENT_ALL) {
+        // Stream threads over the shared pool, like run_batch; the
+        // caller's context is stream 0. Only the cores the pool left
+        // free (main.cpp) get one, split between the --streams:
+        // with the pool on every core the segments run one by one.
+        const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        const int spare = cores - (ctx.pool ? ctx.pool->size() : 1) + 1;
+        const int streams = std::max(1, std::min(count, spare / cfg.streams));
+        std::unique_ptr<RunContext[]> extra(new RunContext[streams - 1]);
+        for (int s = 0; s < streams - 1; s++) {
+            extra[s].pool = ctx.pool;
+            if (cfg.backend == Backend::OpenCL)
+                ocl_init(extra[s].ocl, cfg.grad, false);
+            setup_engine(cfg, true, extra[s]);
+        }
+
+        std::atomic<int> next{0};
+        std::atomic<int> failed{0};
+        auto stream_loop = [&](RunContext& c) {
+            for (int i = next++; i < count; i = next++) {
+                std::error_code dirEc;
+                std::filesystem::create_directories(segment_dir(outDir, i), dirEc);
+                if (run_video(cfg, mode, path, segment_dir(outDir, i), outputs, c, &plan[i]) != 0)
+                    failed++;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int s = 0; s < streams - 1; s++)
+            threads.emplace_back(stream_loop, std::ref(extra[s]));
+        stream_loop(ctx);
+        for (std::thread& t : threads)
+            t.join();
+
+        if (failed.load() > 0) {
+            std::cout << failed.load() << " of " << count << " segments failed, not merged.\n";
+            return -1;
+        }
+    }
+
+    return segment_merge(outDir, count, rawStems) ? 0 : -1;
+}
+
+int run_input(const RunConfig& cfg, const std::string& path,
+              const std::string& outDir, RunContext& ctx) {
+    const RunMode mode = mode_for(cfg.mode, path);
+    const bool is3D = (mode == RunMode::Video3D);
+
+    if (is_live(path) && (mode == RunMode::Image || mode == RunMode::Volume)) {
+        std::cout << path << ": live inputs run in 2d or 3d mode.\n";
+        return -1;
+    }
+
+    if (mode == RunMode::Volume) {
+        std::cout << path << " (" << run_mode_name(mode) << ")\n";
+        std::error_code ec;
+        std::filesystem::create_directories(outDir, ec);
+        return run_to_volume(cfg, path, outDir);
+    }
+
+    // Products this mode can make; no selection = all of them
+    const unsigned supported = is3D ? OUT_ALL_3D : OUT_ALL_2D;
+    const unsigned outputs = (cfg.outputs ? cfg.outputs : ~0u) & supported;
+
+    std::cout << path << " (" << run_mode_name(mode) << ")\n";
+
+    if (outputs == 0) {
+        std::cout << "None of the requested outputs apply to " << run_mode_name(mode)
+                  << " mode, skipping.\n";
+        return -1;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+
+    setup_engine(cfg, is3D, ctx);
+
+    if (mode == RunMode::Image)
+        return run_image(cfg, path, outDir, outputs, ctx);
+    if (is3D && cfg.segments > 1 && !is_live(path) && !is_volume(path))
+        return run_segmented(cfg, mode, path, outDir, outputs, ctx);
+    return run_video(cfg, mode, path, outDir, outputs, ctx);
+}
@@ -0,0 +1,28 @@
+// runner.hpp
+// ------------------------------------------------------------
+// One input file -> output files, for every RunMode.
+//
+// The RunContext lives for the whole batch: the pool threads and
+// the 3D engine's planes are reused from one input to the next, and
+// so is the OpenCL program and its device buffers.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+
+#include "cli.hpp"
+#include "ocl_backend.hpp"
+#include "sobel3d.hpp"
+#include "thread_pool.hpp"
+
+struct RunContext {
+    ThreadPool* pool = nullptr;
+    Sobel3DEngine engine;
+    OclSobel ocl;               // used when ocl.ready (--backend opencl)
+};
+
+// Process one input into outDir (created if needed).
+// Returns 0 on success, -1 on failure (reason printed).
+int run_input(const RunConfig& cfg, const std::string& path,
+              const std::string& outDir, RunContext& ctx);
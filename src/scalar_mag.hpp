@@ -0,0 +1,84 @@
+// scalar_mag.hpp
+// ------------------------------------------------------------
+// Scalar magnitude formulas by MagMode (internal header), shared by
+// the scalar row kernels and the kernel family (kernel_family.cpp).
+//
+// Only for files built for the baseline target: the ISA files keep
+// their own inline code (see simd_kernels.hpp).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "simd_kernels.hpp"
+
+// ------------------------------------------------------------
+// Float magnitude by MagMode
+// ------------------------------------------------------------
+template <int Mag>
+static inline float mag2_f32(float x, float y) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return std::sqrt(x * x + y * y);
+
+    const float ax = std::fabs(x), ay = std::fabs(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return ax + ay;
+
+    const float mx = std::max(ax, ay), mn = std::min(ax, ay);
+    return mx * (AMAX_A * AMAX_Q15) + mn * (AMAX_B2 * AMAX_Q15);
+}
+
+template <int Mag>
+static inline float mag3_f32(float x, float y, float t) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return std::sqrt(x * x + y * y + t * t);
+
+    const float ax = std::fabs(x), ay = std::fabs(y), at = std::fabs(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return ax + ay + at;
+
+    const float mx = std::max(std::max(ax, ay), at);
+    const float mn = std::min(std::min(ax, ay), at);
+    const float md = ax + ay + at - mx - mn;                // integer values: exact below 2^24
+    return mx * (AMAX_A * AMAX_Q15) + md * (AMAX_B3 * AMAX_Q15) + mn * (AMAX_C3 * AMAX_Q15);
+}
+
+// ------------------------------------------------------------
+// int16 magnitude by MagMode
+// ------------------------------------------------------------
+// round(v * c / 2^15), as pmulhrsw / vqrdmulh for v, c >= 0
+static inline int q15(int v, int c) {
+    return (v * c + (1 << 14)) >> 15;
+}
+
+template <int Mag>
+static inline int16_t mag2_s16(int x, int y) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return static_cast<int16_t>(std::lrintf(std::sqrt(static_cast<float>(x * x + y * y))));
+
+    const int ax = std::abs(x), ay = std::abs(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return static_cast<int16_t>(ax + ay);
+
+    const int mx = std::max(ax, ay), mn = std::min(ax, ay);
+    return static_cast<int16_t>(q15(mx, AMAX_A) + q15(mn, AMAX_B2));
+}
+
+template <int Mag>
+static inline int16_t mag3_s16(int x, int y, int t) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return static_cast<int16_t>(std::lrintf(std::sqrt(static_cast<float>(x * x + y * y + t * t))));
+
+    const int ax = std::abs(x), ay = std::abs(y), at = std::abs(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return static_cast<int16_t>(ax + ay + at);
+
+    const int mx = std::max(std::max(ax, ay), at);
+    const int mn = std::min(std::min(ax, ay), at);
+    const int md = ax + ay + at - mx - mn;
+    return static_cast<int16_t>(q15(mx, AMAX_A) + q15(md, AMAX_B3) + q15(mn, AMAX_C3));
+}
@@ -0,0 +1,153 @@
+// segments.cpp
+// ------------------------------------------------------------
+// Segment plan, seek and merge, see segments.hpp.
+// ------------------------------------------------------------
+
+#include "segments.hpp"
+#include "npy_volume.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+std::vector<Segment> segment_plan(long long frames, int count, int overlap) {
+    // Every segment owns overlap + 1 frames or more
+    const long long n = std::max(1LL, std::min(static_cast<long long>(count), frames / (overlap + 1)));
+
+    std::vector<Segment> plan;
+    for (long long i = 0; i < n; i++) {
+        Segment s;
+        s.index = static_cast<int>(i);
+        s.begin = frames * i / n;
+        s.end   = frames * (i + 1) / n;
+        s.start = std::max(0LL, s.begin - overlap);
+
+        // The last segment reads to the end: frame counts of
+        // containers are estimates
+        const bool last = (i == n - 1);
+        s.range.frames = last ? -1 : std::min(frames, s.end + overlap) - s.start;
+        s.range.lead   = s.begin - s.start;
+        s.range.owned  = last ? -1 : s.end - s.begin;
+        plan.push_back(s);
+    }
+    return plan;
+}
+
+std::string segment_dir(const std::string& outDir, int index) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%03d", index);
+    return outDir + "/segments/" + name;
+}
+
+bool segment_seek(cv::VideoCapture& cap, long long frame) {
+    if (frame == 0)
+        return true;
+    if (cap.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(frame)) &&
+        static_cast<long long>(cap.get(cv::CAP_PROP_POS_FRAMES)) == frame)
+        return true;
+
+    // No seek: decode forward without converting the frames
+    long long pos = static_cast<long long>(cap.get(cv::CAP_PROP_POS_FRAMES));
+    if (pos > frame) {
+        std::cout << "Could not seek to frame " << frame << std::endl;
+        return false;
+    }
+    for (; pos < frame; pos++) {
+        if (!cap.grab()) {
+            std::cout << "Video ended before frame " << frame << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append every frame of part to out
+static bool append_npy(NpyWriter& out, const std::string& part) {
+    NpyVolume vol;
+    if (!npy_map(vol, part))
+        return false;
+    bool ok = true;
+    for (int t = 0; t < vol.frames && ok; t++)
+        ok = npy_write(out, npy_frame(vol, t));
+    npy_unmap(vol);
+    return ok;
+}
+
+static bool is_video_file(const fs::path& p) {
+    std::string ext = p.extension().string();
+    for (char& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".mp4" || ext == ".avi";
+}
+
+bool segment_merge(const std::string& outDir, int count, const std::vector<std::string>& rawStems) {
+    std::error_code ec;
+    for (int i = 0; i < count; i++) {
+        if (!fs::is_directory(segment_dir(outDir, i), ec)) {
+            std::cout << "Segment " << i << " is missing: " << segment_dir(outDir, i) << std::endl;
+            return false;
+        }
+    }
+
+    bool ok = true;
+
+    // Sidecars: one volume, frames in segment order
+    for (const std::string& stem : rawStems) {
+        const std::string out = outDir + "/" + stem + ".npy";
+        NpyWriter npy;
+        if (!npy_open(npy, out))
+            return false;
+        for (int i = 0; i < count && ok; i++)
+            ok = append_npy(npy, segment_dir(outDir, i) + "/" + stem + ".npy");
+        const long long frames = npy.frames;
+        ok = npy_close(npy) && ok;
+        if (!ok)
+            return false;
+        std::cout << "Merged " << frames << " frames into " << out << "\n";
+    }
+
+    // Videos: concat lists for ffmpeg, names as in the first segment
+    std::vector<std::string> videos;
+    for (const fs::directory_entry& e : fs::directory_iterator(segment_dir(outDir, 0), ec))
+        if (e.is_regular_file(ec) && is_video_file(e.path()))
+            videos.push_back(e.path().filename().string());
+    std::sort(videos.begin(), videos.end());
+
+    for (const std::string& video : videos) {
+        const std::string list = outDir + "/" + fs::path(video).stem().string() + ".txt";
+        std::ofstream out(list);
+        for (int i = 0; i < count && ok; i++) {
+            const std::string part = segment_dir(outDir, i) + "/" + video;
+            if (!fs::exists(part, ec)) {
+                std::cout << "Segment " << i << " has no " << video << std::endl;
+                ok = false;
+                break;
+            }
+            // Relative to the list's folder
+            out << "file '" << segment_dir(".", i) << "/" << video << "'\n";
+        }
+        if (!ok || !out)
+            return false;
+        std::cout << "Concat list " << list << " (ffmpeg -f concat -safe 0 -i " << list
+                  << " -c copy " << outDir << "/" << video << ")\n";
+    }
+    return ok;
+}
+
+bool segment_parse(const std::string& text, int& segment) {
+    if (text == "all")   { segment = SEGMENT_ALL;   return true; }
+    if (text == "merge") { segment = SEGMENT_MERGE; return true; }
+    if (text.empty() || text.size() > 6)
+        return false;
+    for (char c : text)
+        if (!std::isdigit(static_cast<unsigned char>(c)))
+            return false;
+    segment = std::atoi(text.c_str());
+    return true;
+}
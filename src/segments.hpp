@@ -0,0 +1,73 @@
+// segments.hpp
+// ------------------------------------------------------------
+// One long video split into time segments (--segments N).
+//
+// A 3D output only needs the frames curr - R .. curr + R (R =
+// kernel_radius, 1 for Sobel3), so frame ranges of a clip can be
+// processed independently: segment i owns the output frames
+// [begin, end) and decodes [begin - R, end + R), R overlap frames at
+// each end that are read but not written (the clip's own first /
+// last frames keep their border outputs). The concatenated segments
+// write exactly the frames of a single run.
+//
+// Each segment seeks its own VideoCapture to begin - R. OpenCV does
+// not expose the keyframe index; its FFmpeg backend seeks to the
+// keyframe before the target and decodes forward, so a boundary
+// costs at most one GOP of extra decode (backends that cannot seek
+// are fast-forwarded with grab()).
+//
+// Segments run in-process on N stream threads sharing the pool
+// (like --streams), or one per process / node with --segment I, all
+// writing into <out>/segments/<III>/. The merge (after an in-process
+// run, or --segment merge once every part exists) then:
+//   - appends the segments' .npy sidecars into <out>/<product>.npy,
+//     bit-exact;
+//   - writes <out>/<product>.txt, an ffmpeg concat list of the
+//     segment videos: `ffmpeg -f concat -safe 0 -i sobel3d_gt.txt
+//     -c copy sobel3d_gt.mp4` joins them without re-encoding (OpenCV
+//     cannot remux).
+//
+// Scaling carried from frame to frame (--norm prev / ema /
+// percentile) restarts at every segment; minmax and fixed are
+// identical to a single run.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <vector>
+
+#include "video_pipeline.hpp"
+
+const int SEGMENT_ALL   = -1;   // --segment all (default)
+const int SEGMENT_MERGE = -2;   // --segment merge
+
+struct Segment {
+    int index = 0;
+    long long begin = 0;        // first output frame owned
+    long long end = 0;          // one past the last
+    long long start = 0;        // first frame decoded (begin - overlap, or 0)
+    ClipRange range;            // frames decoded from start, lead / owned
+};
+
+// count segments of about equal length over frames, overlap frames
+// read past each end (fewer segments when the clip is too short for
+// count of overlap + 1 frames or more)
+std::vector<Segment> segment_plan(long long frames, int count, int overlap = 1);
+
+// <outDir>/segments/<III>
+std::string segment_dir(const std::string& outDir, int index);
+
+// Position cap at frame (seek, or grab() forward from the start when
+// the backend cannot seek). Prints the problem on failure.
+bool segment_seek(cv::VideoCapture& cap, long long frame);
+
+// Merge count segment folders under outDir (see above): one .npy per
+// name in rawStems, one concat list per video file found. Prints the
+// results; false if a part is missing or does not match.
+bool segment_merge(const std::string& outDir, int count, const std::vector<std::string>& rawStems);
+
+// "all", "merge" or an index 0 .. count - 1 (checked by the runner)
+bool segment_parse(const std::string& text, int& segment);
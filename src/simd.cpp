@@ -0,0 +1,122 @@
+// simd.cpp
+// ------------------------------------------------------------
+// CPU feature detection + kernel table selection, see simd.hpp.
+// ------------------------------------------------------------
+
+#include "simd.hpp"
+#include "simd_kernels.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(SOBEL_SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static SimdLevel detect_level() {
+#if defined(SOBEL_SIMD_X86)
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SimdLevel::SSE41;
+#elif defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+
+    __cpuid(regs, 1);
+    const bool sse41   = (regs[2] & (1 << 19)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx     = (regs[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx) {
+        // OS must save the YMM state too
+        const bool ymmEnabled = (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(regs, 7, 0);
+        avx2 = ymmEnabled && (regs[1] & (1 << 5)) != 0;
+    }
+
+    if (avx2)
+        return SimdLevel::AVX2;
+    if (sse41)
+        return SimdLevel::SSE41;
+#endif
+#elif defined(SOBEL_SIMD_NEON)
+    return SimdLevel::NEON;
+#endif
+    return SimdLevel::Scalar;
+}
+
+static const SobelRowKernels* table_for(SimdLevel level) {
+    switch (level) {
+#if defined(SOBEL_SIMD_X86)
+    case SimdLevel::SSE41: return sobel_kernels_sse41();
+    case SimdLevel::AVX2:  return sobel_kernels_avx2();
+#endif
+#if defined(SOBEL_SIMD_NEON)
+    case SimdLevel::NEON:  return sobel_kernels_neon();
+#endif
+    default:               return sobel_kernels_scalar();
+    }
+}
+
+static std::atomic<int> gLevel{-1};     // -1 = not detected yet
+
+SimdLevel simd_detect() {
+    static const SimdLevel best = detect_level();
+    return best;
+}
+
+SimdLevel simd_active() {
+    int v = gLevel.load(std::memory_order_acquire);
+    if (v < 0) {
+        v = static_cast<int>(simd_detect());
+        gLevel.store(v, std::memory_order_release);
+    }
+    return static_cast<SimdLevel>(v);
+}
+
+bool simd_set_level(SimdLevel level) {
+    const SimdLevel best = simd_detect();
+
+    bool ok = false;
+    switch (level) {
+    case SimdLevel::Scalar: ok = true; break;
+    case SimdLevel::SSE41:  ok = (best == SimdLevel::SSE41 || best == SimdLevel::AVX2); break;
+    case SimdLevel::AVX2:   ok = (best == SimdLevel::AVX2); break;
+    case SimdLevel::NEON:   ok = (best == SimdLevel::NEON); break;
+    }
+
+    if (ok)
+        gLevel.store(static_cast<int>(level), std::memory_order_release);
+    return ok;
+}
+
+const char* simd_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE41:  return "sse4.1";
+    case SimdLevel::AVX2:   return "avx2";
+    case SimdLevel::NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+bool simd_parse(const char* name, SimdLevel& level) {
+    const SimdLevel all[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::NEON };
+    for (SimdLevel l : all) {
+        if (std::strcmp(name, simd_name(l)) == 0) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+const SobelRowKernels& sobel_kernels() {
+    return *table_for(simd_active());
+}
@@ -0,0 +1,34 @@
+// simd.hpp
+// ------------------------------------------------------------
+// Runtime CPU dispatch for the vectorized Sobel row kernels.
+//
+// One binary carries scalar, SSE4.1 and AVX2 builds on x86 and a
+// NEON build on ARM64. The best level the CPU supports is picked on
+// first use; simd_set_level() can force a lower one (benchmarks,
+// debugging).
+// ------------------------------------------------------------
+
+#pragma once
+
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+    NEON
+};
+
+// Best level supported by this CPU and build.
+SimdLevel simd_detect();
+
+// Level currently used by the kernels.
+SimdLevel simd_active();
+
+// Force a level. Returns false (and changes nothing) if the CPU or
+// build does not support it.
+bool simd_set_level(SimdLevel level);
+
+// "scalar", "sse4.1", "avx2", "neon"
+const char* simd_name(SimdLevel level);
+
+// Parse a name as printed by simd_name(). Returns false if unknown.
+bool simd_parse(const char* name, SimdLevel& level);
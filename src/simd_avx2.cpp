@@ -0,0 +1,709 @@
+// simd_avx2.cpp
+// ------------------------------------------------------------
+// AVX2 row kernels (16 x int16 / 8 x float per instruction).
+// Compiled with -mavx2; only selected when the CPU has it.
+// ------------------------------------------------------------
+
+#include "kernel_weights.hpp"
+#include "simd_kernels.hpp"
+
+#include <immintrin.h>
+
+static inline __m256i load_u8x16(const uint8_t* p) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+static inline __m256i load_s16(const int16_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+static inline void store_s16(int16_t* p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+}
+
+// a + 2b + c
+static inline __m256i smooth3(__m256i a, __m256i b, __m256i c) {
+    return _mm256_add_epi16(_mm256_add_epi16(a, c), _mm256_slli_epi16(b, 1));
+}
+
+static inline __m256 lo_ps(__m256i v) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+}
+
+static inline __m256 hi_ps(__m256i v) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+}
+
+template <int Want>
+static void h3d_avx2(const uint8_t* r, int16_t* hs, int16_t* hd, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i a = load_u8x16(r + x - 1);
+        __m256i b = load_u8x16(r + x);
+        __m256i c = load_u8x16(r + x + 1);
+
+        store_s16(hs + x, smooth3(a, b, c));
+        if (Want & K3D_DERIV)
+            store_s16(hd + x, _mm256_sub_epi16(c, a));
+    }
+    sobel_kernels_scalar()->h3d[Want](r, hs, hd, x, x1);
+}
+
+template <int Want>
+static void v3d_avx2(const int16_t* hsU, const int16_t* hsC, const int16_t* hsD,
+                     const int16_t* hdU, const int16_t* hdC, const int16_t* hdD,
+                     int16_t* dxs, int16_t* sdy, int16_t* ss, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i su = load_s16(hsU + x), sc = load_s16(hsC + x), sd = load_s16(hsD + x);
+
+        if (Want & K3D_DERIV) {
+            __m256i du = load_s16(hdU + x), dc = load_s16(hdC + x), dd = load_s16(hdD + x);
+            store_s16(dxs + x, smooth3(du, dc, dd));
+            store_s16(sdy + x, _mm256_sub_epi16(sd, su));
+        }
+        store_s16(ss  + x, smooth3(su, sc, sd));
+    }
+    sobel_kernels_scalar()->v3d[Want](hsU, hsC, hsD, hdU, hdC, hdD, dxs, sdy, ss, x, x1);
+}
+
+static inline __m256 abs_ps(__m256 v) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+// Float magnitude by MagMode, same operation order as the scalar kernels
+template <int Mag>
+static inline __m256 mag2_ps(__m256 x, __m256 y) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+
+    __m256 ax = abs_ps(x), ay = abs_ps(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return _mm256_add_ps(ax, ay);
+
+    __m256 mx = _mm256_max_ps(ax, ay), mn = _mm256_min_ps(ax, ay);
+    return _mm256_add_ps(_mm256_mul_ps(mx, _mm256_set1_ps(AMAX_A * AMAX_Q15)),
+                      _mm256_mul_ps(mn, _mm256_set1_ps(AMAX_B2 * AMAX_Q15)));
+}
+
+template <int Mag>
+static inline __m256 mag3_ps(__m256 x, __m256 y, __m256 t) {
+    if (Mag == static_cast<int>(MagMode::Exact)) {
+        // (x^2 + y^2) + t^2
+        return _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(t, t)));
+    }
+
+    __m256 ax = abs_ps(x), ay = abs_ps(y), at = abs_ps(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return _mm256_add_ps(_mm256_add_ps(ax, ay), at);
+
+    __m256 mx = _mm256_max_ps(_mm256_max_ps(ax, ay), at);
+    __m256 mn = _mm256_min_ps(_mm256_min_ps(ax, ay), at);
+    __m256 md = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(ax, ay), at), mx), mn);
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx, _mm256_set1_ps(AMAX_A * AMAX_Q15)),
+                                  _mm256_mul_ps(md, _mm256_set1_ps(AMAX_B3 * AMAX_Q15))),
+                      _mm256_mul_ps(mn, _mm256_set1_ps(AMAX_C3 * AMAX_Q15)));
+}
+
+template <int Mag, int Want>
+static void combine3d_avx2(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                           const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                           const int16_t* ssP,  const int16_t* ssN,
+                           float* gt, float* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i g3 = _mm256_sub_epi16(load_s16(ssN + x), load_s16(ssP + x));
+        __m256 ft[2] = { lo_ps(g3), hi_ps(g3) };
+
+        if (Want & K3D_GT) {
+            _mm256_storeu_ps(gt + x,     ft[0]);
+            _mm256_storeu_ps(gt + x + 8, ft[1]);
+        }
+
+        if (Want & K3D_MAG) {
+            __m256i gx = smooth3(load_s16(dxsP + x), load_s16(dxsC + x), load_s16(dxsN + x));
+            __m256i gy = smooth3(load_s16(sdyP + x), load_s16(sdyC + x), load_s16(sdyN + x));
+
+            __m256 fx[2] = { lo_ps(gx), hi_ps(gx) };
+            __m256 fy[2] = { lo_ps(gy), hi_ps(gy) };
+
+            for (int h = 0; h < 2; h++)
+                _mm256_storeu_ps(mag + x + 8 * h, mag3_ps<Mag>(fx[h], fy[h], ft[h]));
+        }
+    }
+    sobel_kernels_scalar()->combine3d[Mag][Want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN, gt, mag, x, x1);
+}
+
+template <int Mag, int Want>
+static void sobel2d_avx2(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                         float* gx, float* gy, float* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i u0 = load_u8x16(u + x - 1), u1 = load_u8x16(u + x), u2 = load_u8x16(u + x + 1);
+        __m256i c0 = load_u8x16(c + x - 1),                           c2 = load_u8x16(c + x + 1);
+        __m256i d0 = load_u8x16(d + x - 1), d1 = load_u8x16(d + x), d2 = load_u8x16(d + x + 1);
+
+        // Gx = [-1 0 1; -2 0 2; -1 0 1], Gy = [-1 -2 -1; 0 0 0; 1 2 1]
+        __m256i sx = smooth3(_mm256_sub_epi16(u2, u0), _mm256_sub_epi16(c2, c0), _mm256_sub_epi16(d2, d0));
+        __m256i sy = _mm256_sub_epi16(smooth3(d0, d1, d2), smooth3(u0, u1, u2));
+
+        __m256 fx[2] = { lo_ps(sx), hi_ps(sx) };
+        __m256 fy[2] = { lo_ps(sy), hi_ps(sy) };
+
+        for (int h = 0; h < 2; h++) {
+            if (Want & K2D_GXGY) {
+                _mm256_storeu_ps(gx  + x + 8 * h, fx[h]);
+                _mm256_storeu_ps(gy  + x + 8 * h, fy[h]);
+            }
+            if (Want & K2D_MAG) {
+                _mm256_storeu_ps(mag + x + 8 * h, mag2_ps<Mag>(fx[h], fy[h]));
+            }
+        }
+    }
+    sobel_kernels_scalar()->sobel2d[Mag][Want](u, c, d, gx, gy, mag, x, x1);
+}
+
+// ------------------------------------------------------------
+// int16 kernels
+// ------------------------------------------------------------
+
+// round(sqrt(s)) of int32 sums, packed back to int16
+static inline __m256i sqrt_s16(__m256i lo, __m256i hi) {
+    return _mm256_packs_epi32(_mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(lo))),
+                           _mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(hi))));
+}
+
+template <int Mag>
+static inline __m256i mag2_s16(__m256i x, __m256i y) {
+    if (Mag == static_cast<int>(MagMode::Exact)) {
+        // x^2 + y^2 in int32 (exact), unpack lo / hi pairs then pack
+        // back in the same (per-lane) order
+        __m256i lo = _mm256_unpacklo_epi16(x, y), hi = _mm256_unpackhi_epi16(x, y);
+        return sqrt_s16(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi));
+    }
+
+    __m256i ax = _mm256_abs_epi16(x), ay = _mm256_abs_epi16(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return _mm256_add_epi16(ax, ay);
+
+    __m256i mx = _mm256_max_epi16(ax, ay), mn = _mm256_min_epi16(ax, ay);
+    return _mm256_add_epi16(_mm256_mulhrs_epi16(mx, _mm256_set1_epi16(AMAX_A)),
+                         _mm256_mulhrs_epi16(mn, _mm256_set1_epi16(AMAX_B2)));
+}
+
+template <int Mag>
+static inline __m256i mag3_s16(__m256i x, __m256i y, __m256i t) {
+    if (Mag == static_cast<int>(MagMode::Exact)) {
+        __m256i z = _mm256_setzero_si256();
+        __m256i lo = _mm256_unpacklo_epi16(x, y), hi = _mm256_unpackhi_epi16(x, y);
+        __m256i tl = _mm256_unpacklo_epi16(t, z), th = _mm256_unpackhi_epi16(t, z);
+        return sqrt_s16(_mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(tl, tl)),
+                        _mm256_add_epi32(_mm256_madd_epi16(hi, hi), _mm256_madd_epi16(th, th)));
+    }
+
+    __m256i ax = _mm256_abs_epi16(x), ay = _mm256_abs_epi16(y), at = _mm256_abs_epi16(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return _mm256_add_epi16(_mm256_add_epi16(ax, ay), at);
+
+    __m256i mx = _mm256_max_epi16(_mm256_max_epi16(ax, ay), at);
+    __m256i mn = _mm256_min_epi16(_mm256_min_epi16(ax, ay), at);
+    __m256i md = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(ax, ay), at), mx), mn);
+    return _mm256_add_epi16(_mm256_add_epi16(_mm256_mulhrs_epi16(mx, _mm256_set1_epi16(AMAX_A)),
+                                        _mm256_mulhrs_epi16(md, _mm256_set1_epi16(AMAX_B3))),
+                         _mm256_mulhrs_epi16(mn, _mm256_set1_epi16(AMAX_C3)));
+}
+
+template <int Mag, int Want>
+static void combine3d_s16_avx2(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                                const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                                const int16_t* ssP,  const int16_t* ssN,
+                                int16_t* gt, int16_t* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i g3 = _mm256_sub_epi16(load_s16(ssN + x), load_s16(ssP + x));
+
+        if (Want & K3D_GT)
+            store_s16(gt + x, g3);
+
+        if (Want & K3D_MAG) {
+            __m256i gx = smooth3(load_s16(dxsP + x), load_s16(dxsC + x), load_s16(dxsN + x));
+            __m256i gy = smooth3(load_s16(sdyP + x), load_s16(sdyC + x), load_s16(sdyN + x));
+            store_s16(mag + x, mag3_s16<Mag>(gx, gy, g3));
+        }
+    }
+    sobel_kernels_scalar()->combine3d_s16[Mag][Want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN, gt, mag, x, x1);
+}
+
+template <int Mag, int Want>
+static void sobel2d_s16_avx2(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                              int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i u0 = load_u8x16(u + x - 1), u1 = load_u8x16(u + x), u2 = load_u8x16(u + x + 1);
+        __m256i c0 = load_u8x16(c + x - 1),                           c2 = load_u8x16(c + x + 1);
+        __m256i d0 = load_u8x16(d + x - 1), d1 = load_u8x16(d + x), d2 = load_u8x16(d + x + 1);
+
+        __m256i sx = smooth3(_mm256_sub_epi16(u2, u0), _mm256_sub_epi16(c2, c0), _mm256_sub_epi16(d2, d0));
+        __m256i sy = _mm256_sub_epi16(smooth3(d0, d1, d2), smooth3(u0, u1, u2));
+
+        if (Want & K2D_GXGY) {
+            store_s16(gx + x, sx);
+            store_s16(gy + x, sy);
+        }
+        if (Want & K2D_MAG)
+            store_s16(mag + x, mag2_s16<Mag>(sx, sy));
+    }
+    sobel_kernels_scalar()->sobel2d_s16[Mag][Want](u, c, d, gx, gy, mag, x, x1);
+}
+
+// ------------------------------------------------------------
+// Orientation (2 x 8 pixels per step)
+// ------------------------------------------------------------
+// 2 x 8 floats of a gradient row
+static inline void load_ps2(const float* p, __m256 v[2]) {
+    v[0] = _mm256_loadu_ps(p);
+    v[1] = _mm256_loadu_ps(p + 8);
+}
+
+static inline void load_ps2(const int16_t* p, __m256 v[2]) {
+    __m256i s = load_s16(p);
+    v[0] = lo_ps(s);
+    v[1] = hi_ps(s);
+}
+
+// 16 int32 (0..15) -> 16 bytes; packs work per 128-bit lane, so
+// restore the order with one permute
+static inline void store_bins16(uint8_t* p, __m256i lo, __m256i hi) {
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    __m128i b = _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), b);
+}
+
+// Scalar tails by gradient type
+static void theta_poly_tail(const float* gx, const float* gy, float* theta, int x0, int x1) {
+    sobel_kernels_scalar()->theta_poly(gx, gy, theta, x0, x1);
+}
+
+static void theta_poly_tail(const int16_t* gx, const int16_t* gy, float* theta, int x0, int x1) {
+    sobel_kernels_scalar()->theta_poly_s16(gx, gy, theta, x0, x1);
+}
+
+static void theta_bins_tail(int b, const float* gx, const float* gy, uint8_t* bins, int x0, int x1) {
+    sobel_kernels_scalar()->theta_bins[b](gx, gy, bins, x0, x1);
+}
+
+static void theta_bins_tail(int b, const int16_t* gx, const int16_t* gy, uint8_t* bins, int x0, int x1) {
+    sobel_kernels_scalar()->theta_bins_s16[b](gx, gy, bins, x0, x1);
+}
+
+template <typename T>
+static void theta_poly_avx2(const T* gx, const T* gy, float* theta, int x0, int x1) {
+    const __m256 zero = _mm256_setzero_ps();
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256 vx[2], vy[2];
+        load_ps2(gx + x, vx);
+        load_ps2(gy + x, vy);
+
+        for (int h = 0; h < 2; h++) {
+            __m256 ax = abs_ps(vx[h]), ay = abs_ps(vy[h]);
+            __m256 mx = _mm256_max_ps(ax, ay), mn = _mm256_min_ps(ax, ay);
+
+            // mn / mx, 0 where mx == 0 (masks the NaN of 0 / 0)
+            __m256 a = _mm256_and_ps(_mm256_div_ps(mn, mx), _mm256_cmp_ps(mx, zero, _CMP_GT_OQ));
+            __m256 s = _mm256_mul_ps(a, a);
+            __m256 r = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(ATAN_C9), s), _mm256_set1_ps(ATAN_C7));
+            r = _mm256_add_ps(_mm256_mul_ps(r, s), _mm256_set1_ps(ATAN_C5));
+            r = _mm256_add_ps(_mm256_mul_ps(r, s), _mm256_set1_ps(ATAN_C3));
+            r = _mm256_add_ps(_mm256_mul_ps(r, s), _mm256_set1_ps(ATAN_C1));
+            r = _mm256_mul_ps(r, a);
+
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(THETA_HALF_PI), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(THETA_PI), r), _mm256_cmp_ps(vx[h], zero, _CMP_LT_OQ));
+            r = _mm256_xor_ps(r, _mm256_and_ps(_mm256_cmp_ps(vy[h], zero, _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+            _mm256_storeu_ps(theta + x + 8 * h, r);
+        }
+    }
+    theta_poly_tail(gx, gy, theta, x, x1);
+}
+
+template <typename T, int B>
+static void theta_bins_avx2(const T* gx, const T* gy, uint8_t* bins, int x0, int x1) {
+    const int n = 4 << B;
+    const __m256 zero = _mm256_setzero_ps();
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256 vx[2], vy[2];
+        load_ps2(gx + x, vx);
+        load_ps2(gy + x, vy);
+
+        __m256i k[2];
+        for (int h = 0; h < 2; h++) {
+            __m256 ax = abs_ps(vx[h]), ay = abs_ps(vy[h]);
+
+            // Sector inside the quadrant: count the edges below (compare masks are -1)
+            __m256i j = _mm256_setzero_si256();
+            for (int i = 0; i < n / 4; i++) {
+                __m256 above = _mm256_cmp_ps(ay, _mm256_mul_ps(ax, _mm256_set1_ps(THETA_BIN_EDGES[B][i])), _CMP_GT_OQ);
+                j = _mm256_sub_epi32(j, _mm256_castps_si256(above));
+            }
+
+            // Mirror: negate j when exactly one of gx, gy is negative, + n/2 when gx < 0
+            __m256i negX = _mm256_castps_si256(_mm256_cmp_ps(vx[h], zero, _CMP_LT_OQ));
+            __m256i negY = _mm256_castps_si256(_mm256_cmp_ps(vy[h], zero, _CMP_LT_OQ));
+            __m256i flip = _mm256_xor_si256(negX, negY);
+            j = _mm256_sub_epi32(_mm256_xor_si256(j, flip), flip);
+            j = _mm256_add_epi32(j, _mm256_and_si256(negX, _mm256_set1_epi32(n / 2)));
+            k[h] = _mm256_and_si256(j, _mm256_set1_epi32(n - 1));
+        }
+        store_bins16(bins + x, k[0], k[1]);
+    }
+    theta_bins_tail(B, gx, gy, bins, x, x1);
+}
+
+// ------------------------------------------------------------
+// BGR -> gray, 16 pixels (48 bytes) per step. Each 8-pixel half is
+// loaded as bytes [0, 16) | [8, 24) so pshufb stays in its lane:
+// (B, G) and (R, 0) int16 pairs, vpmaddwd with the Q15 weights
+// ------------------------------------------------------------
+static inline __m256i load_bgr8(const uint8_t* p) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)), 1);
+}
+
+static void bgr_gray_avx2(const uint8_t* bgr, uint8_t* gray, int x0, int x1) {
+    const char z = -128;
+    const __m256i bg = _mm256_setr_epi8(0, z, 1, z, 3, z, 4, z, 6, z, 7, z, 9, z, 10, z,
+                                        4, z, 5, z, 7, z, 8, z, 10, z, 11, z, 13, z, 14, z);
+    const __m256i r  = _mm256_setr_epi8(2, z, z, z, 5, z, z, z, 8, z, z, z, 11, z, z, z,
+                                        6, z, z, z, 9, z, z, z, 12, z, z, z, 15, z, z, z);
+    const __m256i wBG  = _mm256_set1_epi32((GRAY_G << 16) | GRAY_B);
+    const __m256i wR   = _mm256_set1_epi32(GRAY_R);
+    const __m256i half = _mm256_set1_epi32(1 << (GRAY_SHIFT - 1));
+
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        const uint8_t* p = bgr + 3 * x;
+        __m256i y[2];
+        for (int h = 0; h < 2; h++) {
+            __m256i v = load_bgr8(p + 24 * h);
+            __m256i s = _mm256_add_epi32(_mm256_madd_epi16(_mm256_shuffle_epi8(v, bg), wBG),
+                                         _mm256_madd_epi16(_mm256_shuffle_epi8(v, r), wR));
+            y[h] = _mm256_srli_epi32(_mm256_add_epi32(s, half), GRAY_SHIFT);
+        }
+
+        // Lanes: (0..3 | 4..7), (8..11 | 12..15) -> pixels in order
+        __m256i y16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(y[0], y[1]), 0xD8);
+        __m128i y8  = _mm_packus_epi16(_mm256_castsi256_si128(y16), _mm256_extracti128_si256(y16, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x), y8);
+    }
+    sobel_kernels_scalar()->bgr_gray(bgr, gray, x, x1);
+}
+
+// ------------------------------------------------------------
+// Kernel family (kernel_family.hpp), 16 pixels per step. Both passes
+// in int16 lanes: they wrap, but the sums are exact whenever the
+// output fits int16 (W::Int16); Sobel7's horizontal pass is int32.
+// ------------------------------------------------------------
+
+// v * C for a compile-time weight (no multiply for 1 and 2)
+template <int C>
+static inline __m256i mulc_s16(__m256i v) {
+    if constexpr (C == 1)
+        return v;
+    else if constexpr (C == 2)
+        return _mm256_slli_epi16(v, 1);
+    else
+        return _mm256_mullo_epi16(v, _mm256_set1_epi16(C));
+}
+
+template <int C>
+static inline __m256i mulc_s32(__m256i v) {
+    if constexpr (C == 1)
+        return v;
+    else if constexpr (C == 2)
+        return _mm256_slli_epi32(v, 1);
+    else
+        return _mm256_mullo_epi32(v, _mm256_set1_epi32(C));
+}
+
+// smooth_sum / deriv_sum (kernel_weights.hpp) on vectors
+template <class W, int K, typename F>
+static inline __m256i smooth_s16(const F& v) {
+    if constexpr (K == 0)
+        return mulc_s16<W::smooth[W::R]>(v(0));
+    else
+        return _mm256_add_epi16(mulc_s16<W::smooth[W::R + K]>(_mm256_add_epi16(v(K), v(-K))), smooth_s16<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline __m256i deriv_s16(const F& v) {
+    const __m256i t = mulc_s16<W::deriv[W::R + K]>(_mm256_sub_epi16(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return _mm256_add_epi16(t, deriv_s16<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline __m256i smooth_s32(const F& v) {
+    if constexpr (K == 0)
+        return mulc_s32<W::smooth[W::R]>(v(0));
+    else
+        return _mm256_add_epi32(mulc_s32<W::smooth[W::R + K]>(_mm256_add_epi32(v(K), v(-K))), smooth_s32<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline __m256i deriv_s32(const F& v) {
+    const __m256i t = mulc_s32<W::deriv[W::R + K]>(_mm256_sub_epi32(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return _mm256_add_epi32(t, deriv_s32<W, K - 1>(v));
+}
+
+// 8 int16 -> int32
+static inline __m256i load_s16x8_s32(const int16_t* p) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+// Vertical pass over [a, b), b - a >= 16: the last vector overlaps
+// the one before (same values written twice). Deriv: vd too.
+template <class W, bool Deriv = true>
+static void family_vertical_avx2(const uint8_t* const* r, int16_t* vs, int16_t* vd, int a, int b) {
+    constexpr int R = W::R;
+    for (int x = a; x < b; x += 16) {
+        if (x + 16 > b)
+            x = b - 16;
+        const auto row = [&](int k) { return load_u8x16(r[R + k] + x); };
+        store_s16(vs + x, smooth_s16<W, R>(row));
+        if (Deriv)
+            store_s16(vd + x, deriv_s16<W, R>(row));
+    }
+}
+
+// Horizontal pass of pixels [x, x + 16) as floats
+template <class W>
+static inline void family_horizontal_ps(const int16_t* vs, const int16_t* vd, int x, __m256 fx[2], __m256 fy[2]) {
+    constexpr int R = W::R;
+    if constexpr (W::Int16) {
+        __m256i sx = deriv_s16<W, R>([&](int k) { return load_s16(vs + x + k); });
+        __m256i sy = smooth_s16<W, R>([&](int k) { return load_s16(vd + x + k); });
+        fx[0] = lo_ps(sx);
+        fx[1] = hi_ps(sx);
+        fy[0] = lo_ps(sy);
+        fy[1] = hi_ps(sy);
+    } else {
+        for (int h = 0; h < 2; h++) {
+            const int xh = x + 8 * h;
+            fx[h] = _mm256_cvtepi32_ps(deriv_s32<W, R>([&](int k) { return load_s16x8_s32(vs + xh + k); }));
+            fy[h] = _mm256_cvtepi32_ps(smooth_s32<W, R>([&](int k) { return load_s16x8_s32(vd + xh + k); }));
+        }
+    }
+}
+
+template <class W, int Mag, int Want>
+static void family2d_avx2(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                          float* gx, float* gy, float* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    const int xe = x0 + (x1 - x0) / 16 * 16;
+    if (xe > x0)
+        family_vertical_avx2<W>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 16) {
+        __m256 fx[2], fy[2];
+        family_horizontal_ps<W>(vs, vd, x, fx, fy);
+
+        for (int h = 0; h < 2; h++) {
+            if (Want & K2D_GXGY) {
+                _mm256_storeu_ps(gx  + x + 8 * h, fx[h]);
+                _mm256_storeu_ps(gy  + x + 8 * h, fy[h]);
+            }
+            if (Want & K2D_MAG) {
+                _mm256_storeu_ps(mag + x + 8 * h, mag2_ps<Mag>(fx[h], fy[h]));
+            }
+        }
+    }
+    sobel_kernels_scalar()->family2d[static_cast<int>(W::Type)].f32[Mag][Want](rows, vs, vd, gx, gy, mag, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static void family2d_s16_avx2(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                              int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    const int xe = x0 + (x1 - x0) / 16 * 16;
+    if (xe > x0)
+        family_vertical_avx2<W>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 16) {
+        __m256i sx = deriv_s16<W, R>([&](int k) { return load_s16(vs + x + k); });
+        __m256i sy = smooth_s16<W, R>([&](int k) { return load_s16(vd + x + k); });
+
+        if (Want & K2D_GXGY) {
+            store_s16(gx + x, sx);
+            store_s16(gy + x, sy);
+        }
+        if (Want & K2D_MAG)
+            store_s16(mag + x, mag2_s16<Mag>(sx, sy));
+    }
+    sobel_kernels_scalar()->family2d[static_cast<int>(W::Type)].s16[Mag][Want](rows, vs, vd, gx, gy, mag, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static constexpr Family2DS16Fn family2d_s16_entry() {
+    if constexpr (W::Int16)
+        return family2d_s16_avx2<W, Mag, Want>;
+    else
+        return nullptr;
+}
+
+template <class W>
+static constexpr Family2DKernels family_table() {
+    return {
+        W::R,
+        {
+            { family2d_avx2<W, 0, 0>, family2d_avx2<W, 0, 1>, family2d_avx2<W, 0, 2>, family2d_avx2<W, 0, 3> },
+            { family2d_avx2<W, 1, 0>, family2d_avx2<W, 1, 1>, family2d_avx2<W, 1, 2>, family2d_avx2<W, 1, 3> },
+            { family2d_avx2<W, 2, 0>, family2d_avx2<W, 2, 1>, family2d_avx2<W, 2, 2>, family2d_avx2<W, 2, 3> }
+        },
+        {
+            { family2d_s16_entry<W, 0, 0>(), family2d_s16_entry<W, 0, 1>(), family2d_s16_entry<W, 0, 2>(), family2d_s16_entry<W, 0, 3>() },
+            { family2d_s16_entry<W, 1, 0>(), family2d_s16_entry<W, 1, 1>(), family2d_s16_entry<W, 1, 2>(), family2d_s16_entry<W, 1, 3>() },
+            { family2d_s16_entry<W, 2, 0>(), family2d_s16_entry<W, 2, 1>(), family2d_s16_entry<W, 2, 2>(), family2d_s16_entry<W, 2, 3>() }
+        }
+    };
+}
+
+// [KernelType]
+static const Family2DKernels kFamilyAvx2[KERNEL_TYPE_COUNT] = {
+    family_table<Sobel3Weights>(),
+    family_table<Scharr3Weights>(),
+    family_table<Sobel5Weights>(),
+    family_table<Sobel7Weights>()
+};
+
+// ------------------------------------------------------------
+// 3D kernel family: the vertical pass above, the horizontal one in
+// int32 lanes into float planes, the temporal one on floats (exact,
+// see kernel_family.hpp)
+// ------------------------------------------------------------
+template <int C>
+static inline __m256 mulc_ps(__m256 v) {
+    if constexpr (C == 1)
+        return v;
+    else
+        return _mm256_mul_ps(v, _mm256_set1_ps(static_cast<float>(C)));
+}
+
+template <class W, int K, typename F>
+static inline __m256 smooth_ps(const F& v) {
+    if constexpr (K == 0)
+        return mulc_ps<W::smooth[W::R]>(v(0));
+    else
+        return _mm256_add_ps(mulc_ps<W::smooth[W::R + K]>(_mm256_add_ps(v(K), v(-K))), smooth_ps<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline __m256 deriv_ps(const F& v) {
+    const __m256 t = mulc_ps<W::deriv[W::R + K]>(_mm256_sub_ps(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return _mm256_add_ps(t, deriv_ps<W, K - 1>(v));
+}
+
+template <class W, int Want>
+static void family3d_spatial_avx2(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                                  float* dxs, float* sdy, float* ss, int x0, int x1) {
+    constexpr int R = W::R;
+    constexpr bool deriv = (Want & K3D_DERIV) != 0;
+    const int xe = x0 + (x1 - x0) / 16 * 16;
+    if (xe > x0)
+        family_vertical_avx2<W, deriv>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 8) {
+        const auto s = [&](int k) { return load_s16x8_s32(vs + x + k); };
+        _mm256_storeu_ps(ss + x, _mm256_cvtepi32_ps(smooth_s32<W, R>(s)));
+        if (deriv) {
+            _mm256_storeu_ps(dxs + x, _mm256_cvtepi32_ps(deriv_s32<W, R>(s)));
+            _mm256_storeu_ps(sdy + x, _mm256_cvtepi32_ps(smooth_s32<W, R>([&](int k) { return load_s16x8_s32(vd + x + k); })));
+        }
+    }
+    sobel_kernels_scalar()->family3d[static_cast<int>(W::Type)].spatial[Want](rows, vs, vd, dxs, sdy, ss, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static void family3d_combine_avx2(const float* const* dxs, const float* const* sdy, const float* const* ss,
+                                  float* gt, float* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        const __m256 t = deriv_ps<W, R>([&](int k) { return _mm256_loadu_ps(ss[R + k] + x); });
+        if (Want & K3D_GT)
+            _mm256_storeu_ps(gt + x, t);
+        if (Want & K3D_MAG) {
+            const __m256 gx = smooth_ps<W, R>([&](int k) { return _mm256_loadu_ps(dxs[R + k] + x); });
+            const __m256 gy = smooth_ps<W, R>([&](int k) { return _mm256_loadu_ps(sdy[R + k] + x); });
+            _mm256_storeu_ps(mag + x, mag3_ps<Mag>(gx, gy, t));
+        }
+    }
+    sobel_kernels_scalar()->family3d[static_cast<int>(W::Type)].combine[Mag][Want](dxs, sdy, ss, gt, mag, x, x1);
+}
+
+template <class W>
+static constexpr Family3DKernels family3d_table() {
+    return {
+        W::R,
+        { family3d_spatial_avx2<W, 0>, family3d_spatial_avx2<W, K3D_DERIV> },
+        {
+            { family3d_combine_avx2<W, 0, 0>, family3d_combine_avx2<W, 0, 1>, family3d_combine_avx2<W, 0, 2>, family3d_combine_avx2<W, 0, 3> },
+            { family3d_combine_avx2<W, 1, 0>, family3d_combine_avx2<W, 1, 1>, family3d_combine_avx2<W, 1, 2>, family3d_combine_avx2<W, 1, 3> },
+            { family3d_combine_avx2<W, 2, 0>, family3d_combine_avx2<W, 2, 1>, family3d_combine_avx2<W, 2, 2>, family3d_combine_avx2<W, 2, 3> }
+        }
+    };
+}
+
+// [KernelType]
+static const Family3DKernels kFamily3DAvx2[KERNEL_TYPE_COUNT] = {
+    family3d_table<Sobel3Weights>(),
+    family3d_table<Scharr3Weights>(),
+    family3d_table<Sobel5Weights>(),
+    family3d_table<Sobel7Weights>()
+};
+
+static const SobelRowKernels kAvx2 = {
+    { h3d_avx2<0>, h3d_avx2<1> },
+    { v3d_avx2<0>, v3d_avx2<1> },
+    {
+        { combine3d_avx2<0, 0>, combine3d_avx2<0, 1>, combine3d_avx2<0, 2>, combine3d_avx2<0, 3> },
+        { combine3d_avx2<1, 0>, combine3d_avx2<1, 1>, combine3d_avx2<1, 2>, combine3d_avx2<1, 3> },
+        { combine3d_avx2<2, 0>, combine3d_avx2<2, 1>, combine3d_avx2<2, 2>, combine3d_avx2<2, 3> }
+    },
+    {
+        { sobel2d_avx2<0, 0>, sobel2d_avx2<0, 1>, sobel2d_avx2<0, 2>, sobel2d_avx2<0, 3> },
+        { sobel2d_avx2<1, 0>, sobel2d_avx2<1, 1>, sobel2d_avx2<1, 2>, sobel2d_avx2<1, 3> },
+        { sobel2d_avx2<2, 0>, sobel2d_avx2<2, 1>, sobel2d_avx2<2, 2>, sobel2d_avx2<2, 3> }
+    },
+    {
+        { combine3d_s16_avx2<0, 0>, combine3d_s16_avx2<0, 1>, combine3d_s16_avx2<0, 2>, combine3d_s16_avx2<0, 3> },
+        { combine3d_s16_avx2<1, 0>, combine3d_s16_avx2<1, 1>, combine3d_s16_avx2<1, 2>, combine3d_s16_avx2<1, 3> },
+        { combine3d_s16_avx2<2, 0>, combine3d_s16_avx2<2, 1>, combine3d_s16_avx2<2, 2>, combine3d_s16_avx2<2, 3> }
+    },
+    {
+        { sobel2d_s16_avx2<0, 0>, sobel2d_s16_avx2<0, 1>, sobel2d_s16_avx2<0, 2>, sobel2d_s16_avx2<0, 3> },
+        { sobel2d_s16_avx2<1, 0>, sobel2d_s16_avx2<1, 1>, sobel2d_s16_avx2<1, 2>, sobel2d_s16_avx2<1, 3> },
+        { sobel2d_s16_avx2<2, 0>, sobel2d_s16_avx2<2, 1>, sobel2d_s16_avx2<2, 2>, sobel2d_s16_avx2<2, 3> }
+    },
+    theta_poly_avx2<float>,
+    theta_poly_avx2<int16_t>,
+    { theta_bins_avx2<float, 0>,   theta_bins_avx2<float, 1>,   theta_bins_avx2<float, 2> },
+    { theta_bins_avx2<int16_t, 0>, theta_bins_avx2<int16_t, 1>, theta_bins_avx2<int16_t, 2> },
+    bgr_gray_avx2,
+    kFamilyAvx2,
+    kFamily3DAvx2
+};
+
+const SobelRowKernels* sobel_kernels_avx2() {
+    return &kAvx2;
+}
@@ -0,0 +1,191 @@
+// simd_kernels.hpp
+// ------------------------------------------------------------
+// Row kernels shared by every SIMD build (internal header).
+//
+// Kept free of OpenCV and other inline-heavy headers on purpose:
+// the ISA files are compiled with -msse4.1 / -mavx2, and any inline
+// function they pull in could otherwise be emitted with those
+// instructions and picked by the linker for the whole program.
+//
+// All kernels work on one row, x in [x0, x1) (callers keep the
+// 1-pixel border out of the range). Intermediate sums fit in int16:
+//   3D: |hs|,|dxs|,|sdy| <= 1020, |ss|,|Gx|,|Gy|,|Gt| <= 4080
+//   2D: |Gx|,|Gy| <= 1020
+// (the kernel family, built here per level too: kernel_family.hpp;
+// its 3D planes are float).
+// Float results are computed in the same order as the scalar
+// reference, so every level is bit-identical. The int16 kernels
+// (Precision::Int16) are exact integer code on every level.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+#include "grad_modes.hpp"
+
+typedef void (*H3DFn)(const uint8_t* r, int16_t* hs, int16_t* hd, int x0, int x1);
+
+typedef void (*V3DFn)(const int16_t* hsU, const int16_t* hsC, const int16_t* hsD,
+                      const int16_t* hdU, const int16_t* hdC, const int16_t* hdD,
+                      int16_t* dxs, int16_t* sdy, int16_t* ss, int x0, int x1);
+
+typedef void (*Combine3DFn)(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                            const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                            const int16_t* ssP,  const int16_t* ssN,
+                            float* gt, float* mag, int x0, int x1);
+
+typedef void (*Sobel2DFn)(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                          float* gx, float* gy, float* mag, int x0, int x1);
+
+// Same, with int16 outputs (Precision::Int16)
+typedef void (*Combine3DS16Fn)(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                               const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                               const int16_t* ssP,  const int16_t* ssN,
+                               int16_t* gt, int16_t* mag, int x0, int x1);
+
+typedef void (*Sobel2DS16Fn)(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                             int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1);
+
+// Orientation from gx/gy rows: ThetaMode::Poly (radians) and BinsN (sector index)
+typedef void (*ThetaPolyFn)(const float* gx, const float* gy, float* theta, int x0, int x1);
+typedef void (*ThetaPolyS16Fn)(const int16_t* gx, const int16_t* gy, float* theta, int x0, int x1);
+typedef void (*ThetaBinsFn)(const float* gx, const float* gy, uint8_t* bins, int x0, int x1);
+typedef void (*ThetaBinsS16Fn)(const int16_t* gx, const int16_t* gy, uint8_t* bins, int x0, int x1);
+
+// Luma of interleaved 8-bit BGR pixels x in [x0, x1) (bgr holds 3 bytes per pixel)
+typedef void (*BgrGrayFn)(const uint8_t* bgr, uint8_t* gray, int x0, int x1);
+
+// Kernel family row (kernel_family.hpp). rows[0 .. 2R]: rows y - R
+// .. y + R at pixel 0 ([-R] .. [x1 + R - 1] readable). vs / vd:
+// scratch at pixel 0, [x0 - R, x1 + R) written.
+typedef void (*Family2DFn)(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                           float* gx, float* gy, float* mag, int x0, int x1);
+
+typedef void (*Family2DS16Fn)(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                              int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1);
+
+struct Family2DKernels {
+    int radius;
+
+    // [MagMode][outputs] (K2D_GXGY / K2D_MAG)
+    Family2DFn    f32[MAG_MODE_COUNT][4];
+    Family2DS16Fn s16[MAG_MODE_COUNT][4];   // nullptr: not kernel_fits_int16
+};
+
+// 3D kernel family, spatial pass of one row: rows / vs / vd as for
+// Family2DFn, then dxs = Dx Sy, sdy = Sx Dy (K3D_DERIV) and
+// ss = Sx Sy as floats.
+typedef void (*Family3DSpatialFn)(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                                  float* dxs, float* sdy, float* ss, int x0, int x1);
+
+// 3D kernel family, temporal pass of one row: dxs / sdy / ss[0 .. 2R]
+// are the plane rows of frames t - R .. t + R.
+typedef void (*Family3DCombineFn)(const float* const* dxs, const float* const* sdy, const float* const* ss,
+                                  float* gt, float* mag, int x0, int x1);
+
+struct Family3DKernels {
+    int radius;
+    Family3DSpatialFn spatial[2];                   // [K3D_DERIV]
+    Family3DCombineFn combine[MAG_MODE_COUNT][4];   // [MagMode][K3D_GT / K3D_MAG]
+};
+
+// ------------------------------------------------------------
+// Every kernel comes in compile-time variants indexed by what the
+// caller needs; unused outputs are not computed (pointers for them
+// may be null).
+// ------------------------------------------------------------
+enum {
+    K3D_DERIV = 1,              // h3d/v3d, family spatial: also hd / dxs, sdy (needed for magnitude)
+
+    K3D_GT    = 1,              // combine3d: write gt
+    K3D_MAG   = 2,              // combine3d: write magnitude
+
+    K2D_GXGY  = 1,              // sobel2d: write gx, gy
+    K2D_MAG   = 2               // sobel2d: write magnitude
+};
+
+// MagMode::AMax coefficients in Q15, applied as round(v * c / 2^15)
+// (pmulhrsw / vqrdmulh) by the int16 kernels and as v * (c / 2^15)
+// by the float ones; see grad_modes.hpp for the error bounds
+enum {
+    AMAX_A   = 30720,           // 15/16, largest component
+    AMAX_B2  = 15360,           // 15/32, 2D smaller component
+    AMAX_B3  = 13312,           // 13/32, 3D middle component
+    AMAX_C3  = 9216             //  9/32, 3D smallest component
+};
+
+const float AMAX_Q15 = 1.0f / 32768.0f;
+
+// BGR -> gray with the weights and rounding of OpenCV's 8-bit
+// COLOR_BGR2GRAY (0.114 B + 0.587 G + 0.299 R in Q15), so a fused
+// conversion gives the same gray values as cv::cvtColor:
+//   gray = (B GRAY_B + G GRAY_G + R GRAY_R + 2^14) >> 15
+enum {
+    GRAY_B     = 3735,
+    GRAY_G     = 19235,
+    GRAY_R     = 9798,
+    GRAY_SHIFT = 15
+};
+
+// ThetaMode::Poly: atan(a), a in [0, 1], as
+// a (C1 + s (C3 + s (C5 + s (C7 + s C9)))), s = a^2
+const float ATAN_C1 =  0.9998660f;
+const float ATAN_C3 = -0.3302995f;
+const float ATAN_C5 =  0.1801410f;
+const float ATAN_C7 = -0.0851330f;
+const float ATAN_C9 =  0.0208351f;
+
+const float THETA_PI      = 3.14159265f;
+const float THETA_HALF_PI = 1.57079633f;
+
+// ThetaMode::BinsN, N = 4 << b: tan of the sector edges inside
+// [0, 90) degrees, N/4 of them ((i + 1/2) * 360/N degrees)
+extern const float THETA_BIN_EDGES[3][4];
+
+struct SobelRowKernels {
+    // 3D spatial, horizontal: hs = [1 2 1] r, hd = [-1 0 +1] r
+    H3DFn h3d[2];
+
+    // 3D spatial, vertical over rows U/C/D:
+    //   dxs = hdU + 2 hdC + hdD, sdy = hsD - hsU, ss = hsU + 2 hsC + hsD
+    V3DFn v3d[2];
+
+    // 3D temporal: combine prev/curr/next planes into gt and magnitude,
+    // [MagMode][outputs]
+    Combine3DFn combine3d[MAG_MODE_COUNT][4];
+
+    // 2D Sobel (standard kx/ky) from rows U/C/D into gx, gy, magnitude
+    Sobel2DFn sobel2d[MAG_MODE_COUNT][4];
+
+    // int16 variants, [MagMode][outputs]
+    Combine3DS16Fn combine3d_s16[MAG_MODE_COUNT][4];
+    Sobel2DS16Fn   sobel2d_s16[MAG_MODE_COUNT][4];
+
+    // Orientation of float / int16 gradients, bins indexed by
+    // log2(N / 4)
+    ThetaPolyFn    theta_poly;
+    ThetaPolyS16Fn theta_poly_s16;
+    ThetaBinsFn    theta_bins[3];
+    ThetaBinsS16Fn theta_bins_s16[3];
+
+    // BGR input rows, converted on the fly (border.hpp)
+    BgrGrayFn bgr_gray;
+
+    // Kernel family (kernel_family.hpp), [KernelType]
+    const Family2DKernels* family2d;
+    const Family3DKernels* family3d;
+};
+
+// Kernels for the level chosen by simd.hpp
+const SobelRowKernels& sobel_kernels();
+
+// Per-ISA tables (each defined only when built for this target)
+const SobelRowKernels* sobel_kernels_scalar();
+const SobelRowKernels* sobel_kernels_sse41();
+const SobelRowKernels* sobel_kernels_avx2();
+const SobelRowKernels* sobel_kernels_neon();
+
+// Scalar kernel family (kernel_family.cpp), [KernelType]
+extern const Family2DKernels FAMILY_2D_SCALAR[KERNEL_TYPE_COUNT];
+extern const Family3DKernels FAMILY_3D_SCALAR[KERNEL_TYPE_COUNT];
@@ -0,0 +1,664 @@
+// simd_neon.cpp
+// ------------------------------------------------------------
+// NEON row kernels for ARM64 (8 x int16 / 4 x float per instruction).
+// NEON is part of the AArch64 baseline, so no runtime check needed.
+// ------------------------------------------------------------
+
+#include "kernel_weights.hpp"
+#include "simd_kernels.hpp"
+
+#include <arm_neon.h>
+
+static inline int16x8_t load_u8x8(const uint8_t* p) {
+    return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)));
+}
+
+// a + 2b + c
+static inline int16x8_t smooth3(int16x8_t a, int16x8_t b, int16x8_t c) {
+    return vaddq_s16(vaddq_s16(a, c), vshlq_n_s16(b, 1));
+}
+
+static inline float32x4_t lo_ps(int16x8_t v) { return vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))); }
+static inline float32x4_t hi_ps(int16x8_t v) { return vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))); }
+
+template <int Want>
+static void h3d_neon(const uint8_t* r, int16_t* hs, int16_t* hd, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t a = load_u8x8(r + x - 1);
+        int16x8_t b = load_u8x8(r + x);
+        int16x8_t c = load_u8x8(r + x + 1);
+
+        vst1q_s16(hs + x, smooth3(a, b, c));
+        if (Want & K3D_DERIV)
+            vst1q_s16(hd + x, vsubq_s16(c, a));
+    }
+    sobel_kernels_scalar()->h3d[Want](r, hs, hd, x, x1);
+}
+
+template <int Want>
+static void v3d_neon(const int16_t* hsU, const int16_t* hsC, const int16_t* hsD,
+                     const int16_t* hdU, const int16_t* hdC, const int16_t* hdD,
+                     int16_t* dxs, int16_t* sdy, int16_t* ss, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t su = vld1q_s16(hsU + x), sc = vld1q_s16(hsC + x), sd = vld1q_s16(hsD + x);
+
+        if (Want & K3D_DERIV) {
+            int16x8_t du = vld1q_s16(hdU + x), dc = vld1q_s16(hdC + x), dd = vld1q_s16(hdD + x);
+            vst1q_s16(dxs + x, smooth3(du, dc, dd));
+            vst1q_s16(sdy + x, vsubq_s16(sd, su));
+        }
+        vst1q_s16(ss  + x, smooth3(su, sc, sd));
+    }
+    sobel_kernels_scalar()->v3d[Want](hsU, hsC, hsD, hdU, hdC, hdD, dxs, sdy, ss, x, x1);
+}
+
+// Float magnitude by MagMode, same operation order as the scalar kernels
+template <int Mag>
+static inline float32x4_t mag2_ps(float32x4_t x, float32x4_t y) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return vsqrtq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)));
+
+    float32x4_t ax = vabsq_f32(x), ay = vabsq_f32(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return vaddq_f32(ax, ay);
+
+    float32x4_t mx = vmaxq_f32(ax, ay), mn = vminq_f32(ax, ay);
+    return vaddq_f32(vmulq_n_f32(mx, AMAX_A * AMAX_Q15), vmulq_n_f32(mn, AMAX_B2 * AMAX_Q15));
+}
+
+template <int Mag>
+static inline float32x4_t mag3_ps(float32x4_t x, float32x4_t y, float32x4_t t) {
+    if (Mag == static_cast<int>(MagMode::Exact)) {
+        // (x^2 + y^2) + t^2
+        return vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y)), vmulq_f32(t, t)));
+    }
+
+    float32x4_t ax = vabsq_f32(x), ay = vabsq_f32(y), at = vabsq_f32(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return vaddq_f32(vaddq_f32(ax, ay), at);
+
+    float32x4_t mx = vmaxq_f32(vmaxq_f32(ax, ay), at);
+    float32x4_t mn = vminq_f32(vminq_f32(ax, ay), at);
+    float32x4_t md = vsubq_f32(vsubq_f32(vaddq_f32(vaddq_f32(ax, ay), at), mx), mn);
+    return vaddq_f32(vaddq_f32(vmulq_n_f32(mx, AMAX_A * AMAX_Q15), vmulq_n_f32(md, AMAX_B3 * AMAX_Q15)),
+                     vmulq_n_f32(mn, AMAX_C3 * AMAX_Q15));
+}
+
+template <int Mag, int Want>
+static void combine3d_neon(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                           const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                           const int16_t* ssP,  const int16_t* ssN,
+                           float* gt, float* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t g3 = vsubq_s16(vld1q_s16(ssN + x), vld1q_s16(ssP + x));
+        float32x4_t ft[2] = { lo_ps(g3), hi_ps(g3) };
+
+        if (Want & K3D_GT) {
+            vst1q_f32(gt + x,     ft[0]);
+            vst1q_f32(gt + x + 4, ft[1]);
+        }
+
+        if (Want & K3D_MAG) {
+            int16x8_t gx = smooth3(vld1q_s16(dxsP + x), vld1q_s16(dxsC + x), vld1q_s16(dxsN + x));
+            int16x8_t gy = smooth3(vld1q_s16(sdyP + x), vld1q_s16(sdyC + x), vld1q_s16(sdyN + x));
+
+            float32x4_t fx[2] = { lo_ps(gx), hi_ps(gx) };
+            float32x4_t fy[2] = { lo_ps(gy), hi_ps(gy) };
+
+            for (int h = 0; h < 2; h++)
+                vst1q_f32(mag + x + 4 * h, mag3_ps<Mag>(fx[h], fy[h], ft[h]));
+        }
+    }
+    sobel_kernels_scalar()->combine3d[Mag][Want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN, gt, mag, x, x1);
+}
+
+template <int Mag, int Want>
+static void sobel2d_neon(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                         float* gx, float* gy, float* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t u0 = load_u8x8(u + x - 1), u1 = load_u8x8(u + x), u2 = load_u8x8(u + x + 1);
+        int16x8_t c0 = load_u8x8(c + x - 1),                          c2 = load_u8x8(c + x + 1);
+        int16x8_t d0 = load_u8x8(d + x - 1), d1 = load_u8x8(d + x), d2 = load_u8x8(d + x + 1);
+
+        // Gx = [-1 0 1; -2 0 2; -1 0 1], Gy = [-1 -2 -1; 0 0 0; 1 2 1]
+        int16x8_t sx = smooth3(vsubq_s16(u2, u0), vsubq_s16(c2, c0), vsubq_s16(d2, d0));
+        int16x8_t sy = vsubq_s16(smooth3(d0, d1, d2), smooth3(u0, u1, u2));
+
+        float32x4_t fx[2] = { lo_ps(sx), hi_ps(sx) };
+        float32x4_t fy[2] = { lo_ps(sy), hi_ps(sy) };
+
+        for (int h = 0; h < 2; h++) {
+            if (Want & K2D_GXGY) {
+                vst1q_f32(gx  + x + 4 * h, fx[h]);
+                vst1q_f32(gy  + x + 4 * h, fy[h]);
+            }
+            if (Want & K2D_MAG) {
+                vst1q_f32(mag + x + 4 * h, mag2_ps<Mag>(fx[h], fy[h]));
+            }
+        }
+    }
+    sobel_kernels_scalar()->sobel2d[Mag][Want](u, c, d, gx, gy, mag, x, x1);
+}
+
+// ------------------------------------------------------------
+// int16 kernels
+// ------------------------------------------------------------
+
+// round(sqrt(s)) of int32 sums, narrowed back to int16
+static inline int16x8_t sqrt_s16(int32x4_t lo, int32x4_t hi) {
+    return vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(vsqrtq_f32(vcvtq_f32_s32(lo)))),
+                        vqmovn_s32(vcvtnq_s32_f32(vsqrtq_f32(vcvtq_f32_s32(hi)))));
+}
+
+static inline int32x4_t sq2_lo(int16x8_t x, int16x8_t y) {
+    return vmlal_s16(vmull_s16(vget_low_s16(x), vget_low_s16(x)), vget_low_s16(y), vget_low_s16(y));
+}
+
+static inline int32x4_t sq2_hi(int16x8_t x, int16x8_t y) {
+    return vmlal_high_s16(vmull_high_s16(x, x), y, y);
+}
+
+template <int Mag>
+static inline int16x8_t mag2_s16(int16x8_t x, int16x8_t y) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return sqrt_s16(sq2_lo(x, y), sq2_hi(x, y));
+
+    int16x8_t ax = vabsq_s16(x), ay = vabsq_s16(y);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return vaddq_s16(ax, ay);
+
+    int16x8_t mx = vmaxq_s16(ax, ay), mn = vminq_s16(ax, ay);
+    return vaddq_s16(vqrdmulhq_n_s16(mx, AMAX_A), vqrdmulhq_n_s16(mn, AMAX_B2));
+}
+
+template <int Mag>
+static inline int16x8_t mag3_s16(int16x8_t x, int16x8_t y, int16x8_t t) {
+    if (Mag == static_cast<int>(MagMode::Exact))
+        return sqrt_s16(vmlal_s16(sq2_lo(x, y), vget_low_s16(t), vget_low_s16(t)),
+                        vmlal_high_s16(sq2_hi(x, y), t, t));
+
+    int16x8_t ax = vabsq_s16(x), ay = vabsq_s16(y), at = vabsq_s16(t);
+    if (Mag == static_cast<int>(MagMode::L1))
+        return vaddq_s16(vaddq_s16(ax, ay), at);
+
+    int16x8_t mx = vmaxq_s16(vmaxq_s16(ax, ay), at);
+    int16x8_t mn = vminq_s16(vminq_s16(ax, ay), at);
+    int16x8_t md = vsubq_s16(vsubq_s16(vaddq_s16(vaddq_s16(ax, ay), at), mx), mn);
+    return vaddq_s16(vaddq_s16(vqrdmulhq_n_s16(mx, AMAX_A), vqrdmulhq_n_s16(md, AMAX_B3)),
+                     vqrdmulhq_n_s16(mn, AMAX_C3));
+}
+
+template <int Mag, int Want>
+static void combine3d_s16_neon(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                               const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                               const int16_t* ssP,  const int16_t* ssN,
+                               int16_t* gt, int16_t* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t g3 = vsubq_s16(vld1q_s16(ssN + x), vld1q_s16(ssP + x));
+
+        if (Want & K3D_GT)
+            vst1q_s16(gt + x, g3);
+
+        if (Want & K3D_MAG) {
+            int16x8_t gx = smooth3(vld1q_s16(dxsP + x), vld1q_s16(dxsC + x), vld1q_s16(dxsN + x));
+            int16x8_t gy = smooth3(vld1q_s16(sdyP + x), vld1q_s16(sdyC + x), vld1q_s16(sdyN + x));
+            vst1q_s16(mag + x, mag3_s16<Mag>(gx, gy, g3));
+        }
+    }
+    sobel_kernels_scalar()->combine3d_s16[Mag][Want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN, gt, mag, x, x1);
+}
+
+template <int Mag, int Want>
+static void sobel2d_s16_neon(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                             int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        int16x8_t u0 = load_u8x8(u + x - 1), u1 = load_u8x8(u + x), u2 = load_u8x8(u + x + 1);
+        int16x8_t c0 = load_u8x8(c + x - 1),                          c2 = load_u8x8(c + x + 1);
+        int16x8_t d0 = load_u8x8(d + x - 1), d1 = load_u8x8(d + x), d2 = load_u8x8(d + x + 1);
+
+        int16x8_t sx = smooth3(vsubq_s16(u2, u0), vsubq_s16(c2, c0), vsubq_s16(d2, d0));
+        int16x8_t sy = vsubq_s16(smooth3(d0, d1, d2), smooth3(u0, u1, u2));
+
+        if (Want & K2D_GXGY) {
+            vst1q_s16(gx + x, sx);
+            vst1q_s16(gy + x, sy);
+        }
+        if (Want & K2D_MAG)
+            vst1q_s16(mag + x, mag2_s16<Mag>(sx, sy));
+    }
+    sobel_kernels_scalar()->sobel2d_s16[Mag][Want](u, c, d, gx, gy, mag, x, x1);
+}
+
+// ------------------------------------------------------------
+// Orientation (2 x 4 pixels per step)
+// ------------------------------------------------------------
+
+// 2 x 4 floats of a gradient row
+static inline void load_ps2(const float* p, float32x4_t v[2]) {
+    v[0] = vld1q_f32(p);
+    v[1] = vld1q_f32(p + 4);
+}
+
+static inline void load_ps2(const int16_t* p, float32x4_t v[2]) {
+    int16x8_t s = vld1q_s16(p);
+    v[0] = lo_ps(s);
+    v[1] = hi_ps(s);
+}
+
+// Scalar tails by gradient type
+static void theta_poly_tail(const float* gx, const float* gy, float* theta, int x0, int x1) {
+    sobel_kernels_scalar()->theta_poly(gx, gy, theta, x0, x1);
+}
+
+static void theta_poly_tail(const int16_t* gx, const int16_t* gy, float* theta, int x0, int x1) {
+    sobel_kernels_scalar()->theta_poly_s16(gx, gy, theta, x0, x1);
+}
+
+static void theta_bins_tail(int b, const float* gx, const float* gy, uint8_t* bins, int x0, int x1) {
+    sobel_kernels_scalar()->theta_bins[b](gx, gy, bins, x0, x1);
+}
+
+static void theta_bins_tail(int b, const int16_t* gx, const int16_t* gy, uint8_t* bins, int x0, int x1) {
+    sobel_kernels_scalar()->theta_bins_s16[b](gx, gy, bins, x0, x1);
+}
+
+template <typename T>
+static void theta_poly_neon(const T* gx, const T* gy, float* theta, int x0, int x1) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        float32x4_t vx[2], vy[2];
+        load_ps2(gx + x, vx);
+        load_ps2(gy + x, vy);
+
+        for (int h = 0; h < 2; h++) {
+            float32x4_t ax = vabsq_f32(vx[h]), ay = vabsq_f32(vy[h]);
+            float32x4_t mx = vmaxq_f32(ax, ay), mn = vminq_f32(ax, ay);
+
+            // mn / mx, 0 where mx == 0 (masks the NaN of 0 / 0)
+            float32x4_t a = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vdivq_f32(mn, mx)),
+                                                            vcgtq_f32(mx, zero)));
+            float32x4_t s = vmulq_f32(a, a);
+            float32x4_t r = vaddq_f32(vmulq_f32(vdupq_n_f32(ATAN_C9), s), vdupq_n_f32(ATAN_C7));
+            r = vaddq_f32(vmulq_f32(r, s), vdupq_n_f32(ATAN_C5));
+            r = vaddq_f32(vmulq_f32(r, s), vdupq_n_f32(ATAN_C3));
+            r = vaddq_f32(vmulq_f32(r, s), vdupq_n_f32(ATAN_C1));
+            r = vmulq_f32(r, a);
+
+            r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(THETA_HALF_PI), r), r);
+            r = vbslq_f32(vcltq_f32(vx[h], zero), vsubq_f32(vdupq_n_f32(THETA_PI), r), r);
+            r = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(r),
+                                                vandq_u32(vcltq_f32(vy[h], zero), sign)));
+            vst1q_f32(theta + x + 4 * h, r);
+        }
+    }
+    theta_poly_tail(gx, gy, theta, x, x1);
+}
+
+template <typename T, int B>
+static void theta_bins_neon(const T* gx, const T* gy, uint8_t* bins, int x0, int x1) {
+    const int n = 4 << B;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        float32x4_t vx[2], vy[2];
+        load_ps2(gx + x, vx);
+        load_ps2(gy + x, vy);
+
+        int32x4_t k[2];
+        for (int h = 0; h < 2; h++) {
+            float32x4_t ax = vabsq_f32(vx[h]), ay = vabsq_f32(vy[h]);
+
+            // Sector inside the quadrant: count the edges below (compare masks are -1)
+            int32x4_t j = vdupq_n_s32(0);
+            for (int i = 0; i < n / 4; i++) {
+                uint32x4_t above = vcgtq_f32(ay, vmulq_n_f32(ax, THETA_BIN_EDGES[B][i]));
+                j = vsubq_s32(j, vreinterpretq_s32_u32(above));
+            }
+
+            // Mirror: negate j when exactly one of gx, gy is negative, + n/2 when gx < 0
+            int32x4_t negX = vreinterpretq_s32_u32(vcltq_f32(vx[h], zero));
+            int32x4_t negY = vreinterpretq_s32_u32(vcltq_f32(vy[h], zero));
+            int32x4_t flip = veorq_s32(negX, negY);
+            j = vsubq_s32(veorq_s32(j, flip), flip);
+            j = vaddq_s32(j, vandq_s32(negX, vdupq_n_s32(n / 2)));
+            k[h] = vandq_s32(j, vdupq_n_s32(n - 1));
+        }
+        int16x8_t w = vcombine_s16(vmovn_s32(k[0]), vmovn_s32(k[1]));
+        vst1_u8(bins + x, vmovn_u16(vreinterpretq_u16_s16(w)));
+    }
+    theta_bins_tail(B, gx, gy, bins, x, x1);
+}
+
+// ------------------------------------------------------------
+// BGR -> gray, 8 pixels per step: vld3 deinterleaves, widening
+// multiply-accumulate with the Q15 weights, rounding narrow shift
+// ------------------------------------------------------------
+static void bgr_gray_neon(const uint8_t* bgr, uint8_t* gray, int x0, int x1) {
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        uint8x8x3_t v = vld3_u8(bgr + 3 * x);
+        uint16x8_t b = vmovl_u8(v.val[0]), g = vmovl_u8(v.val[1]), r = vmovl_u8(v.val[2]);
+
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(b), GRAY_B);
+        lo = vmlal_n_u16(lo, vget_low_u16(g), GRAY_G);
+        lo = vmlal_n_u16(lo, vget_low_u16(r), GRAY_R);
+        uint32x4_t hi = vmull_n_u16(vget_high_u16(b), GRAY_B);
+        hi = vmlal_n_u16(hi, vget_high_u16(g), GRAY_G);
+        hi = vmlal_n_u16(hi, vget_high_u16(r), GRAY_R);
+
+        uint16x8_t y = vcombine_u16(vrshrn_n_u32(lo, GRAY_SHIFT), vrshrn_n_u32(hi, GRAY_SHIFT));
+        vst1_u8(gray + x, vmovn_u16(y));
+    }
+    sobel_kernels_scalar()->bgr_gray(bgr, gray, x, x1);
+}
+
+// ------------------------------------------------------------
+// Kernel family (kernel_family.hpp), 8 pixels per step. Both passes
+// in int16 lanes: they wrap, but the sums are exact whenever the
+// output fits int16 (W::Int16); Sobel7's horizontal pass is int32.
+// ------------------------------------------------------------
+
+// v * C for a compile-time weight (no multiply for 1 and 2)
+template <int C>
+static inline int16x8_t mulc_s16(int16x8_t v) {
+    if constexpr (C == 1)
+        return v;
+    else if constexpr (C == 2)
+        return vshlq_n_s16(v, 1);
+    else
+        return vmulq_n_s16(v, C);
+}
+
+template <int C>
+static inline int32x4_t mulc_s32(int32x4_t v) {
+    if constexpr (C == 1)
+        return v;
+    else if constexpr (C == 2)
+        return vshlq_n_s32(v, 1);
+    else
+        return vmulq_n_s32(v, C);
+}
+
+// smooth_sum / deriv_sum (kernel_weights.hpp) on vectors
+template <class W, int K, typename F>
+static inline int16x8_t smooth_s16(const F& v) {
+    if constexpr (K == 0)
+        return mulc_s16<W::smooth[W::R]>(v(0));
+    else
+        return vaddq_s16(mulc_s16<W::smooth[W::R + K]>(vaddq_s16(v(K), v(-K))), smooth_s16<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline int16x8_t deriv_s16(const F& v) {
+    const int16x8_t t = mulc_s16<W::deriv[W::R + K]>(vsubq_s16(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return vaddq_s16(t, deriv_s16<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline int32x4_t smooth_s32(const F& v) {
+    if constexpr (K == 0)
+        return mulc_s32<W::smooth[W::R]>(v(0));
+    else
+        return vaddq_s32(mulc_s32<W::smooth[W::R + K]>(vaddq_s32(v(K), v(-K))), smooth_s32<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline int32x4_t deriv_s32(const F& v) {
+    const int32x4_t t = mulc_s32<W::deriv[W::R + K]>(vsubq_s32(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return vaddq_s32(t, deriv_s32<W, K - 1>(v));
+}
+
+// Vertical pass over [a, b), b - a >= 8: the last vector overlaps
+// the one before (same values written twice). Deriv: vd too.
+template <class W, bool Deriv = true>
+static void family_vertical_neon(const uint8_t* const* r, int16_t* vs, int16_t* vd, int a, int b) {
+    constexpr int R = W::R;
+    for (int x = a; x < b; x += 8) {
+        if (x + 8 > b)
+            x = b - 8;
+        const auto row = [&](int k) { return load_u8x8(r[R + k] + x); };
+        vst1q_s16(vs + x, smooth_s16<W, R>(row));
+        if (Deriv)
+            vst1q_s16(vd + x, deriv_s16<W, R>(row));
+    }
+}
+
+// Horizontal pass of pixels [x, x + 8) as floats
+template <class W>
+static inline void family_horizontal_ps(const int16_t* vs, const int16_t* vd, int x,
+                                        float32x4_t fx[2], float32x4_t fy[2]) {
+    constexpr int R = W::R;
+    if constexpr (W::Int16) {
+        int16x8_t sx = deriv_s16<W, R>([&](int k) { return vld1q_s16(vs + x + k); });
+        int16x8_t sy = smooth_s16<W, R>([&](int k) { return vld1q_s16(vd + x + k); });
+        fx[0] = lo_ps(sx);
+        fx[1] = hi_ps(sx);
+        fy[0] = lo_ps(sy);
+        fy[1] = hi_ps(sy);
+    } else {
+        for (int h = 0; h < 2; h++) {
+            const int xh = x + 4 * h;
+            fx[h] = vcvtq_f32_s32(deriv_s32<W, R>([&](int k) { return vmovl_s16(vld1_s16(vs + xh + k)); }));
+            fy[h] = vcvtq_f32_s32(smooth_s32<W, R>([&](int k) { return vmovl_s16(vld1_s16(vd + xh + k)); }));
+        }
+    }
+}
+
+template <class W, int Mag, int Want>
+static void family2d_neon(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                          float* gx, float* gy, float* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    const int xe = x0 + (x1 - x0) / 8 * 8;
+    if (xe > x0)
+        family_vertical_neon<W>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 8) {
+        float32x4_t fx[2], fy[2];
+        family_horizontal_ps<W>(vs, vd, x, fx, fy);
+
+        for (int h = 0; h < 2; h++) {
+            if (Want & K2D_GXGY) {
+                vst1q_f32(gx  + x + 4 * h, fx[h]);
+                vst1q_f32(gy  + x + 4 * h, fy[h]);
+            }
+            if (Want & K2D_MAG) {
+                vst1q_f32(mag + x + 4 * h, mag2_ps<Mag>(fx[h], fy[h]));
+            }
+        }
+    }
+    sobel_kernels_scalar()->family2d[static_cast<int>(W::Type)].f32[Mag][Want](rows, vs, vd, gx, gy, mag, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static void family2d_s16_neon(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                              int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    const int xe = x0 + (x1 - x0) / 8 * 8;
+    if (xe > x0)
+        family_vertical_neon<W>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 8) {
+        int16x8_t sx = deriv_s16<W, R>([&](int k) { return vld1q_s16(vs + x + k); });
+        int16x8_t sy = smooth_s16<W, R>([&](int k) { return vld1q_s16(vd + x + k); });
+
+        if (Want & K2D_GXGY) {
+            vst1q_s16(gx + x, sx);
+            vst1q_s16(gy + x, sy);
+        }
+        if (Want & K2D_MAG)
+            vst1q_s16(mag + x, mag2_s16<Mag>(sx, sy));
+    }
+    sobel_kernels_scalar()->family2d[static_cast<int>(W::Type)].s16[Mag][Want](rows, vs, vd, gx, gy, mag, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static constexpr Family2DS16Fn family2d_s16_entry() {
+    if constexpr (W::Int16)
+        return family2d_s16_neon<W, Mag, Want>;
+    else
+        return nullptr;
+}
+
+template <class W>
+static constexpr Family2DKernels family_table() {
+    return {
+        W::R,
+        {
+            { family2d_neon<W, 0, 0>, family2d_neon<W, 0, 1>, family2d_neon<W, 0, 2>, family2d_neon<W, 0, 3> },
+            { family2d_neon<W, 1, 0>, family2d_neon<W, 1, 1>, family2d_neon<W, 1, 2>, family2d_neon<W, 1, 3> },
+            { family2d_neon<W, 2, 0>, family2d_neon<W, 2, 1>, family2d_neon<W, 2, 2>, family2d_neon<W, 2, 3> }
+        },
+        {
+            { family2d_s16_entry<W, 0, 0>(), family2d_s16_entry<W, 0, 1>(), family2d_s16_entry<W, 0, 2>(), family2d_s16_entry<W, 0, 3>() },
+            { family2d_s16_entry<W, 1, 0>(), family2d_s16_entry<W, 1, 1>(), family2d_s16_entry<W, 1, 2>(), family2d_s16_entry<W, 1, 3>() },
+            { family2d_s16_entry<W, 2, 0>(), family2d_s16_entry<W, 2, 1>(), family2d_s16_entry<W, 2, 2>(), family2d_s16_entry<W, 2, 3>() }
+        }
+    };
+}
+
+// [KernelType]
+static const Family2DKernels kFamilyNeon[KERNEL_TYPE_COUNT] = {
+    family_table<Sobel3Weights>(),
+    family_table<Scharr3Weights>(),
+    family_table<Sobel5Weights>(),
+    family_table<Sobel7Weights>()
+};
+
+// ------------------------------------------------------------
+// 3D kernel family: the vertical pass above, the horizontal one in
+// int32 lanes into float planes, the temporal one on floats (exact,
+// see kernel_family.hpp)
+// ------------------------------------------------------------
+template <int C>
+static inline float32x4_t mulc_ps(float32x4_t v) {
+    if constexpr (C == 1)
+        return v;
+    else
+        return vmulq_n_f32(v, static_cast<float>(C));
+}
+
+template <class W, int K, typename F>
+static inline float32x4_t smooth_ps(const F& v) {
+    if constexpr (K == 0)
+        return mulc_ps<W::smooth[W::R]>(v(0));
+    else
+        return vaddq_f32(mulc_ps<W::smooth[W::R + K]>(vaddq_f32(v(K), v(-K))), smooth_ps<W, K - 1>(v));
+}
+
+template <class W, int K, typename F>
+static inline float32x4_t deriv_ps(const F& v) {
+    const float32x4_t t = mulc_ps<W::deriv[W::R + K]>(vsubq_f32(v(K), v(-K)));
+    if constexpr (K == 1)
+        return t;
+    else
+        return vaddq_f32(t, deriv_ps<W, K - 1>(v));
+}
+
+template <class W, int Want>
+static void family3d_spatial_neon(const uint8_t* const* rows, int16_t* vs, int16_t* vd,
+                                  float* dxs, float* sdy, float* ss, int x0, int x1) {
+    constexpr int R = W::R;
+    constexpr bool deriv = (Want & K3D_DERIV) != 0;
+    const int xe = x0 + (x1 - x0) / 8 * 8;
+    if (xe > x0)
+        family_vertical_neon<W, deriv>(rows, vs, vd, x0 - R, xe + R);
+
+    for (int x = x0; x < xe; x += 4) {
+        const auto s = [&](int k) { return vmovl_s16(vld1_s16(vs + x + k)); };
+        vst1q_f32(ss + x, vcvtq_f32_s32(smooth_s32<W, R>(s)));
+        if (deriv) {
+            vst1q_f32(dxs + x, vcvtq_f32_s32(deriv_s32<W, R>(s)));
+            vst1q_f32(sdy + x, vcvtq_f32_s32(smooth_s32<W, R>([&](int k) { return vmovl_s16(vld1_s16(vd + x + k)); })));
+        }
+    }
+    sobel_kernels_scalar()->family3d[static_cast<int>(W::Type)].spatial[Want](rows, vs, vd, dxs, sdy, ss, xe, x1);
+}
+
+template <class W, int Mag, int Want>
+static void family3d_combine_neon(const float* const* dxs, const float* const* sdy, const float* const* ss,
+                                  float* gt, float* mag, int x0, int x1) {
+    constexpr int R = W::R;
+    int x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        const float32x4_t t = deriv_ps<W, R>([&](int k) { return vld1q_f32(ss[R + k] + x); });
+        if (Want & K3D_GT)
+            vst1q_f32(gt + x, t);
+        if (Want & K3D_MAG) {
+            const float32x4_t gx = smooth_ps<W, R>([&](int k) { return vld1q_f32(dxs[R + k] + x); });
+            const float32x4_t gy = smooth_ps<W, R>([&](int k) { return vld1q_f32(sdy[R + k] + x); });
+            vst1q_f32(mag + x, mag3_ps<Mag>(gx, gy, t));
+        }
+    }
+    sobel_kernels_scalar()->family3d[static_cast<int>(W::Type)].combine[Mag][Want](dxs, sdy, ss, gt, mag, x, x1);
+}
+
+template <class W>
+static constexpr Family3DKernels family3d_table() {
+    return {
+        W::R,
+        { family3d_spatial_neon<W, 0>, family3d_spatial_neon<W, K3D_DERIV> },
+        {
+            { family3d_combine_neon<W, 0, 0>, family3d_combine_neon<W, 0, 1>, family3d_combine_neon<W, 0, 2>, family3d_combine_neon<W, 0, 3> },
+            { family3d_combine_neon<W, 1, 0>, family3d_combine_neon<W, 1, 1>, family3d_combine_neon<W, 1, 2>, family3d_combine_neon<W, 1, 3> },
+            { family3d_combine_neon<W, 2, 0>, family3d_combine_neon<W, 2, 1>, family3d_combine_neon<W, 2, 2>, family3d_combine_neon<W, 2, 3> }
+        }
+    };
+}
+
+// [KernelType]
+static const Family3DKernels kFamily3DNeon[KERNEL_TYPE_COUNT] = {
+    family3d_table<Sobel3Weights>(),
+    family3d_table<Scharr3Weights>(),
+    family3d_table<Sobel5Weights>(),
+    family3d_table<Sobel7Weights>()
+};
+
+static const SobelRowKernels kNeon = {
+    { h3d_neon<0>, h3d_neon<1> },
+    { v3d_neon<0>, v3d_neon<1> },
+    {
+        { combine3d_neon<0, 0>, combine3d_neon<0, 1>, combine3d_neon<0, 2>, combine3d_neon<0, 3> },
+        { combine3d_neon<1, 0>, combine3d_neon<1, 1>, combine3d_neon<1, 2>, combine3d_neon<1, 3> },
+        { combine3d_neon<2, 0>, combine3d_neon<2, 1>, combine3d_neon<2, 2>, combine3d_neon<2, 3> }
+    },
+    {
+        { sobel2d_neon<0, 0>, sobel2d_neon<0, 1>, sobel2d_neon<0, 2>, sobel2d_neon<0, 3> },
+        { sobel2d_neon<1, 0>, sobel2d_neon<1, 1>, sobel2d_neon<1, 2>, sobel2d_neon<1, 3> },
+        { sobel2d_neon<2, 0>, sobel2d_neon<2, 1>, sobel2d_neon<2, 2>, sobel2d_neon<2, 3> }
+    },
+    {
+        { combine3d_s16_neon<0, 0>, combine3d_s16_neon<0, 1>, combine3d_s16_neon<0, 2>, combine3d_s16_neon<0, 3> },
+        { combine3d_s16_neon<1, 0>, combine3d_s16_neon<1, 1>, combine3d_s16_neon<1, 2>, combine3d_s16_neon<1, 3> },
+        { combine3d_s16_neon<2, 0>, combine3d_s16_neon<2, 1>, combine3d_s16_neon<2, 2>, combine3d_s16_neon<2, 3> }
+    },
+    {
+        { sobel2d_s16_neon<0, 0>, sobel2d_s16_neon<0, 1>, sobel2d_s16_neon<0, 2>, sobel2d_s16_neon<0, 3> },
+        { sobel2d_s16_neon<1, 0>, sobel2d_s16_neon<1, 1>, sobel2d_s16_neon<1, 2>, sobel2d_s16_neon<1, 3> },
+        { sobel2d_s16_neon<2, 0>, sobel2d_s16_neon<2, 1>, sobel2d_s16_neon<2, 2>, sobel2d_s16_neon<2, 3> }
+    },
+    theta_poly_neon<float>,
+    theta_poly_neon<int16_t>,
+    { theta_bins_neon<float, 0>,   theta_bins_neon<float, 1>,   theta_bins_neon<float, 2> },
+    { theta_bins_neon<int16_t, 0>, theta_bins_neon<int16_t, 1>, theta_bins_neon<int16_t, 2> },
+    bgr_gray_neon,
+    kFamilyNeon,
+    kFamily3DNeon
+};
+
+const SobelRowKernels* sobel_kernels_neon() {
+    return &kNeon;
+}
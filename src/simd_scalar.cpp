@@ -0,0 +1,202 @@
+// simd_scalar.cpp
+// ------------------------------------------------------------
+// Scalar row kernels (always built, also used for SIMD tails).
+// ------------------------------------------------------------
+
+#include "scalar_mag.hpp"
+#include "simd_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+template <int Want>
+static void h3d_scalar(const uint8_t* r, int16_t* hs, int16_t* hd, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        hs[x] = static_cast<int16_t>(r[x - 1] + 2 * r[x] + r[x + 1]);
+        if (Want & K3D_DERIV)
+            hd[x] = static_cast<int16_t>(r[x + 1] - r[x - 1]);
+    }
+}
+
+template <int Want>
+static void v3d_scalar(const int16_t* hsU, const int16_t* hsC, const int16_t* hsD,
+                       const int16_t* hdU, const int16_t* hdC, const int16_t* hdD,
+                       int16_t* dxs, int16_t* sdy, int16_t* ss, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        if (Want & K3D_DERIV) {
+            dxs[x] = static_cast<int16_t>(hdU[x] + 2 * hdC[x] + hdD[x]);
+            sdy[x] = static_cast<int16_t>(hsD[x] - hsU[x]);
+        }
+        ss[x] = static_cast<int16_t>(hsU[x] + 2 * hsC[x] + hsD[x]);
+    }
+}
+
+template <int Mag, int Want>
+static void combine3d_scalar(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                             const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                             const int16_t* ssP,  const int16_t* ssN,
+                             float* gt, float* mag, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        float sumT = static_cast<float>(ssN[x] - ssP[x]);                     // d/dt, smooth x,y
+
+        if (Want & K3D_GT)
+            gt[x] = sumT;
+
+        if (Want & K3D_MAG) {
+            float sumX = static_cast<float>(dxsP[x] + 2 * dxsC[x] + dxsN[x]); // d/dx, smooth y,t
+            float sumY = static_cast<float>(sdyP[x] + 2 * sdyC[x] + sdyN[x]); // d/dy, smooth x,t
+            mag[x] = mag3_f32<Mag>(sumX, sumY, sumT);
+        }
+    }
+}
+
+template <int Mag, int Want>
+static void sobel2d_scalar(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                           float* gx, float* gy, float* mag, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        int sx = (u[x + 1] - u[x - 1]) + 2 * (c[x + 1] - c[x - 1]) + (d[x + 1] - d[x - 1]);
+        int sy = (d[x - 1] + 2 * d[x] + d[x + 1]) - (u[x - 1] + 2 * u[x] + u[x + 1]);
+
+        float sumX = static_cast<float>(sx);
+        float sumY = static_cast<float>(sy);
+
+        if (Want & K2D_GXGY) {
+            gx[x] = sumX;
+            gy[x] = sumY;
+        }
+        if (Want & K2D_MAG)
+            mag[x] = mag2_f32<Mag>(sumX, sumY);
+    }
+}
+
+// ------------------------------------------------------------
+// int16 kernels
+// ------------------------------------------------------------
+
+template <int Mag, int Want>
+static void combine3d_s16_scalar(const int16_t* dxsP, const int16_t* dxsC, const int16_t* dxsN,
+                                 const int16_t* sdyP, const int16_t* sdyC, const int16_t* sdyN,
+                                 const int16_t* ssP,  const int16_t* ssN,
+                                 int16_t* gt, int16_t* mag, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        int sumT = ssN[x] - ssP[x];
+
+        if (Want & K3D_GT)
+            gt[x] = static_cast<int16_t>(sumT);
+
+        if (Want & K3D_MAG) {
+            int sumX = dxsP[x] + 2 * dxsC[x] + dxsN[x];
+            int sumY = sdyP[x] + 2 * sdyC[x] + sdyN[x];
+            mag[x] = mag3_s16<Mag>(sumX, sumY, sumT);
+        }
+    }
+}
+
+template <int Mag, int Want>
+static void sobel2d_s16_scalar(const uint8_t* u, const uint8_t* c, const uint8_t* d,
+                               int16_t* gx, int16_t* gy, int16_t* mag, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        int sx = (u[x + 1] - u[x - 1]) + 2 * (c[x + 1] - c[x - 1]) + (d[x + 1] - d[x - 1]);
+        int sy = (d[x - 1] + 2 * d[x] + d[x + 1]) - (u[x - 1] + 2 * u[x] + u[x + 1]);
+
+        if (Want & K2D_GXGY) {
+            gx[x] = static_cast<int16_t>(sx);
+            gy[x] = static_cast<int16_t>(sy);
+        }
+        if (Want & K2D_MAG)
+            mag[x] = mag2_s16<Mag>(sx, sy);
+    }
+}
+
+// ------------------------------------------------------------
+// Orientation
+// ------------------------------------------------------------
+const float THETA_BIN_EDGES[3][4] = {
+    { 1.0f },                                               // 45
+    { 0.41421356f, 2.41421356f },                           // 22.5, 67.5
+    { 0.19891237f, 0.66817864f, 1.49660576f, 5.02733949f }  // 11.25, 33.75, 56.25, 78.75
+};
+
+template <typename T>
+static void theta_poly_scalar(const T* gx, const T* gy, float* theta, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        const float fx = static_cast<float>(gx[x]), fy = static_cast<float>(gy[x]);
+        const float ax = std::fabs(fx), ay = std::fabs(fy);
+        const float mx = std::max(ax, ay), mn = std::min(ax, ay);
+
+        // atan of the octant-reduced ratio, then unfold the octant
+        const float a = mx > 0.0f ? mn / mx : 0.0f;
+        const float s = a * a;
+        float r = ((((ATAN_C9 * s + ATAN_C7) * s + ATAN_C5) * s + ATAN_C3) * s + ATAN_C1) * a;
+
+        if (ay > ax)   r = THETA_HALF_PI - r;
+        if (fx < 0.0f) r = THETA_PI - r;
+        if (fy < 0.0f) r = -r;
+        theta[x] = r;
+    }
+}
+
+template <typename T, int B>
+static void theta_bins_scalar(const T* gx, const T* gy, uint8_t* bins, int x0, int x1) {
+    const int n = 4 << B;
+
+    for (int x = x0; x < x1; x++) {
+        const float fx = static_cast<float>(gx[x]), fy = static_cast<float>(gy[x]);
+        const float ax = std::fabs(fx), ay = std::fabs(fy);
+
+        // Sector inside the quadrant, 0 .. n/4
+        int j = 0;
+        for (int i = 0; i < n / 4; i++)
+            j += ay > ax * THETA_BIN_EDGES[B][i];
+
+        // Mirror into the quadrant of (gx, gy)
+        const bool negX = fx < 0.0f, negY = fy < 0.0f;
+        const int k = (negX ? n / 2 : 0) + ((negX != negY) ? -j : j);
+        bins[x] = static_cast<uint8_t>(k & (n - 1));
+    }
+}
+
+static void bgr_gray_scalar(const uint8_t* bgr, uint8_t* gray, int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        const uint8_t* p = bgr + 3 * x;
+        gray[x] = static_cast<uint8_t>((p[0] * GRAY_B + p[1] * GRAY_G + p[2] * GRAY_R +
+                                        (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT);
+    }
+}
+
+static const SobelRowKernels kScalar = {
+    { h3d_scalar<0>, h3d_scalar<1> },
+    { v3d_scalar<0>, v3d_scalar<1> },
+    {
+        { combine3d_scalar<0, 0>, combine3d_scalar<0, 1>, combine3d_scalar<0, 2>, combine3d_scalar<0, 3> },
+        { combine3d_scalar<1, 0>, combine3d_scalar<1, 1>, combine3d_scalar<1, 2>, combine3d_scalar<1, 3> },
+        { combine3d_scalar<2, 0>, combine3d_scalar<2, 1>, combine3d_scalar<2, 2>, combine3d_scalar<2, 3> }
+    },
+    {
+        { sobel2d_scalar<0, 0>, sobel2d_scalar<0, 1>, sobel2d_scalar<0, 2>, sobel2d_scalar<0, 3> },
+        { sobel2d_scalar<1, 0>, sobel2d_scalar<1, 1>, sobel2d_scalar<1, 2>, sobel2d_scalar<1, 3> },
+        { sobel2d_scalar<2, 0>, sobel2d_scalar<2, 1>, sobel2d_scalar<2, 2>, sobel2d_scalar<2, 3> }
+    },
+    {
+        { combine3d_s16_scalar<0, 0>, combine3d_s16_scalar<0, 1>, combine3d_s16_scalar<0, 2>, combine3d_s16_scalar<0, 3> },
+        { combine3d_s16_scalar<1, 0>, combine3d_s16_scalar<1, 1>, combine3d_s16_scalar<1, 2>, combine3d_s16_scalar<1, 3> },
+        { combine3d_s16_scalar<2, 0>, combine3d_s16_scalar<2, 1>, combine3d_s16_scalar<2, 2>, combine3d_s16_scalar<2, 3> }
+    },
+    {
+        { sobel2d_s16_scalar<0, 0>, sobel2d_s16_scalar<0, 1>, sobel2d_s16_scalar<0, 2>, sobel2d_s16_scalar<0, 3> },
+        { sobel2d_s16_scalar<1, 0>, sobel2d_s16_scalar<1, 1>, sobel2d_s16_scalar<1, 2>, sobel2d_s16_scalar<1, 3> },
+        { sobel2d_s16_scalar<2, 0>, sobel2d_s16_scalar<2, 1>, sobel2d_s16_scalar<2, 2>, sobel2d_s16_scalar<2, 3> }
+    },
+    theta_poly_scalar<float>,
+    theta_poly_scalar<int16_t>,
+    { theta_bins_scalar<float, 0>,   theta_bins_scalar<float, 1>,   theta_bins_scalar<float, 2> },
+    { theta_bins_scalar<int16_t, 0>, theta_bins_scalar<int16_t, 1>, theta_bins_scalar<int16_t, 2> },
+    bgr_gray_scalar,
+    FAMILY_2D_SCALAR,
+    FAMILY_3D_SCALAR
+};
+
+const SobelRowKernels* sobel_kernels_scalar() {
+    return &kScalar;
+}
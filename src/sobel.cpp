@@ -0,0 +1,185 @@
+// sobel.cpp
+// ------------------------------------------------------------
+// Embedding API over sobel2d / the 3D engine, see sobel.hpp.
+//
+// The caller's buffers are wrapped in cv::Mat headers (no copy).
+// The kernels size their outputs with arena_plane / Mat::create,
+// which keep a plane of the right size and type, so they write
+// in place.
+// ------------------------------------------------------------
+
+#include "sobel.hpp"
+#include "outputs.hpp"
+#include "sobel2d.hpp"
+#include "sobel3d.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <iostream>
+#include <memory>
+
+struct SobelContext {
+    SobelConfig cfg;
+    std::unique_ptr<ThreadPool> ownPool;
+    ThreadPool* pool = nullptr;
+
+    // 2D: gx / gy behind a call that leaves out one or both (sobel2d
+    // writes the pair together), and the Mats of mag / theta when
+    // not asked for (never written)
+    cv::Mat gx, gy, unused[2];
+
+    Sobel3DEngine engine;
+    cv::Mat gt, mag3d;          // 3D planes the caller did not pass
+};
+
+SobelContext* sobel_create(const SobelConfig& cfg) {
+    if (cfg.width <= 0 || cfg.height <= 0) {
+        std::cout << "sobel_create: empty frame size " << cfg.width << "x" << cfg.height << std::endl;
+        return nullptr;
+    }
+    if (cfg.grad.precision == Precision::Int16 && !kernel_fits_int16(cfg.grad.kernel)) {
+        std::cout << "sobel_create: kernel " << kernel_type_name(cfg.grad.kernel) << " needs Precision::Float32" << std::endl;
+        return nullptr;
+    }
+    if (cfg.video && cfg.grad.precision == Precision::Int16 && !kernel_fits_int16(cfg.grad.kernel, 3)) {
+        std::cout << "sobel_create: kernel " << kernel_type_name(cfg.grad.kernel) << " needs Precision::Float32 in 3D" << std::endl;
+        return nullptr;
+    }
+
+    SobelContext* ctx = new SobelContext;
+    ctx->cfg = cfg;
+    if (cfg.pool) {
+        ctx->pool = cfg.pool;
+    } else if (cfg.threads != 1) {
+        ctx->ownPool.reset(new ThreadPool(cfg.threads));
+        ctx->pool = ctx->ownPool.get();
+    }
+
+    const cv::Size size(cfg.width, cfg.height);
+    const int type = cfg.grad.precision == Precision::Int16 ? CV_16S : CV_32F;
+    ctx->gx.create(size, type);
+    ctx->gy.create(size, type);
+
+    if (cfg.video) {
+        ctx->engine.pool = ctx->pool;
+        ctx->engine.grad = cfg.grad;
+        ctx->engine.outputs = OUT_GT | OUT_MAG;
+        sobel3d_reserve(ctx->engine, size);
+        sobel3d_reset(ctx->engine);
+        ctx->gt.create(size, type);
+        ctx->mag3d.create(size, type);
+    }
+    return ctx;
+}
+
+void sobel_destroy(SobelContext* ctx) {
+    delete ctx;
+}
+
+// ------------------------------------------------------------
+// Buffers -> Mat headers
+// ------------------------------------------------------------
+static bool frame_mat(const SobelContext* ctx, const SobelImage& f, cv::Mat& m) {
+    if (!f.data || f.width != ctx->cfg.width || f.height != ctx->cfg.height ||
+        (f.channels != 1 && f.channels != 3) || f.stride < static_cast<size_t>(f.width) * f.channels) {
+        std::cout << "sobel: input frame does not match the context (" << ctx->cfg.width << "x"
+                  << ctx->cfg.height << ", 1 or 3 channels)" << std::endl;
+        return false;
+    }
+    // Read only: the kernels take the frame as const cv::Mat&
+    m = cv::Mat(f.height, f.width, CV_8UC(f.channels), const_cast<uint8_t*>(f.data), f.stride);
+    return true;
+}
+
+// p == nullptr: fallback (scratch or unused)
+static bool plane_mat(const SobelContext* ctx, const SobelPlane* p, int type, cv::Mat& fallback, cv::Mat& m) {
+    if (!p) {
+        m = fallback;
+        return true;
+    }
+    const size_t rowBytes = static_cast<size_t>(p->width) * CV_ELEM_SIZE(type);
+    if (!p->data || p->width != ctx->cfg.width || p->height != ctx->cfg.height || p->stride < rowBytes) {
+        std::cout << "sobel: output plane does not match the context (" << ctx->cfg.width << "x"
+                  << ctx->cfg.height << ", stride >= " << rowBytes << " bytes)" << std::endl;
+        return false;
+    }
+    m = cv::Mat(p->height, p->width, type, p->data, p->stride);
+    return true;
+}
+
+// ------------------------------------------------------------
+// 2D
+// ------------------------------------------------------------
+bool sobel_2d(SobelContext* ctx,
+              const SobelImage& frame,
+              const SobelPlane* gx,
+              const SobelPlane* gy,
+              const SobelPlane* mag,
+              const SobelPlane* theta) {
+    const GradientMode& grad = ctx->cfg.grad;
+    const int type = grad.precision == Precision::Int16 ? CV_16S : CV_32F;
+    const int thetaType = theta_bin_count(grad.theta) != 0 ? CV_8U : CV_32F;
+
+    unsigned outputs = 0;
+    if (gx)    outputs |= OUT_GX;
+    if (gy)    outputs |= OUT_GY;
+    if (mag)   outputs |= OUT_MAG;
+    if (theta) outputs |= OUT_THETA;
+
+    // sobel2d writes gx and gy as a pair, and theta needs both: the
+    // preallocated planes stand in for the ones not passed
+    const bool needXY = (outputs & (OUT_GX | OUT_GY | OUT_THETA)) != 0;
+    cv::Mat in, gxM, gyM, magM, thetaM;
+    if (!frame_mat(ctx, frame, in) ||
+        !plane_mat(ctx, gx, type, needXY ? ctx->gx : ctx->unused[0], gxM) ||
+        !plane_mat(ctx, gy, type, needXY ? ctx->gy : ctx->unused[1], gyM) ||
+        !plane_mat(ctx, mag, type, ctx->unused[0], magM) ||
+        !plane_mat(ctx, theta, thetaType, ctx->unused[1], thetaM))
+        return false;
+
+    if (outputs != 0)
+        sobel2d(ctx->pool, in, gxM, gyM, magM, thetaM, outputs, grad);
+    return true;
+}
+
+// ------------------------------------------------------------
+// 3D
+// ------------------------------------------------------------
+bool sobel_3d_push(SobelContext* ctx, const SobelImage& frame) {
+    cv::Mat in;
+    if (!ctx->cfg.video) {
+        std::cout << "sobel: the context was created without the 3D window (SobelConfig::video)" << std::endl;
+        return false;
+    }
+    if (!frame_mat(ctx, frame, in))
+        return false;
+    sobel3d_push(ctx->engine, in);
+    return true;
+}
+
+void sobel_3d_finish(SobelContext* ctx) {
+    if (ctx->cfg.video)
+        sobel3d_finish(ctx->engine);
+}
+
+bool sobel_3d_ready(const SobelContext* ctx) {
+    return ctx->cfg.video && sobel3d_ready(ctx->engine);
+}
+
+bool sobel_3d_compute(SobelContext* ctx, const SobelPlane* gt, const SobelPlane* mag) {
+    if (!sobel_3d_ready(ctx))
+        return false;
+
+    const int type = ctx->cfg.grad.precision == Precision::Int16 ? CV_16S : CV_32F;
+    cv::Mat gtM, magM;
+    if (!plane_mat(ctx, gt, type, ctx->gt, gtM) || !plane_mat(ctx, mag, type, ctx->mag3d, magM))
+        return false;
+
+    sobel3d_compute(ctx->engine, gtM, magM);
+    return true;
+}
+
+void sobel_3d_reset(SobelContext* ctx) {
+    if (ctx->cfg.video)
+        sobel3d_restart(ctx->engine);
+}
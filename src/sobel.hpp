@@ -0,0 +1,108 @@
+// sobel.hpp
+// ------------------------------------------------------------
+// Embedding API of the sobel library (CMake target `sobel`).
+//
+// The 2D and 3D kernels on caller-owned strided buffers: a frame is
+// a pointer, a row stride in bytes and a width / height, and the
+// gradient planes are written straight into the caller's rows.
+// Nothing is copied in or out, and nothing is allocated per call:
+// the context holds the pool, the 3D plane ring and the few scratch
+// planes, all sized by sobel_create.
+//
+//   SobelConfig cfg;
+//   cfg.width = 1920; cfg.height = 1080;
+//   SobelContext* sobel = sobel_create(cfg);
+//   for each frame:
+//       sobel_3d_push(sobel, frame);
+//       if (sobel_3d_ready(sobel))
+//           sobel_3d_compute(sobel, &gt, &mag);   // output of the frame R back
+//   R times (kernel_radius, 1 for Sobel3):
+//       sobel_3d_finish(sobel);                    // border modes: the last R frames
+//       if (sobel_3d_ready(sobel))
+//           sobel_3d_compute(sobel, &gt, &mag);
+//   sobel_destroy(sobel);
+//
+// Input frames are 8-bit gray or BGR (converted row by row inside
+// the kernels, same values as cv::COLOR_BGR2GRAY). Output planes are
+// float, or int16_t with Precision::Int16 (theta: float radians, or
+// uint8_t bins), the same values as the planes of the --raw npy
+// sidecars. A 3D frame must stay valid only during its push: the
+// window keeps the spatial planes, not the frames.
+//
+// Kept free of OpenCV, like simd_kernels.hpp: the front end
+// (main.cpp, runner.cpp) is one user of the library among others.
+// Calls on one context are not thread-safe; use one context per
+// stream (they can share one pool).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "grad_modes.hpp"
+#include "thread_pool.hpp"
+
+// 8-bit input frame (read only)
+struct SobelImage {
+    const uint8_t* data = nullptr;
+    size_t stride = 0;          // bytes from one row to the next
+    int width = 0;
+    int height = 0;
+    int channels = 1;           // 1 = gray, 3 = BGR
+};
+
+// Output plane (written): float / int16_t / uint8_t, see above
+struct SobelPlane {
+    void* data = nullptr;
+    size_t stride = 0;          // bytes from one row to the next
+    int width = 0;
+    int height = 0;
+};
+
+struct SobelConfig {
+    int width = 0;              // frame size of every call
+    int height = 0;
+    GradientMode grad;          // precision, magnitude / theta formula, border, 2D kernel
+
+    ThreadPool* pool = nullptr; // shared pool; nullptr = a pool of threads of its own
+    int threads = 0;            // 0 = one per core, 1 = the calling thread only
+
+    bool video = true;          // reserve the 3D window (sobel_3d_*)
+};
+
+struct SobelContext;
+
+// Allocate everything up front. Prints the problem and returns
+// nullptr for an empty frame size or a kernel that does not fit
+// the precision (kernel_fits_int16, in 3D too with video).
+SobelContext* sobel_create(const SobelConfig& cfg);
+void sobel_destroy(SobelContext* ctx);
+
+// 2D Sobel of one frame; a nullptr plane is not computed (gx and gy
+// are computed as a pair: a call with only one of them, or theta
+// alone, uses the context's scratch planes for the other). Returns
+// false (and writes nothing) when a buffer does not match the config.
+bool sobel_2d(SobelContext* ctx,
+              const SobelImage& frame,
+              const SobelPlane* gx,
+              const SobelPlane* gy,
+              const SobelPlane* mag,
+              const SobelPlane* theta);
+
+// 3D: run the spatial pass on the next frame and slide the window.
+bool sobel_3d_push(SobelContext* ctx, const SobelImage& frame);
+
+// End of the clip: with a border mode the next of the last R frames
+// becomes curr (call it R times).
+void sobel_3d_finish(SobelContext* ctx);
+
+// curr - R .. curr + R available (sobel3d_ready)
+bool sobel_3d_ready(const SobelContext* ctx);
+
+// Temporal pass for the window's curr. Both planes are always
+// computed; a nullptr one goes to a scratch plane.
+bool sobel_3d_compute(SobelContext* ctx, const SobelPlane* gt, const SobelPlane* mag);
+
+// Forget the window (the next push starts a new clip).
+void sobel_3d_reset(SobelContext* ctx);
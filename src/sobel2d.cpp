@@ -0,0 +1,327 @@
+// sobel2d.cpp
+// ------------------------------------------------------------
+// MANUAL 2D Sobel region worker, see sobel2d.hpp.
+// ------------------------------------------------------------
+
+#include "sobel2d.hpp"
+#include "border.hpp"
+#include "frame_arena.hpp"
+#include "kernel_family.hpp"
+#include "metrics.hpp"
+#include "outputs.hpp"
+#include "simd_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+const int SOBEL_KX[3][3] = {
+    {-1,  0, +1},
+    {-2,  0, +2},
+    {-1,  0, +1}
+};
+
+const int SOBEL_KY[3][3] = {
+    {-1, -2, -1},
+    { 0,  0,  0},
+    {+1, +2, +1}
+};
+
+// ------------------------------------------------------------
+// Orientation of one row by ThetaMode (float or int16 gradients)
+// ------------------------------------------------------------
+static inline int bins_index(int bins) {
+    return bins == 4 ? 0 : bins == 8 ? 1 : 2;
+}
+
+static inline void theta_kernel(const SobelRowKernels& k, const float* gx, const float* gy,
+                                float* theta, int x0, int x1) {
+    k.theta_poly(gx, gy, theta, x0, x1);
+}
+
+static inline void theta_kernel(const SobelRowKernels& k, const int16_t* gx, const int16_t* gy,
+                                float* theta, int x0, int x1) {
+    k.theta_poly_s16(gx, gy, theta, x0, x1);
+}
+
+static inline void theta_kernel(const SobelRowKernels& k, int bins, const float* gx, const float* gy,
+                                uint8_t* theta, int x0, int x1) {
+    k.theta_bins[bins_index(bins)](gx, gy, theta, x0, x1);
+}
+
+static inline void theta_kernel(const SobelRowKernels& k, int bins, const int16_t* gx, const int16_t* gy,
+                                uint8_t* theta, int x0, int x1) {
+    k.theta_bins_s16[bins_index(bins)](gx, gy, theta, x0, x1);
+}
+
+template <typename T>
+static void theta_row(const SobelRowKernels& k, ThetaMode mode, const T* gx, const T* gy,
+                      cv::Mat& theta, int y, int x0, int x1) {
+    const int bins = theta_bin_count(mode);
+    if (bins != 0) {
+        theta_kernel(k, bins, gx, gy, theta.ptr<uint8_t>(y), x0, x1);
+        return;
+    }
+
+    float* thetaRow = theta.ptr<float>(y);
+    if (mode == ThetaMode::Poly) {
+        theta_kernel(k, gx, gy, thetaRow, x0, x1);
+        return;
+    }
+
+    for (int x = x0; x < x1; x++)
+        thetaRow[x] = std::atan2(static_cast<float>(gy[x]), static_cast<float>(gx[x])); // radians [-pi, pi]
+}
+
+// BorderMode::Zero: the frame border of this region (radius pixels
+// wide), written as 0
+static void zero_pixels(cv::Mat* m, int y, int x0, int x1) {
+    if (x1 > x0)
+        std::memset(m->ptr(y) + x0 * m->elemSize(), 0, (x1 - x0) * m->elemSize());
+}
+
+static void zero_border(const SobelTask& t, cv::Mat* m, int radius) {
+    const int rows = t.gray->rows;
+    const int cols = t.gray->cols;
+    const int y0 = std::max(t.y0, 0), y1 = std::min(t.y1, rows);
+    const int x0 = std::max(t.x0, 0), x1 = std::min(t.x1, cols);
+
+    for (int y = y0; y < y1; y++) {
+        if (y < radius || y >= rows - radius) {
+            zero_pixels(m, y, x0, x1);
+            continue;
+        }
+        zero_pixels(m, y, x0, std::min(x1, radius));
+        zero_pixels(m, y, std::max(x0, cols - radius), x1);
+    }
+}
+
+// ------------------------------------------------------------
+// KernelType other than Sobel3: the compile-time family
+// (kernel_family.hpp), 2R + 1 rows per output row
+// ------------------------------------------------------------
+template <typename T>
+static void family_rows(const SobelTask& t, const SobelRowKernels& k, PaddedRows* pad,
+                        int startY, int endY, int startX, int endX,
+                        bool wantGxGy, bool wantMag, bool wantTheta) {
+    const Family2DKernels& fam = kernel_family_2d(t.grad.kernel);
+    const int radius = fam.radius;
+    const int mag  = static_cast<int>(t.grad.mag);
+    const int want = (wantGxGy ? K2D_GXGY : 0) | (wantMag ? K2D_MAG : 0);
+
+    // Smoothed / differenced columns [startX - R, endX + R)
+    static thread_local std::vector<int16_t> vs, vd;
+    vs.resize(static_cast<size_t>(t.gray->cols) + 2 * radius);
+    vd.resize(vs.size());
+
+    const uint8_t* rows[7];
+    for (int y = startY; y < endY; y++) {
+        if (pad) {
+            padded_rows_window(*pad, y, rows);
+        } else {
+            for (int j = 0; j <= 2 * radius; j++)
+                rows[j] = t.gray->ptr<uchar>(y - radius + j);
+        }
+
+        T* gxRow  = wantGxGy ? t.gx->ptr<T>(y)  : nullptr;
+        T* gyRow  = wantGxGy ? t.gy->ptr<T>(y)  : nullptr;
+        T* magRow = wantMag  ? t.mag->ptr<T>(y) : nullptr;
+
+        if constexpr (std::is_same<T, int16_t>::value)
+            fam.s16[mag][want](rows, vs.data() + radius, vd.data() + radius, gxRow, gyRow, magRow, startX, endX);
+        else
+            fam.f32[mag][want](rows, vs.data() + radius, vd.data() + radius, gxRow, gyRow, magRow, startX, endX);
+
+        if (wantTheta)
+            theta_row(k, t.grad.theta, gxRow, gyRow, *t.theta, y, startX, endX);
+    }
+}
+
+void SobelWorker(const SobelTask& t) {
+    const cv::Mat& gray = *(t.gray);
+
+    // theta is derived from gx/gy, so it needs them too
+    const bool wantTheta = (t.outputs & OUT_THETA) != 0;
+    const bool wantGxGy  = wantTheta || (t.outputs & (OUT_GX | OUT_GY)) != 0;
+    const bool wantMag   = (t.outputs & OUT_MAG) != 0;
+
+    // --------------------------------------------------------
+    // BorderMode::Zero: clamp the region to the safe convolution
+    // area (we need neighbors x±R, y±R; R = 1 but for the wide
+    // kernels) and write the border as 0.
+    // Other modes: the whole region, from padded rows.
+    // --------------------------------------------------------
+    const bool family = t.grad.kernel != KernelType::Sobel3;
+    const int radius = kernel_radius(t.grad.kernel);
+
+    // No int16 kernels for it (kernel_family_2d has nullptr there):
+    // nothing written, sobel2d runs such a task in float instead
+    if (t.grad.precision == Precision::Int16 && !kernel_fits_int16(t.grad.kernel))
+        return;
+    const bool zeroBorder = t.grad.border == BorderMode::Zero;
+    const int inset = zeroBorder ? radius : 0;
+
+    int startY = std::max(t.y0, inset);
+    int endY   = std::min(t.y1, gray.rows - inset); // exclusive end
+    int startX = std::max(t.x0, inset);
+    int endX   = std::min(t.x1, gray.cols - inset);
+
+    if (zeroBorder) {
+        if (wantGxGy)  { zero_border(t, t.gx, inset); zero_border(t, t.gy, inset); }
+        if (wantMag)   zero_border(t, t.mag, inset);
+        if (wantTheta) zero_border(t, t.theta, inset);
+    }
+    if (startY >= endY || startX >= endX)
+        return;
+
+    // Input rows y-R .. y+R: straight from a gray frame inside the
+    // Zero border, otherwise padded (and converted from BGR) once each
+    const bool padded = !zeroBorder || gray.type() == CV_8UC3;
+    static thread_local PaddedRows pad;
+    if (padded)
+        padded_rows_begin(pad, gray, t.grad.border, startY, radius);
+
+    const SobelRowKernels& k = sobel_kernels();
+    if (family) {
+        PaddedRows* rowsPad = padded ? &pad : nullptr;
+        if (t.grad.precision == Precision::Int16)
+            family_rows<int16_t>(t, k, rowsPad, startY, endY, startX, endX, wantGxGy, wantMag, wantTheta);
+        else
+            family_rows<float>(t, k, rowsPad, startY, endY, startX, endX, wantGxGy, wantMag, wantTheta);
+        return;
+    }
+
+    auto rows_at = [&](int y, const uchar*& u, const uchar*& c, const uchar*& d) {
+        if (padded) {
+            padded_rows_at(pad, y, u, c, d);
+        } else {
+            u = gray.ptr<uchar>(y - 1);
+            c = gray.ptr<uchar>(y);
+            d = gray.ptr<uchar>(y + 1);
+        }
+    };
+
+    // --------------------------------------------------------
+    // Standard kernels: vectorized Gx/Gy/magnitude rows, then
+    // theta in the requested mode
+    // --------------------------------------------------------
+    const int mag  = static_cast<int>(t.grad.mag);
+    const int want = (wantGxGy ? K2D_GXGY : 0) | (wantMag ? K2D_MAG : 0);
+    const uchar *u, *c, *d;
+
+    if (t.grad.precision == Precision::Int16) {
+        const Sobel2DS16Fn sobel2d = k.sobel2d_s16[mag][want];
+
+        for (int y = startY; y < endY; y++) {
+            int16_t* gxRow  = wantGxGy ? t.gx->ptr<int16_t>(y)  : nullptr;
+            int16_t* gyRow  = wantGxGy ? t.gy->ptr<int16_t>(y)  : nullptr;
+            int16_t* magRow = wantMag  ? t.mag->ptr<int16_t>(y) : nullptr;
+
+            rows_at(y, u, c, d);
+            sobel2d(u, c, d, gxRow, gyRow, magRow, startX, endX);
+
+            if (wantTheta)
+                theta_row(k, t.grad.theta, gxRow, gyRow, *t.theta, y, startX, endX);
+        }
+        return;
+    }
+
+    if (t.kx == SOBEL_KX && t.ky == SOBEL_KY) {
+        const Sobel2DFn sobel2d = k.sobel2d[mag][want];
+
+        for (int y = startY; y < endY; y++) {
+            float* gxRow  = wantGxGy ? t.gx->ptr<float>(y)  : nullptr;
+            float* gyRow  = wantGxGy ? t.gy->ptr<float>(y)  : nullptr;
+            float* magRow = wantMag  ? t.mag->ptr<float>(y) : nullptr;
+
+            rows_at(y, u, c, d);
+            sobel2d(u, c, d, gxRow, gyRow, magRow, startX, endX);
+
+            if (wantTheta)
+                theta_row(k, t.grad.theta, gxRow, gyRow, *t.theta, y, startX, endX);
+        }
+        return;
+    }
+
+    // --------------------------------------------------------
+    // Manual Sobel convolution on this region (any 3x3 kernels,
+    // exact magnitude and atan2)
+    // --------------------------------------------------------
+    for (int y = startY; y < endY; y++) {
+        rows_at(y, u, c, d);
+        const uchar* r[3] = { u, c, d };
+
+        for (int x = startX; x < endX; x++) {
+
+            float sumX = 0.0f;
+            float sumY = 0.0f;
+
+            // Apply 3x3 kernels around pixel (x, y)
+            for (int j = -1; j <= 1; j++) {
+                for (int i = -1; i <= 1; i++) {
+                    uchar p = r[j + 1][x + i];
+                    sumX += p * t.kx[j + 1][i + 1];
+                    sumY += p * t.ky[j + 1][i + 1];
+                }
+            }
+
+            if (wantGxGy) {
+                t.gx->at<float>(y, x) = sumX;
+                t.gy->at<float>(y, x) = sumY;
+            }
+            if (wantMag)
+                t.mag->at<float>(y, x) = std::sqrt(sumX * sumX + sumY * sumY);
+            if (wantTheta)
+                t.theta->at<float>(y, x) = std::atan2(sumY, sumX); // radians [-pi, pi]
+        }
+    }
+}
+
+void sobel2d(ThreadPool* pool,
+             const cv::Mat& gray,
+             cv::Mat& gx,
+             cv::Mat& gy,
+             cv::Mat& mag,
+             cv::Mat& theta,
+             unsigned outputs,
+             GradientMode grad) {
+    StageTimer timer(Stage::Gradient);
+
+    if (outputs & OUT_THETA)
+        outputs |= OUT_GX | OUT_GY;
+
+    // A kernel whose sums overflow int16 (Sobel7) is computed in float
+    if (grad.precision == Precision::Int16 && !kernel_fits_int16(grad.kernel))
+        grad.precision = Precision::Float32;
+
+    // Reused across frames; every pixel is written each call
+    const int type = grad.precision == Precision::Int16 ? CV_16S : CV_32F;
+    const size_t elem = grad.precision == Precision::Int16 ? sizeof(int16_t) : sizeof(float);
+    size_t outBytes = 0;
+    if (outputs & (OUT_GX | OUT_GY)) {
+        arena_plane(gx, gray.size(), type);
+        arena_plane(gy, gray.size(), type);
+        outBytes += 2 * elem;
+    }
+    if (outputs & OUT_MAG) {
+        arena_plane(mag, gray.size(), type);
+        outBytes += elem;
+    }
+    if (outputs & OUT_THETA) {
+        const bool bins = theta_bin_count(grad.theta) != 0;
+        arena_plane(theta, gray.size(), bins ? CV_8U : CV_32F);
+        outBytes += bins ? 1 : sizeof(float);
+    }
+
+    // Full-width row bands: 2R + 1 input rows + the outputs per row
+    const size_t inRows = 2 * static_cast<size_t>(kernel_radius(grad.kernel)) + 1;
+    const size_t bytesPerRow = static_cast<size_t>(gray.cols) * (inRows + outBytes);
+
+    parallel_for_rows(pool, 0, gray.rows, bytesPerRow, [&](int y0, int y1) {
+        SobelTask task = { &gray, &gx, &gy, &mag, &theta,
+                           0, gray.cols, y0, y1, SOBEL_KX, SOBEL_KY, outputs, grad };
+        SobelWorker(task);
+    });
+}
@@ -0,0 +1,83 @@
+// sobel2d.hpp
+// ------------------------------------------------------------
+// MANUAL 2D Sobel (Gx, Gy, magnitude, theta) on a grayscale image.
+//
+// Portable version of the Version_5/Version_6 SobelWorker: the
+// region task is the same, but it is scheduled on the persistent
+// ThreadPool instead of 4 per-frame Windows threads.
+//
+// The input is a gray plane (CV_8U) or the decoded BGR frame
+// (CV_8UC3): BGR rows are converted to luma on the fly into the
+// worker's rolling 3-row buffer (border.hpp), bit-identical to
+// cv::cvtColor(COLOR_BGR2GRAY) followed by the gray kernels.
+//
+// With Precision::Int16 (grad_modes.hpp) gx/gy/magnitude are CV_16S
+// and come from the integer kernels. theta is CV_32F radians, or the
+// CV_8U sector index for ThetaMode::BinsN, in both precisions.
+//
+// grad.kernel picks the aperture (KernelType): Sobel3 runs the SIMD
+// kernels, the others the compile-time family of kernel_family.hpp,
+// vectorized per SIMD level as well (Sobel7 is float only, see
+// kernel_fits_int16).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "grad_modes.hpp"
+#include "outputs.hpp"
+#include "thread_pool.hpp"
+
+// ------------------------------------------------------------
+// Sobel kernels (Wikipedia formulation)
+// ------------------------------------------------------------
+extern const int SOBEL_KX[3][3];
+extern const int SOBEL_KY[3][3];
+
+// ------------------------------------------------------------
+// Work item (shared Mats + region bounds)
+// ------------------------------------------------------------
+struct SobelTask {
+    const cv::Mat* gray;        // input grayscale (CV_8U) or BGR (CV_8UC3)
+    cv::Mat* gx;                // output Gx (CV_32F / CV_16S)
+    cv::Mat* gy;                // output Gy (CV_32F / CV_16S)
+    cv::Mat* mag;               // output magnitude (CV_32F / CV_16S)
+    cv::Mat* theta;             // output direction (CV_32F / CV_8U bins)
+
+    int x0, x1;                 // region bounds in x: [x0, x1)
+    int y0, y1;                 // region bounds in y: [y0, y1)
+
+    const int (*kx)[3];         // Sobel kernel X (3x3)
+    const int (*ky)[3];         // Sobel kernel Y (3x3)
+
+    // Products to write (OUT_GX/GY/MAG/THETA); the Mats of the
+    // others are not touched. OUT_THETA also needs gx and gy.
+    unsigned outputs = OUT_GX | OUT_GY | OUT_MAG | OUT_THETA;
+
+    // Precision / magnitude / theta modes of the standard kernels.
+    // Int16 needs them (SOBEL_KX / SOBEL_KY); other kernels run the
+    // exact float formulas. grad.kernel other than Sobel3 replaces
+    // kx / ky. grad.border applies to every kernel.
+    GradientMode grad;
+};
+
+// Run the Sobel convolution on one region (BorderMode::Zero: the
+// frame border of the region is written as 0). A task asking Int16
+// of a kernel that does not fit it (kernel_fits_int16) writes nothing.
+void SobelWorker(const SobelTask& t);
+
+// Allocate outputs once (CV_32F or CV_16S per grad.precision,
+// reused when the size matches) and run SobelWorker over
+// the whole image on the pool (pool == nullptr: single-threaded).
+// Only the planes in outputs are allocated and written (theta
+// brings gx and gy along). Int16 with a kernel that does not fit it
+// gives CV_32F planes, as with Precision::Float32.
+void sobel2d(ThreadPool* pool,
+             const cv::Mat& gray,
+             cv::Mat& gx,
+             cv::Mat& gy,
+             cv::Mat& mag,
+             cv::Mat& theta,
+             unsigned outputs = OUT_GX | OUT_GY | OUT_MAG | OUT_THETA,
+             GradientMode grad = GradientMode());
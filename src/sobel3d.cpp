@@ -0,0 +1,802 @@
+// sobel3d.cpp
+// ------------------------------------------------------------
+// Separable 3D Sobel engine + the original naive reference loop.
+// See sobel3d.hpp for the decomposition.
+// ------------------------------------------------------------
+
+#include "sobel3d.hpp"
+#include "border.hpp"
+#include "frame_arena.hpp"
+#include "kernel_family.hpp"
+#include "metrics.hpp"
+#include "ocl_backend.hpp"
+#include "simd_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+static inline float sqr(float v) { return v * v; }
+
+// ------------------------------------------------------------
+// KernelType other than Sobel3: one pass per output row over its
+// 2R + 1 input rows (kernel_family.hpp), float planes
+// ------------------------------------------------------------
+static void spatial_family(const cv::Mat& gray, Sobel3DPlanes& out, ThreadPool* pool, bool deriv,
+                           BorderMode border, const cv::Rect& area, KernelType kernel) {
+    const cv::Size size = gray.size();
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const Family3DKernels& fam = kernel_family_3d(kernel);
+    const int radius = fam.radius;
+
+    arena_plane(out.dxs, size, CV_32F);
+    arena_plane(out.sdy, size, CV_32F);
+    arena_plane(out.ss,  size, CV_32F);
+
+    // Zero: skip the R-pixel border, rows straight from a gray frame.
+    // Other modes (and BGR): padded rows, as in sobel2d.
+    const int inset = border == BorderMode::Zero ? radius : 0;
+    const bool padded = inset == 0 || gray.type() == CV_8UC3;
+
+    const cv::Rect a = area.empty() ? cv::Rect(0, 0, cols, rows) : area & cv::Rect(0, 0, cols, rows);
+    const int x0 = std::max(a.x, inset);
+    const int x1 = std::min(a.x + a.width, cols - inset);
+    const int y0 = std::max(a.y, inset);
+    const int y1 = std::min(a.y + a.height, rows - inset);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const Family3DSpatialFn spatial = fam.spatial[deriv ? K3D_DERIV : 0];
+    const size_t bytesPerRow = static_cast<size_t>(cols) * (gray.elemSize() + 3 * sizeof(float));
+
+    parallel_for_rows(pool, y0, y1, bytesPerRow, [&](int b0, int b1) {
+        static thread_local PaddedRows pad;
+        static thread_local std::vector<int16_t> vs, vd;
+        vs.resize(static_cast<size_t>(cols) + 2 * radius);
+        vd.resize(vs.size());
+        if (padded)
+            padded_rows_begin(pad, gray, border, b0, radius);
+
+        const uint8_t* r[SOBEL3D_MAX_WINDOW];
+        for (int y = b0; y < b1; y++) {
+            if (padded) {
+                padded_rows_window(pad, y, r);
+            } else {
+                for (int j = 0; j <= 2 * radius; j++)
+                    r[j] = gray.ptr<uchar>(y - radius + j);
+            }
+            spatial(r, vs.data() + radius, vd.data() + radius,
+                    deriv ? out.dxs.ptr<float>(y) : nullptr, deriv ? out.sdy.ptr<float>(y) : nullptr,
+                    out.ss.ptr<float>(y), x0, x1);
+        }
+    });
+}
+
+void sobel3d_spatial(const cv::Mat& gray, Sobel3DPlanes& out, ThreadPool* pool, bool deriv,
+                     BorderMode border, const cv::Rect& area, KernelType kernel) {
+    if (kernel != KernelType::Sobel3) {
+        spatial_family(gray, out, pool, deriv, border, area, kernel);
+        return;
+    }
+
+    const cv::Size size = gray.size();
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+
+    arena_plane(out.hs,  size, CV_16S);
+    arena_plane(out.hd,  size, CV_16S);
+    arena_plane(out.dxs, size, CV_16S);
+    arena_plane(out.sdy, size, CV_16S);
+    arena_plane(out.ss,  size, CV_16S);
+
+    const SobelRowKernels& k = sobel_kernels();
+    const H3DFn h3d = k.h3d[deriv ? K3D_DERIV : 0];
+    const V3DFn v3d = k.v3d[deriv ? K3D_DERIV : 0];
+
+    // Zero: skip the 1-pixel border. Other modes: whole rows from a
+    // padded copy, and the rows outside the frame mapped per mode.
+    // A BGR frame is converted to gray row by row into the same copy.
+    const int inset = border == BorderMode::Zero ? 1 : 0;
+    const bool padded = inset == 0 || gray.type() == CV_8UC3;
+
+    // Columns / rows written (the vertical pass also reads the
+    // horizontal rows just above and below)
+    const cv::Rect a = area.empty() ? cv::Rect(0, 0, cols, rows) : area & cv::Rect(0, 0, cols, rows);
+    const int x0 = std::max(a.x, inset);
+    const int x1 = std::min(a.x + a.width, cols - inset);
+    const int y0 = std::max(a.y, inset);
+    const int y1 = std::min(a.y + a.height, rows - inset);
+
+    // --------------------------------------------------------
+    // Horizontal pass: smooth [1 2 1] and deriv [-1 0 +1] in x
+    // --------------------------------------------------------
+    const size_t hBytes = static_cast<size_t>(cols) * (gray.elemSize() + 2 * sizeof(short));
+    parallel_for_rows(pool, std::max(a.y - 1, 0), std::min(a.y + a.height + 1, rows), hBytes,
+                      [&](int b0, int b1) {
+        static thread_local std::vector<uint8_t> pad;
+        if (padded)
+            pad.resize(static_cast<size_t>(cols) + 2);
+
+        for (int y = b0; y < b1; y++) {
+            const uchar* r = gray.ptr<uchar>(y);
+            if (padded) {
+                pad_source_row(gray, y, border, pad.data());
+                r = pad.data() + 1;
+            }
+            h3d(r, out.hs.ptr<short>(y), out.hd.ptr<short>(y), x0, x1);
+        }
+    });
+
+    // --------------------------------------------------------
+    // Vertical pass. Needs the neighbouring horizontal rows,
+    // hence the barrier between the two passes. A row outside a
+    // Constant border smooths / differentiates to 0.
+    // --------------------------------------------------------
+    const size_t vBytes = static_cast<size_t>(cols) * (3 * 2 + 3) * sizeof(short);
+    parallel_for_rows(pool, y0, y1, vBytes, [&](int b0, int b1) {
+        static thread_local std::vector<short> zero;
+        if (border == BorderMode::Constant)
+            zero.assign(cols, 0);
+
+        auto hs_row = [&](int y) {
+            const int r = border_index(y, rows, border);
+            return r < 0 ? zero.data() : out.hs.ptr<short>(r);
+        };
+        auto hd_row = [&](int y) {
+            const int r = border_index(y, rows, border);
+            return r < 0 ? zero.data() : out.hd.ptr<short>(r);
+        };
+
+        for (int y = b0; y < b1; y++) {
+            v3d(hs_row(y - 1), hs_row(y), hs_row(y + 1),
+                hd_row(y - 1), hd_row(y), hd_row(y + 1),
+                out.dxs.ptr<short>(y), out.sdy.ptr<short>(y), out.ss.ptr<short>(y),
+                x0, x1);
+        }
+    });
+}
+
+// ------------------------------------------------------------
+// Row kernel for the output type (float: Precision::Float32,
+// int16_t: Precision::Int16) and the engine's magnitude mode
+// ------------------------------------------------------------
+static inline void combine_kernel(const SobelRowKernels& k, MagMode mag, int want,
+                                  const short* dxsP, const short* dxsC, const short* dxsN,
+                                  const short* sdyP, const short* sdyC, const short* sdyN,
+                                  const short* ssP,  const short* ssN,
+                                  float* gtRow, float* magRow, int x0, int x1) {
+    k.combine3d[static_cast<int>(mag)][want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN, gtRow, magRow, x0, x1);
+}
+
+static inline void combine_kernel(const SobelRowKernels& k, MagMode mag, int want,
+                                  const short* dxsP, const short* dxsC, const short* dxsN,
+                                  const short* sdyP, const short* sdyC, const short* sdyN,
+                                  const short* ssP,  const short* ssN,
+                                  int16_t* gtRow, int16_t* magRow, int x0, int x1) {
+    k.combine3d_s16[static_cast<int>(mag)][want](dxsP, dxsC, dxsN, sdyP, sdyC, sdyN, ssP, ssN,
+                                                 gtRow, magRow, x0, x1);
+}
+
+// ------------------------------------------------------------
+// Columns [x0, x1) of row y, one kernel call per run of tiles in
+// the same gate state (gate == nullptr: all active). A static run
+// passes curr as prev and next too: Gx / Gy = 4 x curr, Gt = 0.
+// ------------------------------------------------------------
+template <typename T>
+static void combine_span(const SobelRowKernels& k,
+                         MagMode magMode,
+                         int want,
+                         const Sobel3DPlanes& p,
+                         const Sobel3DPlanes& c,
+                         const Sobel3DPlanes& n,
+                         const GateMap* gate,
+                         int y,
+                         T* gtRow,
+                         T* magRow,
+                         int x0,
+                         int x1) {
+    if (!gate) {
+        combine_kernel(k, magMode, want,
+                       p.dxs.ptr<short>(y), c.dxs.ptr<short>(y), n.dxs.ptr<short>(y),
+                       p.sdy.ptr<short>(y), c.sdy.ptr<short>(y), n.sdy.ptr<short>(y),
+                       p.ss.ptr<short>(y),  n.ss.ptr<short>(y),
+                       gtRow, magRow, x0, x1);
+        return;
+    }
+
+    const uint8_t* states = gate_row(*gate, y);
+    const int block = gate->block;
+    for (int x = x0; x < x1;) {
+        const uint8_t s = states[x / block];
+        int e = std::min(x1, (x / block + 1) * block);
+        while (e < x1 && states[e / block] == s)
+            e = std::min(x1, e + block);
+
+        if (s == GATE_OFF) {
+            if (gtRow)  std::fill(gtRow + x, gtRow + e, T(0));
+            if (magRow) std::fill(magRow + x, magRow + e, T(0));
+        } else {
+            const Sobel3DPlanes& sp = s == GATE_ACTIVE ? p : c;
+            const Sobel3DPlanes& sn = s == GATE_ACTIVE ? n : c;
+            combine_kernel(k, magMode, want,
+                           sp.dxs.ptr<short>(y), c.dxs.ptr<short>(y), sn.dxs.ptr<short>(y),
+                           sp.sdy.ptr<short>(y), c.sdy.ptr<short>(y), sn.sdy.ptr<short>(y),
+                           sp.ss.ptr<short>(y),  sn.ss.ptr<short>(y),
+                           gtRow, magRow, x, e);
+        }
+        x = e;
+    }
+}
+
+// ------------------------------------------------------------
+// Temporal pass for one row y (BorderMode::Zero: border rows /
+// columns written as 0, otherwise the whole row). A nullptr output
+// row is not computed (the dxs/sdy planes are not even read when
+// magRow is nullptr).
+// ------------------------------------------------------------
+template <typename T>
+static void combine_row(const SobelRowKernels& k,
+                        MagMode magMode,
+                        BorderMode border,
+                        const Sobel3DPlanes& p,
+                        const Sobel3DPlanes& c,
+                        const Sobel3DPlanes& n,
+                        const GateMap* gate,
+                        int y,
+                        T* gtRow,
+                        T* magRow) {
+    const int rows = c.ss.rows;
+    const int cols = c.ss.cols;
+    const int want = (gtRow ? K3D_GT : 0) | (magRow ? K3D_MAG : 0);
+
+    if (border != BorderMode::Zero) {
+        combine_span(k, magMode, want, p, c, n, gate, y, gtRow, magRow, 0, cols);
+        return;
+    }
+
+    // Border rows: nothing to compute
+    if (y == 0 || y == rows - 1) {
+        for (int x = 0; x < cols; x++) {
+            if (gtRow)  gtRow[x] = 0;
+            if (magRow) magRow[x] = 0;
+        }
+        return;
+    }
+
+    if (gtRow)  { gtRow[0] = 0;  gtRow[cols - 1] = 0; }
+    if (magRow) { magRow[0] = 0; magRow[cols - 1] = 0; }
+
+    combine_span(k, magMode, want, p, c, n, gate, y, gtRow, magRow, 1, cols - 1);
+}
+
+// ------------------------------------------------------------
+// Temporal pass of a wider kernel for row y over frames[0 .. 2R]
+// (curr - R .. curr + R), same border handling with an R-pixel
+// border
+// ------------------------------------------------------------
+static void family_row(const Family3DKernels& fam,
+                       MagMode magMode,
+                       BorderMode border,
+                       const Sobel3DPlanes* const* frames,
+                       int y,
+                       float* gtRow,
+                       float* magRow) {
+    const int radius = fam.radius;
+    const cv::Mat& curr = frames[radius]->ss;
+    const int rows = curr.rows;
+    const int cols = curr.cols;
+    const int want = (gtRow ? K3D_GT : 0) | (magRow ? K3D_MAG : 0);
+
+    // Zero: columns [x0, x1) computed, the rest written as 0 (all of
+    // a border row)
+    int x0 = 0, x1 = cols;
+    if (border == BorderMode::Zero) {
+        const bool inside = y >= radius && y < rows - radius;
+        x0 = inside ? std::min(radius, cols) : cols;
+        x1 = std::max(x0, cols - radius);
+        if (gtRow)  { std::fill(gtRow, gtRow + x0, 0.0f);   std::fill(gtRow + x1, gtRow + cols, 0.0f); }
+        if (magRow) { std::fill(magRow, magRow + x0, 0.0f); std::fill(magRow + x1, magRow + cols, 0.0f); }
+        if (x0 >= x1)
+            return;
+    }
+
+    const float* dxs[SOBEL3D_MAX_WINDOW] = {};
+    const float* sdy[SOBEL3D_MAX_WINDOW] = {};
+    const float* ss[SOBEL3D_MAX_WINDOW];
+    for (int j = 0; j <= 2 * radius; j++) {
+        ss[j] = frames[j]->ss.ptr<float>(y);
+        if (magRow) {
+            dxs[j] = frames[j]->dxs.ptr<float>(y);
+            sdy[j] = frames[j]->sdy.ptr<float>(y);
+        }
+    }
+    fam.combine[static_cast<int>(magMode)][want](dxs, sdy, ss, gtRow, magRow, x0, x1);
+}
+
+void sobel3d_combine(const Sobel3DPlanes& p,
+                     const Sobel3DPlanes& c,
+                     const Sobel3DPlanes& n,
+                     cv::Mat& gt,
+                     cv::Mat& mag3d,
+                     ThreadPool* pool,
+                     GradientMode grad,
+                     const GateMap* gate) {
+    const bool s16 = grad.precision == Precision::Int16;
+    gt.create(c.ss.size(), s16 ? CV_16S : CV_32F);
+    mag3d.create(c.ss.size(), s16 ? CV_16S : CV_32F);
+
+    const SobelRowKernels& k = sobel_kernels();
+
+    // 8 input planes (3 frames) + 2 outputs per row
+    const size_t bytesPerRow = static_cast<size_t>(c.ss.cols) * (8 * sizeof(short) + 2 * gt.elemSize());
+
+    parallel_for_rows(pool, 0, c.ss.rows, bytesPerRow, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            if (s16)
+                combine_row(k, grad.mag, grad.border, p, c, n, gate, y, gt.ptr<int16_t>(y), mag3d.ptr<int16_t>(y));
+            else
+                combine_row(k, grad.mag, grad.border, p, c, n, gate, y, gt.ptr<float>(y), mag3d.ptr<float>(y));
+        }
+    });
+}
+
+// ------------------------------------------------------------
+// Rolling window
+// ------------------------------------------------------------
+static bool family_kernel(const Sobel3DEngine& engine) {
+    return engine.grad.kernel != KernelType::Sobel3;
+}
+
+// Frames in the ring
+static int window_frames(const Sobel3DEngine& engine) {
+    return 2 * sobel3d_radius(engine) + 1;
+}
+
+// CV_16S outputs: Precision::Int16 and a kernel whose sums fit
+static bool int16_outputs(const Sobel3DEngine& engine) {
+    return engine.grad.precision == Precision::Int16 && kernel_fits_int16(engine.grad.kernel, 3);
+}
+
+// dxs / sdy / ss of a frame outside a Constant border (one plane of 0)
+static void zero_planes(Sobel3DPlanes& z, const cv::Size& size, int type) {
+    if (z.ss.size() == size && z.ss.type() == type)
+        return;
+    z.ss = cv::Mat::zeros(size, type);
+    z.dxs = z.ss;
+    z.sdy = z.ss;
+}
+
+static int plane_type(const Sobel3DEngine& engine) {
+    return family_kernel(engine) ? CV_32F : CV_16S;
+}
+
+void sobel3d_reserve(Sobel3DEngine& engine, const cv::Size& size) {
+    if (engine.ocl) {
+        ocl_sobel3d_reserve(*engine.ocl, size, engine.outChannels, engine.grad.border);
+        return;
+    }
+    const int type = plane_type(engine);
+    if (engine.grad.border == BorderMode::Constant)
+        zero_planes(engine.zero, size, type);
+
+    for (int i = 0; i < window_frames(engine); i++) {
+        Sobel3DPlanes& pl = engine.planes[i];
+        if (!family_kernel(engine)) {
+            arena_plane(pl.hs, size, CV_16S);
+            arena_plane(pl.hd, size, CV_16S);
+        }
+        arena_plane(pl.dxs, size, type);
+        arena_plane(pl.sdy, size, type);
+        arena_plane(pl.ss,  size, type);
+    }
+
+    const int outType = int16_outputs(engine) ? CV_16S : CV_32F;
+    arena_plane(engine.gt,    size, outType);
+    arena_plane(engine.mag3d, size, outType);
+}
+
+void sobel3d_restart(Sobel3DEngine& engine) {
+    engine.head = 0;
+    engine.count = 0;
+    engine.ended = 0;
+}
+
+void sobel3d_reset(Sobel3DEngine& engine) {
+    sobel3d_restart(engine);
+    engine.gateMap.active = 0;
+    engine.gateMap.total = 0;
+    norm_reset(engine.gtNorm);
+    norm_reset(engine.magNorm);
+}
+
+// The new frame is in slot head: slide the ring
+static void window_advance(Sobel3DEngine& engine) {
+    const int frames = window_frames(engine);
+    engine.head = (engine.head + 1) % frames;
+    if (engine.count < frames) engine.count++;
+}
+
+void sobel3d_push(Sobel3DEngine& engine, const cv::Mat& gray) {
+    StageTimer timer(Stage::Gradient);
+
+    // The slot being overwritten held the oldest frame (curr - R),
+    // which drops out of the window now.
+    // Without mag3d the temporal pass only needs ss
+    if (engine.ocl) {
+        ocl_sobel3d_spatial(*engine.ocl, gray, engine.head);
+    } else {
+        const bool family = family_kernel(engine);
+        sobel3d_spatial(gray, engine.planes[engine.head], engine.pool,
+                        (engine.outputs & OUT_MAG) != 0, engine.grad.border,
+                        family ? cv::Rect() : gate_area(engine.gate, gray.size()), engine.grad.kernel);
+        if (engine.grad.border == BorderMode::Constant)
+            zero_planes(engine.zero, gray.size(), plane_type(engine));
+    }
+    window_advance(engine);
+}
+
+void sobel3d_push(Sobel3DEngine& engine, const cv::UMat& gray) {
+    StageTimer timer(Stage::Gradient);
+    ocl_sobel3d_spatial(*engine.ocl, gray, engine.head);
+    window_advance(engine);
+}
+
+void sobel3d_finish(Sobel3DEngine& engine) {
+    if (engine.ended < sobel3d_radius(engine))
+        engine.ended++;
+}
+
+int sobel3d_radius(const Sobel3DEngine& engine) {
+    return kernel_radius(engine.grad.kernel);
+}
+
+bool sobel3d_ready(const Sobel3DEngine& engine) {
+    if (engine.grad.border == BorderMode::Zero)
+        return engine.count == window_frames(engine) && engine.ended == 0;
+    return engine.count >= 2 && engine.count + engine.ended > sobel3d_radius(engine);
+}
+
+int sobel3d_slot(const Sobel3DEngine& engine, int offset) {
+    // The ring as a clip of count frames, oldest = 0, newest = count - 1.
+    // Until it wraps that is the clip itself; after, curr - R is never
+    // before its first frame, and past the end the border maps around
+    // the newest frame the same in both.
+    const int frames = window_frames(engine);
+    const int curr = engine.count - 1 - sobel3d_radius(engine) + engine.ended;
+    const int f = border_index(curr + offset, engine.count, engine.grad.border);
+    if (f < 0)
+        return -1;
+    return (engine.head - engine.count + f + frames) % frames;
+}
+
+void sobel3d_window(const Sobel3DEngine& engine, int& p, int& c, int& n) {
+    p = sobel3d_slot(engine, -1);
+    c = sobel3d_slot(engine, 0);
+    n = sobel3d_slot(engine, 1);
+}
+
+static const Sobel3DPlanes& window_planes(const Sobel3DEngine& engine, int slot) {
+    return slot < 0 ? engine.zero : engine.planes[slot];
+}
+
+// Tile states of the window, nullptr without a gate
+static const GateMap* window_gate(Sobel3DEngine& engine, const Sobel3DPlanes& p, const Sobel3DPlanes& n) {
+    if (!gate_enabled(engine.gate))
+        return nullptr;
+    StageTimer timer(Stage::Gradient);
+    gate_update(engine.gate, p.ss, n.ss, engine.grad.border, engine.gateMap, engine.pool);
+    return &engine.gateMap;
+}
+
+// The planes of frames curr - R .. curr + R and the tile states
+// (Sobel3: frames[0 .. 2] = prev / curr / next)
+struct Window3D {
+    int radius = 1;
+    const Sobel3DPlanes* frames[SOBEL3D_MAX_WINDOW] = {};
+    const GateMap* gate = nullptr;
+};
+
+static Window3D window_of(Sobel3DEngine& engine) {
+    Window3D w;
+    w.radius = sobel3d_radius(engine);
+    for (int k = -w.radius; k <= w.radius; k++)
+        w.frames[w.radius + k] = &window_planes(engine, sobel3d_slot(engine, k));
+    if (!family_kernel(engine))
+        w.gate = window_gate(engine, *w.frames[0], *w.frames[2]);
+    return w;
+}
+
+// Plane bytes the temporal pass reads per pixel
+static size_t window_pixel_bytes(const Sobel3DEngine& engine) {
+    // Sobel3: dxs / sdy of 3 frames, ss of prev and next
+    return family_kernel(engine) ? 3 * sizeof(float) * window_frames(engine) : 8 * sizeof(short);
+}
+
+// Temporal pass for row y of the window (see combine_row)
+template <typename T>
+static void window_row(const SobelRowKernels& k, const GradientMode& grad, const Window3D& w,
+                       int y, T* gtRow, T* magRow) {
+    if constexpr (std::is_same<T, float>::value) {
+        if (grad.kernel != KernelType::Sobel3) {
+            family_row(k.family3d[static_cast<int>(grad.kernel)], grad.mag, grad.border, w.frames, y, gtRow, magRow);
+            return;
+        }
+    }
+    combine_row(k, grad.mag, grad.border, *w.frames[0], *w.frames[1], *w.frames[2], w.gate, y, gtRow, magRow);
+}
+
+void sobel3d_compute(Sobel3DEngine& engine, cv::Mat& gt, cv::Mat& mag3d) {
+    if (engine.ocl) {
+        ocl_sobel3d_combine(*engine.ocl, engine, gt, mag3d);
+        return;
+    }
+
+    const Window3D w = window_of(engine);
+    if (!family_kernel(engine)) {
+        sobel3d_combine(*w.frames[0], *w.frames[1], *w.frames[2], gt, mag3d, engine.pool, engine.grad, w.gate);
+        return;
+    }
+
+    const cv::Size size = w.frames[w.radius]->ss.size();
+    gt.create(size, CV_32F);
+    mag3d.create(size, CV_32F);
+
+    const SobelRowKernels& k = sobel_kernels();
+    const size_t bytesPerRow = static_cast<size_t>(size.width) * (window_pixel_bytes(engine) + 2 * sizeof(float));
+    parallel_for_rows(engine.pool, 0, size.height, bytesPerRow, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++)
+            window_row(k, engine.grad, w, y, gt.ptr<float>(y), mag3d.ptr<float>(y));
+    });
+}
+
+// ------------------------------------------------------------
+// Fused temporal pass + normalization to 8-bit BGR, T = the
+// gradient row type of engine.grad.precision
+// ------------------------------------------------------------
+template <typename T>
+static void compute_bgr(Sobel3DEngine& engine, NormMode mode, cv::Mat& gtBgr, cv::Mat& magBgr) {
+    const Window3D w = window_of(engine);
+
+    const cv::Size size = w.frames[w.radius]->ss.size();
+    const int cols = size.width;
+    const SobelRowKernels& k = sobel_kernels();
+    const GradientMode& grad = engine.grad;
+    const size_t windowBytes = window_pixel_bytes(engine);
+    const int planeType = cv::DataType<T>::type;
+
+    const bool wantGt  = (engine.outputs & OUT_GT)  != 0;
+    const bool wantMag = (engine.outputs & OUT_MAG) != 0;
+
+    const int cn = engine.outChannels;
+    if (wantGt)  gtBgr.create(size, CV_8UC(cn));
+    if (wantMag) magBgr.create(size, CV_8UC(cn));
+
+    NormRange gtRange, magRange;    // this frame (|gt| and mag3d)
+    std::mutex rangeMtx;
+
+    // Percentile: per-band histograms over the Fixed range, merged
+    // with the ranges
+    const bool wantHist = norm_wants_hist(mode);
+    NormTrack& gtNorm  = engine.gtNorm;
+    NormTrack& magNorm = engine.magNorm;
+
+    auto merge_band = [&](const NormRange& g, const NormRange& m, const uint32_t* gh, const uint32_t* mh) {
+        std::lock_guard<std::mutex> lock(rangeMtx);
+        range_merge(gtRange, g);
+        range_merge(magRange, m);
+        if (wantHist && wantGt)  norm_hist_merge(gtNorm, gh);
+        if (wantHist && wantMag) norm_hist_merge(magNorm, mh);
+    };
+
+    NormRange gtScaleRange, magScaleRange;
+    const bool onePass = (!wantGt  || norm_pick(mode, gtNorm,  gtScaleRange)) &&
+                         (!wantMag || norm_pick(mode, magNorm, magScaleRange));
+
+    if (onePass) {
+        // ----------------------------------------------------
+        // Gradient rows live in a per-thread scratch row (unless
+        // keepPlanes) and are scaled with the range known before
+        // the frame (Fixed / history): no float planes at all
+        // ----------------------------------------------------
+        float gtScale, gtShift, magScale, magShift;
+        range_scale(gtScaleRange,  gtScale,  gtShift);
+        range_scale(magScaleRange, magScale, magShift);
+
+        const bool keep = engine.keepPlanes;
+        if (keep && wantGt)  engine.gt.create(size, planeType);
+        if (keep && wantMag) engine.mag3d.create(size, planeType);
+
+        const size_t bytesPerRow = static_cast<size_t>(cols) * (windowBytes + 2 * cn);
+
+        // Gradient, range and BGR fused: timed as one gradient stage
+        StageTimer timer(Stage::Gradient);
+        parallel_for_rows(engine.pool, 0, size.height, bytesPerRow, [&](int y0, int y1) {
+            static thread_local std::vector<T> scratch;
+            static thread_local std::vector<uint32_t> hists;
+            scratch.resize(2 * static_cast<size_t>(cols));
+            T* gtRow  = wantGt  ? scratch.data() : nullptr;
+            T* magRow = wantMag ? scratch.data() + cols : nullptr;
+
+            uint32_t* gh = nullptr;
+            uint32_t* mh = nullptr;
+            if (wantHist) {
+                hists.assign(2 * NORM_HIST_BINS, 0u);
+                gh = hists.data();
+                mh = hists.data() + NORM_HIST_BINS;
+            }
+
+            NormRange g, m;
+            for (int y = y0; y < y1; y++) {
+                if (keep && wantGt)  gtRow  = engine.gt.ptr<T>(y);
+                if (keep && wantMag) magRow = engine.mag3d.ptr<T>(y);
+                window_row(k, grad, w, y, gtRow, magRow);
+                if (wantGt) {
+                    range_of_row(gtRow, 0, cols, true, g);
+                    if (gh) hist_of_row(gtRow, 0, cols, true, gtNorm.fixed, gh);
+                    row_to_bgr(gtRow, cols, true, gtScale, gtShift, gtBgr.ptr<uint8_t>(y), cn);
+                }
+                if (wantMag) {
+                    range_of_row(magRow, 0, cols, false, m);
+                    if (mh) hist_of_row(magRow, 0, cols, false, magNorm.fixed, mh);
+                    row_to_bgr(magRow, cols, false, magScale, magShift, magBgr.ptr<uint8_t>(y), cn);
+                }
+            }
+            merge_band(g, m, gh, mh);
+        });
+
+        norm_update(mode, engine.normParams, gtRange,  gtNorm);
+        norm_update(mode, engine.normParams, magRange, magNorm);
+    } else {
+        // ----------------------------------------------------
+        // Scale from this frame: gradient + statistics in one
+        // pass, then one pass plane -> BGR for both planes
+        // ----------------------------------------------------
+        if (wantGt)  engine.gt.create(size, planeType);
+        if (wantMag) engine.mag3d.create(size, planeType);
+
+        const size_t bytesPerRow = static_cast<size_t>(cols) * (windowBytes + 2 * sizeof(T));
+
+        // Gradient with the value range folded in
+        {
+            StageTimer timer(Stage::Gradient);
+            parallel_for_rows(engine.pool, 0, size.height, bytesPerRow, [&](int y0, int y1) {
+                static thread_local std::vector<uint32_t> hists;
+                uint32_t* gh = nullptr;
+                uint32_t* mh = nullptr;
+                if (wantHist) {
+                    hists.assign(2 * NORM_HIST_BINS, 0u);
+                    gh = hists.data();
+                    mh = hists.data() + NORM_HIST_BINS;
+                }
+
+                NormRange g, m;
+                for (int y = y0; y < y1; y++) {
+                    T* gtRow  = wantGt  ? engine.gt.ptr<T>(y)    : nullptr;
+                    T* magRow = wantMag ? engine.mag3d.ptr<T>(y) : nullptr;
+                    window_row(k, grad, w, y, gtRow, magRow);
+                    if (wantGt) {
+                        range_of_row(gtRow, 0, cols, true, g);
+                        if (gh) hist_of_row(gtRow, 0, cols, true, gtNorm.fixed, gh);
+                    }
+                    if (wantMag) {
+                        range_of_row(magRow, 0, cols, false, m);
+                        if (mh) hist_of_row(magRow, 0, cols, false, magNorm.fixed, mh);
+                    }
+                }
+                merge_band(g, m, gh, mh);
+            });
+        }
+
+        // MinMax: this frame's range. The first frame of the other
+        // modes: its own statistics, now in the history.
+        norm_update(mode, engine.normParams, gtRange,  gtNorm);
+        norm_update(mode, engine.normParams, magRange, magNorm);
+        if (!norm_pick(mode, gtNorm, gtScaleRange))
+            gtScaleRange = gtRange;
+        if (!norm_pick(mode, magNorm, magScaleRange))
+            magScaleRange = magRange;
+
+        float gtScale, gtShift, magScale, magShift;
+        range_scale(gtScaleRange,  gtScale,  gtShift);
+        range_scale(magScaleRange, magScale, magShift);
+
+        const size_t outBytes = static_cast<size_t>(cols) * 2 * (sizeof(T) + cn);
+
+        StageTimer timer(Stage::ToBgr);
+        parallel_for_rows(engine.pool, 0, size.height, outBytes, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++) {
+                if (wantGt)
+                    row_to_bgr(engine.gt.ptr<T>(y), cols, true, gtScale, gtShift, gtBgr.ptr<uint8_t>(y), cn);
+                if (wantMag)
+                    row_to_bgr(engine.mag3d.ptr<T>(y), cols, false, magScale, magShift, magBgr.ptr<uint8_t>(y), cn);
+            }
+        });
+    }
+}
+
+// Fixed ranges of the 3D outputs (also the Percentile histogram span)
+static void norm_setup(Sobel3DEngine& engine) {
+    engine.gtNorm.fixed.lo  = 0.0f;
+    engine.gtNorm.fixed.hi  = gradient_bound(3, engine.grad.kernel);
+    engine.magNorm.fixed.lo = 0.0f;
+    engine.magNorm.fixed.hi = magnitude_bound(engine.grad.mag, 3, engine.grad.kernel);
+}
+
+void sobel3d_compute_bgr(Sobel3DEngine& engine, NormMode mode, cv::Mat& gtBgr, cv::Mat& magBgr) {
+    norm_setup(engine);
+    if (engine.ocl)
+        ocl_sobel3d_compute_bgr(*engine.ocl, engine, mode, gtBgr, magBgr);
+    else if (int16_outputs(engine))
+        compute_bgr<int16_t>(engine, mode, gtBgr, magBgr);
+    else
+        compute_bgr<float>(engine, mode, gtBgr, magBgr);
+}
+
+void sobel3d_compute_bgr(Sobel3DEngine& engine, NormMode mode, cv::UMat& gtBgr, cv::UMat& magBgr) {
+    norm_setup(engine);
+    ocl_sobel3d_compute_bgr(*engine.ocl, engine, mode, gtBgr, magBgr);
+}
+
+void sobel3d_separable(Sobel3DEngine& engine,
+                       const cv::Mat& prev,
+                       const cv::Mat& curr,
+                       const cv::Mat& next,
+                       cv::Mat& gt,
+                       cv::Mat& mag3d) {
+    sobel3d_reset(engine);
+    sobel3d_push(engine, prev);
+    sobel3d_push(engine, curr);
+    sobel3d_push(engine, next);
+
+    sobel3d_compute(engine, gt, mag3d);
+}
+
+void sobel3d_reference(const cv::Mat& prev,
+                       const cv::Mat& curr,
+                       const cv::Mat& next,
+                       cv::Mat& gt,
+                       cv::Mat& mag3d) {
+    // smooth = [1 2 1], deriv = [-1 0 +1]
+    const int smooth[3] = { 1, 2, 1 };
+    const int deriv [3] = { -1, 0, 1 };
+
+    gt = cv::Mat(curr.size(), CV_32F, cv::Scalar(0));
+    mag3d = cv::Mat(curr.size(), CV_32F, cv::Scalar(0));
+
+    // 3x3x3 convolution (skip x/y borders)
+    for (int y = 1; y < curr.rows - 1; y++) {
+        for (int x = 1; x < curr.cols - 1; x++) {
+
+            float sumX = 0.0f, sumY = 0.0f, sumT = 0.0f;
+
+            for (int dt = -1; dt <= 1; dt++) {
+                const cv::Mat* It = (dt == -1) ? &prev : (dt == 0) ? &curr : &next;
+
+                int wt_s = smooth[dt + 1];
+                int wt_d = deriv [dt + 1];
+
+                for (int dy = -1; dy <= 1; dy++) {
+                    int wy_s = smooth[dy + 1];
+                    int wy_d = deriv [dy + 1];
+
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int wx_s = smooth[dx + 1];
+                        int wx_d = deriv [dx + 1];
+
+                        float p = static_cast<float>(It->at<uchar>(y + dy, x + dx));
+
+                        sumX += p * static_cast<float>(wx_d * wy_s * wt_s); // d/dx, smooth y,t
+                        sumY += p * static_cast<float>(wx_s * wy_d * wt_s); // d/dy, smooth x,t
+                        sumT += p * static_cast<float>(wx_s * wy_s * wt_d); // d/dt, smooth x,y
+                    }
+                }
+            }
+
+            gt.at<float>(y, x) = sumT;
+            mag3d.at<float>(y, x) = std::sqrt(sqr(sumX) + sqr(sumY) + sqr(sumT));
+        }
+    }
+}
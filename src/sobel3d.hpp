@@ -0,0 +1,225 @@
+// sobel3d.hpp
+// ------------------------------------------------------------
+// SOBEL 3D kernels (treat video as volume I(x,y,t)).
+//
+// The 3x3x3 Sobel is separable: each gradient is a 1D derivative
+// [-1 0 +1] along one axis times [1 2 1] smoothing along the other
+// two axes. So instead of 27 taps x 3 weights per pixel we run:
+//
+//   1) a spatial pass per frame (x then y) producing three planes
+//        dxs = Dx Sy   (goes into Gx, still needs St)
+//        sdy = Sx Dy   (goes into Gy, still needs St)
+//        ss  = Sx Sy   (goes into Gt, still needs Dt)
+//   2) a temporal pass combining prev/curr/next planes:
+//        Gx = dxs[p] + 2 dxs[c] + dxs[n]
+//        Gy = sdy[p] + 2 sdy[c] + sdy[n]
+//        Gt = ss[n]  - ss[p]
+//
+// All intermediate sums are exact integers that fit in int16
+// (|ss| <= 4080), so the planes are CV_16S and the output is
+// bit-identical to the naive 27-tap loop (sobel3d_reference).
+// With BorderMode::Zero (engine.grad.border) x/y borders are left at
+// 0, same as the naive loop, and only frames with both neighbours
+// get an output. The other modes pad each input row once (border.hpp)
+// and map the rows / frames outside the clip, so every pixel of
+// every frame is computed, the first and last frame included.
+//
+// The row loops are the SIMD kernels from simd_kernels.hpp.
+// With Precision::Int16 (grad_modes.hpp) the temporal pass stays
+// in integers too: gt/mag3d are CV_16S. The magnitude formula is
+// the engine's MagMode in both precisions.
+//
+// The spatial planes only depend on their own frame, so the engine
+// keeps them in a ring buffer: sliding the window by one frame costs
+// one spatial pass instead of three.
+//
+// The wider kernels of engine.grad.kernel (KernelType) run the same
+// two passes with their weights along x, y and t (kernel_family.hpp):
+// frames t - R .. t + R, so the ring holds 2R + 1 of them and a
+// frame's output comes R frames after its push. Their sums outgrow
+// int16, so the planes are CV_32F and the output is Float32 (the
+// engine ignores Precision::Int16 for them, kernel_fits_int16).
+// BorderMode::Zero leaves an R-pixel x/y border at 0 and skips the
+// first / last R frames.
+//
+// engine.gate restricts the temporal pass to ROI rectangles and to
+// the tiles whose frames differ (motion_gate.hpp); static tiles get
+// Gt = 0 from curr's cached planes.
+//
+// With engine.ocl set (--backend opencl) the same calls run on the
+// OpenCL device instead, ring included, see ocl_backend.hpp. The
+// gate and the device take the 3x3x3 kernel only.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "grad_modes.hpp"
+#include "motion_gate.hpp"
+#include "normalize.hpp"
+#include "outputs.hpp"
+#include "thread_pool.hpp"
+
+struct OclSobel;
+
+// ------------------------------------------------------------
+// Per-frame spatial planes (CV_16S, same size as the frame; CV_32F
+// for the wider kernels)
+// ------------------------------------------------------------
+struct Sobel3DPlanes {
+    cv::Mat dxs;                // Dx then Sy
+    cv::Mat sdy;                // Sx then Dy
+    cv::Mat ss;                 // Sx then Sy
+
+    cv::Mat hs;                 // scratch: horizontal smooth (Sobel3)
+    cv::Mat hd;                 // scratch: horizontal deriv (Sobel3)
+};
+
+// Frames of the widest window (Sobel7: 2 * 3 + 1)
+const int SOBEL3D_MAX_WINDOW = 7;
+
+// ------------------------------------------------------------
+// Engine state: ring buffer of planes for the frames curr - R ..
+// curr + R (R = kernel_radius(grad.kernel), 1 = prev/curr/next)
+// ------------------------------------------------------------
+struct Sobel3DEngine {
+    Sobel3DPlanes planes[SOBEL3D_MAX_WINDOW];   // ring slots, 2R + 1 used (oldest = planes[head] once full)
+    int head  = 0;              // slot the next pushed frame is written to
+    int count = 0;              // frames pushed since reset (saturates at 2R + 1)
+    int ended = 0;              // sobel3d_finish calls: frames the window slid past the last one (<= R)
+    Sobel3DPlanes zero;         // a frame outside a BorderMode::Constant clip
+
+    ThreadPool* pool = nullptr; // optional: split passes into row bands
+
+    // Products to compute (OUT_GT and/or OUT_MAG). Without OUT_MAG the
+    // spatial pass skips dxs/sdy and the temporal pass skips Gx/Gy.
+    // Set before the first push.
+    unsigned outputs = OUT_GT | OUT_MAG;
+
+    // Output precision / magnitude formula of the temporal pass, the
+    // border mode of both passes and the kernel. Set before
+    // sobel3d_reserve.
+    GradientMode grad;
+
+    // Channels of the sobel3d_compute_bgr outputs: 3 = BGR (CV_8UC3),
+    // 1 = gray (CV_8UC1) for single-channel writers.
+    int outChannels = 3;
+
+    // sobel3d_compute_bgr also leaves the signed gt / mag3d planes in
+    // gt / mag3d below (for raw sidecars), in every NormMode.
+    bool keepPlanes = false;
+
+    // Optional: run on the OpenCL device (ocl_init succeeded; Sobel3
+    // only). The planes then live in ocl and the ones above stay
+    // unallocated.
+    OclSobel* ocl = nullptr;
+
+    // Ema weight / percentile of sobel3d_compute_bgr's NormMode
+    NormParams normParams;
+
+    // Optional ROI / motion gate of the temporal pass (CPU, Sobel3 only)
+    MotionGate gate;
+    GateMap gateMap;            // tile states of the last window
+
+    // sobel3d_compute_bgr state
+    cv::Mat gt, mag3d;          // CV_32F / CV_16S planes (NormMode::MinMax or keepPlanes)
+    NormTrack gtNorm;           // |gt| scale history
+    NormTrack magNorm;          // mag3d scale history
+};
+
+// Allocate every plane up front so the first frames do not pay for it.
+void sobel3d_reserve(Sobel3DEngine& engine, const cv::Size& size);
+
+// Forget the window and the scale history (planes stay
+// allocated for reuse, e.g. by the next video of a batch).
+void sobel3d_reset(Sobel3DEngine& engine);
+
+// Forget the window only (a gap in a live stream): the next push
+// starts a new clip, the scale history and gate totals stay.
+void sobel3d_restart(Sobel3DEngine& engine);
+
+// Run the spatial pass on a new frame and slide the window. The
+// frame is gray (CV_8U) or the decoded BGR frame (CV_8UC3, converted
+// row by row inside the pass, same values as cv::COLOR_BGR2GRAY).
+void sobel3d_push(Sobel3DEngine& engine, const cv::Mat& gray);
+
+// engine.ocl only: a frame already on the device (ocl_upload_gray,
+// e.g. from a decoder thread). The pass reading it is queued; it has
+// finished once the next UMat sobel3d_compute_bgr returns.
+void sobel3d_push(Sobel3DEngine& engine, const cv::UMat& gray);
+
+// End of the clip: the window slides one frame past the last push,
+// so the next frame becomes curr (with a border mode other than
+// Zero; no push after). Called up to R times, sobel3d_ready after
+// each, for the last R frames.
+void sobel3d_finish(Sobel3DEngine& engine);
+
+// Frames the window reaches on each side of curr: the kernel radius
+// R, so curr's output follows the push of curr + R.
+int sobel3d_radius(const Sobel3DEngine& engine);
+
+// True once frames curr - R .. curr + R are all available. With a
+// border mode other than Zero the missing ones near the first frame
+// (from R + 1 pushes) and the last (sobel3d_finish) come from the
+// border; a clip needs 2 frames.
+bool sobel3d_ready(const Sobel3DEngine& engine);
+
+// Ring slot of frame curr + offset, |offset| <= R (-1 = a frame of
+// 0 outside a Constant border).
+int sobel3d_slot(const Sobel3DEngine& engine, int offset);
+
+// Ring slots of the window's prev / curr / next (R = 1).
+void sobel3d_window(const Sobel3DEngine& engine, int& p, int& c, int& n);
+
+// Temporal pass over the cached window (requires sobel3d_ready).
+// The output corresponds to curr, in the engine's precision (CV_32F
+// for the wider kernels).
+void sobel3d_compute(Sobel3DEngine& engine, cv::Mat& gt, cv::Mat& mag3d);
+
+// Temporal pass fused with normalization: writes |gt| and mag3d
+// as 8-bit BGR (CV_8UC3, or CV_8UC1 with engine.outChannels = 1)
+// directly, see normalize.hpp. Only the
+// products in engine.outputs are written; the other Mat is untouched.
+void sobel3d_compute_bgr(Sobel3DEngine& engine, NormMode mode, cv::Mat& gtBgr, cv::Mat& magBgr);
+
+// engine.ocl only: the same, BGR outputs left on the device. The
+// device work is finished on return, so any thread can read them back.
+void sobel3d_compute_bgr(Sobel3DEngine& engine, NormMode mode, cv::UMat& gtBgr, cv::UMat& magBgr);
+
+// Spatial pass on one grayscale (CV_8U) or BGR (CV_8UC3) frame.
+// deriv == false: only ss is written (enough for Gt). A non-empty
+// area limits the planes written to that rectangle (gate_area).
+// kernel: the weights, CV_32F planes for all but Sobel3.
+void sobel3d_spatial(const cv::Mat& gray, Sobel3DPlanes& out, ThreadPool* pool = nullptr, bool deriv = true,
+                     BorderMode border = BorderMode::Zero, const cv::Rect& area = cv::Rect(),
+                     KernelType kernel = KernelType::Sobel3);
+
+// Temporal pass (Sobel3): combine the planes of prev/curr/next into
+// gt and mag3d (CV_32F, or CV_16S for Precision::Int16; allocated
+// here, borders written as 0 for BorderMode::Zero). With gate,
+// per tile as in motion_gate.hpp.
+void sobel3d_combine(const Sobel3DPlanes& p,
+                     const Sobel3DPlanes& c,
+                     const Sobel3DPlanes& n,
+                     cv::Mat& gt,
+                     cv::Mat& mag3d,
+                     ThreadPool* pool = nullptr,
+                     GradientMode grad = GradientMode(),
+                     const GateMap* gate = nullptr);
+
+// Full separable 3x3x3 Sobel over prev/curr/next (CV_8U), no
+// caching: resets the engine and pushes all three frames.
+void sobel3d_separable(Sobel3DEngine& engine,
+                       const cv::Mat& prev,
+                       const cv::Mat& curr,
+                       const cv::Mat& next,
+                       cv::Mat& gt,
+                       cv::Mat& mag3d);
+
+// Original 27-tap loop, kept as the reference implementation.
+void sobel3d_reference(const cv::Mat& prev,
+                       const cv::Mat& curr,
+                       const cv::Mat& next,
+                       cv::Mat& gt,
+                       cv::Mat& mag3d);
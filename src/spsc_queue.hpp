@@ -0,0 +1,92 @@
+// spsc_queue.hpp
+// ------------------------------------------------------------
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// One thread pushes, one thread pops. try_push/try_pop never block;
+// push/pop spin, then yield, then sleep while the ring is full/empty,
+// which is the backpressure between pipeline stages.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------
+// Wait helper: cheap spins first, then give the core away
+// ------------------------------------------------------------
+inline void spsc_backoff(int& spins) {
+    if (spins < 64) {
+        spins++;
+    } else if (spins < 128) {
+        spins++;
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two (at least 2).
+    explicit SpscQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        buf.resize(cap);
+        mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // Items currently queued (exact only from the producer/consumer).
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    // Producer side
+    bool try_push(const T& v) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == capacity())
+            return false;
+        buf[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& v) {
+        int spins = 0;
+        while (!try_push(v))
+            spsc_backoff(spins);
+    }
+
+    // Consumer side
+    bool try_pop(T& v) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        v = buf[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void pop(T& v) {
+        int spins = 0;
+        while (!try_pop(v))
+            spsc_backoff(spins);
+    }
+
+private:
+    std::vector<T> buf;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> head{0};    // next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> tail{0};    // next slot to push (producer)
+};
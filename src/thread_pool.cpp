@@ -0,0 +1,203 @@
+// thread_pool.cpp
+// ------------------------------------------------------------
+// Persistent worker pool with work stealing, see thread_pool.hpp.
+// ------------------------------------------------------------
+
+#include "thread_pool.hpp"
+
+#include "tiler.hpp"
+
+#include <algorithm>
+
+static inline uint64_t pack_range(uint32_t front, uint32_t back) {
+    return (static_cast<uint64_t>(back) << 32) | front;
+}
+
+static inline uint32_t range_front(uint64_t r) { return static_cast<uint32_t>(r); }
+static inline uint32_t range_back (uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+
+// Pool whose items this thread is executing right now (nullptr
+// outside any job). A job that calls run() on that same pool again
+// must not try_lock runMtx: its owner may be this very thread.
+static thread_local const ThreadPool* tRunning = nullptr;
+
+// Marks the current thread as inside a job of pool, restoring the
+// previous mark on exit (jobs of one pool may run() another)
+struct RunningMark {
+    const ThreadPool* prev;
+    explicit RunningMark(const ThreadPool* pool) : prev(tRunning) { tRunning = pool; }
+    ~RunningMark() { tRunning = prev; }
+};
+
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    // The calling thread is one of the numThreads (slice 0),
+    // so spawn one fewer
+    for (int i = 1; i < numThreads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cvStart.notify_all();
+
+    for (std::thread& t : workers)
+        t.join();
+}
+
+void ThreadPool::run(int count, const std::function<void(int)>& fn) {
+    if (count <= 0)
+        return;
+
+    // Nothing to share: skip the wake-up round trip. Called from
+    // inside one of our own jobs: run the nested items here (this
+    // thread is already one of the pool's, its job waits on it)
+    if (workers.empty() || count == 1 || tRunning == this) {
+        for (int i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    const int n = size();
+    Job* j = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (freeJobs.empty()) {
+            freeJobs.emplace_back(new Job);
+            freeJobs.back()->slices.reset(new Slice[n]);
+        }
+        j = freeJobs.back().release();
+        freeJobs.pop_back();
+        j->fn = &fn;
+
+        // Deal out contiguous slices (neighbouring bands stay on
+        // the same core unless stolen)
+        for (int t = 0; t < n; t++) {
+            uint32_t b0 = static_cast<uint32_t>(static_cast<long long>(count) * t / n);
+            uint32_t b1 = static_cast<uint32_t>(static_cast<long long>(count) * (t + 1) / n);
+            j->slices[t].range.store(pack_range(b0, b1), std::memory_order_relaxed);
+        }
+
+        open.push_back(j);
+    }
+    cvStart.notify_all();
+
+    // Caller works too
+    drain(*j, 0);
+
+    // Barrier: every worker has left the job before we return,
+    // so fn (owned by the caller) can safely go out of scope.
+    std::unique_lock<std::mutex> lock(mtx);
+    close_job(j);
+    cvDone.wait(lock, [j] { return j->inside == 0; });
+    j->fn = nullptr;
+    freeJobs.emplace_back(j);
+}
+
+// Under mtx: j has no item left to hand out, so no worker may
+// enter it any more (the ones inside finish their items)
+void ThreadPool::close_job(Job* j) {
+    auto it = std::find(open.begin(), open.end(), j);
+    if (it != open.end())
+        open.erase(it);
+}
+
+bool ThreadPool::pop_front(Job& j, int self, int& item) {
+    std::atomic<uint64_t>& r = j.slices[self].range;
+    uint64_t cur = r.load(std::memory_order_acquire);
+
+    while (range_front(cur) < range_back(cur)) {
+        uint64_t next = pack_range(range_front(cur) + 1, range_back(cur));
+        if (r.compare_exchange_weak(cur, next, std::memory_order_acq_rel)) {
+            item = static_cast<int>(range_front(cur));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal_back(Job& j, int victim, int& item) {
+    std::atomic<uint64_t>& r = j.slices[victim].range;
+    uint64_t cur = r.load(std::memory_order_acquire);
+
+    while (range_front(cur) < range_back(cur)) {
+        uint64_t next = pack_range(range_front(cur), range_back(cur) - 1);
+        if (r.compare_exchange_weak(cur, next, std::memory_order_acq_rel)) {
+            item = static_cast<int>(range_back(cur) - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(Job& j, int self) {
+    const int n = size();
+    int item;
+    RunningMark mark(this);
+
+    // Own slice first
+    while (pop_front(j, self, item))
+        (*j.fn)(item);
+
+    // Then steal. Slices only ever shrink, so one pass that finds
+    // every victim empty means the job is fully handed out.
+    for (int k = 1; k < n; k++) {
+        int victim = (self + k) % n;
+        while (steal_back(j, victim, item))
+            (*j.fn)(item);
+    }
+}
+
+void ThreadPool::worker_loop(int self) {
+    while (true) {
+        Job* j = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cvStart.wait(lock, [&] { return stopping || !open.empty(); });
+            if (stopping)
+                return;
+            // Spread the workers over the open jobs; slices of the
+            // ones that went elsewhere are stolen by those that came
+            j = open[self % open.size()];
+            j->inside++;
+        }
+
+        drain(*j, self);
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            close_job(j);
+            if (--j->inside == 0)
+                cvDone.notify_all();
+        }
+    }
+}
+
+void parallel_for_rows(ThreadPool* pool, int y0, int y1, size_t bytesPerRow,
+                       const std::function<void(int, int)>& body) {
+    const int rows = y1 - y0;
+    if (rows <= 0)
+        return;
+
+    if (pool == nullptr || pool->size() == 1) {
+        body(y0, y1);
+        return;
+    }
+
+    const int band  = band_rows_for(rows, bytesPerRow, pool->size());
+    const int bands = (rows + band - 1) / band;
+
+    pool->run(bands, [&](int i) {
+        int b0 = y0 + i * band;
+        int b1 = std::min(b0 + band, y1);
+        body(b0, b1);
+    });
+}
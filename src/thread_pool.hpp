@@ -0,0 +1,92 @@
+// thread_pool.hpp
+// ------------------------------------------------------------
+// Persistent worker pool (portable, std::thread).
+//
+// Workers are spawned once and sleep between jobs. Each call to
+// run() hands out work items [0, count) to the workers AND the
+// calling thread, then blocks until every item is done (barrier).
+// That replaces the per-frame CreateThread / WaitForMultipleObjects /
+// CloseHandle round trip of the archived Windows versions.
+//
+// Scheduling: every thread starts with a contiguous slice of the
+// items and pops from its front. A thread that runs dry steals
+// from the back of another thread's slice, so a preempted core
+// only delays the items it is actually running.
+//
+// Several threads may call run() at once (the streams of a
+// --streams batch): each call is a job of its own, with its own
+// slices and count of threads inside it, and the workers spread
+// over all open jobs (a worker that runs one dry moves on to the
+// next), so concurrent streams share the workers instead of one
+// owning them. A job may call run() on its own pool too: it sees
+// the thread is already inside one of this pool's jobs and runs
+// the nested items serially on that thread.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // numThreads counts the calling thread too (0 = one per core).
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that execute work (workers + caller).
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Run job(i) for every i in [0, count), return when all finished.
+    void run(int count, const std::function<void(int)>& job);
+
+private:
+    // Per-thread slice [front, back) packed in one word so the owner
+    // (front++) and thieves (back--) race on a single CAS.
+    struct alignas(64) Slice {
+        std::atomic<uint64_t> range{0};
+    };
+
+    // One run() call. Recycled through freeJobs, so a run() only
+    // allocates when more callers are active than ever before.
+    struct Job {
+        const std::function<void(int)>* fn = nullptr;
+        std::unique_ptr<Slice[]> slices;    // one per thread, caller = 0
+        int inside = 0;                     // workers in drain(), under mtx
+    };
+
+    void worker_loop(int self);
+    void drain(Job& j, int self);
+    bool pop_front(Job& j, int self, int& item);
+    bool steal_back(Job& j, int victim, int& item);
+    void close_job(Job* j);
+
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable cvStart;    // job published / stopping
+    std::condition_variable cvDone;     // a job's last worker left it
+
+    std::vector<Job*> open;             // jobs with items not handed out yet
+    std::vector<std::unique_ptr<Job>> freeJobs;
+    bool stopping = false;
+};
+
+// ------------------------------------------------------------
+// Split rows [y0, y1) into cache-sized bands (see tiler.hpp) and
+// run body(bandY0, bandY1) on the pool. bytesPerRow is the memory
+// one row of the kernel touches. pool == nullptr runs the whole
+// range on the calling thread.
+// ------------------------------------------------------------
+void parallel_for_rows(ThreadPool* pool, int y0, int y1, size_t bytesPerRow,
+                       const std::function<void(int, int)>& body);
@@ -0,0 +1,68 @@
+// tiler.cpp
+// ------------------------------------------------------------
+// Row-band sizing, see tiler.hpp.
+// ------------------------------------------------------------
+
+#include "tiler.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static size_t query_l2_bytes() {
+#ifdef _WIN32
+    DWORD len = 0;
+    GetLogicalProcessorInformation(nullptr, &len);
+    if (len == 0)
+        return 0;
+
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(
+        len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!GetLogicalProcessorInformation(info.data(), &len))
+        return 0;
+
+    for (const auto& i : info) {
+        if (i.Relationship == RelationCache && i.Cache.Level == 2)
+            return i.Cache.Size;
+    }
+    return 0;
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+    long v = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return v > 0 ? static_cast<size_t>(v) : 0;
+#else
+    return 0;
+#endif
+}
+
+size_t cache_l2_bytes() {
+    static const size_t l2 = [] {
+        size_t v = query_l2_bytes();
+        return v > 0 ? v : size_t(256) * 1024;
+    }();
+    return l2;
+}
+
+int band_rows_for(int rows, size_t bytesPerRow, int threads) {
+    if (rows <= 0)
+        return 1;
+
+    // Keep a band's working set in half of L2 (the rest is for the
+    // halo rows and whatever the other hyper-thread is doing)
+    size_t budget = cache_l2_bytes() / 2;
+    int byCache = bytesPerRow > 0 ? static_cast<int>(std::max<size_t>(1, budget / bytesPerRow)) : rows;
+
+    // At least ~4 bands per thread so stealing has something to take
+    int byBalance = std::max(1, rows / (std::max(threads, 1) * 4));
+
+    // Tiny bands cost more in scheduling than they gain
+    const int minRows = 4;
+
+    int band = std::max(std::min(byCache, byBalance), minRows);
+    return std::min(band, rows);
+}
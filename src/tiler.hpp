@@ -0,0 +1,20 @@
+// tiler.hpp
+// ------------------------------------------------------------
+// Row-band tiling for the Sobel kernels.
+//
+// Instead of 4 fixed quadrants, a frame is cut into full-width row
+// bands small enough that one band's working set fits in about
+// half of L2, and numerous enough (several per thread) that the
+// pool's work stealing can rebalance when one core is preempted.
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+
+// L2 cache size per core in bytes (queried once, 256 KiB fallback).
+size_t cache_l2_bytes();
+
+// Rows per band for a range of `rows` rows, where each row touches
+// `bytesPerRow` bytes (inputs + outputs), split over `threads`.
+int band_rows_for(int rows, size_t bytesPerRow, int threads);
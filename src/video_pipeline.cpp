@@ -0,0 +1,810 @@
+// video_pipeline.cpp
+// ------------------------------------------------------------
+// 2D and 3D (sequential and pipelined) Sobel video drivers,
+// see video_pipeline.hpp.
+// ------------------------------------------------------------
+
+#include "video_pipeline.hpp"
+
+#include "frame_arena.hpp"
+#include "metrics.hpp"
+#include "ocl_backend.hpp"
+#include "outputs.hpp"
+#include "pyramid.hpp"
+#include "sobel2d.hpp"
+#include "spsc_queue.hpp"
+
+#include <deque>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------
+// Timed stage helpers (see metrics.hpp)
+// ------------------------------------------------------------
+static void read_frame(cv::VideoCapture& cap, cv::Mat& frame) {
+    StageTimer timer(Stage::Decode);
+    cap >> frame;
+}
+
+// Decode one frame at pyramid level (0 = as decoded). The full frame
+// lands in decoded, frame gets the decimated copy; empty at the end.
+static void read_level(cv::VideoCapture& cap, int level, ThreadPool* pool, cv::Mat& decoded, cv::Mat& frame) {
+    if (level == 0) {
+        read_frame(cap, frame);
+        return;
+    }
+    read_frame(cap, decoded);
+    if (decoded.empty())
+        frame.release();
+    else
+        pyramid_down(decoded, level, frame, pool);
+}
+
+static void to_gray(const cv::Mat& bgr, cv::Mat& gray) {
+    StageTimer timer(Stage::CvtColor);
+    cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+}
+
+static void write_frame(cv::VideoWriter* writer, const cv::Mat& frame) {
+    if (!writer)
+        return;
+    StageTimer timer(Stage::Encode);
+    writer->write(frame);
+}
+
+// ------------------------------------------------------------
+// 2D (per frame)
+// ------------------------------------------------------------
+// Scale of one 2D output plane across the frames of a run
+struct PlaneNorm {
+    NormMode mode;
+    const NormParams* params;
+    NormTrack track;
+};
+
+static void scale_plane(ThreadPool* pool, const cv::Mat& plane, bool useAbs, PlaneNorm& norm,
+                        cv::Mat& bgr, int cn) {
+    plane_to_bgr_norm(pool, plane, useAbs, norm.mode, *norm.params, norm.track, bgr, cn);
+}
+
+static void write_plane(ThreadPool* pool, cv::VideoWriter* writer,
+                        const cv::Mat& plane, bool useAbs, PlaneNorm& norm, cv::Mat& bgr, int cn) {
+    if (!writer)
+        return;
+    scale_plane(pool, plane, useAbs, norm, bgr, cn);
+    write_frame(writer, bgr);
+}
+
+static void write_raw(NpyWriter* raw, const cv::Mat& plane) {
+    if (raw)
+        npy_write(*raw, plane);
+}
+
+// State of one 2D run: buffers and the scale history of each plane
+struct Sobel2DRun {
+    const Sobel2DWriters* writers;
+    ThreadPool* pool;
+    GradientMode grad;
+    OclSobel* ocl;
+    cv::Size frameSize;
+
+    FrameArena arena;
+    PlaneNorm normGx, normGy, normMag, normTheta;
+    unsigned outputs = 0;       // planes to compute
+    unsigned packed = 0;
+    cv::Mat grayBgr, planeBgr, packGray[3], packedBgr;
+};
+
+static void sobel2d_run_setup(Sobel2DRun& run, const cv::Size& frameSize, const Sobel2DWriters& writers,
+                              ThreadPool* pool, GradientMode grad, OclSobel* ocl,
+                              NormMode norm, const NormParams& normParams) {
+    run.writers = &writers;
+    run.pool = pool;
+    run.grad = grad;
+    run.ocl = ocl;
+    run.frameSize = frameSize;
+    frame_arena_init(run.arena, frameSize, grad.precision);
+
+    // Fixed ranges from the kernel weights (grad_modes.hpp)
+    run.normGx = { norm, &normParams, NormTrack() };
+    run.normGx.track.fixed.lo = 0.0f;
+    run.normGx.track.fixed.hi = gradient_bound(2, grad.kernel);
+    run.normGy  = run.normGx;
+    run.normMag = run.normGx;
+    run.normMag.track.fixed.hi = magnitude_bound(grad.mag, 2, grad.kernel);
+    run.normTheta = run.normGx;
+    theta_bounds(grad.theta, run.normTheta.track.fixed.lo, run.normTheta.track.fixed.hi);
+
+    unsigned outputs = 0;
+    if (writers.gx)    outputs |= OUT_GX;
+    if (writers.gy)    outputs |= OUT_GY;
+    if (writers.mag)   outputs |= OUT_MAG;
+    if (writers.theta) outputs |= OUT_THETA;
+    outputs |= writers.packedOutputs;
+    if (writers.gxRaw)    outputs |= OUT_GX;
+    if (writers.gyRaw)    outputs |= OUT_GY;
+    if (writers.magRaw)   outputs |= OUT_MAG;
+    if (writers.thetaRaw) outputs |= OUT_THETA;
+    run.outputs = outputs;
+
+    run.packed = writers.packed ? writers.packedOutputs : 0;
+}
+
+// Every product of one decoded frame, written
+static void sobel2d_run_frame(Sobel2DRun& run, const cv::Mat& frame) {
+    const Sobel2DWriters& writers = *run.writers;
+    ThreadPool* pool = run.pool;
+    FrameArena& arena = run.arena;
+
+    write_frame(writers.original, frame);
+
+    // The kernels take the BGR frame itself (gray per row, on the
+    // fly); only the gray product needs the full gray plane
+    if (writers.gray)
+        to_gray(frame, arena.gray);
+
+    if (writers.gray && writers.channels == 1) {
+        write_frame(writers.gray, arena.gray);
+    } else if (writers.gray) {
+        {
+            StageTimer timer(Stage::ToBgr);
+            cv::cvtColor(arena.gray, run.grayBgr, cv::COLOR_GRAY2BGR);
+        }
+        write_frame(writers.gray, run.grayBgr);
+    }
+
+    if (run.outputs != 0) {
+        if (run.ocl)
+            ocl_sobel2d(*run.ocl, frame, arena.gx, arena.gy, arena.mag, arena.theta, run.outputs);
+        else
+            sobel2d(pool, frame, arena.gx, arena.gy, arena.mag, arena.theta, run.outputs, run.grad);
+
+        write_plane(pool, writers.gx,    arena.gx,    true,  run.normGx,    run.planeBgr, writers.channels);
+        write_plane(pool, writers.gy,    arena.gy,    true,  run.normGy,    run.planeBgr, writers.channels);
+        write_plane(pool, writers.mag,   arena.mag,   false, run.normMag,   run.planeBgr, writers.channels);
+        write_plane(pool, writers.theta, arena.theta, false, run.normTheta, run.planeBgr, writers.channels);
+
+        const unsigned packed = run.packed;
+        if (packed != 0) {
+            if (packed & OUT_GX)  scale_plane(pool, arena.gx,  true,  run.normGx,  run.packGray[0], 1);
+            if (packed & OUT_GY)  scale_plane(pool, arena.gy,  true,  run.normGy,  run.packGray[1], 1);
+            if (packed & OUT_MAG) scale_plane(pool, arena.mag, false, run.normMag, run.packGray[2], 1);
+            pack_channels(pool,
+                          (packed & OUT_GX)  ? &run.packGray[0] : nullptr,
+                          (packed & OUT_GY)  ? &run.packGray[1] : nullptr,
+                          (packed & OUT_MAG) ? &run.packGray[2] : nullptr,
+                          run.frameSize, run.packedBgr);
+            write_frame(writers.packed, run.packedBgr);
+        }
+
+        write_raw(writers.gxRaw,    arena.gx);
+        write_raw(writers.gyRaw,    arena.gy);
+        write_raw(writers.magRaw,   arena.mag);
+        write_raw(writers.thetaRaw, arena.theta);
+    }
+
+    metrics_frame();
+}
+
+long long run_sobel2d_sequential(cv::VideoCapture& cap,
+                                 const cv::Size& frameSize,
+                                 const Sobel2DWriters& writers,
+                                 ThreadPool* pool,
+                                 GradientMode grad,
+                                 OclSobel* ocl,
+                                 NormMode norm,
+                                 const NormParams& normParams,
+                                 int level) {
+    Sobel2DRun run;
+    sobel2d_run_setup(run, frameSize, writers, pool, grad, ocl, norm, normParams);
+
+    cv::Mat& frame = run.arena.bgr[0];
+    cv::Mat decoded;
+    long long frameCountWritten = 0;
+
+    while (true) {
+        read_level(cap, level, pool, decoded, frame);
+        if (frame.empty())
+            break;
+
+        sobel2d_run_frame(run, frame);
+        frameCountWritten++;
+    }
+
+    return frameCountWritten;
+}
+
+// Engine products follow the writers that are actually present
+static unsigned engine_outputs(const Sobel3DWriters& writers) {
+    unsigned outputs = 0;
+    if (writers.gt)     outputs |= OUT_GT;
+    if (writers.mag3d)  outputs |= OUT_MAG;
+    if (writers.gtRaw)  outputs |= OUT_GT;
+    if (writers.magRaw) outputs |= OUT_MAG;
+    if (writers.packed) outputs |= writers.packedOutputs;
+    return outputs;
+}
+
+// Engine settings of a 3D run. Packed outputs are scaled to gray
+// planes first and interleaved afterwards (pack_3d).
+static void engine_setup(Sobel3DEngine& engine, const Sobel3DWriters& writers) {
+    engine.outputs     = engine_outputs(writers);
+    engine.outChannels = writers.packed ? 1 : writers.channels;
+    engine.keepPlanes  = writers.gtRaw != nullptr || writers.magRaw != nullptr;
+}
+
+// After sobel3d_compute_bgr: raw sidecars from the engine's planes
+static void write_raw_3d(const Sobel3DWriters& writers, const Sobel3DEngine& engine) {
+    write_raw(writers.gtRaw,  engine.gt);
+    write_raw(writers.magRaw, engine.mag3d);
+}
+
+static void pack_3d(ThreadPool* pool, const Sobel3DWriters& writers, const cv::Size& size,
+                    const cv::Mat& gtGray, const cv::Mat& magGray, cv::Mat& packed) {
+    pack_channels(pool,
+                  (writers.packedOutputs & OUT_GT)  ? &gtGray  : nullptr,
+                  (writers.packedOutputs & OUT_MAG) ? &magGray : nullptr,
+                  nullptr, size, packed);
+}
+
+// Temporal pass for the window's curr and the writes of its outputs
+static void output_3d(const Sobel3DWriters& writers, Sobel3DEngine& engine, NormMode mode,
+                      const cv::Size& frameSize, const cv::Mat& original,
+                      cv::Mat& gtBgr, cv::Mat& magBgr, cv::Mat& packedBgr) {
+    if (engine.outputs != 0)
+        sobel3d_compute_bgr(engine, mode, gtBgr, magBgr);
+
+    write_frame(writers.original, original);
+    write_frame(writers.gt,       gtBgr);
+    write_frame(writers.mag3d,    magBgr);
+    if (writers.packed) {
+        pack_3d(engine.pool, writers, frameSize, gtBgr, magBgr, packedBgr);
+        write_frame(writers.packed, packedBgr);
+    }
+    write_raw_3d(writers, engine);
+    metrics_frame();
+}
+
+// With a border mode the first and the last frame get outputs too
+static bool border_frames(const Sobel3DEngine& engine) {
+    return engine.grad.border != BorderMode::Zero;
+}
+
+// ------------------------------------------------------------
+// Sequential (original single-thread loop)
+// ------------------------------------------------------------
+long long run_sobel3d_sequential(cv::VideoCapture& cap,
+                                 const cv::Size& frameSize,
+                                 const Sobel3DWriters& writers,
+                                 Sobel3DEngine& engine,
+                                 NormMode mode,
+                                 int level,
+                                 const ClipRange& range) {
+    engine_setup(engine, writers);
+    const bool compute = engine.outputs != 0;
+    const bool edges = border_frames(engine);
+
+    // Frames past range.frames read as the end of the clip
+    long long framesLeft = range.frames;
+    cv::Mat decoded, packedBgr;
+    auto read_next = [&](cv::Mat& frame) {
+        if (framesLeft == 0) {
+            frame.release();
+            return;
+        }
+        read_level(cap, level, engine.pool, decoded, frame);
+        if (framesLeft > 0)
+            framesLeft--;
+    };
+
+    // A frame's output follows the push of curr + R: frames curr ..
+    // curr + R wait, frame f decoded into bgr[f % (R + 1)]
+    const int radius = sobel3d_radius(engine);
+    const int buffers = radius + 1;
+    FrameArena arena;
+    frame_arena_init(arena, frameSize, Precision::Float32, buffers);
+    arena_plane(arena.gtBgr,  frameSize, CV_8UC(engine.outChannels));
+    arena_plane(arena.magBgr, frameSize, CV_8UC(engine.outChannels));
+    sobel3d_reserve(engine, frameSize);
+    sobel3d_reset(engine);
+
+    long long framesRead = 0;
+    long long frameCountWritten = 0;
+
+    // Separable Sobel over the cached window for frame curr (index
+    // among the frames read), normalized and expanded to BGR in the
+    // same pass, then written. Overlap frames of a segment get none.
+    auto output = [&](long long curr) {
+        if (curr < range.lead || (range.owned >= 0 && curr >= range.lead + range.owned))
+            return;
+        output_3d(writers, engine, mode, frameSize, arena.bgr[curr % buffers],
+                  arena.gtBgr, arena.magBgr, packedBgr);
+        frameCountWritten++;
+    };
+
+    while (true) {
+        // Lands in the buffer of curr - 1, written last iteration
+        cv::Mat& frame = arena.bgr[framesRead % buffers];
+        read_next(frame);
+        if (frame.empty())
+            break;  // end cleanly -> MP4 finalizes
+
+        // Each frame's spatial pass runs once, when it enters the
+        // window, straight from the BGR frame
+        if (compute)
+            sobel3d_push(engine, frame);
+        framesRead++;
+
+        // Zero: the first R frames have no output (border modes: from
+        // the border)
+        const long long curr = framesRead - 1 - radius;
+        if (curr >= (edges ? 0 : radius))
+            output(curr);
+    }
+
+    if (framesRead < (edges ? 2 : 2 * radius + 1))
+        return -1;
+
+    // Border modes: the last R frames, next ones from the border
+    if (edges) {
+        for (int e = 1; e <= radius; e++) {
+            if (compute)
+                sobel3d_finish(engine);
+            const long long curr = framesRead - 1 - radius + e;
+            if (curr >= 0)
+                output(curr);
+        }
+    }
+
+    return frameCountWritten;
+}
+
+// ------------------------------------------------------------
+// Mapped volume: the window is three views, no decode stage
+// ------------------------------------------------------------
+// Frame t of the volume at pyramid level (a view of the mapping for
+// level 0, else decimated into buf)
+static cv::Mat volume_frame(const NpyVolume& volume, int t, int level, ThreadPool* pool, cv::Mat& buf) {
+    if (level == 0)
+        return npy_frame(volume, t);
+    pyramid_down(npy_frame(volume, t), level, buf, pool);
+    return buf;
+}
+
+long long run_sobel3d_volume(const NpyVolume& volume,
+                             const Sobel3DWriters& writers,
+                             Sobel3DEngine& engine,
+                             NormMode mode,
+                             int level) {
+    const bool edges = border_frames(engine);
+    const int radius = sobel3d_radius(engine);
+    if (volume.frames < (edges ? 2 : 2 * radius + 1) || volume.type != CV_8U)
+        return -1;
+
+    const cv::Size frameSize = pyramid_size(volume.size, level);
+    engine_setup(engine, writers);
+    const bool compute = engine.outputs != 0;
+
+    cv::Mat gtBgr, magBgr, packedBgr, currBgr, levelBuf;
+    arena_plane(gtBgr,  frameSize, CV_8UC(engine.outChannels));
+    arena_plane(magBgr, frameSize, CV_8UC(engine.outChannels));
+    sobel3d_reserve(engine, frameSize);
+    sobel3d_reset(engine);
+
+    long long frameCountWritten = 0;
+    int pushed = 0;             // frames pushed, plus finish calls past the end
+
+    for (int curr = edges ? 0 : radius; curr < volume.frames - (edges ? 0 : radius); curr++) {
+        // Slide the window onto curr: frames up to curr + R
+        for (; compute && pushed <= curr + radius; pushed++) {
+            if (pushed < volume.frames)
+                sobel3d_push(engine, volume_frame(volume, pushed, level, engine.pool, levelBuf));
+            else
+                sobel3d_finish(engine);
+        }
+
+        if (writers.original) {
+            StageTimer timer(Stage::CvtColor);
+            cv::cvtColor(volume_frame(volume, curr, level, engine.pool, levelBuf), currBgr, cv::COLOR_GRAY2BGR);
+        }
+        output_3d(writers, engine, mode, frameSize, currBgr, gtBgr, magBgr, packedBgr);
+        frameCountWritten++;
+    }
+
+    return frameCountWritten;
+}
+
+// ------------------------------------------------------------
+// Pipelined
+// ------------------------------------------------------------
+
+// One queue entry. buf points into a preallocated buffer vector.
+struct FramePacket {
+    cv::Mat* buf = nullptr;     // nullptr = end of stream
+    bool write = false;         // encoder: write it, or only recycle it
+    // OpenCL: the buffer's device twin. Frames: gray uploaded by the
+    // decoder; outputs: BGR the encoder reads back into buf first
+    cv::UMat* dev = nullptr;
+};
+
+// Encoder stage: write packets in order, hand buffers back
+// (writer == nullptr: the product is not requested, only recycle).
+// readBack: the packets are outputs left on the device.
+static void encoder_loop(cv::VideoWriter* writer,
+                         SpscQueue<FramePacket>* in,
+                         SpscQueue<FramePacket>* freeOut,
+                         bool readBack) {
+    FramePacket pk;
+    while (true) {
+        in->pop(pk);
+        if (pk.buf == nullptr)
+            break;
+        if (pk.write && readBack) {
+            // On this thread's queue, next to the compute thread's
+            StageTimer timer(Stage::ToBgr);
+            pk.dev->copyTo(*pk.buf);
+        }
+        if (pk.write)
+            write_frame(writer, *pk.buf);
+        freeOut->push(pk);
+    }
+}
+
+long long run_sobel3d_pipelined(cv::VideoCapture& cap,
+                                const cv::Size& frameSize,
+                                const Sobel3DWriters& writers,
+                                Sobel3DEngine& engine,
+                                NormMode mode,
+                                int queueDepth,
+                                int level) {
+    if (queueDepth < 1)
+        queueDepth = 1;
+
+    engine_setup(engine, writers);
+    sobel3d_reserve(engine, frameSize);
+
+    // Packed frames travel through the gt queue / encoder
+    cv::VideoWriter* gtWriter = writers.packed ? writers.packed : writers.gt;
+    const bool compute = engine.outputs != 0;
+    const bool wantGt  = gtWriter != nullptr;
+    const bool wantMag = writers.packed == nullptr && writers.mag3d != nullptr;
+    const int gtType   = writers.packed ? CV_8UC3 : CV_8UC(engine.outChannels);
+
+    // --------------------------------------------------------
+    // Buffers: decoded frames are held by the decode queue, the
+    // compute stage (R), the original-frame encoder queue, and
+    // one in the hands of the decoder and of the encoder.
+    // --------------------------------------------------------
+    const int radius     = sobel3d_radius(engine);
+    const int numFrames  = 2 * queueDepth + 2 + radius;
+    const int numOutputs = queueDepth + 2;
+
+    // Unselected products get no buffers, queue traffic or encoder
+    std::vector<cv::Mat> frames(numFrames), gtBufs(wantGt ? numOutputs : 0), magBufs(wantMag ? numOutputs : 0);
+    for (cv::Mat& m : frames)  arena_plane(m, frameSize, CV_8UC3);
+    for (cv::Mat& m : gtBufs)  arena_plane(m, frameSize, gtType);
+    for (cv::Mat& m : magBufs) arena_plane(m, frameSize, CV_8UC(engine.outChannels));
+
+    cv::Mat gtGray, magGray;    // --pack: scaled planes before interleaving
+    cv::Mat unusedBgr;          // output of a product that only has a raw sidecar
+
+    // OpenCL: the decoder uploads, the encoders read back (on their
+    // own queues, ocl_backend.hpp); --pack interleaves on the host
+    const bool upload = compute && engine.ocl != nullptr;
+    const bool readBack = upload && writers.packed == nullptr;
+    std::vector<cv::UMat> frameDev(upload ? numFrames : 0);
+    std::vector<cv::UMat> gtDev(readBack ? gtBufs.size() : 0), magDev(readBack ? magBufs.size() : 0);
+    for (cv::UMat& u : frameDev) u.create(frameSize, CV_8U);
+    for (cv::UMat& u : gtDev)    u.create(frameSize, gtType);
+    for (cv::UMat& u : magDev)   u.create(frameSize, CV_8UC(engine.outChannels));
+    cv::UMat unusedDev;
+
+    // Stage queues
+    SpscQueue<FramePacket> decodedQ(queueDepth), originalQ(queueDepth);
+    SpscQueue<FramePacket> gtQ(queueDepth), magQ(queueDepth);
+
+    // Free lists (big enough to hold every buffer, never block)
+    SpscQueue<FramePacket> freeFrames(numFrames), freeGt(numOutputs), freeMag(numOutputs);
+    for (size_t i = 0; i < frames.size(); i++)
+        freeFrames.push(FramePacket{ &frames[i], false, upload ? &frameDev[i] : nullptr });
+    for (size_t i = 0; i < gtBufs.size(); i++)
+        freeGt.push(FramePacket{ &gtBufs[i], false, readBack ? &gtDev[i] : nullptr });
+    for (size_t i = 0; i < magBufs.size(); i++)
+        freeMag.push(FramePacket{ &magBufs[i], false, readBack ? &magDev[i] : nullptr });
+
+    // Queue depths for the metrics exporter (removed before the
+    // queues go out of scope)
+    const int gauges[4] = {
+        metrics_add_gauge("decoded",  [&] { return static_cast<double>(decodedQ.size()); }),
+        metrics_add_gauge("original", [&] { return static_cast<double>(originalQ.size()); }),
+        metrics_add_gauge("gt",       [&] { return static_cast<double>(gtQ.size()); }),
+        metrics_add_gauge("mag3d",    [&] { return static_cast<double>(magQ.size()); })
+    };
+
+    // --------------------------------------------------------
+    // Decoder thread
+    // --------------------------------------------------------
+    std::thread decoder([&] {
+        FramePacket pk;
+        cv::Mat decoded, grayHost;
+        while (true) {
+            freeFrames.pop(pk);
+            read_level(cap, level, engine.pool, decoded, *pk.buf);
+            if (pk.buf->empty())
+                break;
+            if (pk.dev) {
+                StageTimer timer(Stage::CvtColor);
+                ocl_upload_gray(*pk.buf, grayHost, *pk.dev);
+            }
+            decodedQ.push(pk);
+        }
+        decodedQ.push(FramePacket{});
+    });
+
+    // --------------------------------------------------------
+    // Encoder threads (one per writer)
+    // --------------------------------------------------------
+    // The original-frame encoder always runs: it recycles the frame
+    // buffers even when nothing is written.
+    std::thread encOriginal(encoder_loop, writers.original, &originalQ, &freeFrames, false);
+    std::thread encGt, encMag;
+    if (wantGt)  encGt  = std::thread(encoder_loop, gtWriter,      &gtQ,  &freeGt,  readBack);
+    if (wantMag) encMag = std::thread(encoder_loop, writers.mag3d, &magQ, &freeMag, readBack);
+
+    // --------------------------------------------------------
+    // Compute stage (this thread). The BGR frame is only needed
+    // for the original writer once its spatial planes are cached, but
+    // its output follows the push of the frame R later, and only
+    // then do we know whether it gets one (BorderMode::Zero: not
+    // within R of either end), so hold R back.
+    // --------------------------------------------------------
+    sobel3d_reset(engine);
+    const bool edges = border_frames(engine);
+
+    std::deque<FramePacket> held;   // frames pushed after the window's curr, oldest first
+    long long framesSeen = 0;
+    long long frameCountWritten = 0;
+
+    // Output for the window's curr == frame
+    auto output = [&](FramePacket& frame) {
+        FramePacket gtPk, magPk;
+        if (wantGt)  freeGt.pop(gtPk);
+        if (wantMag) freeMag.pop(magPk);
+
+        if (compute && writers.packed) {
+            sobel3d_compute_bgr(engine, mode, gtGray, magGray);
+            pack_3d(engine.pool, writers, frameSize, gtGray, magGray, *gtPk.buf);
+        } else if (readBack) {
+            sobel3d_compute_bgr(engine, mode,
+                                wantGt  ? *gtPk.dev  : unusedDev,
+                                wantMag ? *magPk.dev : unusedDev);
+        } else if (compute) {
+            sobel3d_compute_bgr(engine, mode,
+                                wantGt  ? *gtPk.buf  : unusedBgr,
+                                wantMag ? *magPk.buf : unusedBgr);
+        }
+        write_raw_3d(writers, engine);
+
+        gtPk.write = true;
+        magPk.write = true;
+        if (wantGt)  gtQ.push(gtPk);
+        if (wantMag) magQ.push(magPk);
+
+        frame.write = true;
+        originalQ.push(frame);
+        frameCountWritten++;
+        metrics_frame();
+    };
+
+    // No output of its own, just recycle it (once the pass reading
+    // its upload is done)
+    auto recycle = [&](FramePacket& frame) {
+        if (frame.dev)
+            cv::ocl::finish();
+        frame.write = false;
+        originalQ.push(frame);
+    };
+
+    while (true) {
+        FramePacket pk;
+        decodedQ.pop(pk);
+        if (pk.buf == nullptr)
+            break;
+
+        // Without gt/mag the window only counts frames
+        if (pk.dev)
+            sobel3d_push(engine, *pk.dev);
+        else if (compute)
+            sobel3d_push(engine, *pk.buf);
+        framesSeen++;
+        held.push_back(pk);
+        if (static_cast<int>(held.size()) <= radius)
+            continue;
+
+        // curr = framesSeen - 1 - R; Zero: the first R frames get none
+        FramePacket curr = held.front();
+        held.pop_front();
+        if (framesSeen - 1 - radius >= (edges ? 0 : radius))
+            output(curr);
+        else
+            recycle(curr);
+    }
+
+    // Last R frames: outputs from the border, or none
+    if (edges && framesSeen >= 2) {
+        for (int e = 1; e <= radius; e++) {
+            if (compute)
+                sobel3d_finish(engine);
+            if (framesSeen - 1 - radius + e < 0)
+                continue;       // clip shorter than R + 1: curr not reached yet
+            output(held.front());
+            held.pop_front();
+        }
+    }
+    for (FramePacket& pk : held)
+        recycle(pk);
+
+    // --------------------------------------------------------
+    // Drain + join
+    // --------------------------------------------------------
+    originalQ.push(FramePacket{});
+    if (wantGt)  gtQ.push(FramePacket{});
+    if (wantMag) magQ.push(FramePacket{});
+
+    decoder.join();
+    encOriginal.join();
+    if (wantGt)  encGt.join();
+    if (wantMag) encMag.join();
+
+    for (int id : gauges)
+        metrics_remove_gauge(id);
+
+    return frameCountWritten > 0 ? frameCountWritten : -1;
+}
+
+// ------------------------------------------------------------
+// Live (camera / stream)
+// ------------------------------------------------------------
+// Outputs of f are written: latency, CSV row
+static void live_done(LiveStats& stats, std::ostream* log, long long index, const LiveFrame& f, bool gap) {
+    const int64_t now = metrics_now_ns();
+    if (metrics_enabled())
+        metrics_record(Stage::Latency, f.captureNs, now - f.captureNs);
+
+    const double ms = static_cast<double>(now - f.captureNs) * 1e-6;
+    stats.latencyCount++;
+    stats.latencySumMs += ms;
+    if (ms > stats.latencyMaxMs)
+        stats.latencyMaxMs = ms;
+    if (gap)
+        stats.gaps++;
+
+    if (log)
+        *log << index << "," << f.seq << "," << ms << "," << (gap ? 1 : 0) << "\n";
+}
+
+static void live_log_header(std::ostream* log) {
+    if (log)
+        *log << "frame,seq,latency_ms,gap\n";
+}
+
+long long run_sobel2d_live(LiveSource& src,
+                           const cv::Size& frameSize,
+                           const Sobel2DWriters& writers,
+                           ThreadPool* pool,
+                           GradientMode grad,
+                           OclSobel* ocl,
+                           NormMode norm,
+                           const NormParams& normParams,
+                           std::ostream* log,
+                           LiveStats& stats) {
+    Sobel2DRun run;
+    sobel2d_run_setup(run, frameSize, writers, pool, grad, ocl, norm, normParams);
+    live_log_header(log);
+
+    const int gauge = metrics_add_gauge("live", [&] { return static_cast<double>(live_pending(src)); });
+
+    long long frameCountWritten = 0;
+    long long lastSeq = -1;
+    while (true) {
+        LiveFrame f = live_pop(src);
+        if (!f.buf)
+            break;
+
+        sobel2d_run_frame(run, *f.buf);
+        live_done(stats, log, frameCountWritten, f, lastSeq >= 0 && f.seq != lastSeq + 1);
+        frameCountWritten++;
+        lastSeq = f.seq;
+        live_release(src, f);
+    }
+
+    metrics_remove_gauge(gauge);
+    return frameCountWritten;
+}
+
+long long run_sobel3d_live(LiveSource& src,
+                           const cv::Size& frameSize,
+                           const Sobel3DWriters& writers,
+                           Sobel3DEngine& engine,
+                           NormMode mode,
+                           std::ostream* log,
+                           LiveStats& stats) {
+    engine_setup(engine, writers);
+    const bool compute = engine.outputs != 0;
+    const bool edges = border_frames(engine);
+
+    cv::Mat gtBgr, magBgr, packedBgr;
+    arena_plane(gtBgr,  frameSize, CV_8UC(engine.outChannels));
+    arena_plane(magBgr, frameSize, CV_8UC(engine.outChannels));
+    sobel3d_reserve(engine, frameSize);
+    sobel3d_reset(engine);
+    live_log_header(log);
+
+    const int gauge = metrics_add_gauge("live", [&] { return static_cast<double>(live_pending(src)); });
+
+    // held: the frames pushed after the window's curr, curr once the
+    // frame R later is pushed (like the pipelined driver)
+    const int radius = sobel3d_radius(engine);
+    std::deque<LiveFrame> held;
+    int inWindow = 0;           // frames pushed since the window (re)started
+    bool gap = false;           // the next output is the first after a drop
+    long long frameCountWritten = 0;
+
+    auto output = [&](const LiveFrame& f) {
+        output_3d(writers, engine, mode, frameSize, *f.buf, gtBgr, magBgr, packedBgr);
+        live_done(stats, log, frameCountWritten, f, gap);
+        frameCountWritten++;
+        gap = false;
+    };
+
+    // The clip ends at held.back(): outputs of the held frames with a
+    // border mode
+    auto close_window = [&] {
+        if (edges && inWindow >= 2) {
+            for (int e = 1; e <= radius; e++) {
+                if (compute)
+                    sobel3d_finish(engine);
+                if (inWindow - 1 - radius + e < 0)
+                    continue;
+                output(held.front());
+                live_release(src, held.front());
+                held.pop_front();
+            }
+        }
+        for (LiveFrame& h : held)
+            live_release(src, h);
+        held.clear();
+        inWindow = 0;
+    };
+
+    while (true) {
+        LiveFrame f = live_pop(src);
+        if (!f.buf)
+            break;
+
+        // Frames were dropped between held and f: a window across the
+        // gap would take Gt over frames that are not neighbours
+        if (!held.empty() && f.seq != held.back().seq + 1) {
+            close_window();
+            sobel3d_restart(engine);
+            gap = true;
+        }
+
+        if (compute)
+            sobel3d_push(engine, *f.buf);
+        inWindow++;
+        held.push_back(f);
+        if (static_cast<int>(held.size()) <= radius)
+            continue;
+
+        if (inWindow - 1 - radius >= (edges ? 0 : radius))
+            output(held.front());
+        live_release(src, held.front());
+        held.pop_front();
+    }
+    if (!held.empty())
+        close_window();
+
+    metrics_remove_gauge(gauge);
+    return frameCountWritten;
+}
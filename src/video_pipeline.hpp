@@ -0,0 +1,178 @@
+// video_pipeline.hpp
+// ------------------------------------------------------------
+// Video drivers: decode -> compute -> encode.
+//
+// 2D: per-frame Sobel (Gx, Gy, magnitude, theta), sequential, the
+// kernels run on the pool.
+//
+// Sequential: everything on the calling thread (the original loop).
+//
+// Live (camera / stream, live_source.hpp): the capture thread drops
+// the oldest waiting frame under load; the drivers below compute and
+// encode on the calling thread and log each output's latency.
+//
+// Pipelined: a decoder thread, the compute stage on the calling
+// thread (its kernels still use engine.pool), and one encoder thread
+// per writer, connected by bounded SPSC queues. Frame buffers are
+// preallocated and circulate through "free" queues back to their
+// producer, so a slow stage stalls the others (backpressure) instead
+// of growing memory. Total time approaches the slowest stage.
+// With the OpenCL backend the decoder also uploads each frame and
+// the encoders read the outputs back, each on its own queue, so the
+// transfers overlap the compute thread's kernels (ocl_backend.hpp).
+// ------------------------------------------------------------
+
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "live_source.hpp"
+#include "normalize.hpp"
+#include "npy_volume.hpp"
+#include "sobel3d.hpp"
+#include "thread_pool.hpp"
+
+// Output writers of one 2D run (nullptr = product not requested)
+struct Sobel2DWriters {
+    cv::VideoWriter* original;  // frame, as decoded
+    cv::VideoWriter* gray;      // grayscale input as BGR
+    cv::VideoWriter* gx;        // |Gx| as BGR
+    cv::VideoWriter* gy;        // |Gy| as BGR
+    cv::VideoWriter* mag;       // magnitude as BGR
+    cv::VideoWriter* theta;     // direction as BGR
+
+    // 1: gray..theta writers are single-channel (isColor = false) and
+    // get CV_8UC1 frames, no GRAY2BGR expansion. original stays BGR.
+    int channels = 3;
+
+    // --pack channels: one stream for the products in packedOutputs,
+    // B = |Gx|, G = |Gy|, R = magnitude, each on its own range (their
+    // own writers above are then nullptr)
+    cv::VideoWriter* packed = nullptr;
+    unsigned packedOutputs = 0;
+
+    // Lossless sidecars of the unscaled planes (nullptr = none)
+    NpyWriter* gxRaw    = nullptr;
+    NpyWriter* gyRaw    = nullptr;
+    NpyWriter* magRaw   = nullptr;
+    NpyWriter* thetaRaw = nullptr;
+};
+
+// Returns the number of frames written. Every output plane is
+// scaled on its own (abs for Gx/Gy); NormMode::MinMax = the frame's
+// own range, as in the archived 2D versions.
+//
+// level (every driver): pyramid level of pyramid.hpp. Each decoded
+// frame is decimated once and everything after, the original output
+// included, runs at that size; frameSize is the decimated size.
+long long run_sobel2d_sequential(cv::VideoCapture& cap,
+                                 const cv::Size& frameSize,
+                                 const Sobel2DWriters& writers,
+                                 ThreadPool* pool,
+                                 GradientMode grad = GradientMode(),
+                                 OclSobel* ocl = nullptr,
+                                 NormMode norm = NormMode::MinMax,
+                                 const NormParams& normParams = NormParams(),
+                                 int level = 0);
+
+// Output writers of one 3D run. A nullptr writer drops that product:
+// gt/mag3d are then not computed (engine.outputs is set from these).
+struct Sobel3DWriters {
+    cv::VideoWriter* original;  // curr frame, as decoded
+    cv::VideoWriter* gt;        // |Gt| as BGR
+    cv::VideoWriter* mag3d;     // 3D magnitude as BGR
+
+    int channels = 3;           // 1: gt / mag3d writers are single-channel
+
+    // --pack channels: B = |Gt|, G = mag3d, R = 0 for the products in
+    // packedOutputs (gt / mag3d are then nullptr)
+    cv::VideoWriter* packed = nullptr;
+    unsigned packedOutputs = 0;
+
+    // Lossless sidecars of the signed, unscaled planes
+    NpyWriter* gtRaw  = nullptr;
+    NpyWriter* magRaw = nullptr;
+};
+
+// Part of a clip for a segment run (segments.hpp): at most frames
+// are read (-1 = to the end). The first lead frames read and those
+// after the next owned (-1 = to the end) are overlap frames of the
+// neighbouring segments, read only as the window of this segment's
+// first / last outputs.
+struct ClipRange {
+    long long frames = -1;
+    long long lead = 0;
+    long long owned = -1;
+};
+
+// Both return the number of frames written, or -1 if the input has
+// fewer than 2R + 1 frames (R = sobel3d_radius: 1 for Sobel3). With
+// engine.grad.border other than Zero the first and the last R frames
+// get an output too (one output per input frame, 2 frames are
+// enough). cap must be positioned at the first frame.
+long long run_sobel3d_sequential(cv::VideoCapture& cap,
+                                 const cv::Size& frameSize,
+                                 const Sobel3DWriters& writers,
+                                 Sobel3DEngine& engine,
+                                 NormMode mode,
+                                 int level = 0,
+                                 const ClipRange& range = ClipRange());
+
+// 3D over a mapped CV_8U frame volume (npy_map): the window's frames
+// are views into the mapping, nothing is decoded or copied before
+// the spatial pass. original gets the gray frame as BGR. Returns the
+// frames written, -1 if the volume has fewer than 2R + 1 frames (2
+// with a border mode).
+long long run_sobel3d_volume(const NpyVolume& volume,
+                             const Sobel3DWriters& writers,
+                             Sobel3DEngine& engine,
+                             NormMode mode,
+                             int level = 0);
+
+// queueDepth: frames allowed in flight between two stages
+long long run_sobel3d_pipelined(cv::VideoCapture& cap,
+                                const cv::Size& frameSize,
+                                const Sobel3DWriters& writers,
+                                Sobel3DEngine& engine,
+                                NormMode mode,
+                                int queueDepth = 4,
+                                int level = 0);
+
+// ------------------------------------------------------------
+// Live drivers
+// ------------------------------------------------------------
+struct LiveStats {
+    long long gaps = 0;             // outputs right after dropped frames
+    long long latencyCount = 0;
+    double latencySumMs = 0.0;      // capture -> outputs written
+    double latencyMaxMs = 0.0;
+};
+
+// log (optional) gets one CSV row per output frame:
+//   frame,seq,latency_ms,gap
+// seq is the capture index, so the rows missing in seq are the
+// dropped frames; gap = 1 marks the first output after a drop.
+long long run_sobel2d_live(LiveSource& src,
+                           const cv::Size& frameSize,
+                           const Sobel2DWriters& writers,
+                           ThreadPool* pool,
+                           GradientMode grad,
+                           OclSobel* ocl,
+                           NormMode norm,
+                           const NormParams& normParams,
+                           std::ostream* log,
+                           LiveStats& stats);
+
+// 3D: the window's frames must be consecutive captures. At a drop the
+// window is closed like the end of a clip (with a border mode the R
+// frames before the gap get their outputs, the next ones from the
+// border) and restarts at the frame after it (sobel3d_restart); the
+// first output of the new window is flagged. Returns the frames
+// written.
+long long run_sobel3d_live(LiveSource& src,
+                           const cv::Size& frameSize,
+                           const Sobel3DWriters& writers,
+                           Sobel3DEngine& engine,
+                           NormMode mode,
+                           std::ostream* log,
+                           LiveStats& stats);